@@ -0,0 +1,178 @@
+// ===== FILE: host/bf_test.c =====
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "button_fsm.h"
+
+// bf_test: button_fsm sequences (press / long / toggle / group), exit 1 on the first failure.
+//
+// pure C, no boot: each case feeds bf_step / bf_poll a timed sequence and checks the ops
+// returned, the toggle A/B state after the step, and the bf_exec emit order
+
+#define LONG_MS 500
+
+#define OPS_NONE 0u
+#define DA  BF_OP_DOWN_A
+#define DB  BF_OP_DOWN_B
+#define UA  BF_OP_UP_A
+#define UB  BF_OP_UP_B
+#define TA  BF_OP_TRIG_A
+#define TB  BF_OP_TRIG_B
+#define GRP BF_OP_GROUP
+#define ARM BF_OP_ARM_LONG
+#define DIS BF_OP_DISARM_LONG
+
+typedef struct {
+    char     ev;     // 'd' down, 'u' up, 'p' bf_poll, 0 = end
+    int      ms;     // time since the start of the case
+    uint16_t ops;    // expected ops
+    int      ab;     // expected toggle state after the step (-1 = don't care)
+} bf_t_step_t;
+
+typedef struct {
+    const char *name;
+    uint8_t mode;
+    uint8_t momentary;
+    bf_t_step_t steps[10];
+} bf_t_case_t;
+
+static const bf_t_case_t s_cases[] = {
+    { "press", BF_MODE_SHORT, 0, {
+        { 'd',   0, OPS_NONE, -1 },
+        { 'd',   2, OPS_NONE, -1 },     // bounce while down
+        { 'u',  80, TA,       -1 },
+        { 'u',  82, OPS_NONE, -1 },     // bounce while up
+        { 'u', 900, OPS_NONE, -1 },
+    } },
+    { "press_mom", BF_MODE_SHORT, 1, {
+        { 'd',   0, DA,      -1 },
+        { 'u',  80, UA | TA, -1 },
+    } },
+    { "long_short", BF_MODE_SHORT_LONG, 0, {
+        { 'd',   0, ARM,      -1 },
+        { 'p', 100, OPS_NONE, -1 },
+        { 'u', 120, DIS | TA, -1 },
+        { 'p', 700, OPS_NONE, -1 },     // disarmed: nothing due after release
+    } },
+    { "long_hold", BF_MODE_SHORT_LONG, 0, {
+        { 'd',   0,           ARM,      -1 },
+        { 'p', LONG_MS - 1,   OPS_NONE, -1 },
+        { 'p', LONG_MS,       TB,       -1 },
+        { 'p', LONG_MS + 100, OPS_NONE, -1 },   // fires once
+        { 'u', LONG_MS + 300, OPS_NONE, -1 },
+    } },
+    { "long_late_up", BF_MODE_SHORT_LONG, 0, {
+        { 'd',   0,           ARM, -1 },
+        { 'u', LONG_MS + 20,  TB,  -1 },        // timer not run yet: release still counts as long
+    } },
+    { "long_mom", BF_MODE_SHORT_LONG, 1, {
+        { 'd',   0,           DA | ARM,      -1 },
+        { 'p', LONG_MS,       TB,            -1 },
+        { 'u', LONG_MS + 200, UA,            -1 },
+        { 'd', 1000,          DA | ARM,      -1 },
+        { 'u', 1100,          DIS | UA | TA, -1 },
+    } },
+    { "toggle", BF_MODE_TOGGLE, 0, {
+        { 'd',   0, TA,       1 },
+        { 'u',  80, OPS_NONE, 1 },
+        { 'd', 300, TB,       0 },
+        { 'p', 1000, OPS_NONE, 0 },     // no long in toggle mode
+        { 'u', 1100, OPS_NONE, 0 },
+        { 'd', 1300, TA,       1 },
+    } },
+    { "toggle_mom", BF_MODE_TOGGLE, 1, {
+        { 'd',   0, DA | TA, 1 },
+        { 'u',  80, UA,      1 },       // UP uses the list latched at press
+        { 'd', 300, DB | TB, 0 },
+        { 'u', 380, UB,      0 },
+    } },
+    { "group", BF_MODE_GROUP, 0, {
+        { 'd',   0, TA | GRP, -1 },
+        { 'u',  80, OPS_NONE, -1 },
+        { 'd', 300, TA | GRP, -1 },     // no toggle: A again
+        { 'u', 380, OPS_NONE, -1 },
+    } },
+    { "group_mom", BF_MODE_GROUP, 1, {
+        { 'd',   0, DA | TA | GRP, -1 },
+        { 'u',  80, UA,            -1 },
+    } },
+    { "bad_mode", BF_MODE_COUNT, 0, {  // out of range -> short
+        { 'd',   0, OPS_NONE, -1 },
+        { 'u',  80, TA,       -1 },
+    } },
+};
+#define N_CASES ((int)(sizeof(s_cases) / sizeof(s_cases[0])))
+
+static int check(const char *name, int ok, const char *what)
+{
+    printf("%-14s %s  %s\n", name, ok ? "ok  " : "FAIL", what);
+    return ok ? 0 : 1;
+}
+
+static int run_case(const bf_t_case_t *c)
+{
+    const bf_cfg_t cfg = { .mode = c->mode, .momentary = c->momentary, .long_us = LONG_MS * 1000u };
+    bf_state_t st;
+    uint8_t ab = 0;
+    bf_reset(&st);
+
+    int i;
+    for (i = 0; c->steps[i].ev; i++) {
+        const bf_t_step_t *s = &c->steps[i];
+        const int64_t t_us = (int64_t)s->ms * 1000;
+        uint16_t ops;
+
+        if (s->ev == 'p') ops = bf_poll(&st, &cfg, &ab, t_us);
+        else ops = bf_step(&st, &cfg, &ab, s->ev == 'd' ? BF_EV_DOWN : BF_EV_UP, t_us);
+
+        if (ops != s->ops || (s->ab >= 0 && ab != s->ab)) {
+            char what[80];
+            snprintf(what, sizeof(what), "step %d (%c @%d ms): ops %03X want %03X, ab %u",
+                     i, s->ev, s->ms, ops, s->ops, ab);
+            return check(c->name, 0, what);
+        }
+    }
+
+    char what[80];
+    snprintf(what, sizeof(what), "%d steps", i);
+    return check(c->name, 1, what);
+}
+
+// bf_exec: DOWN, UP, TRIG order, caller side ops not emitted
+static char s_emit[16];
+static int s_emit_n;
+
+static void emit(void *ctx, int list_b, int emit_event)
+{
+    (void)ctx;
+    static const char ev[] = { 'T', 'D', 'U' };
+    if (s_emit_n + 2 >= (int)sizeof(s_emit)) return;
+    s_emit[s_emit_n++] = ev[emit_event];
+    s_emit[s_emit_n++] = list_b ? 'B' : 'A';
+    s_emit[s_emit_n] = 0;
+}
+
+static int run_exec(const char *name)
+{
+    s_emit_n = 0;
+    s_emit[0] = 0;
+    bf_exec(TB | TA | UB | DA | GRP | ARM | DIS, emit, NULL);
+
+    char what[80];
+    snprintf(what, sizeof(what), "emits %s (want DAUBTATB)", s_emit);
+    return check(name, s_emit_n == 8 && !memcmp(s_emit, "DAUBTATB", 8), what);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+
+    int fail = 0;
+    for (int i = 0; i < N_CASES; i++) fail |= run_case(&s_cases[i]);
+    fail |= run_exec("exec_order");
+    return fail;
+}
@@ -0,0 +1,167 @@
+// ===== FILE: host/cfg_bench.c =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "esp_heap_caps.h"
+#include "config_store.h"
+#include "cfg_pack.h"
+
+// v5 vs v6 on-flash config: size and pack/unpack time (cfg_pack.c, no boot needed).
+//
+//   cfg_bench [-n ITERS]      default 200 iterations per measurement
+//
+// configs:
+//   default   1 bank, nothing mapped (fresh device)
+//   typical   20 banks, 2 short + 1 long action per button, short names
+//   fullmax   MAX_BANKS, every slot of every list used (same shape as {"gen":"fullmax"})
+//
+// size = header + payload, i.e. the SPIFFS file. times are wall clock per call on this host,
+// only the v5 / v6 ratio carries over to the ESP32.
+
+#define HDR_SIZE 12   // cfg_hdr_v4_t
+
+static double now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e6 + (double)ts.tv_nsec / 1e3;
+}
+
+static uint32_t s_rng = 1;
+
+static uint8_t rnd(uint8_t lo, uint8_t hi)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return (uint8_t)(lo + (s_rng >> 8) % (uint32_t)(hi - lo + 1u));
+}
+
+static void cfg_defaults(foot_config_t *c)
+{
+    memset(c, 0, sizeof(*c));
+    c->bank_count = 1;
+    for (int b = 0; b < MAX_BANKS; b++) {
+        snprintf(c->bank_name[b], NAME_LEN, "Bank %d", b + 1);
+        for (int k = 0; k < NUM_BTNS; k++) {
+            snprintf(c->switch_name[b][k], NAME_LEN, "SW %d", k + 1);
+            for (int i = 0; i < MAX_ACTIONS; i++) {
+                c->map[b][k].short_actions[i].ch = 1;
+                c->map[b][k].long_actions[i].ch = 1;
+            }
+        }
+    }
+}
+
+static void fill_list(action_t *list, int n)
+{
+    for (int i = 0; i < n; i++) {
+        action_t *a = &list[i];
+        a->type = (i & 1) ? ACT_PC : ACT_CC;
+        a->ch = rnd(1, 16);
+        a->a = rnd(0, 127);
+        a->b = rnd(0, 127);
+        a->c = 0;   // sanitize_cfg clears c for button actions
+    }
+}
+
+static void make_cfg(foot_config_t *c, int banks, int n_short, int n_long)
+{
+    cfg_defaults(c);
+    c->bank_count = (uint8_t)banks;
+    for (int b = 0; b < banks; b++) {
+        for (int k = 0; k < NUM_BTNS; k++) {
+            btn_map_t *m = &c->map[b][k];
+            m->press_mode = (btn_press_mode_t)((b + k) % 4);
+            m->cc_behavior = (cc_behavior_t)((b + k * 3) % 3);
+            fill_list(m->short_actions, n_short);
+            fill_list(m->long_actions, n_long);
+        }
+    }
+}
+
+typedef esp_err_t (*pack_fn)(const foot_config_t *, uint8_t **, size_t *);
+typedef esp_err_t (*unpack_fn)(foot_config_t *, const uint8_t *, size_t);
+
+typedef struct {
+    size_t bytes;
+    double pack_us;
+    double unpack_us;
+    int ok;
+} res_t;
+
+static res_t run(const foot_config_t *c, pack_fn pack, unpack_fn unpack, foot_config_t *tmp, int iters)
+{
+    res_t r = {0};
+    uint8_t *buf = NULL;
+    size_t len = 0;
+
+    double t0 = now_us();
+    for (int i = 0; i < iters; i++) {
+        if (buf) heap_caps_free(buf);
+        buf = NULL;
+        if (pack(c, &buf, &len) != ESP_OK) return r;
+    }
+    r.pack_us = (now_us() - t0) / iters;
+    r.bytes = HDR_SIZE + len;
+
+    // unpack into defaults, like config_store does
+    cfg_defaults(tmp);
+    t0 = now_us();
+    for (int i = 0; i < iters; i++) {
+        if (unpack(tmp, buf, len) != ESP_OK) { heap_caps_free(buf); return r; }
+    }
+    r.unpack_us = (now_us() - t0) / iters;
+    r.ok = (memcmp(tmp, c, sizeof(*c)) == 0);
+
+    heap_caps_free(buf);
+    return r;
+}
+
+int main(int argc, char **argv)
+{
+    int iters = 200;
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) iters = atoi(argv[++i]);
+        else {
+            fprintf(stderr, "usage: %s [-n iters]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (iters < 1) iters = 1;
+
+    foot_config_t *c = malloc(sizeof(*c));
+    foot_config_t *tmp = malloc(sizeof(*tmp));
+    if (!c || !tmp) return 1;
+
+    static const struct { const char *name; int banks, ns, nl; } cases[] = {
+        { "default", 1,         0,           0 },
+        { "typical", 20,        2,           1 },
+        { "fullmax", MAX_BANKS, MAX_ACTIONS, MAX_ACTIONS },
+    };
+
+    printf("%-8s %10s %10s %6s  %10s %10s  %10s %10s\n",
+           "config", "v5 bytes", "v6 bytes", "ratio", "v5 pack", "v6 pack", "v5 unpack", "v6 unpack");
+
+    int rc = 0;
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++) {
+        make_cfg(c, cases[i].banks, cases[i].ns, cases[i].nl);
+
+        res_t r5 = run(c, cfg_v5_pack, cfg_v5_unpack, tmp, iters);
+        res_t r6 = run(c, cfg_v6_pack, cfg_v6_unpack, tmp, iters);
+        if (!r5.ok || !r6.ok) {
+            fprintf(stderr, "%s: round trip mismatch (v5 %s, v6 %s)\n",
+                    cases[i].name, r5.ok ? "ok" : "BAD", r6.ok ? "ok" : "BAD");
+            rc = 1;
+        }
+
+        printf("%-8s %10zu %10zu %5.1fx  %8.1fus %8.1fus  %8.1fus %8.1fus\n",
+               cases[i].name, r5.bytes, r6.bytes, (double)r5.bytes / (double)r6.bytes,
+               r5.pack_us, r6.pack_us, r5.unpack_us, r6.unpack_us);
+    }
+
+    free(c);
+    free(tmp);
+    return rc;
+}
@@ -0,0 +1,327 @@
+// ===== FILE: host/cfg_store_bench.c =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/wait.h>
+
+#include "esp_log.h"
+#include "config_store.h"
+#include "cfg_log.h"
+#include "host.h"
+
+// Settings + config persistence: SPIFFS file / journal + NVS vs the raw config log
+// (cfg_log.c), as flash traffic per operation.
+//
+//   cfg_store_bench [-n N] [-v]    N repetitions per operation (default 40), -v firmware logs
+//
+// every backend gets a scratch dir with a typical config (20 banks, 2 short + 1 long action
+// per button) written by a first boot, then a second boot (own process, like a power cycle)
+// measures:
+//   boot        config_store_init + page-in of the current bank's working set, and
+//               CFG_ST_FLUSH_MS more so a settings write started by boot would show up.
+//               read-only: a warm boot programs nothing. the log mount scans whole
+//               sectors, so cfglog reads more than spiffs+nvs here (slower boot)
+//   btn save    config_store_set_btn_json + the save task (journal / compaction / log append)
+//   cur bank    config_store_set_current_bank (footswitch bank change)
+//   brightness  config_store_set_led_brightness
+//   ab led      config_store_set_ab_led_sel (the whole 800 byte table)
+// the last three are write-behind settings: the changes of a burst share one write, the row
+// is the traffic until CFG_ST_FLUSH_MS after the burst divided by N.
+//
+// traffic sources:
+//   log     cfg_log_get_stats, exact (mount scan, GC copies and erases included)
+//   NVS     host_nvs_get_stats: 32 byte entries, blobs as index + header + data entries
+//   SPIFFS  stdio on "spiffs/" files (linked with --wrap): bytes moved, programs rounded up
+//           to 256 byte pages, + 1 page per open / close-after-write / rename / unlink for
+//           the object index. lower bound, SPIFFS GC page moves are not modelled
+// the SPIFFS and NVS mount scans are not counted (both stay mounted with the log too).
+//
+// time = NOR estimate: 20 MB/s read, 0.4 ms per 256 byte program, 45 ms per 4 KB erase.
+// erases are amortized (programmed bytes / 4 KB) for every backend so short runs compare.
+// on the device the "cfg saved ... in N us" / "config + settings loaded in N us" logs give
+// the real numbers.
+
+#define BENCH_BANKS   20
+#define SETTLE_US     ((CFG_ST_FLUSH_MS + 500) * 1000)   // write-behind settings reach flash
+#define PAGE          256u
+#define SECTOR        4096u
+
+// -------------------- SPIFFS traffic (stdio wrappers) --------------------
+#define TRACK_MAX 8
+
+static struct { FILE *f; bool wr; uint32_t wbytes; } s_trk[TRACK_MAX];
+static uint32_t s_fs_rd = 0, s_fs_pr = 0;
+
+FILE  *__real_fopen(const char *path, const char *mode);
+int    __real_fclose(FILE *f);
+size_t __real_fread(void *p, size_t sz, size_t n, FILE *f);
+size_t __real___fread_chk(void *p, size_t plen, size_t sz, size_t n, FILE *f);
+size_t __real_fwrite(const void *p, size_t sz, size_t n, FILE *f);
+int    __real_rename(const char *a, const char *b);
+int    __real_unlink(const char *path);
+
+static bool is_fs(const char *path)
+{
+    return path && !strncmp(path, CFG_SPIFFS_BASE "/", sizeof(CFG_SPIFFS_BASE));
+}
+
+static int trk_find(FILE *f)
+{
+    for (int i = 0; i < TRACK_MAX; i++) if (f && s_trk[i].f == f) return i;
+    return -1;
+}
+
+static uint32_t pages(uint32_t n) { return (n + PAGE - 1) / PAGE * PAGE; }
+
+FILE *__wrap_fopen(const char *path, const char *mode)
+{
+    FILE *f = __real_fopen(path, mode);
+    if (!f || !is_fs(path)) return f;
+
+    s_fs_rd += PAGE;   // object index header lookup
+    int i = trk_find(NULL);
+    for (int k = 0; k < TRACK_MAX && i < 0; k++) if (!s_trk[k].f) i = k;
+    if (i >= 0) {
+        s_trk[i].f = f;
+        s_trk[i].wr = (strchr(mode, 'w') || strchr(mode, 'a') || strchr(mode, '+'));
+        s_trk[i].wbytes = 0;
+    }
+    return f;
+}
+
+int __wrap_fclose(FILE *f)
+{
+    int i = trk_find(f);
+    if (i >= 0) {
+        if (s_trk[i].wr && s_trk[i].wbytes) s_fs_pr += pages(s_trk[i].wbytes) + PAGE;
+        s_trk[i].f = NULL;
+    }
+    return __real_fclose(f);
+}
+
+size_t __wrap_fread(void *p, size_t sz, size_t n, FILE *f)
+{
+    size_t r = __real_fread(p, sz, n, f);
+    if (trk_find(f) >= 0) s_fs_rd += (uint32_t)(r * sz);
+    return r;
+}
+
+size_t __wrap___fread_chk(void *p, size_t plen, size_t sz, size_t n, FILE *f)
+{
+    size_t r = __real___fread_chk(p, plen, sz, n, f);
+    if (trk_find(f) >= 0) s_fs_rd += (uint32_t)(r * sz);
+    return r;
+}
+
+size_t __wrap_fwrite(const void *p, size_t sz, size_t n, FILE *f)
+{
+    size_t r = __real_fwrite(p, sz, n, f);
+    int i = trk_find(f);
+    if (i >= 0) s_trk[i].wbytes += (uint32_t)(r * sz);
+    return r;
+}
+
+int __wrap_rename(const char *a, const char *b)
+{
+    if (is_fs(a)) s_fs_pr += PAGE;
+    return __real_rename(a, b);
+}
+
+int __wrap_unlink(const char *path)
+{
+    int r = __real_unlink(path);
+    if (r == 0 && is_fs(path)) s_fs_pr += PAGE;
+    return r;
+}
+
+// -------------------- counters --------------------
+typedef struct { double rd, pr; } traffic_t;
+
+static traffic_t traffic_now(void)
+{
+    uint32_t nr = 0, np = 0;
+    host_nvs_get_stats(&nr, &np);
+    cfg_log_stats_t ls;
+    cfg_log_get_stats(&ls);
+    return (traffic_t){ (double)nr + s_fs_rd + ls.read_bytes, (double)np + s_fs_pr + ls.prog_bytes };
+}
+
+static void row(const char *backend, const char *op, traffic_t a, traffic_t b, int n)
+{
+    double rd = (b.rd - a.rd) / n, pr = (b.pr - a.pr) / n;
+    double er = pr / SECTOR;
+    double ms = rd / 20e6 * 1e3 + pr / PAGE * 0.4 + er * 45.0;
+    printf("%-10s %-10s %10.0f %10.0f %8.3f %9.2fms\n", backend, op, rd, pr, er, ms);
+}
+
+// -------------------- phases (one boot per process) --------------------
+static void btn_json(char *out, size_t n, int i, int ns, int nl)
+{
+    char sh[160] = "", lo[80] = "";
+    for (int k = 0; k < ns; k++) {
+        size_t l = strlen(sh);
+        snprintf(sh + l, sizeof(sh) - l, "%s{\"type\":\"cc\",\"ch\":%d,\"a\":%d,\"b\":%d}",
+                 k ? "," : "", 1 + (i + k) % 16, (i * 7 + k) % 128, (i * 13) % 128);
+    }
+    for (int k = 0; k < nl; k++) {
+        snprintf(lo, sizeof(lo), "{\"type\":\"pc\",\"ch\":%d,\"a\":%d,\"b\":0}", 1 + i % 16, (i * 3) % 128);
+    }
+    snprintf(out, n, "{\"pressMode\":%d,\"ccBehavior\":%d,\"short\":[%s],\"long\":[%s]}",
+             i % 4, i % 3, sh, lo);
+}
+
+static int phase_setup(void)
+{
+    host_boot();
+    host_run_for(100 * 1000);
+
+    char js[1024];
+    int l = snprintf(js, sizeof(js), "{\"bankCount\":%d,\"banks\":[", BENCH_BANKS);
+    for (int b = 0; b < BENCH_BANKS; b++) {
+        l += snprintf(js + l, sizeof(js) - (size_t)l, "%s{\"name\":\"Song %d\"}", b ? "," : "", b + 1);
+    }
+    snprintf(js + l, sizeof(js) - (size_t)l, "]}");
+    if (config_store_set_layout_json(js) != ESP_OK) return 1;
+
+    for (int b = 0; b < BENCH_BANKS; b++) {
+        for (int k = 0; k < NUM_BTNS; k++) {
+            btn_json(js, sizeof(js), b * NUM_BTNS + k, 2, 1);
+            if (config_store_set_btn_json(b, k, js) != ESP_OK) return 1;
+        }
+    }
+    config_store_set_led_brightness(60);
+    config_store_set_current_bank(3);
+    host_run_for(3 * 1000 * 1000);
+    return 0;
+}
+
+static int phase_measure(const char *backend, int n)
+{
+    traffic_t t0 = traffic_now();
+    host_boot();
+    host_run_for(SETTLE_US);
+    traffic_t t1 = traffic_now();
+    if (config_store_bank_count() != BENCH_BANKS) {
+        fprintf(stderr, "%s: config not loaded (%d banks)\n", backend, config_store_bank_count());
+        return 1;
+    }
+    row(backend, "boot", t0, t1, 1);
+
+    char js[512];
+    t0 = traffic_now();
+    for (int i = 0; i < n; i++) {
+        btn_json(js, sizeof(js), 1000 + i, 2, 1);
+        if (config_store_set_btn_json((i * 7) % BENCH_BANKS, i % NUM_BTNS, js) != ESP_OK) return 1;
+        host_run_for(1000 * 1000);
+    }
+    row(backend, "btn save", t0, traffic_now(), n);
+
+    t0 = traffic_now();
+    for (int i = 0; i < n; i++) {
+        config_store_set_current_bank((uint8_t)((i * 7 + 1) % BENCH_BANKS));
+        host_run_for(50 * 1000);
+    }
+    host_run_for(SETTLE_US);
+    row(backend, "cur bank", t0, traffic_now(), n);
+
+    t0 = traffic_now();
+    for (int i = 0; i < n; i++) {
+        config_store_set_led_brightness((uint8_t)(61 + i % 40));
+        host_run_for(10 * 1000);
+    }
+    host_run_for(SETTLE_US);
+    row(backend, "brightness", t0, traffic_now(), n);
+
+    t0 = traffic_now();
+    for (int i = 0; i < n; i++) {
+        int b = i % BENCH_BANKS, k = (i / BENCH_BANKS) % NUM_BTNS;
+        config_store_set_ab_led_sel(b, k, (uint8_t)!config_store_get_ab_led_sel(b, k));
+        host_run_for(10 * 1000);
+    }
+    host_run_for(SETTLE_US);
+    row(backend, "ab led", t0, traffic_now(), n);
+    return 0;
+}
+
+// -------------------- driver --------------------
+static void scratch_cleanup(const char *dir)
+{
+    if (chdir(dir) != 0) return;
+    DIR *d = opendir("spiffs");
+    if (d) {
+        struct dirent *de;
+        char p[300];
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] == '.') continue;
+            snprintf(p, sizeof(p), "spiffs/%s", de->d_name);
+            remove(p);
+        }
+        closedir(d);
+        rmdir("spiffs");
+    }
+    remove("cfglog.bin");
+    remove("nvs.bin");
+    if (chdir("/") == 0) rmdir(dir);
+}
+
+static int run_child(bool log, int (*fn)(const char *, int), const char *backend, int n)
+{
+    fflush(stdout);
+    pid_t pid = fork();
+    if (pid < 0) return 1;
+    if (pid == 0) {
+        if (!log) host_partition_set("cfglog", 0);
+        int rc = fn(backend, n);
+        fflush(stdout);
+        _exit(rc);
+    }
+    int st = 0;
+    if (waitpid(pid, &st, 0) < 0 || !WIFEXITED(st)) return 1;
+    return WEXITSTATUS(st);
+}
+
+static int setup_fn(const char *backend, int n) { (void)backend; (void)n; return phase_setup(); }
+
+int main(int argc, char **argv)
+{
+    int n = 40;
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) n = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-v")) esp_log_level_set("*", ESP_LOG_INFO);
+        else {
+            fprintf(stderr, "usage: %s [-n N] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (n < 1) n = 1;
+
+    static const struct { const char *name; bool log; } backends[] = {
+        { "spiffs+nvs", false },
+        { "cfglog",     true  },
+    };
+
+    printf("%-10s %-10s %10s %10s %8s %11s\n", "backend", "op", "read B", "prog B", "erases", "est time");
+
+    int rc = 0;
+    for (size_t i = 0; i < sizeof(backends) / sizeof(backends[0]); i++) {
+        char dir[64];
+        snprintf(dir, sizeof(dir), "/tmp/cfg_store_bench.XXXXXX");
+        if (!mkdtemp(dir) || chdir(dir) != 0) { fprintf(stderr, "no scratch dir\n"); return 2; }
+
+        if (run_child(backends[i].log, setup_fn, backends[i].name, n) != 0) {
+            fprintf(stderr, "%s: setup failed\n", backends[i].name);
+            rc = 1;
+        } else if (run_child(backends[i].log, phase_measure, backends[i].name, n) != 0) {
+            fprintf(stderr, "%s: measure failed\n", backends[i].name);
+            rc = 1;
+        }
+        scratch_cleanup(dir);
+    }
+    return rc;
+}
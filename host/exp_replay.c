@@ -0,0 +1,389 @@
+// ===== FILE: host/exp_replay.c =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "config_store.h"
+#include "exp_filter.h"
+
+// EXP pedal ADC trace through the adaptive filter (exp_filter.c) and the fixed IIR it
+// replaced, lag and jitter per trace segment. pure C, no boot: same input -> same numbers.
+//
+//   exp_replay [options] [trace.txt]
+//     -m oneshot|dma  input path (default oneshot):
+//                     oneshot  10 ms reads, median-3, old = IIR 1/2 (EXP_IIR_SHIFT 1)
+//                     dma      4 ms frame averages, old = no filter
+//     -c DHZ -b DHZ   adaptive min cutoff / beta, 0.1 Hz units (default: config defaults)
+//     -o FILE         per sample CSV: ms,raw,truth,old,new
+//     -w FILE         write the built-in synthetic trace and exit
+//     -k              check: exit 1 if the adaptive filter jitters more than the old one at
+//                     rest (p-p or 7b/s), or trails a fast sweep (<= FAST_MS) by more than
+//                     the old one + CHECK_LAG_MS
+//
+// trace lines (# = comment): "<ms> <raw> [truth]", one per sample, ms ascending.
+// without a truth column (recorded trace) truth = centered 50 ms running median of raw,
+// and rest allows REST_TOL_EST LSB of left-over noise in it.
+// no trace -> built-in synthetic one: 1.5 s rests at 7-bit step edges with +/-2 LSB noise
+// (oneshot: + a single spike now and then), a 300 ms full sweep, a 2 s sweep back and a
+// 100 ms jump.
+//
+// segments come from truth: rest = truth flat for REST_MS, everything between two rests
+// is a sweep (moves under MIN_SWEEP LSB stay rest).
+//   lag     sweep: mean delay of the output crossing 10, 20 .. 90 % of the step vs truth
+//   p-p     rest (after SETTLE_MS): output peak to peak, LSB
+//   7b/s    rest: changes of the 7-bit value (out * 127 / 4095) per second. upper bound
+//           for the CC sends, expfs adds its send thresholds on top
+
+#define MAX_SAMPLES 200000
+#define REST_MS     200
+#define SETTLE_MS   500   // rest stats start this long after the sweep (1 Hz filter settles)
+#define MA_HALF_MS  25
+#define MA_MAX      63
+#define REST_TOL_EST 3.0
+#define MIN_SWEEP   64    // smaller truth moves count as rest (two 7-bit steps)
+#define FAST_MS       500
+#define CHECK_LAG_MS  10    // one oneshot read period
+
+typedef struct {
+    double   ms;
+    uint16_t raw;
+    double   truth;
+    uint16_t out[2];   // 0 = old, 1 = adaptive
+} smp_t;
+
+static smp_t *s_s;
+static int s_n;
+static double s_rest_tol = 0.5;   // truth flat within this (LSB) = rest
+
+// -------------------- traces --------------------
+static uint32_t s_rng = 12345;
+
+static int noise(int amp)
+{
+    s_rng = s_rng * 1664525u + 1013904223u;
+    return (int)((s_rng >> 8) % (uint32_t)(2 * amp + 1)) - amp;
+}
+
+static void add(double ms, double truth, int raw)
+{
+    if (s_n >= MAX_SAMPLES) return;
+    if (raw < 0) raw = 0;
+    if (raw > EF_FULL_SCALE) raw = EF_FULL_SCALE;
+    s_s[s_n++] = (smp_t){ .ms = ms, .raw = (uint16_t)raw, .truth = truth };
+}
+
+// 806 / 3805: next to a 7-bit step (k * 4095 / 127) -> noise shows up as MIDI jitter
+static void synth(double period_ms, bool spikes)
+{
+    static const struct { double t0, t1, from, to; } seg[] = {
+        {    0, 1500,  806,  806 },
+        { 1500, 1800,  806, 3805 },   // full sweep, 300 ms
+        { 1800, 3300, 3805, 3805 },
+        { 3300, 5300, 3805,  806 },   // slow sweep, 2 s
+        { 5300, 6800,  806,  806 },
+        { 6800, 6900,  806, 3000 },   // jump, 100 ms
+        { 6900, 8400, 3000, 3000 },
+    };
+    const int nseg = (int)(sizeof(seg) / sizeof(seg[0]));
+
+    int i = 0;
+    for (double t = 0; t < seg[nseg - 1].t1; t += period_ms) {
+        while (t >= seg[i].t1) i++;
+        double tr = seg[i].from + (seg[i].to - seg[i].from) * (t - seg[i].t0) / (seg[i].t1 - seg[i].t0);
+        int raw = (int)(tr + 0.5) + noise(2);
+        if (spikes && ((int)(t / period_ms) % 97) == 50) raw += 300;   // single spike (contact / EMI)
+        add(t, tr, raw);
+    }
+}
+
+static bool load(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    if (!f) { fprintf(stderr, "cannot read %s\n", path); return false; }
+
+    char line[256];
+    bool have_truth = true;
+    while (fgets(line, sizeof(line), f)) {
+        char *h = strchr(line, '#');
+        if (h) *h = 0;
+        double ms, tr;
+        int raw;
+        int k = sscanf(line, "%lf %d %lf", &ms, &raw, &tr);
+        if (k < 2) continue;
+        if (k < 3) have_truth = false;
+        add(ms, k == 3 ? tr : 0, raw);
+    }
+    fclose(f);
+
+    if (!have_truth) {
+        for (int i = 0, lo = 0, hi = 0; i < s_n; i++) {
+            while (s_s[lo].ms < s_s[i].ms - MA_HALF_MS) lo++;
+            while (hi + 1 < s_n && s_s[hi + 1].ms <= s_s[i].ms + MA_HALF_MS) hi++;
+            uint16_t w[MA_MAX];
+            int n = 0;
+            for (int j = lo; j <= hi && n < MA_MAX; j++) {
+                int k = n++;
+                while (k > 0 && w[k - 1] > s_s[j].raw) { w[k] = w[k - 1]; k--; }
+                w[k] = s_s[j].raw;
+            }
+            s_s[i].truth = w[n / 2];
+        }
+        s_rest_tol = REST_TOL_EST;
+    }
+    return s_n > 0;
+}
+
+// -------------------- filters --------------------
+static uint16_t median3(uint16_t a, uint16_t b, uint16_t c)
+{
+    if (a > b) { uint16_t t = a; a = b; b = t; }
+    if (b > c) { uint16_t t = b; b = c; c = t; }
+    if (a > b) { uint16_t t = a; a = b; b = t; }
+    return b;
+}
+
+// same stages as expfs before / after the adaptive filter
+static void run_filters(bool oneshot, const ef_cfg_t *cfg)
+{
+    uint16_t hist[3] = {0};
+    int hi = 0;
+    int32_t iir = 0;
+    ef_state_t ef;
+    ef_reset(&ef);
+
+    for (int i = 0; i < s_n; i++) {
+        uint16_t in = s_s[i].raw;
+
+        if (oneshot) {
+            if (i == 0) {
+                hist[0] = hist[1] = hist[2] = in;
+                iir = in;
+            } else {
+                hist[hi] = in;
+                hi = (hi + 1) % 3;
+                in = median3(hist[0], hist[1], hist[2]);
+                iir += ((int32_t)in - iir) >> 1;
+            }
+            s_s[i].out[0] = (uint16_t)iir;
+        } else {
+            s_s[i].out[0] = in;
+        }
+        s_s[i].out[1] = ef_update(&ef, cfg, in, (int64_t)(s_s[i].ms * 1000.0));
+    }
+}
+
+// -------------------- metrics --------------------
+typedef struct {
+    bool   rest;
+    int    i0, i1;        // samples [i0, i1)
+    double from, to;      // sweep: truth before / after
+    double lag_ms[2];
+    int    pp[2];
+    double steps_s[2];
+} seg_t;
+
+#define MAX_SEGS 64
+
+static inline int to7(uint16_t v) { return (int)v * 127 / EF_FULL_SCALE; }
+
+// rest = truth within +/-s_rest_tol LSB over the last REST_MS
+static int find_segments(seg_t *sg)
+{
+    int ns = 0;
+    bool cur = true;
+    int start = 0;
+
+    for (int i = 0; i <= s_n && ns < MAX_SEGS; i++) {
+        bool rest = cur;
+        if (i < s_n) {
+            int j = i;
+            while (j > 0 && s_s[i].ms - s_s[j - 1].ms <= REST_MS) j--;
+            bool flat = true;
+            for (int k = j; k <= i && flat; k++) {
+                double d = s_s[k].truth - s_s[i].truth;
+                flat = (d < s_rest_tol && -d < s_rest_tol);
+            }
+            rest = flat;
+        }
+        if (i == s_n || rest != cur) {
+            if (i > start) sg[ns++] = (seg_t){ .rest = cur, .i0 = start, .i1 = i };
+            start = i;
+            cur = rest;
+        }
+    }
+
+    // a sweep's flat tail is detected one REST_MS late: move the border back to the
+    // last truth change
+    for (int k = 0; k < ns; k++) {
+        if (sg[k].rest || k + 1 >= ns) continue;
+        int e = sg[k].i1;
+        const double end = s_s[sg[k + 1].i0].truth;
+        while (e > sg[k].i0 + 1 && s_s[e - 1].truth - end < s_rest_tol && end - s_s[e - 1].truth < s_rest_tol) e--;
+        sg[k].i1 = e;
+        sg[k + 1].i0 = e;
+    }
+
+    // small moves (noise left in an estimated truth) -> rest, then join neighbouring rests
+    int m = 0;
+    for (int k = 0; k < ns; k++) {
+        seg_t g = sg[k];
+        if (!g.rest) {
+            double from = s_s[g.i0 > 0 ? g.i0 - 1 : 0].truth;
+            double to = s_s[g.i1 < s_n ? g.i1 : s_n - 1].truth;
+            if (to - from < MIN_SWEEP && from - to < MIN_SWEEP) g.rest = true;
+        }
+        if (m > 0 && g.rest && sg[m - 1].rest) sg[m - 1].i1 = g.i1;
+        else sg[m++] = g;
+    }
+    return m;
+}
+
+// first time at or after sample i0 where v crosses level in the sweep direction
+static double cross_ms(int i0, double level, bool up, int which)
+{
+    for (int i = i0; i < s_n; i++) {
+        double v = (which < 0) ? s_s[i].truth : s_s[i].out[which];
+        if (up ? v >= level : v <= level) return s_s[i].ms;
+    }
+    return -1;
+}
+
+static void measure(seg_t *sg, int ns)
+{
+    for (int k = 0; k < ns; k++) {
+        seg_t *g = &sg[k];
+        if (g->rest) {
+            // steady state only: skip the settling part after a sweep
+            int i0 = g->i0;
+            while (i0 < g->i1 && k > 0 && s_s[i0].ms - s_s[g->i0].ms < SETTLE_MS) i0++;
+            for (int w = 0; w < 2; w++) {
+                int mn = 0xFFFF, mx = 0, steps = 0;
+                for (int i = i0; i < g->i1; i++) {
+                    uint16_t v = s_s[i].out[w];
+                    if (v < mn) mn = v;
+                    if (v > mx) mx = v;
+                    if (i > i0 && to7(v) != to7(s_s[i - 1].out[w])) steps++;
+                }
+                double secs = (i0 < g->i1) ? (s_s[g->i1 - 1].ms - s_s[i0].ms) / 1000.0 : 0;
+                g->pp[w] = (mx >= mn) ? mx - mn : 0;
+                g->steps_s[w] = (secs > 0) ? steps / secs : 0;
+            }
+            continue;
+        }
+
+        g->from = s_s[g->i0 > 0 ? g->i0 - 1 : 0].truth;
+        g->to = s_s[g->i1 < s_n ? g->i1 : s_n - 1].truth;
+        const bool up = g->to > g->from;
+        for (int w = 0; w < 2; w++) {
+            double sum = 0;
+            int n = 0;
+            for (int p = 10; p <= 90; p += 10) {
+                double level = g->from + (g->to - g->from) * p / 100.0;
+                double tt = cross_ms(g->i0, level, up, -1);
+                double to = cross_ms(g->i0, level, up, w);
+                if (tt < 0 || to < 0) continue;
+                sum += to - tt;
+                n++;
+            }
+            g->lag_ms[w] = n ? sum / n : -1;
+        }
+    }
+}
+
+static int usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-m oneshot|dma] [-c dhz] [-b dhz] [-o out.csv] [-w trace] [-k] [trace.txt]\n", argv0);
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    bool oneshot = true, check = false;
+    const char *trace = NULL, *csv = NULL, *wr = NULL;
+    ef_cfg_t cfg = { .min_cut_dhz = EXP_FLT_MIN_CUT_DEFAULT, .beta_dhz = EXP_FLT_BETA_DEFAULT };
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strcmp(a, "-m") && i + 1 < argc) {
+            const char *m = argv[++i];
+            if (!strcmp(m, "oneshot")) oneshot = true;
+            else if (!strcmp(m, "dma")) oneshot = false;
+            else return usage(argv[0]);
+        }
+        else if (!strcmp(a, "-c") && i + 1 < argc) cfg.min_cut_dhz = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "-b") && i + 1 < argc) cfg.beta_dhz = (uint16_t)atoi(argv[++i]);
+        else if (!strcmp(a, "-o") && i + 1 < argc) csv = argv[++i];
+        else if (!strcmp(a, "-w") && i + 1 < argc) wr = argv[++i];
+        else if (!strcmp(a, "-k")) check = true;
+        else if (a[0] != '-' && !trace) trace = a;
+        else return usage(argv[0]);
+    }
+
+    s_s = calloc(MAX_SAMPLES, sizeof(*s_s));
+    if (!s_s) return 1;
+
+    const double period_ms = oneshot ? 10.0 : 4.0;
+    if (trace) {
+        if (!load(trace)) return 2;
+    } else {
+        synth(period_ms, oneshot);   // a DMA frame average has no single-sample spikes
+    }
+
+    if (wr) {
+        FILE *f = fopen(wr, "w");
+        if (!f) { fprintf(stderr, "cannot write %s\n", wr); return 2; }
+        fprintf(f, "# ms raw truth (exp_replay synthetic, %s)\n", oneshot ? "oneshot" : "dma");
+        for (int i = 0; i < s_n; i++) fprintf(f, "%g %u %g\n", s_s[i].ms, s_s[i].raw, s_s[i].truth);
+        fclose(f);
+        return 0;
+    }
+
+    run_filters(oneshot, &cfg);
+
+    if (csv) {
+        FILE *f = fopen(csv, "w");
+        if (!f) { fprintf(stderr, "cannot write %s\n", csv); return 2; }
+        fprintf(f, "ms,raw,truth,old,new\n");
+        for (int i = 0; i < s_n; i++) {
+            fprintf(f, "%g,%u,%.1f,%u,%u\n", s_s[i].ms, s_s[i].raw, s_s[i].truth, s_s[i].out[0], s_s[i].out[1]);
+        }
+        fclose(f);
+    }
+
+    seg_t sg[MAX_SEGS];
+    int ns = find_segments(sg);
+    measure(sg, ns);
+
+    printf("%s, %d samples, adaptive min_cut %.1f Hz beta %.1f Hz, old = %s\n",
+           oneshot ? "oneshot" : "dma", s_n, cfg.min_cut_dhz / 10.0, cfg.beta_dhz / 10.0,
+           oneshot ? "median-3 + IIR 1/2" : "none");
+    printf("%-6s %9s %-18s %14s %14s\n", "seg", "ms", "", "old", "adaptive");
+
+    int fail = 0;
+    for (int k = 0; k < ns; k++) {
+        const seg_t *g = &sg[k];
+        char what[40];
+        if (g->rest) {
+            snprintf(what, sizeof(what), "rest %.0f", s_s[g->i0].truth);
+            printf("%-6s %4.0f-%-4.0f %-18s %4d p-p %3.1f 7b/s %4d p-p %3.1f 7b/s\n", "rest",
+                   s_s[g->i0].ms, s_s[g->i1 - 1].ms, what,
+                   g->pp[0], g->steps_s[0], g->pp[1], g->steps_s[1]);
+            if (g->pp[1] > g->pp[0] || g->steps_s[1] > g->steps_s[0]) fail = 1;
+        } else {
+            snprintf(what, sizeof(what), "%.0f -> %.0f", g->from, g->to);
+            printf("%-6s %4.0f-%-4.0f %-18s %7.1f ms lag %7.1f ms lag\n", "sweep",
+                   s_s[g->i0].ms, s_s[g->i1 - 1].ms, what, g->lag_ms[0], g->lag_ms[1]);
+            bool fast = s_s[g->i1 - 1].ms - s_s[g->i0].ms <= FAST_MS;
+            if (g->lag_ms[1] < 0 || (fast && g->lag_ms[1] > g->lag_ms[0] + CHECK_LAG_MS)) fail = 1;
+        }
+    }
+
+    free(s_s);
+    if (check && fail) {
+        fprintf(stderr, "check failed: adaptive filter jitters more at rest or lags a fast sweep\n");
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+// ===== FILE: host/footsw_host_run.c =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_log.h"
+#include "config_store.h"
+#include "display_uart.h"
+#include "host.h"
+
+// footsw_host_run [-v] [-i config.json] [-t ms]
+//   boots the firmware core in the working directory (nvs.bin, spiffs/, cfglog.bin),
+//   optionally imports a full config JSON, runs -t ms of virtual time (default 1000)
+//   and prints every MIDI message that left the device
+
+static void print_midi(const host_midi_evt_t *e, void *arg)
+{
+    (void)arg;
+    printf("%10lld %s", (long long)e->t_us, e->tx == HOST_MIDI_USB ? "usb " : "uart");
+    for (int i = 0; i < e->len; i++) printf(" %02X", e->b[i]);
+    printf("\n");
+}
+
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char *s = (n >= 0) ? malloc((size_t)n + 1) : NULL;
+    if (s && fread(s, 1, (size_t)n, f) != (size_t)n) { free(s); s = NULL; }
+    if (s) s[n] = 0;
+    fclose(f);
+    return s;
+}
+
+int main(int argc, char **argv)
+{
+    const char *import = NULL;
+    long run_ms = 1000;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-v")) esp_log_level_set("*", ESP_LOG_INFO);
+        else if (!strcmp(argv[i], "-i") && i + 1 < argc) import = argv[++i];
+        else if (!strcmp(argv[i], "-t") && i + 1 < argc) run_ms = strtol(argv[++i], NULL, 10);
+        else {
+            fprintf(stderr, "usage: %s [-v] [-i config.json] [-t ms]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    host_midi_set_sink(print_midi, NULL);
+    host_boot();
+
+    if (import) {
+        char *json = read_file(import);
+        if (!json) { fprintf(stderr, "cannot read %s\n", import); return 1; }
+        esp_err_t e = config_store_import_json(json);
+        free(json);
+        if (e != ESP_OK) { fprintf(stderr, "import failed: %s\n", esp_err_to_name(e)); return 1; }
+    }
+
+    host_run_for((int64_t)run_ms * 1000);
+
+    char msg[512];
+    display_uart_build_msg(msg, sizeof(msg));
+    printf("display: %s", msg);
+    return 0;
+}
@@ -0,0 +1,480 @@
+// ===== FILE: host/footsw_sim.c =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "esp_log.h"
+#include "config_store.h"
+#include "footswitch.h"
+#include "expfs.h"
+#include "lat_stats.h"
+#include "host.h"
+
+// Deterministic trace replay through the real footswitch / expfs / midi_out path.
+//
+//   footsw_sim [options] trace.txt
+//     -o FILE        write the MIDI stream to FILE (default stdout)
+//     -g FILE        compare with golden FILE, exit 1 on the first difference
+//     -u FILE        (re)write golden FILE
+//     -b N           benchmark: replay the trace N times back to back, print throughput
+//     -l             print press-to-wire latency (virtual time) at the end
+//     -v             firmware logs (INFO, default: errors only)
+//
+// trace lines (# = comment). setup lines have no time and run right after boot:
+//   config FILE                 full config import (path relative to the trace)
+//   layout JSON                 bank count + names (same as the web UI)
+//   btn BANK SW JSON            per-button JSON (same as the web UI), SW 1..8
+//   expfs PORT JSON             exp/fs port JSON, PORT 1..2
+//
+// timed lines: "<ms> cmd ..." absolute from trace start, "+<ms> cmd ..." relative to the
+// previous line. ms may have a fraction (0.25 = 250 us). times never go backwards.
+// lines at the same time are one burst: the firmware tasks only run once the time moves on.
+//   down SW / up SW             footswitch 1..8 (pin low = pressed)
+//   bounce SW down|up N GAP_US  N contact bounces GAP_US apart, then settles in that state
+//   tip PORT down|up            EXP/FS jack tip contact, PORT 1..2
+//   ring PORT down|up           EXP/FS jack ring contact
+//   adc PORT RAW                EXP pedal ADC raw (0..4095) on the ring of PORT
+//   pin GPIO 0|1|z              any pin (z = released, back to its pull)
+//   bank N                      footswitch_set_bank(N - 1)
+//   end                         stop here (default: last event + 1000 ms)
+//
+// output: one MIDI message per line, "<us since trace start> usb|uart <hex bytes>"
+
+#define SIM_TAIL_US (1000 * 1000)
+#define SIM_BOOT_SETTLE_US (200 * 1000)
+
+typedef enum {
+    EV_PIN = 0,     // a = gpio, b = level (-1 = float)
+    EV_ADC,         // a = gpio, b = raw
+    EV_BANK,        // a = bank index
+    EV_END,
+} ev_kind_t;
+
+typedef struct {
+    int64_t t_us;
+    ev_kind_t kind;
+    int a, b;
+} sim_ev_t;
+
+typedef enum {
+    SU_CONFIG = 0,  // text = json
+    SU_BTN,         // a = bank, b = sw, text = json
+    SU_EXPFS,       // a = port, text = json
+    SU_LAYOUT,      // text = json
+} su_kind_t;
+
+typedef struct {
+    su_kind_t kind;
+    int a, b;
+    char *text;
+} sim_setup_t;
+
+typedef struct {
+    sim_ev_t *ev;
+    int n_ev, cap_ev;
+    sim_setup_t *su;
+    int n_su, cap_su;
+    int64_t end_us;
+    int n_edges;
+} sim_trace_t;
+
+// -------------------- output --------------------
+typedef struct {
+    FILE *out;          // text stream (NULL in benchmark mode)
+    int64_t origin_us;
+    uint64_t n_msgs;
+} sim_sink_t;
+
+static void sink_midi(const host_midi_evt_t *e, void *arg)
+{
+    sim_sink_t *s = (sim_sink_t *)arg;
+    s->n_msgs++;
+    if (!s->out) return;
+
+    fprintf(s->out, "%lld %s", (long long)(e->t_us - s->origin_us), e->tx == HOST_MIDI_USB ? "usb " : "uart");
+    for (int i = 0; i < e->len; i++) fprintf(s->out, " %02X", e->b[i]);
+    fputc('\n', s->out);
+}
+
+// -------------------- trace parsing --------------------
+static char *read_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long n = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    char *s = (n >= 0) ? malloc((size_t)n + 1) : NULL;
+    if (s && fread(s, 1, (size_t)n, f) != (size_t)n) { free(s); s = NULL; }
+    if (s) s[n] = 0;
+    fclose(f);
+    return s;
+}
+
+static bool push_ev(sim_trace_t *tr, int64_t t_us, ev_kind_t kind, int a, int b)
+{
+    if (tr->n_ev == tr->cap_ev) {
+        int cap = tr->cap_ev ? tr->cap_ev * 2 : 256;
+        sim_ev_t *p = realloc(tr->ev, (size_t)cap * sizeof(*p));
+        if (!p) return false;
+        tr->ev = p;
+        tr->cap_ev = cap;
+    }
+    tr->ev[tr->n_ev++] = (sim_ev_t){ .t_us = t_us, .kind = kind, .a = a, .b = b };
+    if (kind == EV_PIN) tr->n_edges++;
+    return true;
+}
+
+static bool push_setup(sim_trace_t *tr, su_kind_t kind, int a, int b, char *text)
+{
+    if (tr->n_su == tr->cap_su) {
+        int cap = tr->cap_su ? tr->cap_su * 2 : 8;
+        sim_setup_t *p = realloc(tr->su, (size_t)cap * sizeof(*p));
+        if (!p) return false;
+        tr->su = p;
+        tr->cap_su = cap;
+    }
+    tr->su[tr->n_su++] = (sim_setup_t){ .kind = kind, .a = a, .b = b, .text = text };
+    return true;
+}
+
+static int parse_updown(const char *s)
+{
+    if (!s) return -1;
+    if (!strcmp(s, "down")) return 0;
+    if (!strcmp(s, "up")) return 1;
+    return -1;
+}
+
+static char *skip_ws(char *p)
+{
+    while (*p && isspace((unsigned char)*p)) p++;
+    return p;
+}
+
+// path of a file named in the trace: relative to the trace's directory
+static char *trace_rel_path(const char *trace_path, const char *name)
+{
+    const char *slash = strrchr(trace_path, '/');
+    size_t dl = (name[0] == '/' || !slash) ? 0 : (size_t)(slash - trace_path + 1);
+    char *p = malloc(dl + strlen(name) + 1);
+    if (!p) return NULL;
+    memcpy(p, trace_path, dl);
+    strcpy(p + dl, name);
+    return p;
+}
+
+static bool parse_trace(const char *path, sim_trace_t *tr)
+{
+    char *src = read_file(path);
+    if (!src) { fprintf(stderr, "cannot read %s\n", path); return false; }
+
+    memset(tr, 0, sizeof(*tr));
+    tr->end_us = -1;
+
+    int64_t t_prev = 0;
+    int line_no = 0;
+    bool ok = true;
+
+    for (char *line = src, *next; line && ok; line = next) {
+        next = strchr(line, '\n');
+        if (next) *next++ = 0;
+        line_no++;
+
+        char *hash = strchr(line, '#');
+        if (hash) *hash = 0;
+        char *p = skip_ws(line);
+        if (!*p) continue;
+
+        // ---- setup lines (no time) ----
+        if (!isdigit((unsigned char)*p) && *p != '+' && *p != '.') {
+            char cmd[16] = {0};
+            int a = 0, b = 0, used = 0;
+
+            if (sscanf(p, "%15s%n", cmd, &used) != 1) { ok = false; break; }
+            char *rest = skip_ws(p + used);
+
+            if (!strcmp(cmd, "config")) {
+                char *rp = trace_rel_path(path, rest);
+                char *json = rp ? read_file(rp) : NULL;
+                if (!json) fprintf(stderr, "%s:%d: cannot read %s\n", path, line_no, rest);
+                free(rp);
+                ok = json && push_setup(tr, SU_CONFIG, 0, 0, json);
+            } else if (!strcmp(cmd, "btn") && sscanf(rest, "%d %d%n", &a, &b, &used) == 2) {
+                ok = push_setup(tr, SU_BTN, a, b, strdup(skip_ws(rest + used)));
+            } else if (!strcmp(cmd, "expfs") && sscanf(rest, "%d%n", &a, &used) == 1) {
+                ok = push_setup(tr, SU_EXPFS, a, 0, strdup(skip_ws(rest + used)));
+            } else if (!strcmp(cmd, "layout")) {
+                ok = push_setup(tr, SU_LAYOUT, 0, 0, strdup(rest));
+            } else {
+                ok = false;
+            }
+            if (!ok) fprintf(stderr, "%s:%d: bad setup line\n", path, line_no);
+            continue;
+        }
+
+        // ---- timed lines ----
+        const bool rel = (*p == '+');
+        char *endp = NULL;
+        double ms = strtod(rel ? p + 1 : p, &endp);
+        if (endp == p || ms < 0) { fprintf(stderr, "%s:%d: bad time\n", path, line_no); ok = false; break; }
+
+        int64_t t = (int64_t)(ms * 1000.0 + 0.5) + (rel ? t_prev : 0);
+        if (t < t_prev) { fprintf(stderr, "%s:%d: time goes backwards\n", path, line_no); ok = false; break; }
+        t_prev = t;
+
+        char cmd[16] = {0}, w[16] = {0};
+        int a = 0, n = 0, gap = 0;
+        if (sscanf(endp, "%15s", cmd) != 1) { ok = false; break; }
+        char *args = strstr(endp, cmd) + strlen(cmd);
+
+        if (!strcmp(cmd, "down") || !strcmp(cmd, "up")) {
+            const int g = (sscanf(args, "%d", &a) == 1) ? footswitch_gpio(a - 1) : -1;
+            ok = (g >= 0) && push_ev(tr, t, EV_PIN, g, parse_updown(cmd));
+        } else if (!strcmp(cmd, "bounce") && sscanf(args, "%d %15s %d %d", &a, w, &n, &gap) == 4) {
+            const int g = footswitch_gpio(a - 1);
+            const int lv = parse_updown(w);
+            ok = (g >= 0) && lv >= 0 && n >= 0 && gap > 0;
+            for (int k = 0; ok && k < n; k++) ok = push_ev(tr, t + (int64_t)k * gap, EV_PIN, g, (k & 1) ? !lv : lv);
+            if (ok) ok = push_ev(tr, t + (int64_t)n * gap, EV_PIN, g, lv);
+            t_prev = t + (int64_t)n * gap;
+        } else if ((!strcmp(cmd, "tip") || !strcmp(cmd, "ring")) && sscanf(args, "%d %15s", &a, w) == 2) {
+            int tip = -1, ring = -1;
+            expfs_port_gpio(a - 1, &tip, &ring);
+            const int g = (cmd[0] == 't') ? tip : ring;
+            const int lv = parse_updown(w);
+            ok = (g >= 0) && lv >= 0 && push_ev(tr, t, EV_PIN, g, lv);
+        } else if (!strcmp(cmd, "adc") && sscanf(args, "%d %d", &a, &n) == 2) {
+            int ring = -1;
+            expfs_port_gpio(a - 1, NULL, &ring);
+            ok = (ring >= 0) && push_ev(tr, t, EV_ADC, ring, n);
+        } else if (!strcmp(cmd, "pin") && sscanf(args, "%d %15s", &a, w) == 2) {
+            const int lv = (w[0] == 'z') ? -1 : (atoi(w) ? 1 : 0);
+            ok = push_ev(tr, t, EV_PIN, a, lv);
+        } else if (!strcmp(cmd, "bank") && sscanf(args, "%d", &a) == 1) {
+            ok = push_ev(tr, t, EV_BANK, a - 1, 0);
+        } else if (!strcmp(cmd, "end")) {
+            tr->end_us = t;
+        } else {
+            ok = false;
+        }
+        if (!ok) fprintf(stderr, "%s:%d: bad event line\n", path, line_no);
+    }
+
+    free(src);
+    if (!ok) return false;
+
+    if (tr->end_us < 0) tr->end_us = (tr->n_ev ? tr->ev[tr->n_ev - 1].t_us : 0) + SIM_TAIL_US;
+    return true;
+}
+
+// -------------------- replay --------------------
+static bool apply_setup(const sim_trace_t *tr)
+{
+    for (int i = 0; i < tr->n_su; i++) {
+        const sim_setup_t *s = &tr->su[i];
+        esp_err_t e = ESP_FAIL;
+        switch (s->kind) {
+        case SU_CONFIG: e = config_store_import_json(s->text); break;
+        case SU_BTN:    e = config_store_set_btn_json(s->a, s->b - 1, s->text); break;
+        case SU_EXPFS:  e = config_store_set_expfs_json(s->a - 1, s->text); break;
+        case SU_LAYOUT: e = config_store_set_layout_json(s->text); break;
+        }
+        if (e != ESP_OK) {
+            fprintf(stderr, "setup line %d failed: %s\n", i + 1, esp_err_to_name(e));
+            return false;
+        }
+    }
+    return true;
+}
+
+static void replay(const sim_trace_t *tr, int64_t origin_us)
+{
+    for (int i = 0; i < tr->n_ev; i++) {
+        const sim_ev_t *e = &tr->ev[i];
+        if (e->t_us > tr->end_us) break;
+        // same timestamp = one burst: no task runs between those edges
+        if (i == 0 || e->t_us != tr->ev[i - 1].t_us) host_run_until(origin_us + e->t_us);
+
+        switch (e->kind) {
+        case EV_PIN:  host_gpio_input(e->a, e->b); break;
+        case EV_ADC:  host_adc_set(e->a, e->b); break;
+        case EV_BANK: footswitch_set_bank(e->a); break;
+        default: break;
+        }
+    }
+    host_run_until(origin_us + tr->end_us);
+}
+
+// -------------------- golden compare --------------------
+static int compare_golden(const char *got, const char *golden_path)
+{
+    char *want = read_file(golden_path);
+    if (!want) { fprintf(stderr, "cannot read golden %s\n", golden_path); return 1; }
+
+    int line = 1;
+    const char *a = got, *b = want;
+    while (*a && *b && *a == *b) {
+        if (*a == '\n') line++;
+        a++;
+        b++;
+    }
+
+    int rc = 0;
+    if (*a || *b) {
+        // rewind both to the start of the differing line
+        while (a > got && a[-1] != '\n') { a--; b--; }
+        const char *na = strchr(a, '\n'), *nb = strchr(b, '\n');
+        fprintf(stderr, "golden mismatch at line %d\n  got:  %.*s\n  want: %.*s\n", line,
+                (int)(na ? na - a : (long)strlen(a)), a, (int)(nb ? nb - b : (long)strlen(b)), b);
+        rc = 1;
+    }
+    free(want);
+    return rc;
+}
+
+// -------------------- main --------------------
+static double wall_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+// fresh state for every run: nvs (memory), spiffs + config log in a scratch directory
+static char s_workdir[64];
+
+static void workdir_cleanup(void)
+{
+    if (!s_workdir[0]) return;
+    DIR *d = opendir("spiffs");
+    if (d) {
+        struct dirent *de;
+        char p[300];
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] == '.') continue;
+            snprintf(p, sizeof(p), "spiffs/%s", de->d_name);
+            remove(p);
+        }
+        closedir(d);
+        rmdir("spiffs");
+    }
+    remove("cfglog.bin");   // config log partition image
+    if (chdir("/") == 0) rmdir(s_workdir);
+}
+
+static void print_latency(void)
+{
+    static const char *names[LAT_STAGE_COUNT] = { "edge", "actions", "submit_usb", "submit_uart", "wire_usb" };
+    for (int s = 0; s < LAT_STAGE_COUNT; s++) {
+        lat_summary_t r;
+        lat_stats_get((lat_stage_t)s, &r);
+        if (!r.n) continue;
+        fprintf(stderr, "lat %-11s n=%u p50=%uus p99=%uus max=%uus\n", names[s],
+                (unsigned)r.n, (unsigned)r.p50_us, (unsigned)r.p99_us, (unsigned)r.max_us);
+    }
+}
+
+static int usage(const char *argv0)
+{
+    fprintf(stderr, "usage: %s [-o out] [-g golden | -u golden] [-b N] [-l] [-v] trace.txt\n", argv0);
+    return 2;
+}
+
+int main(int argc, char **argv)
+{
+    const char *out_path = NULL, *golden = NULL, *update = NULL, *trace_path = NULL;
+    int bench = 0;
+    bool lat = false;
+
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    for (int i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (!strcmp(a, "-o") && i + 1 < argc) out_path = argv[++i];
+        else if (!strcmp(a, "-g") && i + 1 < argc) golden = argv[++i];
+        else if (!strcmp(a, "-u") && i + 1 < argc) update = argv[++i];
+        else if (!strcmp(a, "-b") && i + 1 < argc) bench = atoi(argv[++i]);
+        else if (!strcmp(a, "-l")) lat = true;
+        else if (!strcmp(a, "-v")) esp_log_level_set("*", ESP_LOG_INFO);
+        else if (a[0] != '-' && !trace_path) trace_path = a;
+        else return usage(argv[0]);
+    }
+    if (!trace_path) return usage(argv[0]);
+
+    sim_trace_t tr;
+    if (!parse_trace(trace_path, &tr)) return 2;
+
+    // golden / update paths stay valid after chdir
+    char *golden_abs = golden ? realpath(golden, NULL) : NULL;
+    if (golden && !golden_abs) { fprintf(stderr, "cannot read golden %s\n", golden); return 2; }
+    FILE *out = NULL;
+    char *buf = NULL;
+    size_t buf_len = 0;
+    if (!bench) {
+        out = (golden || update) ? open_memstream(&buf, &buf_len)
+                                 : (out_path ? fopen(out_path, "w") : stdout);
+        if (!out) { fprintf(stderr, "cannot open output\n"); return 2; }
+    }
+    FILE *upd = update ? fopen(update, "w") : NULL;
+    if (update && !upd) { fprintf(stderr, "cannot write %s\n", update); return 2; }
+
+    snprintf(s_workdir, sizeof(s_workdir), "/tmp/footsw_sim.XXXXXX");
+    if (!mkdtemp(s_workdir) || chdir(s_workdir) != 0) { fprintf(stderr, "no scratch dir\n"); return 2; }
+    atexit(workdir_cleanup);
+    host_nvs_set_path(NULL);
+
+    sim_sink_t sink = { .out = NULL };
+    host_midi_set_sink(sink_midi, &sink);
+
+    host_boot();
+    if (!apply_setup(&tr)) return 2;
+    host_run_for(SIM_BOOT_SETTLE_US);   // config save / display refresh settle before t = 0
+    lat_stats_reset();
+
+    if (!bench) {
+        sink.out = out;
+        sink.origin_us = host_now_us();
+        replay(&tr, sink.origin_us);
+        fflush(out);
+
+        int rc = 0;
+        if (upd) {
+            fwrite(buf, 1, buf_len, upd);
+            fclose(upd);
+        }
+        if (golden_abs) rc = compare_golden(buf ? buf : "", golden_abs);
+        if (out != stdout) fclose(out);
+        free(buf);
+        free(golden_abs);
+        if (lat) print_latency();
+        return rc;
+    }
+
+    // ---- benchmark: N back to back replays, no output ----
+    const uint64_t sw0 = host_switch_count();
+    const int64_t v0 = host_now_us();
+    const double w0 = wall_s();
+
+    for (int r = 0; r < bench; r++) replay(&tr, v0 + (int64_t)r * tr.end_us);
+
+    const double wall = wall_s() - w0;
+    const double virt = (double)(host_now_us() - v0) * 1e-6;
+    const double edges = (double)tr.n_edges * bench;
+
+    printf("bench: %d x %s\n", bench, trace_path);
+    printf("  input edges   %.0f  (%.0f /s)\n", edges, wall > 0 ? edges / wall : 0.0);
+    printf("  midi messages %llu  (%.0f /s)\n", (unsigned long long)sink.n_msgs,
+           wall > 0 ? (double)sink.n_msgs / wall : 0.0);
+    printf("  task switches %llu\n", (unsigned long long)(host_switch_count() - sw0));
+    printf("  virtual %.3f s in %.3f s wall (x%.0f)\n", virt, wall, wall > 0 ? virt / wall : 0.0);
+    if (lat) print_latency();
+    return 0;
+}
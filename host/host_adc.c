@@ -0,0 +1,94 @@
+// ===== FILE: host/host_adc.c =====
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_continuous.h"
+#include "host.h"
+
+// ESP32-S3 pin map: ADC1 = GPIO1..10 (ch0..9), ADC2 = GPIO11..20 (ch0..9)
+// raw values per GPIO come from host_adc_set(); unset pins read 0
+
+#define HOST_ADC_GPIO_MAX 21
+
+struct host_adc_unit {
+    adc_unit_t unit;
+};
+
+static uint16_t s_raw[HOST_ADC_GPIO_MAX];
+
+void host_adc_set(int gpio, int raw)
+{
+    if (gpio < 0 || gpio >= HOST_ADC_GPIO_MAX) return;
+    if (raw < 0) raw = 0;
+    if (raw > 4095) raw = 4095;
+    s_raw[gpio] = (uint16_t)raw;
+}
+
+esp_err_t adc_oneshot_io_to_channel(int io, adc_unit_t *unit, adc_channel_t *ch)
+{
+    if (!unit || !ch) return ESP_ERR_INVALID_ARG;
+    if (io >= 1 && io <= 10)  { *unit = ADC_UNIT_1; *ch = (adc_channel_t)(io - 1);  return ESP_OK; }
+    if (io >= 11 && io <= 20) { *unit = ADC_UNIT_2; *ch = (adc_channel_t)(io - 11); return ESP_OK; }
+    return ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t adc_continuous_io_to_channel(int io, adc_unit_t *unit, adc_channel_t *ch)
+{
+    return adc_oneshot_io_to_channel(io, unit, ch);
+}
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t *cfg, adc_oneshot_unit_handle_t *out)
+{
+    if (!cfg || !out) return ESP_ERR_INVALID_ARG;
+    struct host_adc_unit *u = calloc(1, sizeof(*u));
+    if (!u) return ESP_ERR_NO_MEM;
+    u->unit = cfg->unit_id;
+    *out = u;
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_del_unit(adc_oneshot_unit_handle_t h)
+{
+    free(h);
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t h, adc_channel_t ch, const adc_oneshot_chan_cfg_t *cfg)
+{
+    (void)ch;
+    (void)cfg;
+    return h ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t h, adc_channel_t ch, int *out_raw)
+{
+    if (!h || !out_raw || ch > ADC_CHANNEL_9) return ESP_ERR_INVALID_ARG;
+    const int gpio = (h->unit == ADC_UNIT_1) ? (1 + (int)ch) : (11 + (int)ch);
+    *out_raw = s_raw[gpio];
+    return ESP_OK;
+}
+
+// -------------------- continuous: not available --------------------
+esp_err_t adc_continuous_new_handle(const adc_continuous_handle_cfg_t *cfg, adc_continuous_handle_t *out)
+{
+    (void)cfg;
+    if (out) *out = NULL;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_continuous_config(adc_continuous_handle_t h, const adc_continuous_config_t *cfg)
+{
+    (void)h; (void)cfg;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_continuous_register_event_callbacks(adc_continuous_handle_t h, const adc_continuous_evt_cbs_t *cbs, void *arg)
+{
+    (void)h; (void)cbs; (void)arg;
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t adc_continuous_start(adc_continuous_handle_t h)  { (void)h; return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_continuous_stop(adc_continuous_handle_t h)   { (void)h; return ESP_ERR_NOT_SUPPORTED; }
+esp_err_t adc_continuous_deinit(adc_continuous_handle_t h) { (void)h; return ESP_ERR_NOT_SUPPORTED; }
@@ -0,0 +1,67 @@
+// ===== FILE: host/host_boot.c =====
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "nvs_flash.h"
+
+#include "config_store.h"
+#include "footswitch.h"
+#include "usb_midi_host.h"
+#include "uart_midi_out.h"
+#include "midi_out.h"
+#include "expfs.h"
+#include "rgb_led.h"
+#include "rgb_store.h"
+#include "display_uart.h"
+#include "lat_stats.h"
+
+#include "host.h"
+
+// app_main.c bootstrap_task, same order and delays (no Wi-Fi portal on the host)
+
+static const char *TAG = "HOST";
+
+static volatile bool s_boot_done = false;
+
+static void host_bootstrap_task(void *arg)
+{
+    (void)arg;
+
+    esp_err_t err = nvs_flash_init();
+    if (err != ESP_OK) ESP_LOGE(TAG, "nvs init failed: %s", esp_err_to_name(err));
+
+    config_store_init();
+
+    if (rgb_led_init() == ESP_OK) {
+        (void)rgb_store_init();
+        rgb_store_apply();
+        rgb_led_all_on();
+    }
+
+    display_uart_init();
+    vTaskDelay(pdMS_TO_TICKS(50));
+
+    usb_midi_host_init();
+    vTaskDelay(pdMS_TO_TICKS(50));
+
+    uart_midi_out_init();
+    vTaskDelay(pdMS_TO_TICKS(20));
+
+    midi_out_start();
+    lat_stats_init();
+
+    footswitch_start();
+    expfs_start();
+
+    s_boot_done = true;
+    vTaskDelete(NULL);
+}
+
+void host_boot(void)
+{
+    s_boot_done = false;
+    xTaskCreatePinnedToCore(host_bootstrap_task, "bootstrap", 6144, NULL, 8, NULL, 0);
+    while (!s_boot_done) host_run_for(10 * 1000);
+}
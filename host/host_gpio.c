@@ -0,0 +1,180 @@
+// ===== FILE: host/host_gpio.c =====
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#include "driver/gpio.h"
+#include "host.h"
+
+// pin level = output latch (output mode) / scripted input / pull (nothing driving it)
+// edges from any of them fire the pin ISR, synchronously, in the caller's context
+
+typedef struct {
+    gpio_mode_t mode;
+    int8_t pull;          // 1 up, -1 down, 0 none
+    int8_t driven;        // host_gpio_input level, -1 = floating
+    uint8_t out;
+    uint8_t level;        // last effective level
+    gpio_int_type_t intr;
+    bool intr_on;
+    gpio_isr_t isr;
+    void *isr_arg;
+} host_pin_t;
+
+static host_pin_t s_pin[GPIO_PIN_COUNT];
+static bool s_inited = false;
+
+static void pins_init(void)
+{
+    if (s_inited) return;
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) s_pin[i].driven = -1;
+    s_inited = true;
+}
+
+static bool pin_ok(int pin)
+{
+    pins_init();
+    return pin >= 0 && pin < GPIO_PIN_COUNT;
+}
+
+static uint8_t pin_eval(const host_pin_t *p)
+{
+    if (p->mode == GPIO_MODE_OUTPUT || p->mode == GPIO_MODE_INPUT_OUTPUT) return p->out;
+    if (p->driven >= 0) return (uint8_t)p->driven;
+    return (p->pull > 0) ? 1 : 0;
+}
+
+static void pin_update(int pin)
+{
+    host_pin_t *p = &s_pin[pin];
+    const uint8_t old = p->level;
+    p->level = pin_eval(p);
+    if (p->level == old || !p->isr || !p->intr_on) return;
+
+    bool fire = false;
+    switch (p->intr) {
+    case GPIO_INTR_POSEDGE:    fire = p->level;  break;
+    case GPIO_INTR_NEGEDGE:    fire = !p->level; break;
+    case GPIO_INTR_ANYEDGE:    fire = true;      break;
+    case GPIO_INTR_LOW_LEVEL:  fire = !p->level; break;
+    case GPIO_INTR_HIGH_LEVEL: fire = p->level;  break;
+    default: break;
+    }
+    if (fire) p->isr(p->isr_arg);
+}
+
+// -------------------- driver API --------------------
+esp_err_t gpio_config(const gpio_config_t *cfg)
+{
+    if (!cfg) return ESP_ERR_INVALID_ARG;
+    pins_init();
+    for (int i = 0; i < GPIO_PIN_COUNT; i++) {
+        if (!(cfg->pin_bit_mask & (1ULL << i))) continue;
+        host_pin_t *p = &s_pin[i];
+        p->mode = cfg->mode;
+        p->pull = cfg->pull_up_en ? 1 : (cfg->pull_down_en ? -1 : 0);
+        p->intr = cfg->intr_type;
+        p->intr_on = (cfg->intr_type != GPIO_INTR_DISABLE);
+        p->level = pin_eval(p);
+    }
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(gpio_num_t pin)
+{
+    if (!pin_ok(pin)) return ESP_ERR_INVALID_ARG;
+    host_pin_t *p = &s_pin[pin];
+    const int8_t driven = p->driven;
+    memset(p, 0, sizeof(*p));
+    p->driven = driven;
+    p->pull = 1;
+    p->level = pin_eval(p);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t pin, gpio_mode_t mode)
+{
+    if (!pin_ok(pin)) return ESP_ERR_INVALID_ARG;
+    s_pin[pin].mode = mode;
+    pin_update(pin);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_pull_mode(gpio_num_t pin, gpio_pull_mode_t pull)
+{
+    if (!pin_ok(pin)) return ESP_ERR_INVALID_ARG;
+    s_pin[pin].pull = (pull == GPIO_PULLUP_ONLY) ? 1 : (pull == GPIO_PULLDOWN_ONLY ? -1 : 0);
+    pin_update(pin);
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(gpio_num_t pin, uint32_t level)
+{
+    if (!pin_ok(pin)) return ESP_ERR_INVALID_ARG;
+    s_pin[pin].out = level ? 1 : 0;
+    pin_update(pin);
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t pin)
+{
+    if (!pin_ok(pin)) return 0;
+    return pin_eval(&s_pin[pin]);
+}
+
+esp_err_t gpio_set_intr_type(gpio_num_t pin, gpio_int_type_t type)
+{
+    if (!pin_ok(pin)) return ESP_ERR_INVALID_ARG;
+    s_pin[pin].intr = type;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_enable(gpio_num_t pin)
+{
+    if (!pin_ok(pin)) return ESP_ERR_INVALID_ARG;
+    s_pin[pin].intr_on = true;
+    return ESP_OK;
+}
+
+esp_err_t gpio_intr_disable(gpio_num_t pin)
+{
+    if (!pin_ok(pin)) return ESP_ERR_INVALID_ARG;
+    s_pin[pin].intr_on = false;
+    return ESP_OK;
+}
+
+esp_err_t gpio_install_isr_service(int flags)
+{
+    (void)flags;
+    pins_init();
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_add(gpio_num_t pin, gpio_isr_t fn, void *arg)
+{
+    if (!pin_ok(pin)) return ESP_ERR_INVALID_ARG;
+    s_pin[pin].isr = fn;
+    s_pin[pin].isr_arg = arg;
+    return ESP_OK;
+}
+
+esp_err_t gpio_isr_handler_remove(gpio_num_t pin)
+{
+    if (!pin_ok(pin)) return ESP_ERR_INVALID_ARG;
+    s_pin[pin].isr = NULL;
+    s_pin[pin].isr_arg = NULL;
+    return ESP_OK;
+}
+
+// -------------------- harness --------------------
+void host_gpio_input(int pin, int level)
+{
+    if (!pin_ok(pin)) return;
+    s_pin[pin].driven = (int8_t)((level < 0) ? -1 : (level ? 1 : 0));
+    pin_update(pin);
+}
+
+int host_gpio_get(int pin)
+{
+    return gpio_get_level(pin);
+}
@@ -0,0 +1,200 @@
+// ===== FILE: host/host_midi.c =====
+#include <stdint.h>
+#include <string.h>
+
+#include "freertos/FreeRTOS.h"
+#include "driver/uart.h"
+
+#include "usb_midi_host.h"
+#include "lat_stats.h"
+#include "host.h"
+
+// MIDI transports as capture buffers.
+//
+// - USB: usb_midi_host.h API with the same batching as the device (one 64 byte transfer,
+//   submit when full or on flush). a submitted transfer is "on the wire" at once
+// - UART: the real uart_midi_out.c runs on top of this driver/uart.h shim,
+//   bytes written to UART1 are MIDI, UART2 is the display link
+
+#define HOST_USB_MPS   64
+#define HOST_UART_MIDI UART_NUM_1
+#define HOST_UART_DISP UART_NUM_2
+
+static host_midi_sink_t s_midi_sink = NULL;
+static void *s_midi_arg = NULL;
+static host_uart_sink_t s_disp_sink = NULL;
+static void *s_disp_arg = NULL;
+
+static int s_usb_connected = 1;
+static int s_usb_stalled = 0;
+static uint8_t s_agg[HOST_USB_MPS];
+static int s_agg_len = 0;
+static uint32_t s_agg_t0 = 0;
+
+void host_midi_set_sink(host_midi_sink_t fn, void *arg)
+{
+    s_midi_sink = fn;
+    s_midi_arg = arg;
+}
+
+void host_display_set_sink(host_uart_sink_t fn, void *arg)
+{
+    s_disp_sink = fn;
+    s_disp_arg = arg;
+}
+
+void host_usb_midi_connect(int on)
+{
+    s_usb_connected = on ? 1 : 0;
+    if (!on) {
+        s_agg_len = 0;
+        s_agg_t0 = 0;
+    }
+}
+
+void host_usb_midi_stall(int on)
+{
+    s_usb_stalled = on ? 1 : 0;
+}
+
+static void emit(uint8_t tx, const uint8_t *b, int n)
+{
+    if (!s_midi_sink || n <= 0) return;
+    host_midi_evt_t e = { .t_us = host_now_us(), .tx = tx, .len = (uint8_t)n };
+    memcpy(e.b, b, (size_t)n);
+    s_midi_sink(&e, s_midi_arg);
+}
+
+// -------------------- USB --------------------
+static int cin_len(uint8_t cin)
+{
+    switch (cin & 0x0F) {
+    case 0x5: case 0xF:             return 1;
+    case 0x2: case 0x6: case 0xC: case 0xD: return 2;
+    default:                        return 3;
+    }
+}
+
+void usb_midi_host_init(void) { }
+
+int usb_midi_ready_fast(void) { return s_usb_connected; }
+
+esp_err_t usb_midi_flush(void)
+{
+    if (!s_agg_len) return ESP_OK;
+
+    for (int i = 0; i < s_agg_len; i += 4) emit(HOST_MIDI_USB, &s_agg[i + 1], cin_len(s_agg[i]));
+    lat_since(LAT_WIRE_USB, s_agg_t0);
+
+    s_agg_len = 0;
+    s_agg_t0 = 0;
+    return ESP_OK;
+}
+
+esp_err_t usb_midi_queue_pkt_ts(const uint8_t pkt4[4], uint32_t t0_us)
+{
+    if (!pkt4) return ESP_ERR_INVALID_ARG;
+    if (!s_usb_connected) return ESP_ERR_INVALID_STATE;
+    if (s_usb_stalled) return ESP_ERR_TIMEOUT;
+
+    if (t0_us && !s_agg_t0) s_agg_t0 = t0_us;
+    memcpy(&s_agg[s_agg_len], pkt4, 4);
+    s_agg_len += 4;
+
+    if (s_agg_len + 4 > HOST_USB_MPS) return usb_midi_flush();
+    return ESP_OK;
+}
+
+esp_err_t usb_midi_queue_pkt(const uint8_t pkt4[4])
+{
+    return usb_midi_queue_pkt_ts(pkt4, 0);
+}
+
+esp_err_t usb_midi_send_pkt(const uint8_t pkt4[4])
+{
+    esp_err_t err = usb_midi_queue_pkt(pkt4);
+    if (err != ESP_OK) return err;
+    return usb_midi_flush();
+}
+
+static inline uint8_t ch_bits(uint8_t ch_1_16)
+{
+    if (ch_1_16 < 1) ch_1_16 = 1;
+    if (ch_1_16 > 16) ch_1_16 = 16;
+    return (uint8_t)(ch_1_16 - 1);
+}
+
+esp_err_t usb_midi_send_cc(uint8_t ch_1_16, uint8_t cc, uint8_t val)
+{
+    const uint8_t p[4] = { 0x0B, (uint8_t)(0xB0 | ch_bits(ch_1_16)), (uint8_t)(cc & 0x7F), (uint8_t)(val & 0x7F) };
+    return usb_midi_send_pkt(p);
+}
+
+esp_err_t usb_midi_send_pc(uint8_t ch_1_16, uint8_t pc)
+{
+    const uint8_t p[4] = { 0x0C, (uint8_t)(0xC0 | ch_bits(ch_1_16)), (uint8_t)(pc & 0x7F), 0 };
+    return usb_midi_send_pkt(p);
+}
+
+esp_err_t usb_midi_send_note_on(uint8_t ch_1_16, uint8_t note, uint8_t vel)
+{
+    const uint8_t p[4] = { 0x09, (uint8_t)(0x90 | ch_bits(ch_1_16)), (uint8_t)(note & 0x7F), (uint8_t)(vel & 0x7F) };
+    return usb_midi_send_pkt(p);
+}
+
+esp_err_t usb_midi_send_note_off(uint8_t ch_1_16, uint8_t note, uint8_t vel)
+{
+    const uint8_t p[4] = { 0x08, (uint8_t)(0x80 | ch_bits(ch_1_16)), (uint8_t)(note & 0x7F), (uint8_t)(vel & 0x7F) };
+    return usb_midi_send_pkt(p);
+}
+
+esp_err_t usb_midi_send_rt(uint8_t rt_byte)
+{
+    const uint8_t p[4] = { 0x0F, rt_byte, 0, 0 };
+    return usb_midi_send_pkt(p);
+}
+
+// -------------------- UART driver --------------------
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *cfg)
+{
+    (void)cfg;
+    return (port >= 0 && port < UART_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts)
+{
+    (void)tx; (void)rx; (void)rts; (void)cts;
+    return (port >= 0 && port < UART_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buf, int tx_buf, int queue_size, void *queue, int intr_flags)
+{
+    (void)rx_buf; (void)tx_buf; (void)queue_size; (void)queue; (void)intr_flags;
+    return (port >= 0 && port < UART_NUM_MAX) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+int uart_write_bytes(uart_port_t port, const void *src, size_t size)
+{
+    const uint8_t *b = (const uint8_t *)src;
+
+    if (port == HOST_UART_MIDI) {
+        for (size_t i = 0; i < size; i += 3) emit(HOST_MIDI_UART, b + i, (int)((size - i) < 3 ? (size - i) : 3));
+    } else if (port == HOST_UART_DISP && s_disp_sink) {
+        s_disp_sink(b, size, s_disp_arg);
+    }
+    return (int)size;
+}
+
+esp_err_t uart_wait_tx_done(uart_port_t port, TickType_t ticks)
+{
+    (void)port;
+    (void)ticks;
+    return ESP_OK;
+}
+
+esp_err_t uart_get_tx_buffer_free_size(uart_port_t port, size_t *size)
+{
+    (void)port;
+    if (size) *size = 512;
+    return ESP_OK;
+}
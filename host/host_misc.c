@@ -0,0 +1,192 @@
+// ===== FILE: host/host_misc.c =====
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <sys/stat.h>
+
+#include "esp_err.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_spiffs.h"
+#include "mbedtls/base64.h"
+#include "esp_rom_crc.h"
+#include "host.h"
+
+// small leftovers: logging, error names, reset reason, SPIFFS as a directory, base64, crc32
+
+// -------------------- log --------------------
+static esp_log_level_t s_level = ESP_LOG_WARN;
+
+void esp_log_level_set(const char *tag, esp_log_level_t level)
+{
+    (void)tag;
+    s_level = level;
+}
+
+void host_log(esp_log_level_t level, const char *tag, const char *fmt, ...)
+{
+    if (level > s_level || level == ESP_LOG_NONE) return;
+
+    static const char L[] = "NEWIDV";
+    fprintf(stderr, "%c (%lld) %s: ", L[level], (long long)(host_now_us() / 1000), tag);
+
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+}
+
+// -------------------- esp_err / system --------------------
+const char *esp_err_to_name(esp_err_t code)
+{
+    switch (code) {
+    case ESP_OK:                        return "ESP_OK";
+    case ESP_FAIL:                      return "ESP_FAIL";
+    case ESP_ERR_NO_MEM:                return "ESP_ERR_NO_MEM";
+    case ESP_ERR_INVALID_ARG:           return "ESP_ERR_INVALID_ARG";
+    case ESP_ERR_INVALID_STATE:         return "ESP_ERR_INVALID_STATE";
+    case ESP_ERR_INVALID_SIZE:          return "ESP_ERR_INVALID_SIZE";
+    case ESP_ERR_NOT_FOUND:             return "ESP_ERR_NOT_FOUND";
+    case ESP_ERR_NOT_SUPPORTED:         return "ESP_ERR_NOT_SUPPORTED";
+    case ESP_ERR_TIMEOUT:               return "ESP_ERR_TIMEOUT";
+    case ESP_ERR_INVALID_CRC:           return "ESP_ERR_INVALID_CRC";
+    case ESP_ERR_NVS_NOT_INITIALIZED:   return "ESP_ERR_NVS_NOT_INITIALIZED";
+    case ESP_ERR_NVS_NOT_FOUND:         return "ESP_ERR_NVS_NOT_FOUND";
+    case ESP_ERR_NVS_TYPE_MISMATCH:     return "ESP_ERR_NVS_TYPE_MISMATCH";
+    case ESP_ERR_NVS_INVALID_HANDLE:    return "ESP_ERR_NVS_INVALID_HANDLE";
+    case ESP_ERR_NVS_INVALID_LENGTH:    return "ESP_ERR_NVS_INVALID_LENGTH";
+    case ESP_ERR_NVS_NO_FREE_PAGES:     return "ESP_ERR_NVS_NO_FREE_PAGES";
+    case ESP_ERR_NVS_NEW_VERSION_FOUND: return "ESP_ERR_NVS_NEW_VERSION_FOUND";
+    default:                            return "ESP_ERR_UNKNOWN";
+    }
+}
+
+esp_reset_reason_t esp_reset_reason(void)
+{
+    return ESP_RST_POWERON;
+}
+
+// same as ESP-IDF: up to 5 handlers, run by esp_restart() in reverse order
+#define SHUTDOWN_HANDLERS 5
+static shutdown_handler_t s_shutdown[SHUTDOWN_HANDLERS];
+
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle)
+{
+    for (int i = 0; i < SHUTDOWN_HANDLERS; i++) {
+        if (s_shutdown[i] == handle) return ESP_ERR_INVALID_STATE;
+        if (!s_shutdown[i]) {
+            s_shutdown[i] = handle;
+            return ESP_OK;
+        }
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void esp_restart(void)
+{
+    for (int i = SHUTDOWN_HANDLERS - 1; i >= 0; i--) {
+        if (s_shutdown[i]) s_shutdown[i]();
+    }
+    fprintf(stderr, "esp_restart() -> exit\n");
+    exit(0);
+}
+
+// -------------------- SPIFFS --------------------
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf)
+{
+    if (!conf || !conf->base_path) return ESP_ERR_INVALID_ARG;
+    const char *dir = (conf->base_path[0] == '/') ? conf->base_path + 1 : conf->base_path;
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) return ESP_FAIL;
+    return ESP_OK;
+}
+
+esp_err_t esp_vfs_spiffs_unregister(const char *partition_label)
+{
+    (void)partition_label;
+    return ESP_OK;
+}
+
+esp_err_t esp_spiffs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes)
+{
+    (void)partition_label;
+    if (total_bytes) *total_bytes = 1024 * 1024;
+    if (used_bytes) *used_bytes = 0;
+    return ESP_OK;
+}
+
+// -------------------- base64 --------------------
+static const char B64[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+int mbedtls_base64_encode(unsigned char *dst, size_t dlen, size_t *olen,
+                          const unsigned char *src, size_t slen)
+{
+    const size_t need = 4 * ((slen + 2) / 3);
+    *olen = need + 1;
+    if (!dst || dlen < need + 1) return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+
+    size_t o = 0;
+    for (size_t i = 0; i < slen; i += 3) {
+        uint32_t v = (uint32_t)src[i] << 16;
+        if (i + 1 < slen) v |= (uint32_t)src[i + 1] << 8;
+        if (i + 2 < slen) v |= src[i + 2];
+        dst[o++] = (unsigned char)B64[(v >> 18) & 63];
+        dst[o++] = (unsigned char)B64[(v >> 12) & 63];
+        dst[o++] = (i + 1 < slen) ? (unsigned char)B64[(v >> 6) & 63] : '=';
+        dst[o++] = (i + 2 < slen) ? (unsigned char)B64[v & 63] : '=';
+    }
+    dst[o] = 0;
+    *olen = o;
+    return 0;
+}
+
+static int b64_val(unsigned char c)
+{
+    const char *p = (c && c != '=') ? strchr(B64, c) : NULL;
+    return p ? (int)(p - B64) : -1;
+}
+
+int mbedtls_base64_decode(unsigned char *dst, size_t dlen, size_t *olen,
+                          const unsigned char *src, size_t slen)
+{
+    // count payload, reject junk (whitespace is not accepted here)
+    size_t n = 0, pad = 0;
+    for (size_t i = 0; i < slen; i++) {
+        if (src[i] == '=') { pad++; continue; }
+        if (pad || b64_val(src[i]) < 0) return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+        n++;
+    }
+    if ((n + pad) % 4 || pad > 2) return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+
+    const size_t need = (n * 6) / 8;
+    *olen = need;
+    if (!dst || dlen < need) return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+
+    uint32_t acc = 0;
+    int bits = 0;
+    size_t o = 0;
+    for (size_t i = 0; i < slen; i++) {
+        if (src[i] == '=') break;
+        acc = (acc << 6) | (uint32_t)b64_val(src[i]);
+        bits += 6;
+        if (bits >= 8) {
+            bits -= 8;
+            dst[o++] = (unsigned char)((acc >> bits) & 0xFF);
+        }
+    }
+    *olen = o;
+    return 0;
+}
+
+// -------------------- crc32 (ROM) --------------------
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len)
+{
+    crc = ~crc;
+    for (uint32_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1u)));
+    }
+    return ~crc;
+}
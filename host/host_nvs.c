@@ -0,0 +1,304 @@
+// ===== FILE: host/host_nvs.c =====
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "nvs.h"
+#include "nvs_flash.h"
+#include "host.h"
+
+// in-memory key/value store, written to one file on nvs_commit()
+// (writes are visible at once like the real NVS, the file only matters across runs)
+//
+// file: "HNVS1" then records { u8 ns_len, ns, u8 key_len, key, u8 type, u32 len, data }
+
+#define NVS_KEY_MAX   16
+#define NVS_NS_MAX    16
+#define NVS_HANDLES   16
+
+typedef enum { NT_U8 = 1, NT_U16, NT_U32, NT_BLOB } nvs_type_t;
+
+typedef struct nvs_ent {
+    char ns[NVS_NS_MAX];
+    char key[NVS_KEY_MAX];
+    uint8_t type;
+    uint32_t len;
+    uint8_t *data;
+    struct nvs_ent *next;
+} nvs_ent_t;
+
+typedef struct {
+    bool used;
+    bool rw;
+    char ns[NVS_NS_MAX];
+} nvs_open_t;
+
+static const char *s_path = "nvs.bin";
+static bool s_inited = false;
+static nvs_ent_t *s_ents = NULL;
+static nvs_open_t s_h[NVS_HANDLES];
+
+// flash traffic of the real NVS layout (benchmarks): 32 byte entries, a blob = index entry
+// + chunk header entry + data entries. an unchanged value is not written (like nvs_set_*)
+static uint32_t s_rd_bytes = 0;
+static uint32_t s_prog_bytes = 0;
+
+void host_nvs_set_path(const char *path)
+{
+    s_path = path;
+}
+
+void host_nvs_get_stats(uint32_t *read_bytes, uint32_t *prog_bytes)
+{
+    if (read_bytes) *read_bytes = s_rd_bytes;
+    if (prog_bytes) *prog_bytes = s_prog_bytes;
+}
+
+static uint32_t ent_flash_size(uint8_t type, size_t len)
+{
+    return (type == NT_BLOB) ? 32u * (2u + (uint32_t)((len + 31) / 32)) : 32u;
+}
+
+// -------------------- store --------------------
+static void ents_clear(void)
+{
+    while (s_ents) {
+        nvs_ent_t *e = s_ents;
+        s_ents = e->next;
+        free(e->data);
+        free(e);
+    }
+}
+
+static nvs_ent_t *ent_find(const char *ns, const char *key)
+{
+    for (nvs_ent_t *e = s_ents; e; e = e->next) {
+        if (!strcmp(e->ns, ns) && !strcmp(e->key, key)) return e;
+    }
+    return NULL;
+}
+
+static esp_err_t ent_put(const char *ns, const char *key, uint8_t type, const void *v, size_t len)
+{
+    if (!key || strlen(key) >= NVS_KEY_MAX) return ESP_ERR_INVALID_ARG;
+
+    uint8_t *d = malloc(len ? len : 1);
+    if (!d) return ESP_ERR_NO_MEM;
+    if (len) memcpy(d, v, len);
+
+    nvs_ent_t *e = ent_find(ns, key);
+    if (!e) {
+        e = calloc(1, sizeof(*e));
+        if (!e) { free(d); return ESP_ERR_NO_MEM; }
+        snprintf(e->ns, sizeof(e->ns), "%s", ns);
+        snprintf(e->key, sizeof(e->key), "%s", key);
+        e->next = s_ents;
+        s_ents = e;
+    }
+    free(e->data);
+    e->data = d;
+    e->len = (uint32_t)len;
+    e->type = type;
+    return ESP_OK;
+}
+
+static bool rd(FILE *f, void *p, size_t n) { return fread(p, 1, n, f) == n; }
+
+static void store_load(void)
+{
+    ents_clear();
+    if (!s_path) return;
+
+    FILE *f = fopen(s_path, "rb");
+    if (!f) return;
+
+    char magic[5];
+    if (!rd(f, magic, 5) || memcmp(magic, "HNVS1", 5)) { fclose(f); return; }
+
+    for (;;) {
+        char ns[NVS_NS_MAX] = {0}, key[NVS_KEY_MAX] = {0};
+        uint8_t nl, kl, type;
+        uint32_t len;
+        if (!rd(f, &nl, 1) || nl >= NVS_NS_MAX || !rd(f, ns, nl)) break;
+        if (!rd(f, &kl, 1) || kl >= NVS_KEY_MAX || !rd(f, key, kl)) break;
+        if (!rd(f, &type, 1) || !rd(f, &len, 4) || len > (1u << 20)) break;
+
+        uint8_t *d = malloc(len ? len : 1);
+        if (!d) break;
+        if (!rd(f, d, len)) { free(d); break; }
+        (void)ent_put(ns, key, type, d, len);
+        free(d);
+    }
+    fclose(f);
+}
+
+static esp_err_t store_save(void)
+{
+    if (!s_path) return ESP_OK;
+
+    FILE *f = fopen(s_path, "wb");
+    if (!f) return ESP_FAIL;
+
+    fwrite("HNVS1", 1, 5, f);
+    for (nvs_ent_t *e = s_ents; e; e = e->next) {
+        uint8_t nl = (uint8_t)strlen(e->ns), kl = (uint8_t)strlen(e->key);
+        fwrite(&nl, 1, 1, f);
+        fwrite(e->ns, 1, nl, f);
+        fwrite(&kl, 1, 1, f);
+        fwrite(e->key, 1, kl, f);
+        fwrite(&e->type, 1, 1, f);
+        fwrite(&e->len, 4, 1, f);
+        fwrite(e->data, 1, e->len, f);
+    }
+    return fclose(f) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+// -------------------- nvs_flash --------------------
+esp_err_t nvs_flash_init(void)
+{
+    if (s_inited) return ESP_OK;
+    store_load();
+    s_inited = true;
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void)
+{
+    ents_clear();
+    if (s_path) remove(s_path);
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_deinit(void)
+{
+    ents_clear();
+    memset(s_h, 0, sizeof(s_h));
+    s_inited = false;
+    return ESP_OK;
+}
+
+// -------------------- handles --------------------
+static nvs_open_t *h_get(nvs_handle_t h)
+{
+    if (h == 0 || h > NVS_HANDLES || !s_h[h - 1].used) return NULL;
+    return &s_h[h - 1];
+}
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out)
+{
+    if (!s_inited) return ESP_ERR_NVS_NOT_INITIALIZED;
+    if (!ns || !out || strlen(ns) >= NVS_NS_MAX) return ESP_ERR_INVALID_ARG;
+
+    for (int i = 0; i < NVS_HANDLES; i++) {
+        if (s_h[i].used) continue;
+        s_h[i].used = true;
+        s_h[i].rw = (mode == NVS_READWRITE);
+        snprintf(s_h[i].ns, sizeof(s_h[i].ns), "%s", ns);
+        *out = (nvs_handle_t)(i + 1);
+        return ESP_OK;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void nvs_close(nvs_handle_t h)
+{
+    nvs_open_t *o = h_get(h);
+    if (o) o->used = false;
+}
+
+esp_err_t nvs_commit(nvs_handle_t h)
+{
+    if (!h_get(h)) return ESP_ERR_NVS_INVALID_HANDLE;
+    return store_save();
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t h, const char *key)
+{
+    nvs_open_t *o = h_get(h);
+    if (!o) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!o->rw) return ESP_ERR_INVALID_STATE;
+
+    for (nvs_ent_t **pp = &s_ents; *pp; pp = &(*pp)->next) {
+        nvs_ent_t *e = *pp;
+        if (strcmp(e->ns, o->ns) || strcmp(e->key, key)) continue;
+        *pp = e->next;
+        free(e->data);
+        free(e);
+        return ESP_OK;
+    }
+    return ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t h)
+{
+    nvs_open_t *o = h_get(h);
+    if (!o) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!o->rw) return ESP_ERR_INVALID_STATE;
+
+    for (nvs_ent_t **pp = &s_ents; *pp;) {
+        nvs_ent_t *e = *pp;
+        if (!strcmp(e->ns, o->ns)) {
+            *pp = e->next;
+            free(e->data);
+            free(e);
+        } else {
+            pp = &e->next;
+        }
+    }
+    return ESP_OK;
+}
+
+// -------------------- typed get / set --------------------
+static esp_err_t get_typed(nvs_handle_t h, const char *key, uint8_t type, void *out, size_t len)
+{
+    nvs_open_t *o = h_get(h);
+    if (!o) return ESP_ERR_NVS_INVALID_HANDLE;
+    nvs_ent_t *e = ent_find(o->ns, key);
+    if (!e || e->type != type) return ESP_ERR_NVS_NOT_FOUND;
+    s_rd_bytes += ent_flash_size(type, len);
+    memcpy(out, e->data, len);
+    return ESP_OK;
+}
+
+static esp_err_t set_typed(nvs_handle_t h, const char *key, uint8_t type, const void *v, size_t len)
+{
+    nvs_open_t *o = h_get(h);
+    if (!o) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!o->rw) return ESP_ERR_INVALID_STATE;
+
+    nvs_ent_t *e = ent_find(o->ns, key);
+    if (e && e->type == type && e->len == len && (!len || !memcmp(e->data, v, len))) return ESP_OK;
+    s_prog_bytes += ent_flash_size(type, len);
+    return ent_put(o->ns, key, type, v, len);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t h, const char *key, uint8_t *out)   { return get_typed(h, key, NT_U8, out, 1); }
+esp_err_t nvs_set_u8(nvs_handle_t h, const char *key, uint8_t v)      { return set_typed(h, key, NT_U8, &v, 1); }
+esp_err_t nvs_get_u16(nvs_handle_t h, const char *key, uint16_t *out) { return get_typed(h, key, NT_U16, out, 2); }
+esp_err_t nvs_set_u16(nvs_handle_t h, const char *key, uint16_t v)    { return set_typed(h, key, NT_U16, &v, 2); }
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *key, uint32_t *out) { return get_typed(h, key, NT_U32, out, 4); }
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *key, uint32_t v)    { return set_typed(h, key, NT_U32, &v, 4); }
+
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len)
+{
+    nvs_open_t *o = h_get(h);
+    if (!o) return ESP_ERR_NVS_INVALID_HANDLE;
+    if (!len) return ESP_ERR_INVALID_ARG;
+
+    nvs_ent_t *e = ent_find(o->ns, key);
+    if (!e || e->type != NT_BLOB) return ESP_ERR_NVS_NOT_FOUND;
+
+    if (!out) { *len = e->len; return ESP_OK; }
+    if (*len < e->len) { *len = e->len; return ESP_ERR_NVS_INVALID_LENGTH; }
+    s_rd_bytes += ent_flash_size(NT_BLOB, e->len);
+    memcpy(out, e->data, e->len);
+    *len = e->len;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *v, size_t len)
+{
+    return set_typed(h, key, NT_BLOB, v, len);
+}
@@ -0,0 +1,139 @@
+// ===== FILE: host/host_partition.c =====
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "esp_partition.h"
+#include "host.h"
+
+// raw data partitions of partitions.csv the firmware opens by label. each one is a RAM
+// image loaded from / written through to "./<label>.bin" (missing file = erased flash)
+
+#define PART_MAX    4
+#define PART_SEC    4096u
+
+typedef struct {
+    esp_partition_t p;
+    uint8_t *img;      // NULL until first use
+    bool on;
+} host_part_t;
+
+// partitions.csv
+static host_part_t s_parts[PART_MAX] = {
+    { .p = { ESP_PARTITION_TYPE_DATA, 0x40, 0xF60000, 0x80000, PART_SEC, "cfglog", false }, .on = true },
+};
+
+void host_partition_set(const char *label, uint32_t size)
+{
+    for (int i = 0; i < PART_MAX; i++) {
+        host_part_t *hp = &s_parts[i];
+        if (strcmp(hp->p.label, label)) continue;
+
+        free(hp->img);
+        hp->img = NULL;
+        hp->on = (size != 0);
+        if (size) hp->p.size = size;
+        return;
+    }
+}
+
+static void part_path(const host_part_t *hp, char *out, size_t n)
+{
+    snprintf(out, n, "%s.bin", hp->p.label);
+}
+
+static bool part_load(host_part_t *hp)
+{
+    if (hp->img) return true;
+
+    hp->img = malloc(hp->p.size);
+    if (!hp->img) return false;
+    memset(hp->img, 0xFF, hp->p.size);
+
+    char path[48];
+    part_path(hp, path, sizeof(path));
+    FILE *f = fopen(path, "rb");
+    if (f) {
+        size_t n = fread(hp->img, 1, hp->p.size, f);
+        (void)n;
+        fclose(f);
+    }
+    return true;
+}
+
+// write-through of the touched range (the image is tiny, keep it simple and crash-safe
+// enough for a test harness)
+static esp_err_t part_flush(host_part_t *hp, size_t off, size_t n)
+{
+    char path[48];
+    part_path(hp, path, sizeof(path));
+
+    FILE *f = fopen(path, "r+b");
+    if (!f) {
+        f = fopen(path, "w+b");
+        if (!f) return ESP_FAIL;
+        if (fwrite(hp->img, 1, hp->p.size, f) != hp->p.size) { fclose(f); return ESP_FAIL; }
+        fclose(f);
+        return ESP_OK;
+    }
+    bool ok = (fseek(f, (long)off, SEEK_SET) == 0) && (fwrite(hp->img + off, 1, n, f) == n);
+    fclose(f);
+    return ok ? ESP_OK : ESP_FAIL;
+}
+
+static host_part_t *part_of(const esp_partition_t *part)
+{
+    for (int i = 0; i < PART_MAX; i++) {
+        if (&s_parts[i].p == part) return part_load(&s_parts[i]) ? &s_parts[i] : NULL;
+    }
+    return NULL;
+}
+
+const esp_partition_t *esp_partition_find_first(esp_partition_type_t type,
+                                                esp_partition_subtype_t subtype, const char *label)
+{
+    for (int i = 0; i < PART_MAX; i++) {
+        host_part_t *hp = &s_parts[i];
+        if (!hp->on || !hp->p.label[0]) continue;
+        if (type != ESP_PARTITION_TYPE_ANY && hp->p.type != type) continue;
+        if (subtype != ESP_PARTITION_SUBTYPE_ANY && hp->p.subtype != subtype) continue;
+        if (label && strcmp(hp->p.label, label)) continue;
+        return &hp->p;
+    }
+    return NULL;
+}
+
+esp_err_t esp_partition_read(const esp_partition_t *part, size_t src_offset, void *dst, size_t size)
+{
+    host_part_t *hp = part_of(part);
+    if (!hp || !dst) return ESP_ERR_INVALID_ARG;
+    if (src_offset > hp->p.size || size > hp->p.size - src_offset) return ESP_ERR_INVALID_SIZE;
+
+    memcpy(dst, hp->img + src_offset, size);
+    return ESP_OK;
+}
+
+esp_err_t esp_partition_write(const esp_partition_t *part, size_t dst_offset, const void *src, size_t size)
+{
+    host_part_t *hp = part_of(part);
+    if (!hp || !src) return ESP_ERR_INVALID_ARG;
+    if (dst_offset > hp->p.size || size > hp->p.size - dst_offset) return ESP_ERR_INVALID_SIZE;
+
+    // NOR: programming can only clear bits
+    const uint8_t *s = (const uint8_t *)src;
+    for (size_t i = 0; i < size; i++) hp->img[dst_offset + i] &= s[i];
+    return part_flush(hp, dst_offset, size);
+}
+
+esp_err_t esp_partition_erase_range(const esp_partition_t *part, size_t offset, size_t size)
+{
+    host_part_t *hp = part_of(part);
+    if (!hp) return ESP_ERR_INVALID_ARG;
+    if ((offset % PART_SEC) || (size % PART_SEC)) return ESP_ERR_INVALID_ARG;
+    if (offset > hp->p.size || size > hp->p.size - offset) return ESP_ERR_INVALID_SIZE;
+
+    memset(hp->img + offset, 0xFF, size);
+    return part_flush(hp, offset, size);
+}
@@ -0,0 +1,67 @@
+// ===== FILE: host/host_rgb_led.c =====
+#include <stdint.h>
+
+#include "rgb_led.h"
+#include "host.h"
+
+// rgb_led.h without the strip: colors / on flags / brightness are only stored
+
+static uint32_t s_hex[RGB_LED_STRIP_LED_COUNT];
+static uint8_t s_on[RGB_LED_STRIP_LED_COUNT];
+static uint8_t s_bri = 100;
+
+static int idx_ok(int idx) { return idx >= 0 && idx < RGB_LED_STRIP_LED_COUNT; }
+
+esp_err_t rgb_led_init(void) { return ESP_OK; }
+
+void rgb_led_set_brightness(uint8_t percent) { s_bri = (percent > 100) ? 100 : percent; }
+uint8_t rgb_led_get_brightness(void) { return s_bri; }
+
+void rgb_led_set_pixel_hex(int idx, uint32_t hex_rgb)
+{
+    if (idx_ok(idx)) s_hex[idx] = hex_rgb & 0xFFFFFFu;
+}
+
+uint32_t rgb_led_get_pixel_hex(int idx)
+{
+    return idx_ok(idx) ? s_hex[idx] : 0;
+}
+
+void rgb_led_set_pixels_hex(const uint32_t *hex_rgb, int n)
+{
+    if (!hex_rgb) return;
+    for (int i = 0; i < n && i < RGB_LED_STRIP_LED_COUNT; i++) s_hex[i] = hex_rgb[i] & 0xFFFFFFu;
+}
+
+void rgb_led_set_hex(uint32_t hex_rgb)
+{
+    for (int i = 0; i < RGB_LED_STRIP_LED_COUNT; i++) s_hex[i] = hex_rgb & 0xFFFFFFu;
+}
+
+uint32_t rgb_led_get_hex(void) { return s_hex[0]; }
+
+void rgb_led_set_pixel_on(int idx, int on)
+{
+    if (idx_ok(idx)) s_on[idx] = on ? 1 : 0;
+}
+
+int rgb_led_get_pixel_on(int idx)
+{
+    return idx_ok(idx) ? s_on[idx] : 0;
+}
+
+void rgb_led_all_off(void)
+{
+    for (int i = 0; i < RGB_LED_STRIP_LED_COUNT; i++) s_on[i] = 0;
+}
+
+void rgb_led_all_on(void)
+{
+    for (int i = 0; i < RGB_LED_STRIP_LED_COUNT; i++) s_on[i] = 1;
+}
+
+uint32_t host_led_get(int idx, int *on)
+{
+    if (on) *on = rgb_led_get_pixel_on(idx);
+    return rgb_led_get_pixel_hex(idx);
+}
@@ -0,0 +1,459 @@
+// ===== FILE: host/host_rtos.c =====
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ucontext.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+#include "host.h"
+
+// Cooperative virtual-time scheduler (see freertos/FreeRTOS.h).
+//
+// - every task is a ucontext coroutine, the caller of host_run_until() is the scheduler
+// - pick: highest priority ready task, equal priority -> the one that ran least recently
+// - a task gives the CPU back only when it blocks or wakes a higher priority task
+// - esp_timer callbacks run in scheduler context (like the esp_timer task, prio above all)
+
+static const char *TAG = "HOST_RTOS";
+
+#define HOST_STACK_BYTES (256 * 1024)
+#define WAKE_NEVER       INT64_MAX
+
+typedef enum {
+    T_READY = 0,
+    T_BLOCKED,
+    T_DEAD,
+} task_state_t;
+
+struct host_sem;
+
+struct host_task {
+    ucontext_t ctx;
+    void *stack;
+    TaskFunction_t fn;
+    void *arg;
+    const char *name;
+    UBaseType_t prio;
+    task_state_t state;
+
+    uint64_t last_run;        // round robin among equal priorities
+    int64_t wake_us;          // timeout, WAKE_NEVER = none
+
+    uint32_t notify;
+    bool wait_notify;
+
+    struct host_sem *wait_sem;
+    uint64_t wait_seq;        // FIFO among equal priority waiters
+    bool sem_got;
+
+    struct host_task *next;
+};
+
+struct host_sem {
+    UBaseType_t count;
+    UBaseType_t max;
+};
+
+struct host_timer {
+    esp_timer_cb_t cb;
+    void *arg;
+    const char *name;
+    bool active;
+    uint64_t period_us;       // 0 = one shot
+    int64_t deadline_us;
+    uint64_t seq;             // arming order, breaks deadline ties
+    struct host_timer *next;
+};
+
+static ucontext_t s_sched_ctx;
+static struct host_task *s_tasks = NULL;
+static struct host_task *s_cur = NULL;
+static struct host_timer *s_timers = NULL;
+
+static int64_t s_now_us = 0;
+static uint64_t s_run_seq = 0;
+static uint64_t s_wait_seq = 0;
+static uint64_t s_arm_seq = 0;
+static uint64_t s_switches = 0;
+
+// -------------------- time --------------------
+int64_t host_now_us(void) { return s_now_us; }
+int64_t esp_timer_get_time(void) { return s_now_us; }
+TickType_t xTaskGetTickCount(void) { return (TickType_t)(s_now_us / 1000); }
+uint64_t host_switch_count(void) { return s_switches; }
+
+static int64_t wake_after(TickType_t ticks)
+{
+    if (ticks == portMAX_DELAY) return WAKE_NEVER;
+    return s_now_us + (int64_t)ticks * 1000;
+}
+
+// -------------------- tasks --------------------
+static void task_entry(void)
+{
+    struct host_task *t = s_cur;
+    t->fn(t->arg);
+
+    // FreeRTOS tasks must not return, be lenient
+    vTaskDelete(NULL);
+}
+
+// back to the scheduler (current task already marked READY / BLOCKED / DEAD)
+static void task_switch_out(void)
+{
+    struct host_task *t = s_cur;
+    swapcontext(&t->ctx, &s_sched_ctx);
+}
+
+static void make_ready(struct host_task *t)
+{
+    t->state = T_READY;
+    t->wake_us = WAKE_NEVER;
+}
+
+// woke t from a task: a preemptive port would switch right away
+static void maybe_preempt(const struct host_task *t)
+{
+    if (s_cur && t != s_cur && t->prio > s_cur->prio) task_switch_out();
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t prio, TaskHandle_t *out, BaseType_t core)
+{
+    (void)stack_depth;
+    (void)core;
+
+    struct host_task *t = calloc(1, sizeof(*t));
+    if (!t) return pdFAIL;
+    t->stack = malloc(HOST_STACK_BYTES);
+    if (!t->stack) { free(t); return pdFAIL; }
+
+    t->fn = fn;
+    t->arg = arg;
+    t->name = name;
+    t->prio = prio;
+    t->wake_us = WAKE_NEVER;
+    t->last_run = s_run_seq++;
+
+    getcontext(&t->ctx);
+    t->ctx.uc_stack.ss_sp = t->stack;
+    t->ctx.uc_stack.ss_size = HOST_STACK_BYTES;
+    t->ctx.uc_link = NULL;
+    makecontext(&t->ctx, task_entry, 0);
+
+    t->next = s_tasks;
+    s_tasks = t;
+    make_ready(t);
+
+    if (out) *out = t;
+    maybe_preempt(t);
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t prio, TaskHandle_t *out)
+{
+    return xTaskCreatePinnedToCore(fn, name, stack_depth, arg, prio, out, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t t)
+{
+    if (!t) t = s_cur;
+    if (!t) return;   // scheduler context (app_main style callers): nothing to delete
+
+    t->state = T_DEAD;
+    if (t == s_cur) {
+        task_switch_out();
+        abort();   // never resumed
+    }
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    if (!s_cur) return;
+    s_cur->state = (ticks == 0) ? T_READY : T_BLOCKED;
+    s_cur->wake_us = (ticks == 0) ? WAKE_NEVER : wake_after(ticks);
+    task_switch_out();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+    return s_cur;
+}
+
+// -------------------- notifications --------------------
+static void notify_give(struct host_task *t)
+{
+    if (!t || t->state == T_DEAD) return;
+    t->notify++;
+    if (t->state == T_BLOCKED && t->wait_notify) {
+        t->wait_notify = false;
+        make_ready(t);
+    }
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t t)
+{
+    notify_give(t);
+    if (t) maybe_preempt(t);
+    return pdPASS;
+}
+
+void vTaskNotifyGiveFromISR(TaskHandle_t t, BaseType_t *woken)
+{
+    notify_give(t);
+    if (woken && t && (!s_cur || t->prio > s_cur->prio)) *woken = pdTRUE;
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks)
+{
+    struct host_task *t = s_cur;
+    if (!t) return 0;
+
+    if (t->notify == 0 && ticks != 0) {
+        t->wait_notify = true;
+        t->state = T_BLOCKED;
+        t->wake_us = wake_after(ticks);
+        task_switch_out();
+        t->wait_notify = false;
+    }
+
+    uint32_t v = t->notify;
+    if (v) t->notify = clear_on_exit ? 0 : (v - 1);
+    return v;
+}
+
+// -------------------- semaphores --------------------
+static SemaphoreHandle_t sem_new(UBaseType_t max, UBaseType_t initial)
+{
+    struct host_sem *s = calloc(1, sizeof(*s));
+    if (!s) return NULL;
+    s->max = max;
+    s->count = initial;
+    return s;
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) { return sem_new(1, 1); }
+SemaphoreHandle_t xSemaphoreCreateBinary(void) { return sem_new(1, 0); }
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max, UBaseType_t initial) { return sem_new(max, initial); }
+
+void vSemaphoreDelete(SemaphoreHandle_t s)
+{
+    free(s);
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t ticks)
+{
+    if (!s) return pdFALSE;
+    if (s->count > 0) {
+        s->count--;
+        return pdTRUE;
+    }
+
+    // scheduler context cannot block (a task holding it is parked, not running)
+    if (!s_cur || ticks == 0) return pdFALSE;
+
+    struct host_task *t = s_cur;
+    t->wait_sem = s;
+    t->wait_seq = s_wait_seq++;
+    t->sem_got = false;
+    t->state = T_BLOCKED;
+    t->wake_us = wake_after(ticks);
+    task_switch_out();
+
+    t->wait_sem = NULL;
+    return t->sem_got ? pdTRUE : pdFALSE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s)
+{
+    if (!s) return pdFALSE;
+
+    // hand over to the best waiter directly (count stays 0)
+    struct host_task *best = NULL;
+    for (struct host_task *t = s_tasks; t; t = t->next) {
+        if (t->state != T_BLOCKED || t->wait_sem != s) continue;
+        if (!best || t->prio > best->prio || (t->prio == best->prio && t->wait_seq < best->wait_seq)) best = t;
+    }
+    if (best) {
+        best->sem_got = true;
+        best->wait_sem = NULL;
+        make_ready(best);
+        maybe_preempt(best);
+        return pdTRUE;
+    }
+
+    if (s->count >= s->max) return pdFALSE;
+    s->count++;
+    return pdTRUE;
+}
+
+// -------------------- esp_timer --------------------
+esp_err_t esp_timer_create(const esp_timer_create_args_t *args, esp_timer_handle_t *out)
+{
+    if (!args || !args->callback || !out) return ESP_ERR_INVALID_ARG;
+    struct host_timer *tm = calloc(1, sizeof(*tm));
+    if (!tm) return ESP_ERR_NO_MEM;
+
+    tm->cb = args->callback;
+    tm->arg = args->arg;
+    tm->name = args->name;
+    tm->next = s_timers;
+    s_timers = tm;
+    *out = tm;
+    return ESP_OK;
+}
+
+static esp_err_t timer_arm(esp_timer_handle_t t, uint64_t after_us, uint64_t period_us)
+{
+    if (!t) return ESP_ERR_INVALID_ARG;
+    if (t->active) return ESP_ERR_INVALID_STATE;
+    t->active = true;
+    t->period_us = period_us;
+    t->deadline_us = s_now_us + (int64_t)after_us;
+    t->seq = s_arm_seq++;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_start_once(esp_timer_handle_t t, uint64_t timeout_us)
+{
+    return timer_arm(t, timeout_us, 0);
+}
+
+esp_err_t esp_timer_start_periodic(esp_timer_handle_t t, uint64_t period_us)
+{
+    if (period_us == 0) return ESP_ERR_INVALID_ARG;
+    return timer_arm(t, period_us, period_us);
+}
+
+esp_err_t esp_timer_stop(esp_timer_handle_t t)
+{
+    if (!t) return ESP_ERR_INVALID_ARG;
+    if (!t->active) return ESP_ERR_INVALID_STATE;
+    t->active = false;
+    return ESP_OK;
+}
+
+esp_err_t esp_timer_delete(esp_timer_handle_t t)
+{
+    if (!t) return ESP_ERR_INVALID_ARG;
+    if (t->active) return ESP_ERR_INVALID_STATE;
+
+    for (struct host_timer **pp = &s_timers; *pp; pp = &(*pp)->next) {
+        if (*pp == t) { *pp = t->next; break; }
+    }
+    free(t);
+    return ESP_OK;
+}
+
+bool esp_timer_is_active(esp_timer_handle_t t)
+{
+    return t && t->active;
+}
+
+// earliest due timer (deadline <= limit), ties in arming order
+static struct host_timer *timer_due(int64_t limit)
+{
+    struct host_timer *best = NULL;
+    for (struct host_timer *t = s_timers; t; t = t->next) {
+        if (!t->active || t->deadline_us > limit) continue;
+        if (!best || t->deadline_us < best->deadline_us ||
+            (t->deadline_us == best->deadline_us && t->seq < best->seq)) best = t;
+    }
+    return best;
+}
+
+// -------------------- scheduler --------------------
+static void reap_dead(void)
+{
+    for (struct host_task **pp = &s_tasks; *pp;) {
+        struct host_task *t = *pp;
+        if (t->state == T_DEAD && t != s_cur) {
+            *pp = t->next;
+            free(t->stack);
+            free(t);
+        } else {
+            pp = &t->next;
+        }
+    }
+}
+
+static struct host_task *pick_ready(void)
+{
+    struct host_task *best = NULL;
+    for (struct host_task *t = s_tasks; t; t = t->next) {
+        if (t->state != T_READY) continue;
+        if (!best || t->prio > best->prio || (t->prio == best->prio && t->last_run < best->last_run)) best = t;
+    }
+    return best;
+}
+
+// timeouts that expired by now
+static void wake_timeouts(void)
+{
+    for (struct host_task *t = s_tasks; t; t = t->next) {
+        if (t->state != T_BLOCKED || t->wake_us > s_now_us) continue;
+        t->wait_notify = false;
+        if (t->wait_sem) { t->wait_sem = NULL; t->sem_got = false; }
+        make_ready(t);
+    }
+}
+
+static int64_t next_event_us(void)
+{
+    int64_t n = WAKE_NEVER;
+    for (struct host_task *t = s_tasks; t; t = t->next) {
+        if (t->state == T_BLOCKED && t->wake_us < n) n = t->wake_us;
+    }
+    for (struct host_timer *t = s_timers; t; t = t->next) {
+        if (t->active && t->deadline_us < n) n = t->deadline_us;
+    }
+    return n;
+}
+
+void host_run_until(int64_t t_us)
+{
+    if (s_cur) {
+        ESP_LOGE(TAG, "host_run_until called from task %s", s_cur->name);
+        abort();
+    }
+
+    for (;;) {
+        struct host_timer *tm;
+        while ((tm = timer_due(s_now_us)) != NULL) {
+            if (tm->period_us) tm->deadline_us += (int64_t)tm->period_us;
+            else tm->active = false;
+            tm->cb(tm->arg);
+        }
+
+        wake_timeouts();
+
+        struct host_task *t = pick_ready();
+        if (t) {
+            t->last_run = s_run_seq++;
+            s_cur = t;
+            s_switches++;
+            swapcontext(&s_sched_ctx, &t->ctx);
+            s_cur = NULL;
+            reap_dead();
+            continue;
+        }
+
+        int64_t n = next_event_us();
+        if (n > t_us) break;
+        if (n > s_now_us) s_now_us = n;
+    }
+
+    if (t_us > s_now_us) s_now_us = t_us;
+}
+
+void host_run_for(int64_t us)
+{
+    host_run_until(s_now_us + (us > 0 ? us : 0));
+}
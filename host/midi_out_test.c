@@ -0,0 +1,266 @@
+// ===== FILE: host/midi_out_test.c =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "esp_log.h"
+#include "midi_out.h"
+#include "uart_midi_out.h"
+#include "midi_ring.h"
+#include "host.h"
+
+// midi_out_test: midi_out delivery cases on the virtual clock, exit 1 on the first failure.
+//
+//   stall_updates   USB stalled 300 ms while one controller is updated every 10 ms
+//   stall_hold      same controller updated only in the first 100 ms of the stall
+//   uart_governor   100 ordered CCs + pedal values faster than 31250 baud carries them
+//   ring_full       CC14 / NRPN with no coalescing slot free and the ring short of room
+//
+// the value the receiver ends up with must be the last one posted, however long the wire
+// was stuck (coalesced slots are never dropped as stale). ordered messages refused by the
+// UART rate governor wait for the wire and all arrive, in order. a CC14 / NRPN value that
+// does not fit the ring goes out whole or not at all
+
+#define T_CH     16
+#define T_CC     20    // pedal (coalesced)
+#define T_CC_ORD 21    // footswitch (ordered ring)
+#define T_ORD_N  100
+#define T_SEQ_CH 15    // CC14 / NRPN sequences (ring_full)
+#define T_CC14   7     // CC14 MSB, LSB = 39
+#define T_FILL   40    // coalescing slot fillers: CC 40, 41, ..
+
+typedef struct {
+    int n;          // pedal messages on the transport under test
+    int last;       // last pedal value seen (-1 = none)
+    int ord_n;      // ordered messages seen
+    int ord_bad;    // ordered messages out of sequence
+    int seq_n;      // T_SEQ_CH: whole CC14 / NRPN sequences seen
+    int seq_bad;    // T_SEQ_CH: messages out of a whole sequence
+    int seq_pos;    // T_SEQ_CH: position in the current sequence (0 = between)
+    const uint8_t *seq_want;
+} cap_t;
+
+static cap_t s_cap;
+
+// whole sequences as co_build sends them with nothing assumed about the receiver
+static const uint8_t s_seq_cc14[] = { T_CC14, T_CC14 + 32, 0 };
+static const uint8_t s_seq_nrpn[] = { 99, 98, 6, 38, 0 };
+
+static void seq_track(uint8_t cc)
+{
+    if (!s_cap.seq_pos) {
+        if (cc == s_seq_cc14[0])      s_cap.seq_want = s_seq_cc14;
+        else if (cc == s_seq_nrpn[0]) s_cap.seq_want = s_seq_nrpn;
+        else { s_cap.seq_bad++; return; }
+    } else if (cc != s_cap.seq_want[s_cap.seq_pos]) {
+        s_cap.seq_bad++;   // previous sequence cut short
+        s_cap.seq_pos = 0;
+        seq_track(cc);
+        return;
+    }
+    if (!s_cap.seq_want[++s_cap.seq_pos]) {
+        s_cap.seq_n++;
+        s_cap.seq_pos = 0;
+    }
+}
+static int s_cap_tx = HOST_MIDI_USB;
+static uint8_t s_uart_st;   // UART: running status as the receiver tracks it
+
+static void sink(const host_midi_evt_t *e, void *arg)
+{
+    (void)arg;
+    const uint8_t *d = e->b;
+    uint8_t st;
+
+    if (e->tx == HOST_MIDI_UART) {
+        if (d[0] & 0x80) { st = s_uart_st = d[0]; d++; }
+        else st = s_uart_st;
+    } else {
+        st = d[0];
+        d++;
+    }
+    if (e->tx != s_cap_tx) return;
+    if (st == (0xB0 | (T_SEQ_CH - 1))) { seq_track(d[0]); return; }
+    if (st != (0xB0 | (T_CH - 1))) return;
+
+    if (d[0] == T_CC) {
+        s_cap.n++;
+        s_cap.last = d[1];
+    } else if (d[0] == T_CC_ORD) {
+        if (d[1] != (s_cap.ord_n & 0x7F)) s_cap.ord_bad++;
+        s_cap.ord_n++;
+    }
+}
+
+static void cap_reset(int tx)
+{
+    memset(&s_cap, 0, sizeof(s_cap));
+    s_cap.last = -1;
+    s_cap_tx = tx;
+}
+
+static int check(const char *name, int ok, const char *what)
+{
+    printf("%-14s %s  %s\n", name, ok ? "ok  " : "FAIL", what);
+    return ok ? 0 : 1;
+}
+
+// nvs stays in memory, spiffs + config log go to a scratch directory
+static char s_workdir[64];
+
+static void workdir_cleanup(void)
+{
+    DIR *d = opendir("spiffs");
+    if (d) {
+        struct dirent *de;
+        char p[300];
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] == '.') continue;
+            snprintf(p, sizeof(p), "spiffs/%s", de->d_name);
+            remove(p);
+        }
+        closedir(d);
+        rmdir("spiffs");
+    }
+    remove("cfglog.bin");
+    if (chdir("/") == 0) rmdir(s_workdir);
+}
+
+// stall USB for stall_ms, post 1, 2, ... every 10 ms during the first upd_ms of it
+static int run_stall(const char *name, int stall_ms, int upd_ms)
+{
+    cap_reset(HOST_MIDI_USB);
+
+    host_usb_midi_stall(1);
+    const int64_t t0 = host_now_us();
+    int v = 0;
+    for (int t = 0; t < upd_ms; t += 10) {
+        midi_out_cc_latest(T_CH, T_CC, (uint8_t)(++v & 0x7F));
+        host_run_until(t0 + (int64_t)(t + 10) * 1000);
+    }
+    host_run_until(t0 + (int64_t)stall_ms * 1000);
+    const int during = s_cap.n;
+
+    host_usb_midi_stall(0);
+    host_run_for(50 * 1000);
+
+    char what[80];
+    int fail = 0;
+    snprintf(what, sizeof(what), "sent while stalled: %d", during);
+    fail |= check(name, during == 0, what);
+    snprintf(what, sizeof(what), "last value on the wire: %d (posted %d)", s_cap.last, v);
+    fail |= check(name, s_cap.last == v, what);
+    return fail;
+}
+
+// two bursts of ordered CCs 1 ms apart (~64 ms of wire time) with a pedal sweep between
+static int run_uart_governor(const char *name)
+{
+    cap_reset(HOST_MIDI_UART);
+
+    uart_midi_stats_t u0, u1;
+    uart_midi_out_get_stats(&u0);
+    midi_out_stats_t m0, m1;
+    midi_out_get_stats(MIDI_TX_UART, &m0);
+
+    int v = 0;
+    for (int i = 0; i < T_ORD_N; i++) {
+        midi_out_cc(T_CH, T_CC_ORD, (uint8_t)(i & 0x7F));
+        if (i % 10 == 9) midi_out_cc_latest(T_CH, T_CC, (uint8_t)(++v & 0x7F));
+        if (i == T_ORD_N / 2 - 1) host_run_for(1000);
+    }
+    host_run_for(200 * 1000);
+
+    uart_midi_out_get_stats(&u1);
+    midi_out_get_stats(MIDI_TX_UART, &m1);
+
+    char what[80];
+    int fail = 0;
+    snprintf(what, sizeof(what), "governor refusals (retried): %u",
+             (unsigned)(u1.governor_refusals - u0.governor_refusals));
+    fail |= check(name, u1.governor_refusals != u0.governor_refusals, what);
+    snprintf(what, sizeof(what), "ordered on the wire: %d of %d, %d out of order", s_cap.ord_n, T_ORD_N, s_cap.ord_bad);
+    fail |= check(name, s_cap.ord_n == T_ORD_N && !s_cap.ord_bad, what);
+    snprintf(what, sizeof(what), "dropped: stale %u fail %u",
+             (unsigned)(m1.stale - m0.stale), (unsigned)(m1.fail - m0.fail));
+    fail |= check(name, m1.stale == m0.stale && m1.fail == m0.fail, what);
+    snprintf(what, sizeof(what), "last pedal value on the wire: %d (posted %d)", s_cap.last, v);
+    fail |= check(name, s_cap.last == v, what);
+    return fail;
+}
+
+// USB stalled: every coalescing slot pending, the ring filled up to `room` free entries,
+// then one controller that needs more than that. old: the first `room` messages of it
+// went out anyway (MSB without LSB, NRPN select without data)
+static int run_ring_full_one(const char *name, const midi_ctl_t *v, int room)
+{
+    midi_out_stats_t m0, m1;
+    midi_out_get_stats(MIDI_TX_USB, &m0);
+
+    host_usb_midi_stall(1);
+    for (int k = 0; k < MIDI_OUT_BATCH_MAX; k++) midi_out_cc_latest(T_CH, (uint8_t)(T_FILL + k), 1);
+    midi_out_cc(T_CH, T_CC_ORD, 0);
+    host_run_for(2 * 1000);   // sender holds that one, retrying -> its slot is free again
+    for (int k = 0; k < MIDI_RING_LEN - room; k++) midi_out_cc(T_CH, T_CC_ORD, (uint8_t)((k + 1) & 0x7F));
+
+    midi_out_ctl_batch(v, 1);
+    midi_out_get_stats(MIDI_TX_USB, &m1);
+
+    host_usb_midi_stall(0);
+    host_run_for(100 * 1000);
+
+    char what[80];
+    snprintf(what, sizeof(what), "refused whole: overflow %u", (unsigned)(m1.overflow - m0.overflow));
+    return check(name, m1.overflow - m0.overflow == 1, what);
+}
+
+static int run_ring_full(const char *name)
+{
+    cap_reset(HOST_MIDI_USB);
+
+    const midi_ctl_t cc14 = { .kind = MIDI_CTL_CC14, .ch = T_SEQ_CH, .id = T_CC14, .val = 0x1234 };
+    const midi_ctl_t nrpn = { .kind = MIDI_CTL_NRPN, .ch = T_SEQ_CH, .id = 0x0105, .val = 0x0678 };
+
+    int fail = 0;
+    fail |= run_ring_full_one(name, &cc14, 1);
+    fail |= run_ring_full_one(name, &nrpn, 3);
+
+    // the ring has room again: both go out whole
+    const midi_ctl_t both[2] = { cc14, nrpn };
+    for (int k = 0; k < MIDI_OUT_BATCH_MAX; k++) midi_out_cc_latest(T_CH, (uint8_t)(T_FILL + k), 2);
+    midi_out_ctl_batch(both, 2);
+    host_run_for(100 * 1000);
+
+    char what[80];
+    snprintf(what, sizeof(what), "on the wire: %d whole sequences, %d partial", s_cap.seq_n, s_cap.seq_bad);
+    fail |= check(name, s_cap.seq_n == 2 && !s_cap.seq_bad && !s_cap.seq_pos, what);
+    return fail;
+}
+
+int main(int argc, char **argv)
+{
+    (void)argv;
+    if (argc > 1) {
+        fprintf(stderr, "usage: %s\n", argv[0]);
+        return 2;
+    }
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    snprintf(s_workdir, sizeof(s_workdir), "/tmp/midi_out_test.XXXXXX");
+    if (!mkdtemp(s_workdir) || chdir(s_workdir) != 0) { fprintf(stderr, "no scratch dir\n"); return 2; }
+    atexit(workdir_cleanup);
+    host_nvs_set_path(NULL);
+
+    host_midi_set_sink(sink, NULL);
+    host_boot();
+    host_run_for(200 * 1000);
+
+    int fail = 0;
+    fail |= run_stall("stall_updates", 300, 300);
+    fail |= run_stall("stall_hold", 300, 100);
+    fail |= run_uart_governor("uart_governor");
+    fail |= run_ring_full("ring_full");
+    return fail;
+}
@@ -0,0 +1,236 @@
+// ===== FILE: host/prog_bench.c =====
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "esp_log.h"
+#include "config_store.h"
+#include "midi_actions.h"
+#include "host.h"
+
+// Compiled action programs (midi_prog_run) vs the action list walker (midi_actions_run).
+//
+//   prog_bench [-n PASSES] [-s SEED] [-v]
+//
+// boots, imports {"gen":"fullmax","seed":SEED} (MAX_BANKS, every list MAX_ACTIONS long,
+// press modes / cc behaviors cycled) and fires every list of every button of every bank
+// with TRIGGER, DOWN and UP, through both paths:
+//   - equality: the USB MIDI stream of one walker pass and one program pass, byte for byte
+//     (toggle state is put back between them with a second walker pass: every toggle CC
+//     flips twice). exit 1 on the first difference
+//   - time: wall clock per call on this host, midi_out_post (ring push on both transports)
+//     included, the sender drains between calls outside the measurement. PASSES passes,
+//     rows per cc behavior. compile = midi_prog_compile per list (once per bank change)
+// only the walker / program ratio carries over to the ESP32.
+
+#define DRAIN_US (30 * 1000)   // UART: MAX_ACTIONS messages at 31250 baud, + margin
+
+static const int s_evt[] = { MIDI_EVT_TRIGGER, MIDI_EVT_DOWN, MIDI_EVT_UP };
+#define N_EVT ((int)(sizeof(s_evt) / sizeof(s_evt[0])))
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+// -------------------- USB capture --------------------
+typedef struct {
+    uint8_t *b;
+    size_t n, cap;
+    uint32_t msgs;
+} cap_t;
+
+static cap_t *s_cap = NULL;
+
+static void sink(const host_midi_evt_t *e, void *arg)
+{
+    (void)arg;
+    if (!s_cap || e->tx != HOST_MIDI_USB) return;
+    if (s_cap->n + 4 > s_cap->cap) {
+        size_t nc = s_cap->cap ? s_cap->cap * 2 : 4096;
+        uint8_t *nb = realloc(s_cap->b, nc);
+        if (!nb) return;
+        s_cap->b = nb;
+        s_cap->cap = nc;
+    }
+    s_cap->b[s_cap->n++] = e->len;
+    memcpy(&s_cap->b[s_cap->n], e->b, e->len);
+    s_cap->n += e->len;
+    s_cap->msgs++;
+}
+
+// -------------------- passes --------------------
+typedef struct {
+    btn_map_t   map[MAX_BANKS][NUM_BTNS];
+    midi_prog_t prog[MAX_BANKS][NUM_BTNS][2];
+} bench_cfg_t;
+
+typedef struct {
+    double ns[3];       // per cc_behavior
+    uint32_t calls[3];
+} pass_time_t;
+
+// every (bank, button, list, event) once. prog = false -> walker
+static void run_pass(const bench_cfg_t *c, bool prog, pass_time_t *t)
+{
+    for (int b = 0; b < MAX_BANKS; b++) {
+        for (int k = 0; k < NUM_BTNS; k++) {
+            const btn_map_t *m = &c->map[b][k];
+            for (int l = 0; l < 2; l++) {
+                const action_t *list = l ? m->long_actions : m->short_actions;
+                for (int e = 0; e < N_EVT; e++) {
+                    double t0 = now_ns();
+                    if (prog) midi_prog_run(&c->prog[b][k][l], s_evt[e]);
+                    else      midi_actions_run(list, MAX_ACTIONS, m->cc_behavior, s_evt[e]);
+                    double t1 = now_ns();
+
+                    if (t) {
+                        t->ns[m->cc_behavior] += t1 - t0;
+                        t->calls[m->cc_behavior]++;
+                    }
+                    host_run_for(DRAIN_US);
+                }
+            }
+        }
+    }
+}
+
+static int compare(const cap_t *a, const cap_t *b)
+{
+    size_t n = a->n < b->n ? a->n : b->n;
+    for (size_t i = 0; i < n; i++) {
+        if (a->b[i] != b->b[i]) {
+            fprintf(stderr, "stream differs at byte %zu (walker %02X, prog %02X)\n", i, a->b[i], b->b[i]);
+            return 1;
+        }
+    }
+    if (a->n != b->n) {
+        fprintf(stderr, "stream length differs (walker %zu, prog %zu bytes)\n", a->n, b->n);
+        return 1;
+    }
+    return 0;
+}
+
+// nvs stays in memory, spiffs + config log go to a scratch directory
+static char s_workdir[64];
+
+static void workdir_cleanup(void)
+{
+    DIR *d = opendir("spiffs");
+    if (d) {
+        struct dirent *de;
+        char p[300];
+        while ((de = readdir(d)) != NULL) {
+            if (de->d_name[0] == '.') continue;
+            snprintf(p, sizeof(p), "spiffs/%s", de->d_name);
+            remove(p);
+        }
+        closedir(d);
+        rmdir("spiffs");
+    }
+    remove("cfglog.bin");
+    if (chdir("/") == 0) rmdir(s_workdir);
+}
+
+int main(int argc, char **argv)
+{
+    int passes = 3;
+    long seed = 1;
+    esp_log_level_set("*", ESP_LOG_ERROR);
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "-n") && i + 1 < argc) passes = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc) seed = strtol(argv[++i], NULL, 10);
+        else if (!strcmp(argv[i], "-v")) esp_log_level_set("*", ESP_LOG_INFO);
+        else {
+            fprintf(stderr, "usage: %s [-n passes] [-s seed] [-v]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (passes < 1) passes = 1;
+
+    snprintf(s_workdir, sizeof(s_workdir), "/tmp/prog_bench.XXXXXX");
+    if (!mkdtemp(s_workdir) || chdir(s_workdir) != 0) { fprintf(stderr, "no scratch dir\n"); return 2; }
+    atexit(workdir_cleanup);
+    host_nvs_set_path(NULL);
+
+    host_midi_set_sink(sink, NULL);
+    host_boot();
+    host_run_for(100 * 1000);
+
+    char js[64];
+    snprintf(js, sizeof(js), "{\"gen\":\"fullmax\",\"seed\":%ld}", seed);
+    if (config_store_import_json(js) != ESP_OK) { fprintf(stderr, "fullmax import failed\n"); return 1; }
+    host_run_for(500 * 1000);
+
+    bench_cfg_t *c = calloc(1, sizeof(*c));
+    if (!c) return 1;
+    for (int b = 0; b < MAX_BANKS; b++) {
+        // banks are paged in on demand: make it the current one first
+        config_store_set_current_bank((uint8_t)b);
+        host_run_for(20 * 1000);
+
+        const cfg_bank_snap_t *v = config_store_snap_bank(b);
+        if (v) memcpy(c->map[b], v->map, sizeof(c->map[b]));
+        config_store_snap_release();
+        if (!v) { fprintf(stderr, "bank %d not loaded\n", b + 1); return 1; }
+    }
+
+    // compile: every list, timed
+    double t0 = now_ns();
+    for (int b = 0; b < MAX_BANKS; b++) {
+        for (int k = 0; k < NUM_BTNS; k++) {
+            const btn_map_t *m = &c->map[b][k];
+            midi_prog_compile(&c->prog[b][k][0], m->short_actions, MAX_ACTIONS, m->cc_behavior);
+            midi_prog_compile(&c->prog[b][k][1], m->long_actions,  MAX_ACTIONS, m->cc_behavior);
+        }
+    }
+    const double compile_ns = (now_ns() - t0) / (MAX_BANKS * NUM_BTNS * 2);
+
+    // equality: walker (A), walker (toggles back), program (B)
+    cap_t a = {0}, b = {0};
+    s_cap = &a;
+    run_pass(c, false, NULL);
+    s_cap = NULL;
+    run_pass(c, false, NULL);
+    s_cap = &b;
+    run_pass(c, true, NULL);
+    s_cap = NULL;
+
+    int rc = compare(&a, &b);
+
+    // time
+    pass_time_t tw = {0}, tp = {0};
+    for (int p = 0; p < passes; p++) {
+        run_pass(c, false, &tw);
+        run_pass(c, true, &tp);
+    }
+
+    static const char *beh[3] = { "normal", "toggle", "momentary" };
+    printf("%-10s %8s %12s %12s %8s\n", "cc mode", "calls", "walker", "program", "speedup");
+    double sw = 0, sp = 0;
+    uint32_t sc = 0;
+    for (int i = 0; i < 3; i++) {
+        if (!tw.calls[i]) continue;
+        sw += tw.ns[i];
+        sp += tp.ns[i];
+        sc += tw.calls[i];
+        printf("%-10s %8u %10.0fns %10.0fns %7.2fx\n", beh[i], (unsigned)tw.calls[i],
+               tw.ns[i] / tw.calls[i], tp.ns[i] / tp.calls[i], tw.ns[i] / tp.ns[i]);
+    }
+    printf("%-10s %8u %10.0fns %10.0fns %7.2fx\n", "all", (unsigned)sc, sw / sc, sp / sc, sw / sp);
+    printf("compile    %8d %10.0fns per list\n", MAX_BANKS * NUM_BTNS * 2, compile_ns);
+    printf("output     %8u USB messages per pass, %s\n", (unsigned)a.msgs, rc ? "DIFFERENT" : "identical");
+
+    free(a.b);
+    free(b.b);
+    free(c);
+    return rc;
+}
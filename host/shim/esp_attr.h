@@ -0,0 +1,7 @@
+// ===== FILE: host/shim/esp_attr.h =====
+#pragma once
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_DATA_ATTR
+#define EXT_RAM_BSS_ATTR
@@ -0,0 +1,6 @@
+// ===== FILE: host/shim/esp_rom_crc.h =====
+#pragma once
+#include <stdint.h>
+
+// same result as the ROM version: crc32_le(0, buf, len) = standard CRC-32 (IEEE 802.3)
+uint32_t esp_rom_crc32_le(uint32_t crc, uint8_t const *buf, uint32_t len);
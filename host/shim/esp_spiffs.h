@@ -0,0 +1,19 @@
+// ===== FILE: host/shim/esp_spiffs.h =====
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// SPIFFS = a plain directory. base_path "/spiffs" -> "./spiffs" (leading '/' dropped),
+// so the host build compiles config_store with CFG_SPIFFS_BASE="spiffs"
+
+typedef struct {
+    const char *base_path;
+    const char *partition_label;
+    size_t max_files;
+    bool format_if_mount_failed;
+} esp_vfs_spiffs_conf_t;
+
+esp_err_t esp_vfs_spiffs_register(const esp_vfs_spiffs_conf_t *conf);
+esp_err_t esp_vfs_spiffs_unregister(const char *partition_label);
+esp_err_t esp_spiffs_info(const char *partition_label, size_t *total_bytes, size_t *used_bytes);
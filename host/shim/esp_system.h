@@ -0,0 +1,15 @@
+// ===== FILE: host/shim/esp_system.h =====
+#pragma once
+#include "esp_err.h"
+
+typedef enum {
+    ESP_RST_UNKNOWN = 0,
+    ESP_RST_POWERON,
+    ESP_RST_SW,
+} esp_reset_reason_t;
+
+typedef void (*shutdown_handler_t)(void);
+
+esp_reset_reason_t esp_reset_reason(void);
+esp_err_t esp_register_shutdown_handler(shutdown_handler_t handle);
+void esp_restart(void) __attribute__((noreturn));
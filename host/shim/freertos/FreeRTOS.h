@@ -0,0 +1,44 @@
+// ===== FILE: host/shim/freertos/FreeRTOS.h =====
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Deterministic single-threaded FreeRTOS stand-in (host_rtos.c).
+//
+// - tasks are coroutines (ucontext), one runs at a time, highest priority first
+// - a task runs until it blocks (notify / delay / semaphore); giving a notify to a
+//   higher priority task yields at once, like a preemptive port would
+// - 1 tick = 1 ms of virtual time, advanced only by host_run_until()
+// - critical sections are no-ops (nothing runs concurrently)
+
+typedef int32_t  BaseType_t;
+typedef uint32_t UBaseType_t;
+typedef uint32_t TickType_t;
+typedef uint32_t StackType_t;
+
+#define pdFALSE 0
+#define pdTRUE  1
+#define pdPASS  1
+#define pdFAIL  0
+
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define portMAX_DELAY      ((TickType_t)0xFFFFFFFFu)
+#define pdMS_TO_TICKS(ms)  ((TickType_t)(ms))
+#define pdTICKS_TO_MS(t)   ((uint32_t)(t))
+
+#define tskNO_AFFINITY     0x7FFFFFFF
+
+typedef struct {
+    uint32_t owner;
+    uint32_t count;
+} portMUX_TYPE;
+
+#define portMUX_INITIALIZER_UNLOCKED { 0, 0 }
+
+#define portENTER_CRITICAL(m)     ((void)(m))
+#define portEXIT_CRITICAL(m)      ((void)(m))
+#define portENTER_CRITICAL_ISR(m) ((void)(m))
+#define portEXIT_CRITICAL_ISR(m)  ((void)(m))
+#define portYIELD_FROM_ISR(...)   ((void)0)
+#define portYIELD()               ((void)0)
@@ -0,0 +1,19 @@
+// ===== FILE: host/shim/freertos/task.h =====
+#pragma once
+#include "freertos/FreeRTOS.h"
+
+typedef struct host_task *TaskHandle_t;
+typedef void (*TaskFunction_t)(void *arg);
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                                   void *arg, UBaseType_t prio, TaskHandle_t *out, BaseType_t core);
+BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_depth,
+                       void *arg, UBaseType_t prio, TaskHandle_t *out);
+void       vTaskDelete(TaskHandle_t t);
+void       vTaskDelay(TickType_t ticks);
+TickType_t xTaskGetTickCount(void);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+
+BaseType_t xTaskNotifyGive(TaskHandle_t t);
+void       vTaskNotifyGiveFromISR(TaskHandle_t t, BaseType_t *woken);
+uint32_t   ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks);
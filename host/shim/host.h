@@ -0,0 +1,73 @@
+// ===== FILE: host/shim/host.h =====
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// Host harness API (Linux build of main/, see host/README.txt).
+//
+// - nothing runs on its own: tasks, esp_timer callbacks and virtual time only move
+//   inside host_run_until() / host_run_for()
+// - inputs are scripted between runs (host_gpio_input, host_adc_set), they act at host_now_us()
+// - MIDI leaving the device (USB packets, UART1 bytes) goes to one capture sink
+
+// -------------------- time / scheduler --------------------
+int64_t host_now_us(void);
+
+// run tasks + timers until virtual time reaches t_us (never goes backwards)
+void host_run_until(int64_t t_us);
+void host_run_for(int64_t us);
+
+// context switches so far (benchmarks)
+uint64_t host_switch_count(void);
+
+// same init order as app_main's bootstrap_task, minus Wi-Fi portal and USB host stack
+void host_boot(void);
+
+// -------------------- GPIO --------------------
+// drive an input pin (footswitch / jack contact). fires the pin ISR on a matching edge
+void host_gpio_input(int pin, int level);
+int  host_gpio_get(int pin);
+
+// -------------------- ADC --------------------
+// value returned by oneshot reads of the ADC channel wired to gpio (0..4095)
+void host_adc_set(int gpio, int raw);
+
+// -------------------- MIDI capture --------------------
+#define HOST_MIDI_USB  0
+#define HOST_MIDI_UART 1
+
+typedef struct {
+    int64_t t_us;     // virtual time the bytes left the transport
+    uint8_t tx;       // HOST_MIDI_USB / HOST_MIDI_UART
+    uint8_t len;      // 1..3
+    uint8_t b[3];     // serial bytes (UART: as written, running status applied)
+} host_midi_evt_t;
+
+typedef void (*host_midi_sink_t)(const host_midi_evt_t *e, void *arg);
+
+void host_midi_set_sink(host_midi_sink_t fn, void *arg);
+
+// USB-MIDI device attached (default 1)
+void host_usb_midi_connect(int on);
+// device attached but not taking transfers: queueing fails with ESP_ERR_TIMEOUT (all
+// transfers still on the bus) until released
+void host_usb_midi_stall(int on);
+
+// -------------------- display link (UART2) --------------------
+typedef void (*host_uart_sink_t)(const uint8_t *b, size_t n, void *arg);
+void host_display_set_sink(host_uart_sink_t fn, void *arg);
+
+// -------------------- LEDs --------------------
+// stored color (0xrrggbb) and on/off of one LED
+uint32_t host_led_get(int idx, int *on);
+
+// -------------------- NVS --------------------
+// backing file, call before nvs_flash_init (default "nvs.bin", NULL = memory only)
+void host_nvs_set_path(const char *path);
+// modelled flash bytes read / programmed by nvs_get_* / nvs_set_* since start (benchmarks)
+void host_nvs_get_stats(uint32_t *read_bytes, uint32_t *prog_bytes);
+
+// -------------------- raw partitions --------------------
+// resize a data partition of the table (default: partitions.csv), 0 = not in the table
+// (device with an older partition table). call before host_boot
+void host_partition_set(const char *label, uint32_t size);
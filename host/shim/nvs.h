@@ -0,0 +1,29 @@
+// ===== FILE: host/shim/nvs.h =====
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// file backed NVS (host_nvs.c): all namespaces in one file, written on nvs_commit
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY = 0,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *ns, nvs_open_mode_t mode, nvs_handle_t *out);
+void      nvs_close(nvs_handle_t h);
+esp_err_t nvs_commit(nvs_handle_t h);
+esp_err_t nvs_erase_key(nvs_handle_t h, const char *key);
+esp_err_t nvs_erase_all(nvs_handle_t h);
+
+esp_err_t nvs_get_u8(nvs_handle_t h, const char *key, uint8_t *out);
+esp_err_t nvs_set_u8(nvs_handle_t h, const char *key, uint8_t v);
+esp_err_t nvs_get_u16(nvs_handle_t h, const char *key, uint16_t *out);
+esp_err_t nvs_set_u16(nvs_handle_t h, const char *key, uint16_t v);
+esp_err_t nvs_get_u32(nvs_handle_t h, const char *key, uint32_t *out);
+esp_err_t nvs_set_u32(nvs_handle_t h, const char *key, uint32_t v);
+esp_err_t nvs_get_blob(nvs_handle_t h, const char *key, void *out, size_t *len);
+esp_err_t nvs_set_blob(nvs_handle_t h, const char *key, const void *v, size_t len);
@@ -0,0 +1,8 @@
+// ===== FILE: host/shim/nvs_flash.h =====
+#pragma once
+#include "esp_err.h"
+
+// backing file: host_nvs_set_path(), default "nvs.bin" in the working directory
+esp_err_t nvs_flash_init(void);
+esp_err_t nvs_flash_erase(void);
+esp_err_t nvs_flash_deinit(void);
@@ -10,12 +10,14 @@
 #include "footswitch.h"
 #include "usb_midi_host.h"
 #include "uart_midi_out.h"
+#include "midi_out.h"
 #include "expfs.h"
 
 #include "rgb_led.h"
 #include "rgb_store.h"
 
 #include "display_uart.h"
+#include "lat_stats.h"
 #include "nvs_flash.h"
 
 static const char *TAG = "APP";
@@ -84,6 +86,11 @@ static void bootstrap_task(void *arg)
     uart_midi_out_init();
     vTaskDelay(pdMS_TO_TICKS(20));
 
+    // 3.2) midi out queue + sender tasks
+    ESP_LOGI(TAG, "midi_out_start()");
+    midi_out_start();
+    lat_stats_init();
+
     // 4) captive portal
     ESP_LOGI(TAG, "portal_wifi_start()");
     portal_wifi_start();
@@ -0,0 +1,131 @@
+// ===== FILE: main/button_fsm.c =====
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "button_fsm.h"
+
+// -------------------- table ops (internal, resolved in bf_step) --------------------
+#define T_ARM      (1u << 0)
+#define T_DISARM   (1u << 1)
+#define T_TRIG_A   (1u << 2)
+#define T_TRIG_B   (1u << 3)
+#define T_TRIG_AB  (1u << 4)   // trigger list by A/B state, then flip
+#define T_GROUP    (1u << 5)
+#define T_MOM_DN   (1u << 6)   // momentary DOWN (latch list)
+#define T_MOM_UP   (1u << 7)   // momentary UP (latched list)
+
+typedef struct {
+    uint8_t next;
+    uint8_t ops;
+} bf_rule_t;
+
+#define R(n, o) { (uint8_t)(n), (uint8_t)(o) }
+
+#define IDLE BF_PH_IDLE
+#define DOWN BF_PH_DOWN
+#define HELD BF_PH_HELD
+
+// [mode][phase][event]   events: DOWN, UP, LONG
+static const bf_rule_t BF_TABLE[BF_MODE_COUNT][BF_PH_COUNT][BF_EV_COUNT] = {
+    [BF_MODE_SHORT] = {
+        [IDLE] = { R(DOWN, T_MOM_DN), R(IDLE, 0), R(IDLE, 0) },
+        [DOWN] = { R(DOWN, 0), R(IDLE, T_MOM_UP | T_TRIG_A), R(DOWN, 0) },
+        [HELD] = { R(HELD, 0), R(IDLE, T_MOM_UP | T_TRIG_A), R(HELD, 0) },
+    },
+    [BF_MODE_SHORT_LONG] = {
+        [IDLE] = { R(DOWN, T_MOM_DN | T_ARM), R(IDLE, 0), R(IDLE, 0) },
+        [DOWN] = { R(DOWN, 0), R(IDLE, T_DISARM | T_MOM_UP | T_TRIG_A), R(HELD, T_TRIG_B) },
+        [HELD] = { R(HELD, 0), R(IDLE, T_MOM_UP), R(HELD, 0) },
+    },
+    [BF_MODE_TOGGLE] = {
+        [IDLE] = { R(DOWN, T_MOM_DN | T_TRIG_AB), R(IDLE, 0), R(IDLE, 0) },
+        [DOWN] = { R(DOWN, 0), R(IDLE, T_MOM_UP), R(DOWN, 0) },
+        [HELD] = { R(HELD, 0), R(IDLE, T_MOM_UP), R(HELD, 0) },
+    },
+    [BF_MODE_GROUP] = {
+        [IDLE] = { R(DOWN, T_MOM_DN | T_TRIG_A | T_GROUP), R(IDLE, 0), R(IDLE, 0) },
+        [DOWN] = { R(DOWN, 0), R(IDLE, T_MOM_UP), R(DOWN, 0) },
+        [HELD] = { R(HELD, 0), R(IDLE, T_MOM_UP), R(HELD, 0) },
+    },
+};
+
+#undef R
+#undef IDLE
+#undef DOWN
+#undef HELD
+
+static inline bool long_due(const bf_state_t *st, const bf_cfg_t *cfg, int64_t t_us)
+{
+    return st->phase == BF_PH_DOWN &&
+           cfg->mode == BF_MODE_SHORT_LONG &&
+           (t_us - st->down_us) >= (int64_t)cfg->long_us;
+}
+
+static uint16_t apply(bf_state_t *st, const bf_cfg_t *cfg, uint8_t *ab, bf_event_t ev, int64_t t_us)
+{
+    uint8_t mode = (cfg->mode < BF_MODE_COUNT) ? cfg->mode : BF_MODE_SHORT;
+    const bf_rule_t r = BF_TABLE[mode][st->phase][ev];
+
+    uint8_t t = r.ops;
+    if (!cfg->momentary) t &= (uint8_t)~(T_MOM_DN | T_MOM_UP);
+
+    if (ev == BF_EV_DOWN && st->phase == BF_PH_IDLE) st->down_us = t_us;
+    st->phase = r.next;
+
+    if (!t) return 0;
+
+    uint16_t ops = 0;
+    uint8_t cur = (ab && *ab) ? 1u : 0u;
+
+    // latch before a toggle flip so DOWN/UP use the same list
+    if (t & T_MOM_DN) {
+        st->sel = (mode == BF_MODE_TOGGLE) ? cur : 0u;
+        ops |= st->sel ? BF_OP_DOWN_B : BF_OP_DOWN_A;
+    }
+    if (t & T_MOM_UP)  ops |= st->sel ? BF_OP_UP_B : BF_OP_UP_A;
+    if (t & T_TRIG_A)  ops |= BF_OP_TRIG_A;
+    if (t & T_TRIG_B)  ops |= BF_OP_TRIG_B;
+    if (t & T_TRIG_AB) {
+        ops |= cur ? BF_OP_TRIG_B : BF_OP_TRIG_A;
+        if (ab) *ab = (uint8_t)!cur;
+    }
+    if (t & T_GROUP)   ops |= BF_OP_GROUP;
+    if (t & T_ARM)     ops |= BF_OP_ARM_LONG;
+    if (t & T_DISARM)  ops |= BF_OP_DISARM_LONG;
+
+    return ops;
+}
+
+uint16_t bf_step(bf_state_t *st, const bf_cfg_t *cfg, uint8_t *ab, bf_event_t ev, int64_t t_us)
+{
+    if (!st || !cfg || (unsigned)ev >= BF_EV_COUNT) return 0;
+
+    uint16_t ops = 0;
+
+    // a release after the deadline still counts as long (timer may not have run yet)
+    if (ev == BF_EV_UP && long_due(st, cfg, t_us)) {
+        ops |= apply(st, cfg, ab, BF_EV_LONG, t_us);
+    }
+
+    ops |= apply(st, cfg, ab, ev, t_us);
+    return ops;
+}
+
+uint16_t bf_poll(bf_state_t *st, const bf_cfg_t *cfg, uint8_t *ab, int64_t t_us)
+{
+    if (!st || !cfg) return 0;
+    if (!long_due(st, cfg, t_us)) return 0;
+    return apply(st, cfg, ab, BF_EV_LONG, t_us);
+}
+
+void bf_exec(uint16_t ops, bf_emit_fn emit, void *ctx)
+{
+    if (!ops || !emit) return;
+
+    if (ops & BF_OP_DOWN_A) emit(ctx, 0, BF_EMIT_DOWN);
+    if (ops & BF_OP_DOWN_B) emit(ctx, 1, BF_EMIT_DOWN);
+    if (ops & BF_OP_UP_A)   emit(ctx, 0, BF_EMIT_UP);
+    if (ops & BF_OP_UP_B)   emit(ctx, 1, BF_EMIT_UP);
+    if (ops & BF_OP_TRIG_A) emit(ctx, 0, BF_EMIT_TRIGGER);
+    if (ops & BF_OP_TRIG_B) emit(ctx, 1, BF_EMIT_TRIGGER);
+}
@@ -0,0 +1,91 @@
+// ===== FILE: main/button_fsm.h =====
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Shared press/hold/release engine for footswitches and EXP/FS jack switches.
+//
+// - pure C (no ESP-IDF headers) -> builds on the host for tests / benchmarks
+// - transitions live in one const table: [mode][phase][event] -> { next phase, ops }
+// - the engine never sends MIDI itself: bf_step() returns an ops bitmask and
+//   bf_exec() turns it into emit callbacks in a fixed order
+//
+// Mode values are the same as btn_press_mode_t, emit events the same as MIDI_EVT_*.
+
+typedef enum {
+    BF_MODE_SHORT      = 0,   // fire A on release
+    BF_MODE_SHORT_LONG = 1,   // A on short release, B when held past long_us
+    BF_MODE_TOGGLE     = 2,   // fire A/B alternately on press
+    BF_MODE_GROUP      = 3,   // fire A on press + select in group
+    BF_MODE_COUNT
+} bf_mode_t;
+
+typedef enum {
+    BF_EV_DOWN = 0,
+    BF_EV_UP,
+    BF_EV_LONG,     // hold deadline reached (normally produced by bf_poll)
+    BF_EV_COUNT
+} bf_event_t;
+
+typedef enum {
+    BF_PH_IDLE = 0,
+    BF_PH_DOWN,
+    BF_PH_HELD,     // long deadline passed while down
+    BF_PH_COUNT
+} bf_phase_t;
+
+// ops (bitmask). bf_exec() order: DOWN, UP, TRIG, then caller side ops.
+#define BF_OP_DOWN_A      (1u << 0)
+#define BF_OP_DOWN_B      (1u << 1)
+#define BF_OP_UP_A        (1u << 2)
+#define BF_OP_UP_B        (1u << 3)
+#define BF_OP_TRIG_A      (1u << 4)
+#define BF_OP_TRIG_B      (1u << 5)
+#define BF_OP_GROUP       (1u << 6)   // caller: select this button in its group
+#define BF_OP_ARM_LONG    (1u << 7)   // caller: start long timer (deadline = bf_long_deadline)
+#define BF_OP_DISARM_LONG (1u << 8)   // caller: stop long timer
+
+// emit events (same values as MIDI_EVT_TRIGGER / DOWN / UP)
+#define BF_EMIT_TRIGGER 0
+#define BF_EMIT_DOWN    1
+#define BF_EMIT_UP      2
+
+typedef struct {
+    uint8_t  mode;        // bf_mode_t
+    uint8_t  momentary;   // cc_behavior == CC_MOMENTARY -> DOWN/UP emits
+    uint32_t long_us;     // hold threshold
+} bf_cfg_t;
+
+typedef struct {
+    uint8_t phase;     // bf_phase_t
+    uint8_t sel;       // list latched at press for momentary UP (0=A,1=B)
+    int64_t down_us;   // press timestamp
+} bf_state_t;
+
+typedef void (*bf_emit_fn)(void *ctx, int list_b, int emit_event);
+
+static inline void bf_reset(bf_state_t *st)
+{
+    st->phase = BF_PH_IDLE;
+    st->sel = 0;
+    st->down_us = 0;
+}
+
+static inline bool bf_is_down(const bf_state_t *st)
+{
+    return st->phase != BF_PH_IDLE;
+}
+
+static inline int64_t bf_long_deadline(const bf_state_t *st, const bf_cfg_t *cfg)
+{
+    return st->down_us + (int64_t)cfg->long_us;
+}
+
+// feed one event at time t_us. ab = toggle A/B state for this button (0=A,1=B), may flip.
+uint16_t bf_step(bf_state_t *st, const bf_cfg_t *cfg, uint8_t *ab, bf_event_t ev, int64_t t_us);
+
+// time driven: deliver BF_EV_LONG if the deadline has passed (0 if nothing due)
+uint16_t bf_poll(bf_state_t *st, const bf_cfg_t *cfg, uint8_t *ab, int64_t t_us);
+
+// run DOWN/UP/TRIG ops through emit (GROUP / ARM / DISARM are left to the caller)
+void bf_exec(uint16_t ops, bf_emit_fn emit, void *ctx);
@@ -0,0 +1,568 @@
+// ===== FILE: main/cfg_log.c =====
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "esp_partition.h"
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+#include "esp_log.h"
+
+#include "cfg_log.h"
+
+static const char *TAG = "CFGLOG";
+
+#define SEC_SIZE    4096u
+#define SEC_MAGIC   0x314C5346u     // 'FSL1'
+#define SEC_HDR     12u
+#define REC_HDR     12u
+#define SEC_MAX     256             // partitions up to 1 MB
+#define GC_RESERVE  2               // free sectors kept back: compacting one sector needs up to 2
+#define CHUNK       256u            // stack buffer for crc / copy passes
+
+#define F_DEL     0x01              // tombstone (len 0)
+#define F_BATCH   0x02              // belongs to batch `batch`, valid once its commit is seen
+#define F_COMMIT  0x04              // end of batch `batch` (no key, no value)
+
+typedef struct __attribute__((packed)) {
+    uint8_t  key;
+    uint8_t  flags;
+    uint16_t len;
+    uint16_t batch;
+    uint16_t rsv;
+    uint32_t crc;
+} rec_hdr_t;
+
+_Static_assert(sizeof(rec_hdr_t) == REC_HDR, "rec_hdr_t");
+
+// newest record of a key. off = partition offset of the header, 0 = none
+// (a sector header sits at every sector start, so 0 never holds a record)
+typedef struct {
+    uint32_t off;
+    uint16_t len;
+    uint8_t  del;
+    uint8_t  rsv;
+} ent_t;
+
+static const esp_partition_t *s_part;
+static SemaphoreHandle_t s_mtx;
+
+static ent_t    s_idx[CFG_LOG_KEYS];
+static ent_t    s_pend[CFG_LOG_KEYS];    // batch in flight (mount scan / cfg_log_write)
+static uint32_t s_seq[SEC_MAX];          // 0 = erased / free
+static int      s_nsec;
+static int      s_head = -1;             // sector taking appends
+static uint32_t s_wpos;                  // append offset inside s_head
+static uint32_t s_next_seq = 1;
+static uint16_t s_batch;                 // next batch id
+static uint32_t s_batch_seq = 0;         // != 0: a batch is being written since this sector seq
+static uint8_t *s_val;                   // SEC_SIZE: cfg_log_write items, mount: one sector
+
+static uint32_t s_rd_bytes, s_pr_bytes, s_erases;
+
+static inline void log_lock(void)   { xSemaphoreTake(s_mtx, portMAX_DELAY); }
+static inline void log_unlock(void) { xSemaphoreGive(s_mtx); }
+
+static inline uint32_t rec_size(uint32_t len) { return REC_HDR + ((len + 3u) & ~3u); }
+static inline uint32_t sec_off(int s)         { return (uint32_t)s * SEC_SIZE; }
+
+// -------------------- flash access --------------------
+static esp_err_t fl_read(uint32_t off, void *dst, size_t n)
+{
+    s_rd_bytes += (uint32_t)n;
+    return esp_partition_read(s_part, off, dst, n);
+}
+
+static esp_err_t fl_write(uint32_t off, const void *src, size_t n)
+{
+    s_pr_bytes += (uint32_t)n;
+    return esp_partition_write(s_part, off, src, n);
+}
+
+static esp_err_t fl_erase(int s)
+{
+    s_erases++;
+    return esp_partition_erase_range(s_part, sec_off(s), SEC_SIZE);
+}
+
+static bool all_ff(const uint8_t *p, size_t n)
+{
+    for (size_t i = 0; i < n; i++) if (p[i] != 0xFF) return false;
+    return true;
+}
+
+// [off, off + n) still erased
+static bool fl_blank(uint32_t off, uint32_t n)
+{
+    uint8_t buf[CHUNK];
+    while (n) {
+        uint32_t k = n < CHUNK ? n : CHUNK;
+        if (fl_read(off, buf, k) != ESP_OK || !all_ff(buf, k)) return false;
+        off += k;
+        n -= k;
+    }
+    return true;
+}
+
+// crc of a record: first 8 header bytes (no crc field) + value
+static uint32_t rec_crc_mem(const rec_hdr_t *h, const void *val)
+{
+    uint32_t c = esp_rom_crc32_le(0, (const uint8_t *)h, 8);
+    return h->len ? esp_rom_crc32_le(c, (const uint8_t *)val, h->len) : c;
+}
+
+static esp_err_t rec_crc_flash(const rec_hdr_t *h, uint32_t val_off, uint32_t *out)
+{
+    uint8_t buf[CHUNK];
+    uint32_t c = esp_rom_crc32_le(0, (const uint8_t *)h, 8);
+    for (uint32_t pos = 0; pos < h->len; ) {
+        uint32_t k = h->len - pos < CHUNK ? h->len - pos : CHUNK;
+        esp_err_t e = fl_read(val_off + pos, buf, k);
+        if (e != ESP_OK) return e;
+        c = esp_rom_crc32_le(c, buf, k);
+        pos += k;
+    }
+    *out = c;
+    return ESP_OK;
+}
+
+// -------------------- sectors --------------------
+static int free_count(void)
+{
+    int n = 0;
+    for (int s = 0; s < s_nsec; s++) if (!s_seq[s]) n++;
+    return n;
+}
+
+static uint32_t live_bytes(void)
+{
+    uint32_t n = 0;
+    for (int k = 0; k < CFG_LOG_KEYS; k++) if (s_idx[k].off) n += rec_size(s_idx[k].len);
+    return n;
+}
+
+// next free sector after the head in ring order (the ring is what spreads the erases)
+static esp_err_t sec_open(void)
+{
+    for (int i = 1; i <= s_nsec; i++) {
+        int s = (s_head < 0 ? i - 1 : s_head + i) % s_nsec;
+        if (s_seq[s]) continue;
+
+        // freed sectors are erased right away; a torn erase / foreign data gets another one
+        if (!fl_blank(sec_off(s), SEC_SIZE)) {
+            esp_err_t e = fl_erase(s);
+            if (e != ESP_OK) return e;
+        }
+
+        uint32_t hdr[3] = { SEC_MAGIC, s_next_seq, 0 };
+        hdr[2] = esp_rom_crc32_le(0, (const uint8_t *)hdr, 8);
+        esp_err_t e = fl_write(sec_off(s), hdr, sizeof(hdr));
+        if (e != ESP_OK) return e;
+
+        s_seq[s] = s_next_seq++;
+        s_head = s;
+        s_wpos = SEC_HDR;
+        return ESP_OK;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+static esp_err_t log_gc(void);
+
+// room for `need` bytes at the head -> *at (partition offset)
+static esp_err_t log_reserve(uint32_t need, uint32_t *at, bool gc_ok)
+{
+    if (s_head < 0 || s_wpos + need > SEC_SIZE) {
+        if (gc_ok) {
+            for (int i = 0; i < s_nsec && free_count() <= GC_RESERVE; i++) {
+                esp_err_t e = log_gc();
+                if (e != ESP_OK) return e;
+            }
+            if (free_count() <= GC_RESERVE) return ESP_ERR_NO_MEM;
+        }
+        esp_err_t e = sec_open();
+        if (e != ESP_OK) return e;
+    }
+
+    *at = sec_off(s_head) + s_wpos;
+    s_wpos += need;
+    return ESP_OK;
+}
+
+// header first, then the value: a cut in between leaves a crc mismatch, never a valid record
+static esp_err_t rec_write(uint32_t at, rec_hdr_t *h, const void *val)
+{
+    esp_err_t e = fl_write(at, h, REC_HDR);
+    if (e == ESP_OK && h->len) e = fl_write(at + REC_HDR, val, h->len);
+    if (e != ESP_OK) s_wpos = SEC_SIZE;   // seal the head, the next append opens a new sector
+    return e;
+}
+
+static esp_err_t log_append(uint8_t key, uint8_t flags, uint16_t batch, const void *val, uint16_t len, uint32_t *at)
+{
+    esp_err_t e = log_reserve(rec_size(len), at, true);
+    if (e != ESP_OK) return e;
+
+    rec_hdr_t h = { .key = key, .flags = flags, .len = len, .batch = batch, .rsv = 0xFFFF };
+    h.crc = rec_crc_mem(&h, val);
+    return rec_write(*at, &h, val);
+}
+
+// live record at `off` -> head, as a plain record (its batch is long committed)
+static esp_err_t gc_copy(uint32_t off, const rec_hdr_t *src)
+{
+    uint32_t at;
+    esp_err_t e = log_reserve(rec_size(src->len), &at, false);
+    if (e != ESP_OK) return e;
+
+    rec_hdr_t h = { .key = src->key, .flags = (uint8_t)(src->flags & F_DEL), .len = src->len,
+                    .batch = 0xFFFF, .rsv = 0xFFFF };
+    uint32_t crc = 0;
+    e = rec_crc_flash(&h, off + REC_HDR, &crc);
+    h.crc = crc;
+    if (e == ESP_OK) e = fl_write(at, &h, REC_HDR);
+
+    uint8_t buf[CHUNK];
+    for (uint32_t pos = 0; e == ESP_OK && pos < h.len; ) {
+        uint32_t k = h.len - pos < CHUNK ? h.len - pos : CHUNK;
+        e = fl_read(off + REC_HDR + pos, buf, k);
+        if (e == ESP_OK) e = fl_write(at + REC_HDR + pos, buf, k);
+        pos += k;
+    }
+    if (e != ESP_OK) {
+        s_wpos = SEC_SIZE;
+        return e;
+    }
+
+    s_idx[src->key].off = at;
+    return ESP_OK;
+}
+
+// oldest sector: live records -> head, dead ones and tombstones dropped, sector erased
+static esp_err_t log_gc(void)
+{
+    int v = -1;
+    for (int s = 0; s < s_nsec; s++) {
+        if (!s_seq[s] || s == s_head) continue;
+        if (v < 0 || s_seq[s] < s_seq[v]) v = s;
+    }
+    if (v < 0) return ESP_ERR_NO_MEM;
+
+    // records of the batch in flight must stay where they are until its commit
+    if (s_batch_seq && s_seq[v] >= s_batch_seq) return ESP_ERR_NO_MEM;
+
+    uint32_t base = sec_off(v);
+    for (uint32_t pos = SEC_HDR; pos + REC_HDR <= SEC_SIZE; ) {
+        rec_hdr_t h;
+        esp_err_t e = fl_read(base + pos, &h, REC_HDR);
+        if (e != ESP_OK) return e;
+        if (all_ff((const uint8_t *)&h, REC_HDR)) break;
+
+        // the mount scan only indexed records that passed their crc -> an indexed offset
+        // is a valid record; everything else in here is dead
+        uint32_t off = base + pos;
+        if (h.key < CFG_LOG_KEYS && !(h.flags & F_COMMIT) && s_idx[h.key].off == off) {
+            if (s_idx[h.key].del) {
+                memset(&s_idx[h.key], 0, sizeof(ent_t));   // nothing older left to hide
+            } else {
+                e = gc_copy(off, &h);
+                if (e != ESP_OK) return e;
+            }
+        }
+
+        if (h.len > CFG_LOG_VAL_MAX) break;   // garbage past a torn record
+        pos += rec_size(h.len);
+    }
+
+    s_seq[v] = 0;
+    return fl_erase(v);
+}
+
+// -------------------- mount --------------------
+static void idx_apply(ent_t *dst, const ent_t *src)
+{
+    for (int k = 0; k < CFG_LOG_KEYS; k++) {
+        if (src[k].off) dst[k] = src[k];
+    }
+}
+
+// records of one sector (sec = its SEC_SIZE bytes); false = sealed (torn / corrupt record,
+// nothing valid after it)
+static bool scan_sector(int s, const uint8_t *sec, uint32_t *end, uint16_t *pend_batch, bool *pend_on)
+{
+    uint32_t base = sec_off(s);
+    uint32_t pos = SEC_HDR;
+
+    while (pos + REC_HDR <= SEC_SIZE) {
+        rec_hdr_t h;
+        memcpy(&h, sec + pos, REC_HDR);
+        if (all_ff(sec + pos, REC_HDR)) {
+            *end = pos;
+            return true;
+        }
+
+        if (h.len > CFG_LOG_VAL_MAX || pos + rec_size(h.len) > SEC_SIZE) break;
+        if (!(h.flags & F_COMMIT) && h.key >= CFG_LOG_KEYS) break;
+        if (rec_crc_mem(&h, sec + pos + REC_HDR) != h.crc) break;
+
+        ent_t e = { .off = base + pos, .len = h.len, .del = (uint8_t)((h.flags & F_DEL) ? 1 : 0) };
+
+        if (h.flags & F_BATCH) {
+            // a new batch id drops whatever an interrupted batch left behind
+            if (!*pend_on || *pend_batch != h.batch) {
+                memset(s_pend, 0, sizeof(s_pend));
+                *pend_batch = h.batch;
+                *pend_on = true;
+            }
+            if (h.flags & F_COMMIT) {
+                idx_apply(s_idx, s_pend);
+                memset(s_pend, 0, sizeof(s_pend));
+                *pend_on = false;
+            } else {
+                s_pend[h.key] = e;
+            }
+            s_batch = (uint16_t)(h.batch + 1u);
+        } else {
+            s_idx[h.key] = e;
+        }
+
+        pos += rec_size(h.len);
+    }
+
+    *end = pos;
+    return pos + REC_HDR > SEC_SIZE;   // full
+}
+
+esp_err_t cfg_log_mount(const char *label)
+{
+    if (s_part) return ESP_OK;
+
+    const esp_partition_t *p = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, label);
+    if (!p) return ESP_ERR_NOT_FOUND;
+
+    int nsec = (int)(p->size / SEC_SIZE);
+    if (nsec < GC_RESERVE + 2) return ESP_ERR_INVALID_SIZE;
+    if (nsec > SEC_MAX) nsec = SEC_MAX;
+
+    s_val = (uint8_t *)heap_caps_malloc(SEC_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_mtx = xSemaphoreCreateMutex();
+    if (!s_val || !s_mtx) {
+        heap_caps_free(s_val);
+        s_val = NULL;
+        if (s_mtx) vSemaphoreDelete(s_mtx);
+        s_mtx = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_part = p;
+    s_nsec = nsec;
+    s_rd_bytes = s_pr_bytes = s_erases = 0;
+    memset(s_idx, 0, sizeof(s_idx));
+    memset(s_pend, 0, sizeof(s_pend));
+
+    // sector headers: valid -> in the ring, blank -> free, anything else -> erased now
+    static uint16_t order[SEC_MAX];
+    int order_n = 0;
+    uint32_t max_seq = 0;
+    for (int s = 0; s < s_nsec; s++) {
+        uint32_t hdr[3];
+        s_seq[s] = 0;
+        if (fl_read(sec_off(s), hdr, sizeof(hdr)) != ESP_OK) continue;
+
+        // crc: a torn header write leaves 0xFF in the seq bytes -> a bogus "newest" sector
+        if (hdr[0] == SEC_MAGIC && hdr[1] != 0 && hdr[2] == esp_rom_crc32_le(0, (const uint8_t *)hdr, 8)) {
+            s_seq[s] = hdr[1];
+            if (hdr[1] > max_seq) max_seq = hdr[1];
+
+            int i = order_n++;
+            while (i > 0 && s_seq[order[i - 1]] > hdr[1]) { order[i] = order[i - 1]; i--; }
+            order[i] = (uint16_t)s;
+        } else if (!all_ff((const uint8_t *)hdr, sizeof(hdr))) {
+            ESP_LOGW(TAG, "sector %d: bad header, erased", s);
+            fl_erase(s);
+        }
+    }
+    s_next_seq = max_seq + 1;
+
+    // one pass, oldest -> newest, one read per sector: later records override earlier ones
+    uint16_t pend_batch = 0;
+    bool pend_on = false;
+    s_head = -1;
+    for (int i = 0; i < order_n; i++) {
+        int s = order[i];
+        uint32_t end = SEC_HDR;
+        bool ok = (fl_read(sec_off(s), s_val, SEC_SIZE) == ESP_OK) &&
+                  scan_sector(s, s_val, &end, &pend_batch, &pend_on);
+        if (i == order_n - 1) {
+            if (!ok) ESP_LOGW(TAG, "sector %d: torn record @%u, sealed", s, (unsigned)end);
+            s_head = s;
+            // appends go on only into a clean tail
+            s_wpos = (ok && all_ff(s_val + end, SEC_SIZE - end)) ? end : SEC_SIZE;
+        }
+    }
+
+    if (pend_on) ESP_LOGW(TAG, "interrupted batch %u dropped", (unsigned)pend_batch);
+    memset(s_pend, 0, sizeof(s_pend));
+
+    ESP_LOGI(TAG, "mounted '%s': %d sectors, %d free, %u live bytes", label, s_nsec,
+             free_count(), (unsigned)live_bytes());
+    return ESP_OK;
+}
+
+bool cfg_log_ready(void) { return s_part != NULL; }
+
+// -------------------- access --------------------
+esp_err_t cfg_log_get(uint8_t key, void *dst, size_t cap, size_t *len)
+{
+    if (!s_part) return ESP_ERR_INVALID_STATE;
+    if (key >= CFG_LOG_KEYS) return ESP_ERR_INVALID_ARG;
+
+    log_lock();
+    ent_t e = s_idx[key];
+    esp_err_t err = ESP_OK;
+    if (!e.off || e.del) err = ESP_ERR_NOT_FOUND;
+    else if (e.len > cap) err = ESP_ERR_INVALID_SIZE;
+    else if (e.len) err = fl_read(e.off + REC_HDR, dst, e.len);
+    log_unlock();
+
+    if (len) *len = (e.off && !e.del) ? e.len : 0;
+    return err;
+}
+
+bool cfg_log_has(uint8_t key)
+{
+    if (!s_part || key >= CFG_LOG_KEYS) return false;
+
+    log_lock();
+    bool has = s_idx[key].off && !s_idx[key].del;
+    log_unlock();
+    return has;
+}
+
+static bool same_value(uint8_t key, const void *val, size_t len)
+{
+    const ent_t *e = &s_idx[key];
+    if (!e->off || e->del || e->len != len) return false;
+
+    uint8_t buf[CHUNK];
+    for (size_t pos = 0; pos < len; ) {
+        size_t k = len - pos < CHUNK ? len - pos : CHUNK;
+        if (fl_read(e->off + REC_HDR + (uint32_t)pos, buf, k) != ESP_OK) return false;
+        if (memcmp(buf, (const uint8_t *)val + pos, k)) return false;
+        pos += k;
+    }
+    return true;
+}
+
+// room check before writing: the ring minus the compaction reserve must hold every
+// live record (otherwise gc would only shuffle full sectors around)
+static bool fits(uint32_t add)
+{
+    uint32_t cap = (uint32_t)(s_nsec - GC_RESERVE - 1) * (SEC_SIZE - SEC_HDR);
+    return live_bytes() + add <= cap;
+}
+
+esp_err_t cfg_log_put(uint8_t key, const void *val, size_t len)
+{
+    if (!s_part) return ESP_ERR_INVALID_STATE;
+    if (key >= CFG_LOG_KEYS || len > CFG_LOG_VAL_MAX || (len && !val)) return ESP_ERR_INVALID_ARG;
+
+    log_lock();
+    esp_err_t e = ESP_OK;
+    if (!same_value(key, val, len)) {
+        uint32_t at = 0;
+        e = fits(rec_size((uint32_t)len)) ? log_append(key, 0, 0xFFFF, val, (uint16_t)len, &at)
+                                          : ESP_ERR_NO_MEM;
+        if (e == ESP_OK) s_idx[key] = (ent_t){ .off = at, .len = (uint16_t)len };
+    }
+    log_unlock();
+
+    if (e != ESP_OK) ESP_LOGE(TAG, "put key %u: %s", key, esp_err_to_name(e));
+    return e;
+}
+
+esp_err_t cfg_log_del(uint8_t key)
+{
+    if (!s_part) return ESP_ERR_INVALID_STATE;
+    if (key >= CFG_LOG_KEYS) return ESP_ERR_INVALID_ARG;
+
+    log_lock();
+    esp_err_t e = ESP_OK;
+    if (s_idx[key].off && !s_idx[key].del) {
+        uint32_t at = 0;
+        e = log_append(key, F_DEL, 0xFFFF, NULL, 0, &at);
+        if (e == ESP_OK) s_idx[key] = (ent_t){ .off = at, .del = 1 };
+    }
+    log_unlock();
+    return e;
+}
+
+esp_err_t cfg_log_write(int n, cfg_log_item_fn fn, void *ctx)
+{
+    if (!s_part) return ESP_ERR_INVALID_STATE;
+    if (n < 0 || !fn) return ESP_ERR_INVALID_ARG;
+
+    log_lock();
+
+    uint16_t batch = s_batch++;
+    s_batch_seq = s_head >= 0 ? s_seq[s_head] : s_next_seq;
+    memset(s_pend, 0, sizeof(s_pend));
+
+    esp_err_t e = ESP_OK;
+    int written = 0;
+    for (int i = 0; i < n && e == ESP_OK; i++) {
+        uint8_t key = 0;
+        size_t len = 0;
+        e = fn(ctx, i, &key, s_val, &len);
+        if (e == ESP_ERR_NOT_FOUND) { e = ESP_OK; continue; }
+        if (e != ESP_OK) break;
+
+        bool del = (len == CFG_LOG_DEL);
+        if (key >= CFG_LOG_KEYS || (!del && len > CFG_LOG_VAL_MAX)) { e = ESP_ERR_INVALID_ARG; break; }
+        if (del && !(s_idx[key].off && !s_idx[key].del) && !s_pend[key].off) continue;
+        if (!del && !s_pend[key].off && same_value(key, s_val, len)) continue;
+
+        uint32_t add = del ? REC_HDR : rec_size((uint32_t)len);
+        if (!fits(add)) { e = ESP_ERR_NO_MEM; break; }
+
+        uint32_t at = 0;
+        e = log_append(key, (uint8_t)(F_BATCH | (del ? F_DEL : 0)), batch, del ? NULL : s_val,
+                       (uint16_t)(del ? 0 : len), &at);
+        if (e == ESP_OK) {
+            s_pend[key] = (ent_t){ .off = at, .len = (uint16_t)(del ? 0 : len), .del = del };
+            written++;
+        }
+    }
+
+    if (e == ESP_OK && written) {
+        uint32_t at = 0;
+        e = log_append(0, F_BATCH | F_COMMIT, batch, NULL, 0, &at);
+    }
+    if (e == ESP_OK) idx_apply(s_idx, s_pend);   // readers see the batch only once it is whole
+
+    memset(s_pend, 0, sizeof(s_pend));
+    s_batch_seq = 0;
+    log_unlock();
+
+    if (e != ESP_OK) ESP_LOGE(TAG, "batch %u: %s", (unsigned)batch, esp_err_to_name(e));
+    return e;
+}
+
+void cfg_log_get_stats(cfg_log_stats_t *out)
+{
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if (!s_part) return;
+
+    log_lock();
+    out->sectors      = (uint32_t)s_nsec;
+    out->free_sectors = (uint32_t)free_count();
+    out->live_bytes   = live_bytes();
+    out->read_bytes   = s_rd_bytes;
+    out->prog_bytes   = s_pr_bytes;
+    out->erases       = s_erases;
+    log_unlock();
+}
@@ -0,0 +1,58 @@
+// ===== FILE: main/cfg_log.h =====
+#pragma once
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+// Log-structured key/record store on a raw data partition ("cfglog" in partitions.csv).
+//
+// - a write is one append (header + value), the newest copy of a key wins: no FAT, no
+//   directory, no tmp file + rename
+// - 4 KB sectors used as a ring: when free sectors run low the oldest one is compacted
+//   (live records copied to the head) and erased -> every sector sees the same erase count
+// - every record carries a crc32, a torn write at the head is skipped on mount
+// - mount = one sequential scan -> RAM index (key -> flash offset), reads are one
+//   esp_partition_read of the value
+// - cfg_log_write: several records valid together (all or nothing across a power cut)
+//
+// sector: u32 magic 'FSL1', u32 seq (ring order), u32 crc32 (magic + seq), records
+// record: u8 key, u8 flags, u16 len, u16 batch, u16 rsv, u32 crc32 (first 8 bytes + value),
+//         value, padded to 4 bytes
+//
+// callers: config_store (settings + one record per config bank). mount runs once at boot,
+// everything else takes an internal mutex.
+
+#define CFG_LOG_KEYS     128                  // keys 0..CFG_LOG_KEYS-1
+#define CFG_LOG_VAL_MAX  (4096 - 12 - 12)     // a record never spans sectors
+#define CFG_LOG_DEL      ((size_t)-1)         // cfg_log_write item length: delete the key
+
+typedef struct {
+    uint32_t sectors;        // partition size / 4 KB
+    uint32_t free_sectors;   // erased, ready for the head
+    uint32_t live_bytes;     // newest record of every key, headers included
+    uint32_t read_bytes;     // flash traffic since mount (mount scan included)
+    uint32_t prog_bytes;
+    uint32_t erases;
+} cfg_log_stats_t;
+
+// ESP_ERR_NOT_FOUND: no partition with that label (older partition table)
+esp_err_t cfg_log_mount(const char *label);
+bool      cfg_log_ready(void);
+
+// newest value of `key`. ESP_ERR_NOT_FOUND = never written / deleted,
+// ESP_ERR_INVALID_SIZE = longer than cap (*len is set either way)
+esp_err_t cfg_log_get(uint8_t key, void *dst, size_t cap, size_t *len);
+bool      cfg_log_has(uint8_t key);
+
+// single record (same value as stored = no write)
+esp_err_t cfg_log_put(uint8_t key, const void *val, size_t len);
+esp_err_t cfg_log_del(uint8_t key);
+
+// n items as one batch. fn fills item i: *key, the value into buf (CFG_LOG_VAL_MAX bytes)
+// and *len (CFG_LOG_DEL = delete the key). fn returns ESP_OK, ESP_ERR_NOT_FOUND = skip the
+// item, anything else aborts: nothing of the batch becomes valid
+typedef esp_err_t (*cfg_log_item_fn)(void *ctx, int i, uint8_t *key, uint8_t *buf, size_t *len);
+esp_err_t cfg_log_write(int n, cfg_log_item_fn fn, void *ctx);
+
+void cfg_log_get_stats(cfg_log_stats_t *out);
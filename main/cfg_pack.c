@@ -0,0 +1,313 @@
+// ===== FILE: main/cfg_pack.c =====
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "esp_heap_caps.h"
+#include "esp_rom_crc.h"
+
+#include "cfg_pack.h"
+
+static inline int clamp_bc(int bc)
+{
+    if (bc < 1) return 1;
+    if (bc > MAX_BANKS) return MAX_BANKS;
+    return bc;
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// -------------------- v5 (raw) --------------------
+size_t cfg_v5_packed_size(int bank_count)
+{
+    int bc = clamp_bc(bank_count);
+
+    // [u8 bank_count] + bank_name + switch_name + map
+    return (size_t)1
+         + (size_t)bc * (size_t)NAME_LEN
+         + (size_t)bc * (size_t)NUM_BTNS * (size_t)NAME_LEN
+         + (size_t)bc * (size_t)NUM_BTNS * sizeof(btn_map_t);
+}
+
+esp_err_t cfg_v5_pack(const foot_config_t *in, uint8_t **out_buf, size_t *out_len)
+{
+    if (!in || !out_buf || !out_len) return ESP_ERR_INVALID_ARG;
+
+    int bc = clamp_bc((int)in->bank_count);
+    size_t need = cfg_v5_packed_size(bc);
+
+    uint8_t *buf = (uint8_t *)heap_caps_malloc(need, MALLOC_CAP_8BIT);
+    if (!buf) return ESP_ERR_NO_MEM;
+
+    uint8_t *p = buf;
+    *p++ = (uint8_t)bc;
+
+    memcpy(p, in->bank_name, (size_t)bc * (size_t)NAME_LEN);
+    p += (size_t)bc * (size_t)NAME_LEN;
+
+    memcpy(p, in->switch_name, (size_t)bc * (size_t)NUM_BTNS * (size_t)NAME_LEN);
+    p += (size_t)bc * (size_t)NUM_BTNS * (size_t)NAME_LEN;
+
+    memcpy(p, in->map, (size_t)bc * (size_t)NUM_BTNS * sizeof(btn_map_t));
+
+    *out_buf = buf;
+    *out_len = need;
+    return ESP_OK;
+}
+
+esp_err_t cfg_v5_unpack(foot_config_t *out, const uint8_t *buf, size_t len)
+{
+    if (!out || !buf) return ESP_ERR_INVALID_ARG;
+    if (len < 1) return ESP_FAIL;
+
+    int bc = (int)buf[0];
+    if (bc < 1 || bc > MAX_BANKS) return ESP_FAIL;
+    if (len != cfg_v5_packed_size(bc)) return ESP_FAIL;
+
+    out->bank_count = (uint8_t)bc;
+
+    const uint8_t *p = buf + 1;
+
+    memcpy(out->bank_name, p, (size_t)bc * (size_t)NAME_LEN);
+    p += (size_t)bc * (size_t)NAME_LEN;
+
+    memcpy(out->switch_name, p, (size_t)bc * (size_t)NUM_BTNS * (size_t)NAME_LEN);
+    p += (size_t)bc * (size_t)NUM_BTNS * (size_t)NAME_LEN;
+
+    memcpy(out->map, p, (size_t)bc * (size_t)NUM_BTNS * sizeof(btn_map_t));
+    return ESP_OK;
+}
+
+// -------------------- v6 (compact) --------------------
+size_t cfg_v6_max_size(int bank_count)
+{
+    int bc = clamp_bc(bank_count);
+
+    // names: u8 len + at most NAME_LEN-1 chars = NAME_LEN
+    return (size_t)1
+         + (size_t)bc * ((size_t)NAME_LEN + 4u)
+         + (size_t)bc * (size_t)NUM_BTNS * ((size_t)NAME_LEN + CFG_V6_BTN_MAX)
+         + 4u;
+}
+
+static size_t put_name(uint8_t *dst, const char *name)
+{
+    size_t n = strnlen(name, NAME_LEN - 1);
+    dst[0] = (uint8_t)n;
+    memcpy(dst + 1, name, n);
+    return 1 + n;
+}
+
+// 0 = malformed
+static size_t get_name(char dst[NAME_LEN], const uint8_t *src, size_t len)
+{
+    if (len < 1) return 0;
+    size_t n = src[0];
+    if (n > NAME_LEN - 1 || 1 + n > len) return 0;
+    memcpy(dst, src + 1, n);
+    memset(dst + n, 0, NAME_LEN - n);
+    return 1 + n;
+}
+
+static inline uint32_t act_enc(const action_t *a)
+{
+    return ((uint32_t)a->type & 0x07u)
+         | (((uint32_t)(a->ch - 1u) & 0x0Fu) << 3)
+         | (((uint32_t)a->a & 0x7Fu) << 7)
+         | (((uint32_t)a->b & 0x7Fu) << 14)
+         | (((uint32_t)a->c & 0x7Fu) << 21);
+}
+
+static inline void act_dec(action_t *a, uint32_t v)
+{
+    a->type = (action_type_t)(v & 0x07u);
+    a->ch   = (uint8_t)(((v >> 3) & 0x0Fu) + 1u);
+    a->a    = (uint8_t)((v >> 7) & 0x7Fu);
+    a->b    = (uint8_t)((v >> 14) & 0x7Fu);
+    a->c    = (uint8_t)((v >> 21) & 0x7Fu);
+}
+
+static int act_count(const action_t *list)
+{
+    int n = MAX_ACTIONS;
+    while (n > 0 && list[n - 1].type == ACT_NONE) n--;
+    return n;
+}
+
+size_t cfg_v6_put_btn(uint8_t *dst, const btn_map_t *m)
+{
+    int ns = act_count(m->short_actions);
+    int nl = act_count(m->long_actions);
+
+    uint8_t *p = dst;
+    *p++ = (uint8_t)(((uint32_t)m->press_mode & 0x03u) | (((uint32_t)m->cc_behavior & 0x03u) << 2));
+    *p++ = (uint8_t)ns;
+    *p++ = (uint8_t)nl;
+    for (int i = 0; i < ns; i++, p += CFG_V6_ACT_SIZE) put_u32(p, act_enc(&m->short_actions[i]));
+    for (int i = 0; i < nl; i++, p += CFG_V6_ACT_SIZE) put_u32(p, act_enc(&m->long_actions[i]));
+    return (size_t)(p - dst);
+}
+
+size_t cfg_v6_get_btn(btn_map_t *m, const uint8_t *src, size_t len)
+{
+    if (len < 3) return 0;
+
+    int ns = src[1];
+    int nl = src[2];
+    if (ns > MAX_ACTIONS || nl > MAX_ACTIONS) return 0;
+
+    size_t need = 3u + (size_t)(ns + nl) * CFG_V6_ACT_SIZE;
+    if (need > len) return 0;
+
+    m->press_mode  = (btn_press_mode_t)(src[0] & 0x03u);
+    m->cc_behavior = (cc_behavior_t)((src[0] >> 2) & 0x03u);
+
+    const action_t none = { .type = ACT_NONE, .ch = 1, .a = 0, .b = 0, .c = 0 };
+    const uint8_t *p = src + 3;
+    for (int i = 0; i < MAX_ACTIONS; i++) {
+        if (i < ns) { act_dec(&m->short_actions[i], get_u32(p)); p += CFG_V6_ACT_SIZE; }
+        else m->short_actions[i] = none;
+    }
+    for (int i = 0; i < MAX_ACTIONS; i++) {
+        if (i < nl) { act_dec(&m->long_actions[i], get_u32(p)); p += CFG_V6_ACT_SIZE; }
+        else m->long_actions[i] = none;
+    }
+    return need;
+}
+
+size_t cfg_v6_put_bank(uint8_t *dst, const char *names, const btn_map_t *map)
+{
+    size_t pos = 0;
+    for (int k = 0; k < NUM_BTNS; k++) pos += put_name(dst + pos, names + (size_t)k * NAME_LEN);
+    for (int k = 0; k < NUM_BTNS; k++) pos += cfg_v6_put_btn(dst + pos, &map[k]);
+    return pos;
+}
+
+size_t cfg_v6_get_bank(char *names, btn_map_t *map, const uint8_t *src, size_t len)
+{
+    size_t pos = 0;
+    for (int k = 0; k < NUM_BTNS; k++) {
+        size_t n = get_name(names + (size_t)k * NAME_LEN, src + pos, len - pos);
+        if (!n) return 0;
+        pos += n;
+    }
+    for (int k = 0; k < NUM_BTNS; k++) {
+        size_t n = cfg_v6_get_btn(&map[k], src + pos, len - pos);
+        if (!n) return 0;
+        pos += n;
+    }
+    return pos;
+}
+
+size_t cfg_v6_put_names(uint8_t *dst, int bank_count, const char *bank_names)
+{
+    int bc = clamp_bc(bank_count);
+
+    size_t pos = 0;
+    dst[pos++] = (uint8_t)bc;
+    for (int b = 0; b < bc; b++) pos += put_name(dst + pos, bank_names + (size_t)b * NAME_LEN);
+    return pos;
+}
+
+size_t cfg_v6_get_names(int *bank_count, char *bank_names, const uint8_t *src, size_t len)
+{
+    if (len < 1) return 0;
+
+    int bc = (int)src[0];
+    if (bc < 1 || bc > MAX_BANKS) return 0;
+
+    size_t pos = 1;
+    for (int b = 0; b < bc; b++) {
+        size_t n = get_name(bank_names + (size_t)b * NAME_LEN, src + pos, len - pos);
+        if (!n) return 0;
+        pos += n;
+    }
+
+    *bank_count = bc;
+    return pos;
+}
+
+size_t cfg_v6_put_head(uint8_t *dst, int bank_count, const char *bank_names, const uint32_t *rec_off)
+{
+    int bc = clamp_bc(bank_count);
+
+    size_t pos = cfg_v6_put_names(dst, bc, bank_names);
+    for (int b = 0; b < bc; b++, pos += 4u) put_u32(dst + pos, rec_off ? rec_off[b] : 0u);
+    return pos;
+}
+
+size_t cfg_v6_get_head(int *bank_count, char *bank_names, uint32_t *rec_off, const uint8_t *src, size_t len)
+{
+    int bc = 0;
+    size_t pos = cfg_v6_get_names(&bc, bank_names, src, len);
+    if (!pos) return 0;
+
+    if (pos + (size_t)bc * 4u > len) return 0;
+    for (int b = 0; b < bc; b++, pos += 4u) {
+        rec_off[b] = get_u32(src + pos);
+        if (rec_off[b] < pos + (size_t)(bc - b) * 4u) return 0;   // records follow the table
+    }
+
+    *bank_count = bc;
+    return pos;
+}
+
+esp_err_t cfg_v6_pack(const foot_config_t *in, uint8_t **out_buf, size_t *out_len)
+{
+    if (!in || !out_buf || !out_len) return ESP_ERR_INVALID_ARG;
+
+    int bc = clamp_bc((int)in->bank_count);
+
+    // sized for the worst case, trimmed below (typical configs are a few % of this)
+    uint8_t *buf = (uint8_t *)heap_caps_malloc(cfg_v6_max_size(bc), MALLOC_CAP_8BIT);
+    if (!buf) return ESP_ERR_NO_MEM;
+
+    // head first with a zero table, patched once the record offsets are known
+    size_t off_tab = cfg_v6_put_head(buf, bc, &in->bank_name[0][0], NULL) - (size_t)bc * 4u;
+    size_t pos = off_tab + (size_t)bc * 4u;
+
+    for (int b = 0; b < bc; b++) {
+        put_u32(buf + off_tab + (size_t)b * 4u, (uint32_t)pos);
+        pos += cfg_v6_put_bank(buf + pos, &in->switch_name[b][0][0], in->map[b]);
+    }
+
+    put_u32(buf + pos, esp_rom_crc32_le(0, buf, (uint32_t)pos));
+    pos += 4u;
+
+    uint8_t *fit = (uint8_t *)heap_caps_realloc(buf, pos, MALLOC_CAP_8BIT);
+    *out_buf = fit ? fit : buf;
+    *out_len = pos;
+    return ESP_OK;
+}
+
+esp_err_t cfg_v6_unpack(foot_config_t *out, const uint8_t *buf, size_t len)
+{
+    if (!out || !buf) return ESP_ERR_INVALID_ARG;
+    if (len < 1 + 4) return ESP_FAIL;
+
+    size_t body = len - 4u;
+    if (get_u32(buf + body) != esp_rom_crc32_le(0, buf, (uint32_t)body)) return ESP_ERR_INVALID_CRC;
+
+    int bc = 0;
+    uint32_t off[MAX_BANKS];
+    if (!cfg_v6_get_head(&bc, &out->bank_name[0][0], off, buf, body)) return ESP_FAIL;
+
+    for (int b = 0; b < bc; b++) {
+        if (off[b] >= body) return ESP_FAIL;
+        if (!cfg_v6_get_bank(&out->switch_name[b][0][0], out->map[b], buf + off[b], body - off[b])) return ESP_FAIL;
+    }
+
+    out->bank_count = (uint8_t)bc;
+    return ESP_OK;
+}
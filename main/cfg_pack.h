@@ -0,0 +1,63 @@
+// ===== FILE: main/cfg_pack.h =====
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "config_store.h"
+
+// On-flash encodings of foot_config_t (payload after cfg_hdr_v4_t).
+//
+// v5: raw slices of foot_config_t (bank_count, names, btn_map_t[]), fixed size per bank.
+//
+// v6: variable length, little endian
+//   u8  bank_count
+//   bank_count x { u8 len, name[len] }          bank names (no '\0')
+//   bank_count x u32                            offset of each bank record in the payload
+//   bank record: 8 x { u8 len, name[len] }      switch names
+//                8 x btn                        see below
+//   u32 crc32                                   esp_rom_crc32_le(0, everything above)
+//
+//   btn:    u8 mode (press_mode | cc_behavior << 2), u8 n_short, u8 n_long,
+//           (n_short + n_long) x u32 action
+//   action: bits 0..2 type, 3..6 ch-1, 7..13 a, 14..20 b, 21..27 c, 28..31 zero
+//   n = last non-NONE slot + 1, slots past n decode as ACT_NONE
+//
+// unpack only writes banks < bank_count: the caller fills `out` with defaults first.
+// pure C (no ESP-IDF calls besides crc32 / heap) -> builds on the host for the benchmark.
+
+#define CFG_V6_ACT_SIZE  4
+#define CFG_V6_BTN_MAX   (3 + 2 * MAX_ACTIONS * CFG_V6_ACT_SIZE)
+
+// ---- v5 ----
+size_t    cfg_v5_packed_size(int bank_count);
+esp_err_t cfg_v5_pack(const foot_config_t *in, uint8_t **out_buf, size_t *out_len);
+esp_err_t cfg_v5_unpack(foot_config_t *out, const uint8_t *buf, size_t len);
+
+// ---- v6 ----
+size_t    cfg_v6_max_size(int bank_count);
+esp_err_t cfg_v6_pack(const foot_config_t *in, uint8_t **out_buf, size_t *out_len);
+esp_err_t cfg_v6_unpack(foot_config_t *out, const uint8_t *buf, size_t len);
+
+// ---- v6 pieces (paged access: config_store reads / writes one bank record at a time) ----
+#define CFG_V6_BANK_MAX  ((size_t)NUM_BTNS * ((size_t)NAME_LEN + CFG_V6_BTN_MAX))
+#define CFG_V6_HEAD_MAX  ((size_t)1 + (size_t)MAX_BANKS * ((size_t)NAME_LEN + 4u))
+
+// bank record. names = NUM_BTNS x NAME_LEN chars (like switch_name[bank]), map = NUM_BTNS.
+// dst needs CFG_V6_BANK_MAX bytes; get returns bytes consumed, 0 = malformed
+size_t cfg_v6_put_bank(uint8_t *dst, const char *names, const btn_map_t *map);
+size_t cfg_v6_get_bank(char *names, btn_map_t *map, const uint8_t *src, size_t len);
+
+// payload head: bank_count, bank names (bank_count x NAME_LEN chars), record offset table
+// (rec_off NULL = zeros, patch later). dst needs CFG_V6_HEAD_MAX; get returns the head
+// length, 0 = malformed or `len` too short
+size_t cfg_v6_put_head(uint8_t *dst, int bank_count, const char *bank_names, const uint32_t *rec_off);
+size_t cfg_v6_get_head(int *bank_count, char *bank_names, uint32_t *rec_off, const uint8_t *src, size_t len);
+
+// bank_count + bank names without the offset table (layout record of the raw config log)
+size_t cfg_v6_put_names(uint8_t *dst, int bank_count, const char *bank_names);
+size_t cfg_v6_get_names(int *bank_count, char *bank_names, const uint8_t *src, size_t len);
+
+// one button in v6 encoding (journal records). dst needs CFG_V6_BTN_MAX bytes
+size_t cfg_v6_put_btn(uint8_t *dst, const btn_map_t *m);
+// returns bytes consumed, 0 = malformed
+size_t cfg_v6_get_btn(btn_map_t *m, const uint8_t *src, size_t len);
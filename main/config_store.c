@@ -4,6 +4,7 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include <stdio.h>  // snprintf
+#include <stddef.h> // offsetof
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -17,54 +18,269 @@
 #include "mbedtls/base64.h"
 #include "esp_heap_caps.h"
 #include "esp_spiffs.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "esp_system.h"
 
 #include <sys/stat.h>
 #include <unistd.h>
 
 #include "config_store.h"
+#include "cfg_pack.h"
+#include "cfg_log.h"
 #include "display_uart.h"
 #include "rgb_store.h"
 
 static const char *TAG = "CFG";
 
 /**
- * ✅ DRAM overflow guard:
- * - ใช้ heap allocate (PSRAM ก่อน) แทน static ใหญ่ ๆ ใน .bss
+ * ✅ DRAM overflow guard (paged banks):
+ * - resident: bank layout + record index of the base image + a few decoded banks (pages)
+ * - foot_config_t only exists briefly while migrating / importing an old format
  */
-static foot_config_t *s_cfg = NULL;
+typedef struct {
+    uint8_t bank_count;                       // 1..MAX_BANKS
+    char    bank_name[MAX_BANKS][NAME_LEN];
+} cfg_layout_t;
+
+static cfg_layout_t s_layout;   // writers under cfg_lock
+
+// one bank's names + mapping (image builder unit)
+typedef struct {
+    char      switch_name[NUM_BTNS][NAME_LEN];
+    btn_map_t map[NUM_BTNS];
+} cfg_page_t;
+
+// ---- base image + bank pages ----
+// the last full write ("base", v6 image) stays on flash, RAM keeps its record index and
+// a few decoded banks ("pages"). a page *is* the published read snapshot of its bank:
+// - working set = current bank +-1, loaded by cfg_page_task right after a bank change,
+//   so foot_task never touches flash (a jump to a far bank costs one record read)
+// - web reads / edits page in on the caller's task; edits are copy-on-write and pin the
+//   page (dirty = differs from the base) until cfg_save_task writes the next base
+// - other pages are evicted LRU past CFG_PAGE_MAX: RAM follows the working set, not MAX_BANKS
+// - base = the config log (one record per bank, cfg_log.h) when its partition exists, else
+//   CFG_FILE_PATH (one fseek + fread per page-in); without either the compact image itself
+//   stays in RAM
+#define CFG_PAGE_MAX      6   // resident pages (working set + recent web edits)
+#define CFG_PAGE_PIN_MAX  8   // edited banks waiting for a base rewrite; more -> rewrite now
 
-// forward (used by v5 unpack)
-static void set_defaults(foot_config_t *cfg);
+typedef struct {
+    int      bank_count;            // banks in the image (0 = no image: all defaults)
+    uint32_t rec_off[MAX_BANKS];    // bank record offsets in the payload
+    uint32_t body;                  // payload length without the crc
+    uint32_t size;                  // header + payload (0 = no image)
+    uint16_t epoch;
+    bool     stored;                // RAM image: also saved to NVS
+    bool     log;                   // no image: bank records live in the config log
+    uint8_t *ram;                   // whole image in RAM, NULL = CFG_FILE_PATH (or log)
+} cfg_base_t;
+
+static cfg_base_t s_base;        // swapped under s_io_mtx + cfg_lock
+static cfg_base_t s_base_next;   // image being written (under s_io_mtx)
+
+static uint8_t  s_page_dirty[MAX_BANKS];    // 1 = edited since the base (pinned)
+static uint8_t  s_page_saving[MAX_BANKS];   // being written by cfg_rewrite (pinned)
+static uint32_t s_page_used[MAX_BANKS];     // LRU stamp
+static uint32_t s_page_clock = 0;
+static int      s_page_count = 0;           // resident pages
+static TaskHandle_t s_page_task = NULL;
+
+// forward (used by cfg_unpack / cfg_request_save_delta)
+static void set_cfg_defaults(foot_config_t *cfg);
+static int cfg_page_pinned_count(void);
 
 // ✅ สถานะ NVS (กัน abort/รีบูต)
 static bool s_nvs_ok = false;
 static bool s_spiffs_ok = false;
-
-#define CFG_FILE_PATH     "/spiffs/footsw_cfg_v5.bin"
-#define CFG_FILE_PATH_TMP "/spiffs/footsw_cfg_v5.tmp"
+static bool s_log_ok = false;
+
+// ---- config log (raw partition, cfg_log.h): config + settings when the partition exists ----
+// SPIFFS (shared with the web files) / NVS stay the fallback and one-time migration source
+#define CFG_LOG_LABEL      "cfglog"
+#define CFG_LK_LAYOUT      0    // cfg_v6_put_names: bank_count + bank names
+#define CFG_LK_BRIGHTNESS  1    // u8
+#define CFG_LK_AB_LED      2    // s_ab_led_sel
+#define CFG_LK_CUR_BANK    3    // u8
+#define CFG_LK_LONG_MS     4    // s_long_ms
+#define CFG_LK_CHORD_MS    5    // u8
+#define CFG_LK_BANK0       16   // + bank: cfg_v6_put_bank record
+_Static_assert(CFG_LK_BANK0 + MAX_BANKS <= CFG_LOG_KEYS, "config log keys");
+
+// mount point (host build: a directory relative to the working dir)
+#ifndef CFG_SPIFFS_BASE
+#define CFG_SPIFFS_BASE "/spiffs"
+#endif
+
+#define CFG_FILE_PATH     CFG_SPIFFS_BASE "/footsw_cfg_v6.bin"
+#define CFG_FILE_PATH_TMP CFG_SPIFFS_BASE "/footsw_cfg_v6.tmp"
+#define CFG_JNL_PATH      CFG_SPIFFS_BASE "/footsw_cfg_v6.jnl"
+
+// v5 files: loaded once at boot, rewritten as v6, then removed
+#define CFG_V5_FILE_PATH  CFG_SPIFFS_BASE "/footsw_cfg_v5.bin"
+#define CFG_V5_JNL_PATH   CFG_SPIFFS_BASE "/footsw_cfg_v5.jnl"
 
 #define CFG_MAGIC 0x46435346u  // 'FSCF'
-#define CFG_VER   5            // v4 = no pages
+#define CFG_VER   6            // v4 = no pages, v5 = raw packed, v6 = compact (cfg_pack.h)
 
 typedef struct __attribute__((packed)) {
     uint32_t magic;
     uint16_t ver;
-    uint16_t reserved;
+    uint16_t epoch;     // v5/v6 image: bumped per full rewrite, binds the journal
     uint32_t size;
 } cfg_hdr_v4_t;
 
+// ---- config journal (per-button deltas appended next to the base file) ----
+// - set_btn_json / set_bank_json only mark what changed, cfg_save_task appends those
+//   items (absolute values -> replay is idempotent) instead of rewriting the whole file
+// - the journal belongs to the base image with the same epoch, a stale one is ignored
+// - past CFG_JNL_COMPACT_BYTES the save task rewrites the base and drops the journal
+// - layout / import / generator changes still do a full rewrite
+#define CFG_JNL_MAGIC 0x4E4A5346u  // 'FSJN'
+#define CFG_JNL_VER   2          // btn payload = cfg_v6_put_btn (v1, next to a v5 base: raw btn_map_t)
+#define CFG_JNL_VER_V5 1
+#define CFG_JNL_COMPACT_BYTES (16 * 1024)
+#define CFG_JNL_MAX_BATCH     32   // more dirty items than this -> full rewrite is cheaper
+
+typedef enum {
+    CFG_JREC_BTN   = 1,   // payload = map[bank][btn] (encoding: see CFG_JNL_VER)
+    CFG_JREC_NAMES = 2,   // payload = switch_name[bank][0..NUM_BTNS-1]
+} cfg_jrec_kind_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t magic;
+    uint16_t ver;
+    uint16_t epoch;       // == cfg_hdr_v4_t.epoch of the base file
+} cfg_jnl_hdr_t;
+
+// record = hdr + payload + u32 crc32 (hdr + payload)
+typedef struct __attribute__((packed)) {
+    uint8_t  kind;
+    uint8_t  bank;
+    uint8_t  btn;
+    uint8_t  rsv;
+    uint16_t len;
+} cfg_jrec_hdr_t;
+
+#define CFG_JREC_MAX_PAYLOAD ((sizeof(btn_map_t) > (size_t)NUM_BTNS * NAME_LEN) ? sizeof(btn_map_t) : (size_t)NUM_BTNS * NAME_LEN)
+#define CFG_JREC_MAX_SIZE    (sizeof(cfg_jrec_hdr_t) + CFG_JREC_MAX_PAYLOAD + sizeof(uint32_t))
+
 // ---- config persistence (async + coalesce) ----
 static SemaphoreHandle_t s_cfg_mtx = NULL;
+static SemaphoreHandle_t s_io_mtx = NULL;   // io_lock()
 static TaskHandle_t s_cfg_save_task = NULL;
 static volatile uint32_t s_cfg_seq = 0;
-static volatile bool s_cfg_dirty = false;
+static volatile bool s_cfg_dirty = false;   // full rewrite needed
+
+// journal state (dirty maps: under cfg_lock)
+static uint8_t s_jnl_btn_dirty[MAX_BANKS];   // bit k = map[b][k] changed
+static uint8_t s_jnl_name_dirty[MAX_BANKS];  // 1 = switch_name[b][*] changed
+static volatile bool s_jnl_pending = false;
+static bool s_jnl_ok = false;                // base file on SPIFFS with known epoch
+static uint16_t s_cfg_epoch = 0;
+static size_t s_jnl_size = 0;                // bytes in CFG_JNL_PATH (0 = none)
+
+// exp/fs lazy save (auto calibration): at most one NVS write per EXPFS_LAZY_SAVE_MS
+#define EXPFS_LAZY_SAVE_MS 30000
+
+// write-behind settings (see config_store.h): bit per cfg_setting_t + flush deadline,
+// written by cfg_save_task. s_st_mux only guards the bitmap, flash I/O runs under s_st_mtx
+#define CFG_ST_RETRY_MS 5000
+static uint32_t            s_st_dirty = 0;
+static TickType_t          s_st_due[CFG_ST_COUNT];
+static portMUX_TYPE        s_st_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t   s_st_mtx = NULL;
+
+static volatile uint32_t s_cfg_gen = 0;   // bumped on every live config change
+static volatile uint32_t s_expfs_gen = 0; // ver of the published exp/fs snapshot (expfs_publish)
 
 static void cfg_lock(void)   { if (s_cfg_mtx) xSemaphoreTake(s_cfg_mtx, portMAX_DELAY); }
 static void cfg_unlock(void) { if (s_cfg_mtx) xSemaphoreGive(s_cfg_mtx); }
 
+// base image writes + journal appends (taken before cfg_lock, never by readers)
+static void io_lock(void)   { if (s_io_mtx) xSemaphoreTake(s_io_mtx, portMAX_DELAY); }
+static void io_unlock(void) { if (s_io_mtx) xSemaphoreGive(s_io_mtx); }
+
+// mark live config changed (call under cfg_lock, before cfg_unlock)
+static inline void cfg_touch(void) { s_cfg_gen++; }
+
+// ---- read snapshots (RCU style) ----
+// - a bank page *is* its published copy (copy-on-write edits under cfg_lock);
+//   s_expfs stays the exp/fs master copy (s_expfs_mtx)
+// - readers see only published copies: one per bank + one for exp/fs, swapped atomically
+// - one global reader count: a replaced copy goes on the retired list and is freed the
+//   first time the count is seen at 0 *after* the swap (next publish or cfg_save_task poll).
+//   read sections are a memcpy long, so that is microseconds away; nobody ever waits for it
+#define CFG_SNAP_POLL_MS 20   // cfg_save_task retry while copies wait for readers
+
+typedef struct cfg_snap_node {
+    struct cfg_snap_node *next;   // retired list
+    uint32_t rsv;
+} cfg_snap_node_t;
+
+static cfg_bank_snap_t  *s_snap_bank[MAX_BANKS];
+static uint32_t          s_snap_bank_ver[MAX_BANKS];
+static cfg_expfs_snap_t *s_snap_expfs = NULL;
+static uint32_t          s_snap_seq = 0;        // bank ver source (under cfg_lock)
+static uint32_t          s_snap_readers = 0;    // open read sections
+static cfg_snap_node_t  *s_snap_retired = NULL;
+static portMUX_TYPE      s_snap_mux = portMUX_INITIALIZER_UNLOCKED;   // retired list only
+
+// exp/fs writers (web, calibration, expfs_task auto-range); never held across flash I/O
+static SemaphoreHandle_t s_expfs_mtx = NULL;
+static void expfs_lock(void)   { if (s_expfs_mtx) xSemaphoreTake(s_expfs_mtx, portMAX_DELAY); }
+static void expfs_unlock(void) { if (s_expfs_mtx) xSemaphoreGive(s_expfs_mtx); }
+
+// bank pages are read on every foot_task event: internal RAM first, PSRAM as a fallback
+static void *cfg_snap_alloc(size_t size)
+{
+    size_t need = sizeof(cfg_snap_node_t) + size;
+    cfg_snap_node_t *n = (cfg_snap_node_t *)heap_caps_malloc(need, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!n) n = (cfg_snap_node_t *)heap_caps_malloc(need, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!n) return NULL;
+    n->next = NULL;
+    return n + 1;
+}
+
+// free retired copies if no reader section is open right now
+static void cfg_snap_reclaim(void)
+{
+    cfg_snap_node_t *dead = NULL;
+
+    portENTER_CRITICAL(&s_snap_mux);
+    if (s_snap_retired && __atomic_load_n(&s_snap_readers, __ATOMIC_SEQ_CST) == 0) {
+        dead = s_snap_retired;
+        s_snap_retired = NULL;
+    }
+    portEXIT_CRITICAL(&s_snap_mux);
+
+    while (dead) {
+        cfg_snap_node_t *next = dead->next;
+        heap_caps_free(dead);
+        dead = next;
+    }
+}
+
+// call after the old pointer was swapped out
+static void cfg_snap_retire(void *p)
+{
+    if (!p) return;
+    cfg_snap_node_t *n = (cfg_snap_node_t *)p - 1;
+
+    portENTER_CRITICAL(&s_snap_mux);
+    n->next = s_snap_retired;
+    s_snap_retired = n;
+    portEXIT_CRITICAL(&s_snap_mux);
+}
+
+static inline bool cfg_snap_pending(void)
+{
+    return __atomic_load_n(&s_snap_retired, __ATOMIC_RELAXED) != NULL;
+}
+
 static void cfg_request_save(void)
 {
-    if (!s_nvs_ok && !s_spiffs_ok) return;
+    if (!s_nvs_ok && !s_spiffs_ok && !s_log_ok) return;
     if (!s_cfg_save_task) return;
 
     s_cfg_dirty = true;
@@ -72,16 +288,76 @@ static void cfg_request_save(void)
     xTaskNotifyGive(s_cfg_save_task);
 }
 
+// mark one button / one bank's switch names for the journal (call under cfg_lock)
+static inline void cfg_mark_btn(int bank, int btn) { s_jnl_btn_dirty[bank] |= (uint8_t)(1u << btn); }
+static inline void cfg_mark_names(int bank)        { s_jnl_name_dirty[bank] = 1; }
+
+// save only what was marked (falls back to a full rewrite when there is no journal)
+static void cfg_request_save_delta(void)
+{
+    if (!s_nvs_ok && !s_spiffs_ok && !s_log_ok) return;
+    if (!s_cfg_save_task) return;
+
+    s_jnl_pending = true;
+    if (cfg_page_pinned_count() > CFG_PAGE_PIN_MAX) s_cfg_dirty = true;   // too many pinned pages
+    s_cfg_seq++;
+    xTaskNotifyGive(s_cfg_save_task);
+}
+
+// setting changed: on flash within delay_ms (an earlier deadline already set stays).
+// critical section + task notify only -> callable from foot_task
+static void st_mark_in(cfg_setting_t item, uint32_t delay_ms)
+{
+    if (!s_nvs_ok && !s_log_ok) return;
+
+    TickType_t due = xTaskGetTickCount() + pdMS_TO_TICKS(delay_ms);
+    uint32_t bit = 1u << item;
+
+    portENTER_CRITICAL(&s_st_mux);
+    bool kick = !(s_st_dirty & bit) || (int32_t)(due - s_st_due[item]) < 0;
+    if (kick) s_st_due[item] = due;
+    s_st_dirty |= bit;
+    portEXIT_CRITICAL(&s_st_mux);
+
+    if (kick && s_cfg_save_task) xTaskNotifyGive(s_cfg_save_task);
+}
+
+static inline void st_mark(cfg_setting_t item) { st_mark_in(item, CFG_ST_FLUSH_MS); }
+
+// ticks until the first dirty setting is due (portMAX_DELAY = none)
+static TickType_t st_next_due(void)
+{
+    TickType_t now = xTaskGetTickCount();
+    TickType_t wait = portMAX_DELAY;
+
+    portENTER_CRITICAL(&s_st_mux);
+    for (int i = 0; i < CFG_ST_COUNT; i++) {
+        if (!(s_st_dirty & (1u << i))) continue;
+        int32_t d = (int32_t)(s_st_due[i] - now);
+        TickType_t w = (d > 0) ? (TickType_t)d : 0;
+        if (w < wait) wait = w;
+    }
+    portEXIT_CRITICAL(&s_st_mux);
+    return wait;
+}
+
 // forward decl
 static bool cfg_mount_spiffs_noformat(void);
-static esp_err_t cfg_save_v5_packed_file(const foot_config_t *in);
-static esp_err_t cfg_load_v5_packed_file(foot_config_t *out);
-static esp_err_t nvs_save_v5_packed(const foot_config_t *in);
-
-// v5 pack/unpack helpers (defined later)
-static size_t cfg_v5_packed_size(int bank_count);
-static esp_err_t cfg_v5_pack(const foot_config_t *in, uint8_t **out_buf, size_t *out_len);
-static esp_err_t cfg_v5_unpack(foot_config_t *out, const uint8_t *buf, size_t len);
+static esp_err_t nvs_save_expfs(void);
+static esp_err_t st_flush(bool all);
+static void expfs_publish(void);
+static esp_err_t cfg_load_packed_file(foot_config_t *out, const char *path);
+static esp_err_t cfg_jnl_flush(void);
+static esp_err_t cfg_rewrite(void);
+
+// bank pages (defined with the base image code)
+static void sanitize_page(char (*names)[NAME_LEN], btn_map_t *map);
+static cfg_bank_snap_t *cfg_page_edit(int bank);
+static void cfg_page_commit(cfg_bank_snap_t *n, bool dirty);
+
+// packed payload helpers (defined later, encodings in cfg_pack.c)
+static size_t cfg_packed_max(uint16_t ver);
+static esp_err_t cfg_unpack(foot_config_t *out, uint16_t ver, const uint8_t *buf, size_t len);
 
 static void cfg_save_task(void *arg)
 {
@@ -90,43 +366,44 @@ static void cfg_save_task(void *arg)
     uint32_t last_seq = 0;
 
     while (1) {
-        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
-
-        // debounce/coalesce: รอจน "นิ่ง" สักพัก
-        vTaskDelay(pdMS_TO_TICKS(250));
-        while (ulTaskNotifyTake(pdTRUE, 0) > 0) {
-            vTaskDelay(pdMS_TO_TICKS(120));
+        // dirty settings -> wake up when the first one is due
+        TickType_t wait = st_next_due();
+        // replaced snapshots still waiting for a moment without readers
+        if (cfg_snap_pending() && wait > pdMS_TO_TICKS(CFG_SNAP_POLL_MS)) wait = pdMS_TO_TICKS(CFG_SNAP_POLL_MS);
+
+        if (ulTaskNotifyTake(pdTRUE, wait) > 0 && (s_cfg_dirty || s_jnl_pending)) {
+            // debounce/coalesce: รอจน "นิ่ง" สักพัก (a due setting cuts it short)
+            vTaskDelay(pdMS_TO_TICKS(250));
+            while (ulTaskNotifyTake(pdTRUE, 0) > 0 && st_next_due() > 0) {
+                vTaskDelay(pdMS_TO_TICKS(120));
+            }
         }
 
-        if (!s_cfg_dirty) continue;
+        cfg_snap_reclaim();
+        (void)st_flush(false);
 
-        // snapshot (ห้ามวาง foot_config_t บน stack เพราะมันใหญ่มาก)
-        foot_config_t *snap = (foot_config_t *)heap_caps_malloc(sizeof(*snap), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (!snap) snap = (foot_config_t *)heap_caps_malloc(sizeof(*snap), MALLOC_CAP_8BIT);
-        if (!snap) {
-            ESP_LOGE(TAG, "cfg snapshot alloc failed");
-            continue;
-        }
+        if (!s_cfg_dirty && !s_jnl_pending) continue;
 
-        cfg_lock();
-        memcpy(snap, s_cfg, sizeof(*snap));
-        last_seq = s_cfg_seq;
-        cfg_unlock();
+        // config log: a rewrite only appends the edited banks, no journal in front of it
+        if (!s_cfg_dirty && !s_base.log) {
+            io_lock();
+            esp_err_t je = cfg_jnl_flush();
+            io_unlock();
+            if (je == ESP_OK && s_jnl_size < CFG_JNL_COMPACT_BYTES) continue;
 
-        // Prefer SPIFFS (supports MAX_BANKS without NVS double-space problem)
-        esp_err_t e = ESP_FAIL;
-        if (cfg_mount_spiffs_noformat()) {
-            e = cfg_save_v5_packed_file(snap);
-        }
-        // fallback to NVS (may fail when config is very large)
-        if (e != ESP_OK) {
-            e = nvs_save_v5_packed(snap);
+            // no journal / too many items / append failed / compaction due -> full rewrite
+            if (je == ESP_OK) ESP_LOGI(TAG, "cfg journal %u bytes -> compact", (unsigned)s_jnl_size);
+            s_cfg_dirty = true;
         }
-        heap_caps_free(snap);
 
+        last_seq = s_cfg_seq;
+
+        // streamed from the resident pages + the old base (no full-size snapshot)
+        int64_t t0 = esp_timer_get_time();
+        esp_err_t e = cfg_rewrite();
         if (e == ESP_OK) {
-            s_cfg_dirty = false;
-            ESP_LOGI(TAG, "cfg saved (v5 packed) seq=%u", (unsigned)last_seq);
+            ESP_LOGI(TAG, "cfg saved (%s) seq=%u in %u us", s_base.log ? "log" : "v6 packed",
+                     (unsigned)last_seq, (unsigned)(esp_timer_get_time() - t0));
         } else {
             ESP_LOGE(TAG, "cfg save failed: %s", esp_err_to_name(e));
             // keep dirty; next notify will retry
@@ -140,7 +417,7 @@ static bool cfg_mount_spiffs_noformat(void)
     if (s_spiffs_ok) return true;
 
     esp_vfs_spiffs_conf_t conf = {
-        .base_path = "/spiffs",
+        .base_path = CFG_SPIFFS_BASE,
         .partition_label = NULL,
         .max_files = 8,
         .format_if_mount_failed = false, // IMPORTANT: do not wipe web files
@@ -162,89 +439,246 @@ static bool cfg_mount_spiffs_noformat(void)
     return true;
 }
 
-// ---------- SPIFFS config save/load (v5 packed) ----------
-static esp_err_t cfg_save_v5_packed_file(const foot_config_t *in)
+// ---------- SPIFFS config load (v5 read for migration) ----------
+// path = CFG_FILE_PATH (v6) or CFG_V5_FILE_PATH (v5), the header says which
+static esp_err_t cfg_load_packed_file(foot_config_t *out, const char *path)
 {
-    if (!in) return ESP_ERR_INVALID_ARG;
+    if (!out || !path) return ESP_ERR_INVALID_ARG;
     if (!cfg_mount_spiffs_noformat()) return ESP_ERR_INVALID_STATE;
 
-    uint8_t *buf = NULL;
-    size_t len = 0;
-    esp_err_t e = cfg_v5_pack(in, &buf, &len);
-    if (e != ESP_OK) return e;
+    FILE *f = fopen(path, "rb");
+    if (!f) return ESP_ERR_NOT_FOUND;
 
     cfg_hdr_v4_t hdr;
-    memset(&hdr, 0, sizeof(hdr));
-    hdr.magic = CFG_MAGIC;
-    hdr.ver   = CFG_VER;      // 5
-    hdr.size  = (uint32_t)len;
+    size_t r1 = fread(&hdr, 1, sizeof(hdr), f);
+    if (r1 != sizeof(hdr) || hdr.magic != CFG_MAGIC || (hdr.ver != CFG_VER && hdr.ver != 5)) {
+        fclose(f);
+        return ESP_FAIL;
+    }
+    if (hdr.size < 1 || hdr.size > (uint32_t)cfg_packed_max(hdr.ver)) {
+        fclose(f);
+        return ESP_FAIL;
+    }
+
+    size_t dlen = (size_t)hdr.size;
+    uint8_t *buf = (uint8_t *)heap_caps_malloc(dlen, MALLOC_CAP_8BIT);
+    if (!buf) {
+        fclose(f);
+        return ESP_ERR_NO_MEM;
+    }
+    size_t r2 = fread(buf, 1, dlen, f);
+    fclose(f);
+
+    if (r2 != dlen) {
+        heap_caps_free(buf);
+        return ESP_FAIL;
+    }
+
+    esp_err_t e = cfg_unpack(out, hdr.ver, buf, dlen);
+    heap_caps_free(buf);
+
+    if (e == ESP_OK) {
+        s_cfg_epoch = hdr.epoch;
+        s_jnl_ok = true;
+    }
+    return e;
+}
+
+// ---------- SPIFFS config journal ----------
+static size_t cfg_jrec_put(uint8_t *dst, uint8_t kind, int bank, int btn, const void *payload, size_t len)
+{
+    cfg_jrec_hdr_t rh = {
+        .kind = kind,
+        .bank = (uint8_t)bank,
+        .btn  = (uint8_t)btn,
+        .rsv  = 0,
+        .len  = (uint16_t)len,
+    };
+
+    memcpy(dst, &rh, sizeof(rh));
+    memcpy(dst + sizeof(rh), payload, len);
+
+    uint32_t crc = esp_rom_crc32_le(0, dst, (uint32_t)(sizeof(rh) + len));
+    memcpy(dst + sizeof(rh) + len, &crc, sizeof(crc));
+    return sizeof(rh) + len + sizeof(crc);
+}
+
+// append the marked items (save task only)
+static esp_err_t cfg_jnl_flush(void)
+{
+    if (!s_jnl_ok || !s_spiffs_ok) return ESP_ERR_INVALID_STATE;
+
+    uint8_t enc[CFG_V6_BTN_MAX];
+    uint8_t *buf = (uint8_t *)heap_caps_malloc(CFG_JNL_MAX_BATCH * CFG_JREC_MAX_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) buf = (uint8_t *)heap_caps_malloc(CFG_JNL_MAX_BATCH * CFG_JREC_MAX_SIZE, MALLOC_CAP_8BIT);
+    if (!buf) return ESP_ERR_NO_MEM;
+
+    size_t len = 0;
+    int n = 0;
+
+    cfg_lock();
+
+    for (int b = 0; b < MAX_BANKS; b++) {
+        if (s_jnl_name_dirty[b]) n++;
+        for (int k = 0; k < NUM_BTNS; k++) {
+            if (s_jnl_btn_dirty[b] & (1u << k)) n++;
+        }
+    }
+    if (n > CFG_JNL_MAX_BATCH) {
+        cfg_unlock();
+        heap_caps_free(buf);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    for (int b = 0; b < MAX_BANKS; b++) {
+        // marked banks are pinned pages (dirty until the next base)
+        const cfg_bank_snap_t *p = s_snap_bank[b];
+        if (!p) continue;
+        if (s_jnl_name_dirty[b]) {
+            len += cfg_jrec_put(buf + len, CFG_JREC_NAMES, b, 0, p->switch_name, (size_t)NUM_BTNS * NAME_LEN);
+        }
+        for (int k = 0; k < NUM_BTNS; k++) {
+            if (s_jnl_btn_dirty[b] & (1u << k)) {
+                size_t n_enc = cfg_v6_put_btn(enc, &p->map[k]);
+                len += cfg_jrec_put(buf + len, CFG_JREC_BTN, b, k, enc, n_enc);
+            }
+        }
+    }
+    memset(s_jnl_btn_dirty, 0, sizeof(s_jnl_btn_dirty));
+    memset(s_jnl_name_dirty, 0, sizeof(s_jnl_name_dirty));
+    s_jnl_pending = false;
+    uint32_t seq = s_cfg_seq;
+
+    cfg_unlock();
+
+    if (len == 0) {
+        heap_caps_free(buf);
+        return ESP_OK;
+    }
 
-    FILE *f = fopen(CFG_FILE_PATH_TMP, "wb");
+    FILE *f = fopen(CFG_JNL_PATH, (s_jnl_size == 0) ? "wb" : "ab");
     if (!f) {
         heap_caps_free(buf);
         return ESP_FAIL;
     }
 
-    size_t w1 = fwrite(&hdr, 1, sizeof(hdr), f);
-    size_t w2 = fwrite(buf, 1, len, f);
+    bool ok = true;
+    size_t wrote = 0;
+    if (s_jnl_size == 0) {
+        cfg_jnl_hdr_t jh = { .magic = CFG_JNL_MAGIC, .ver = CFG_JNL_VER, .epoch = s_cfg_epoch };
+        ok = (fwrite(&jh, 1, sizeof(jh), f) == sizeof(jh));
+        wrote += sizeof(jh);
+    }
+    if (ok) ok = (fwrite(buf, 1, len, f) == len);
+    wrote += len;
     fflush(f);
     fclose(f);
-
     heap_caps_free(buf);
 
-    if (w1 != sizeof(hdr) || w2 != len) {
-        unlink(CFG_FILE_PATH_TMP);
+    if (!ok) {
+        // torn tail: replay stops there, so never append behind it
+        s_jnl_ok = false;
         return ESP_FAIL;
     }
 
-    // atomic replace
-    unlink(CFG_FILE_PATH);
-    if (rename(CFG_FILE_PATH_TMP, CFG_FILE_PATH) != 0) {
-        unlink(CFG_FILE_PATH_TMP);
-        return ESP_FAIL;
-    }
+    s_jnl_size += wrote;
+    ESP_LOGI(TAG, "cfg journal +%u bytes (%d items) seq=%u", (unsigned)wrote, n, (unsigned)seq);
     return ESP_OK;
 }
 
-static esp_err_t cfg_load_v5_packed_file(foot_config_t *out)
+// one journal record onto the legacy struct (v5 migration) or onto the bank's page (pins it,
+// call under cfg_lock). unknown / malformed records are skipped (crc was fine)
+static void cfg_jnl_apply(foot_config_t *legacy, const cfg_jrec_hdr_t *rh, const uint8_t *pl, uint16_t ver)
 {
-    if (!out) return ESP_ERR_INVALID_ARG;
-    if (!cfg_mount_spiffs_noformat()) return ESP_ERR_INVALID_STATE;
+    btn_map_t m;
+    bool is_btn = false;
 
-    FILE *f = fopen(CFG_FILE_PATH, "rb");
-    if (!f) return ESP_ERR_NOT_FOUND;
+    if (rh->kind == CFG_JREC_BTN) {
+        if (ver == CFG_JNL_VER_V5) {
+            if (rh->len != sizeof(btn_map_t)) return;
+            memcpy(&m, pl, sizeof(m));
+        } else if (cfg_v6_get_btn(&m, pl, rh->len) != rh->len) {
+            return;
+        }
+        is_btn = true;
+    } else if (rh->kind != CFG_JREC_NAMES || rh->len != (size_t)NUM_BTNS * NAME_LEN) {
+        return;
+    }
 
-    cfg_hdr_v4_t hdr;
-    size_t r1 = fread(&hdr, 1, sizeof(hdr), f);
-    if (r1 != sizeof(hdr) || hdr.magic != CFG_MAGIC || hdr.ver != CFG_VER) {
-        fclose(f);
-        return ESP_FAIL;
+    if (legacy) {
+        if (is_btn) legacy->map[rh->bank][rh->btn] = m;
+        else memcpy(legacy->switch_name[rh->bank], pl, (size_t)NUM_BTNS * NAME_LEN);
+        return;
     }
-    if (hdr.size < 1 || hdr.size > (uint32_t)cfg_v5_packed_size(MAX_BANKS)) {
+
+    cfg_bank_snap_t *n = cfg_page_edit(rh->bank);
+    if (!n) return;
+    if (is_btn) n->map[rh->btn] = m;
+    else memcpy(n->switch_name, pl, (size_t)NUM_BTNS * NAME_LEN);
+    sanitize_page(n->switch_name, n->map);
+    cfg_page_commit(n, true);
+}
+
+// apply the journal on top of a freshly loaded base image
+// - legacy NULL: CFG_JNL_PATH + CFG_JNL_VER onto the pages (under cfg_lock)
+// - legacy: the v5 pair onto a temp struct while migrating
+// returns false when the journal has a bad tail (caller rewrites the base)
+static bool cfg_jnl_replay(foot_config_t *legacy, const char *path, uint16_t ver)
+{
+    s_jnl_size = 0;
+
+    FILE *f = fopen(path, "rb");
+    if (!f) return true;
+
+    cfg_jnl_hdr_t jh;
+    if (fread(&jh, 1, sizeof(jh), f) != sizeof(jh) ||
+        jh.magic != CFG_JNL_MAGIC || jh.ver != ver || jh.epoch != s_cfg_epoch) {
         fclose(f);
-        return ESP_FAIL;
+        ESP_LOGW(TAG, "cfg journal stale/invalid, dropped");
+        unlink(path);
+        return true;
     }
 
-    size_t dlen = (size_t)hdr.size;
-    uint8_t *buf = (uint8_t *)heap_caps_malloc(dlen, MALLOC_CAP_8BIT);
-    if (!buf) {
+    uint8_t *rec = (uint8_t *)heap_caps_malloc(CFG_JREC_MAX_SIZE, MALLOC_CAP_8BIT);
+    if (!rec) {
         fclose(f);
-        return ESP_ERR_NO_MEM;
+        return false;
     }
-    size_t r2 = fread(buf, 1, dlen, f);
-    fclose(f);
 
-    if (r2 != dlen) {
-        heap_caps_free(buf);
-        return ESP_FAIL;
-    }
+    size_t pos = sizeof(jh);
+    int n = 0;
+    bool clean = true;
 
-    esp_err_t e = cfg_v5_unpack(out, buf, dlen);
-    heap_caps_free(buf);
-    return e;
-}
+    while (1) {
+        cfg_jrec_hdr_t rh;
+        size_t r = fread(&rh, 1, sizeof(rh), f);
+        if (r == 0) break;   // end
+        if (r != sizeof(rh) || rh.len > CFG_JREC_MAX_PAYLOAD) { clean = false; break; }
+
+        memcpy(rec, &rh, sizeof(rh));
+        uint32_t crc = 0;
+        if (fread(rec + sizeof(rh), 1, rh.len, f) != rh.len ||
+            fread(&crc, 1, sizeof(crc), f) != sizeof(crc) ||
+            crc != esp_rom_crc32_le(0, rec, (uint32_t)(sizeof(rh) + rh.len))) {
+            clean = false;
+            break;
+        }
+
+        const uint8_t *pl = rec + sizeof(rh);
+        int bc = legacy ? (int)legacy->bank_count : config_store_bank_count();
+        if (rh.bank < bc && rh.btn < NUM_BTNS) cfg_jnl_apply(legacy, &rh, pl, ver);
+
+        pos += sizeof(rh) + rh.len + sizeof(crc);
+        n++;
+    }
 
+    fclose(f);
+    heap_caps_free(rec);
 
+    s_jnl_size = pos;
+    ESP_LOGI(TAG, "cfg journal replayed: %d items, %u bytes%s", n, (unsigned)pos, clean ? "" : " (bad tail)");
+    return clean;
+}
 
 // ---- led brightness stored separately ----
 static uint8_t s_led_brightness = 100; // 0..100
@@ -253,12 +687,21 @@ static uint8_t s_led_brightness = 100; // 0..100
 // 0=A, 1=B
 static uint8_t s_ab_led_sel[MAX_BANKS][NUM_BTNS];
 
+// ---- long-press threshold stored separately (ms) ----
+static uint16_t s_long_ms[MAX_BANKS][NUM_BTNS];
+
+// ---- chord coincidence window stored separately (ms) ----
+static uint8_t s_chord_ms = CHORD_MS_DEFAULT;
+
 // ---- current bank persisted ----
 static uint8_t s_cur_bank = 0;
 
 // ---- exp/fs stored separately (blob) ----
 static expfs_port_cfg_t s_expfs[EXPFS_PORT_COUNT];
 
+// size of the first (v1) exp/fs port layout, before appended fields
+#define EXPFS_CFG_V1_SIZE offsetof(expfs_port_cfg_t, long_ms)
+
 // ---------- legacy structures (v3 had pages) ----------
 #define LEGACY_V3_MAX_BANKS 20
 #define LEGACY_V3_MAX_PAGES 4
@@ -359,6 +802,47 @@ static esp_err_t nvs_save_led_brightness(uint8_t v)
     return e;
 }
 
+// ---- chord window NVS helpers ----
+static uint8_t chord_ms_sanitize(int v)
+{
+    return (uint8_t)clampi(v, CHORD_MS_MIN, CHORD_MS_MAX);
+}
+
+static esp_err_t nvs_load_chord_ms(uint8_t *out)
+{
+    if (!out) return ESP_ERR_INVALID_ARG;
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+
+    nvs_handle_t h;
+    esp_err_t e = nvs_open("footsw", NVS_READONLY, &h);
+    if (e != ESP_OK) return e;
+
+    uint8_t v = 0;
+    e = nvs_get_u8(h, "chord_ms", &v);
+    nvs_close(h);
+
+    if (e != ESP_OK) return e;
+
+    *out = chord_ms_sanitize(v);
+    return ESP_OK;
+}
+
+static esp_err_t nvs_save_chord_ms(uint8_t v)
+{
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+
+    nvs_handle_t h;
+    esp_err_t e = nvs_open("footsw", NVS_READWRITE, &h);
+    if (e != ESP_OK) return e;
+
+    e = nvs_set_u8(h, "chord_ms", chord_ms_sanitize(v));
+    if (e == ESP_OK) e = nvs_commit(h);
+    nvs_close(h);
+
+    if (e != ESP_OK) ESP_LOGE(TAG, "nvs_save_chord_ms failed: %s", esp_err_to_name(e));
+    return e;
+}
+
 // ---- current bank NVS helpers ----
 static esp_err_t nvs_load_cur_bank(uint8_t *out)
 {
@@ -460,7 +944,7 @@ static esp_err_t nvs_load_ab_led_sel(void)
     return ESP_ERR_INVALID_SIZE;
 }
 
-static esp_err_t nvs_save_ab_led_sel(void)
+static esp_err_t nvs_save_ab_led_sel(const uint8_t *sel)
 {
     if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
 
@@ -468,7 +952,7 @@ static esp_err_t nvs_save_ab_led_sel(void)
     esp_err_t e = nvs_open("footsw", NVS_READWRITE, &h);
     if (e != ESP_OK) return e;
 
-    e = nvs_set_blob(h, "ab_led", s_ab_led_sel, sizeof(s_ab_led_sel));
+    e = nvs_set_blob(h, "ab_led", sel, sizeof(s_ab_led_sel));
     if (e == ESP_OK) e = nvs_commit(h);
     nvs_close(h);
 
@@ -476,217 +960,1330 @@ static esp_err_t nvs_save_ab_led_sel(void)
     return e;
 }
 
-// -------------------- exp/fs helpers --------------------
-static void expfs_set_defaults_one(expfs_port_cfg_t *p)
+// ---- settings kept in the config log (NVS: fallback, first boot copies the old value over) ----
+static bool st_log_get(uint8_t key, void *dst, size_t len)
 {
-    if (!p) return;
-    memset(p, 0, sizeof(*p));
-
-    p->kind = EXPFS_KIND_SINGLE_SW;
-
-    // exp default = CC ch1 cc0 val1=0 val2=127
-    p->exp_action.type = ACT_CC;
-    p->exp_action.ch = 1;
-    p->exp_action.a = 0;     // cc#
-    p->exp_action.b = 0;     // val1
-    p->exp_action.c = 100;   // val2
-
-    // default calibration (safe)
-    p->cal_min = 0;
-    p->cal_max = 4095;
-
-    // switch defaults
-    p->tip.press_mode = BTN_SHORT;
-    p->tip.cc_behavior = CC_NORMAL;
-    for (int i = 0; i < MAX_ACTIONS; i++) {
-        set_default_action(&p->tip.short_actions[i]);
-        set_default_action(&p->tip.long_actions[i]);
-    }
+    size_t n = 0;
+    return s_log_ok && cfg_log_get(key, dst, len, &n) == ESP_OK && n == len;
+}
 
-    p->ring.press_mode = BTN_SHORT;
-    p->ring.cc_behavior = CC_NORMAL;
-    for (int i = 0; i < MAX_ACTIONS; i++) {
-        set_default_action(&p->ring.short_actions[i]);
-        set_default_action(&p->ring.long_actions[i]);
+static esp_err_t st_load_led_brightness(uint8_t *out)
+{
+    uint8_t v = 0;
+    if (st_log_get(CFG_LK_BRIGHTNESS, &v, 1)) {
+        *out = (v > 100) ? 100 : v;
+        return ESP_OK;
     }
+    esp_err_t e = nvs_load_led_brightness(out);
+    if (e == ESP_OK && s_log_ok) (void)cfg_log_put(CFG_LK_BRIGHTNESS, out, 1);
+    return e;
 }
 
-static void expfs_defaults(void)
+// st_save_*: write-behind save functions (cfg_save_task / shutdown, under s_st_mtx),
+// they write the current RAM value
+static esp_err_t st_save_led_brightness(void)
 {
-    for (int i = 0; i < EXPFS_PORT_COUNT; i++) expfs_set_defaults_one(&s_expfs[i]);
+    uint8_t v = s_led_brightness;
+    if (v > 100) v = 100;
+    return s_log_ok ? cfg_log_put(CFG_LK_BRIGHTNESS, &v, 1) : nvs_save_led_brightness(v);
 }
 
-static void expfs_sanitize_btn(expfs_btncfg_t *m)
+static esp_err_t st_load_cur_bank(uint8_t *out)
+{
+    if (st_log_get(CFG_LK_CUR_BANK, out, 1)) return ESP_OK;
+    esp_err_t e = nvs_load_cur_bank(out);
+    if (e == ESP_OK && s_log_ok) (void)cfg_log_put(CFG_LK_CUR_BANK, out, 1);
+    return e;
+}
+
+static esp_err_t st_save_cur_bank(void)
+{
+    uint8_t bank = s_cur_bank;
+    return s_log_ok ? cfg_log_put(CFG_LK_CUR_BANK, &bank, 1) : nvs_save_cur_bank(bank);
+}
+
+static esp_err_t st_load_ab_led_sel(void)
+{
+    if (st_log_get(CFG_LK_AB_LED, s_ab_led_sel, sizeof(s_ab_led_sel))) {
+        ab_led_sanitize();
+        return ESP_OK;
+    }
+    esp_err_t e = nvs_load_ab_led_sel();
+    if (e == ESP_OK && s_log_ok) (void)cfg_log_put(CFG_LK_AB_LED, s_ab_led_sel, sizeof(s_ab_led_sel));
+    return e;
+}
+
+// the table changes under cfg_lock while this runs: write a copy (record crc = data)
+static esp_err_t st_save_ab_led_sel(void)
+{
+    uint8_t *copy = (uint8_t *)malloc(sizeof(s_ab_led_sel));
+    if (!copy) return ESP_ERR_NO_MEM;
+    cfg_lock();
+    memcpy(copy, s_ab_led_sel, sizeof(s_ab_led_sel));
+    cfg_unlock();
+
+    esp_err_t e = s_log_ok ? cfg_log_put(CFG_LK_AB_LED, copy, sizeof(s_ab_led_sel)) : nvs_save_ab_led_sel(copy);
+    free(copy);
+    return e;
+}
+
+// ---- long-press threshold NVS helpers (blob) ----
+static void long_ms_defaults(void)
+{
+    for (int b = 0; b < MAX_BANKS; b++) {
+        for (int k = 0; k < NUM_BTNS; k++) s_long_ms[b][k] = LONG_MS_DEFAULT;
+    }
+}
+
+static void long_ms_sanitize(void)
+{
+    for (int b = 0; b < MAX_BANKS; b++) {
+        for (int k = 0; k < NUM_BTNS; k++) {
+            s_long_ms[b][k] = (uint16_t)clampi((int)s_long_ms[b][k], LONG_MS_MIN, LONG_MS_MAX);
+        }
+    }
+}
+
+static esp_err_t nvs_load_long_ms(void)
+{
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+
+    nvs_handle_t h;
+    esp_err_t e = nvs_open("footsw", NVS_READONLY, &h);
+    if (e != ESP_OK) return e;
+
+    size_t len = 0;
+    e = nvs_get_blob(h, "long_ms", NULL, &len);
+    if (e != ESP_OK) { nvs_close(h); return e; }
+    if (len != sizeof(s_long_ms)) { nvs_close(h); return ESP_ERR_INVALID_SIZE; }
+
+    e = nvs_get_blob(h, "long_ms", s_long_ms, &len);
+    nvs_close(h);
+
+    if (e == ESP_OK) long_ms_sanitize();
+    return e;
+}
+
+static esp_err_t nvs_save_long_ms(const uint16_t *ms)
+{
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+
+    nvs_handle_t h;
+    esp_err_t e = nvs_open("footsw", NVS_READWRITE, &h);
+    if (e != ESP_OK) return e;
+
+    e = nvs_set_blob(h, "long_ms", ms, sizeof(s_long_ms));
+    if (e == ESP_OK) e = nvs_commit(h);
+    nvs_close(h);
+
+    if (e != ESP_OK) ESP_LOGE(TAG, "nvs_save_long_ms failed: %s", esp_err_to_name(e));
+    return e;
+}
+
+static esp_err_t st_load_long_ms(void)
+{
+    if (st_log_get(CFG_LK_LONG_MS, s_long_ms, sizeof(s_long_ms))) {
+        long_ms_sanitize();
+        return ESP_OK;
+    }
+    esp_err_t e = nvs_load_long_ms();
+    if (e == ESP_OK && s_log_ok) (void)cfg_log_put(CFG_LK_LONG_MS, s_long_ms, sizeof(s_long_ms));
+    return e;
+}
+
+// the table changes under cfg_lock while this runs: write a copy (record crc = data)
+static esp_err_t st_save_long_ms(void)
+{
+    uint16_t *copy = (uint16_t *)malloc(sizeof(s_long_ms));
+    if (!copy) return ESP_ERR_NO_MEM;
+    cfg_lock();
+    memcpy(copy, s_long_ms, sizeof(s_long_ms));
+    cfg_unlock();
+
+    esp_err_t e = s_log_ok ? cfg_log_put(CFG_LK_LONG_MS, copy, sizeof(s_long_ms)) : nvs_save_long_ms(copy);
+    free(copy);
+    return e;
+}
+
+static esp_err_t st_load_chord_ms(uint8_t *out)
+{
+    uint8_t v = 0;
+    if (st_log_get(CFG_LK_CHORD_MS, &v, 1)) {
+        *out = chord_ms_sanitize(v);
+        return ESP_OK;
+    }
+    esp_err_t e = nvs_load_chord_ms(out);
+    if (e == ESP_OK && s_log_ok) (void)cfg_log_put(CFG_LK_CHORD_MS, out, 1);
+    return e;
+}
+
+static esp_err_t st_save_chord_ms(void)
+{
+    uint8_t v = s_chord_ms;
+    return s_log_ok ? cfg_log_put(CFG_LK_CHORD_MS, &v, 1) : nvs_save_chord_ms(v);
+}
+
+// -------------------- exp/fs helpers --------------------
+static void expfs_set_defaults_one(expfs_port_cfg_t *p)
+{
+    if (!p) return;
+    memset(p, 0, sizeof(*p));
+
+    p->kind = EXPFS_KIND_SINGLE_SW;
+
+    // exp default = CC ch1 cc0 val1=0 val2=127
+    p->exp_action.type = ACT_CC;
+    p->exp_action.ch = 1;
+    p->exp_action.a = 0;     // cc#
+    p->exp_action.b = 0;     // val1
+    p->exp_action.c = 100;   // val2
+
+    // default calibration (safe)
+    p->cal_min = 0;
+    p->cal_max = 4095;
+
+    // switch defaults
+    p->tip.press_mode = BTN_SHORT;
+    p->tip.cc_behavior = CC_NORMAL;
+    for (int i = 0; i < MAX_ACTIONS; i++) {
+        set_default_action(&p->tip.short_actions[i]);
+        set_default_action(&p->tip.long_actions[i]);
+    }
+
+    p->ring.press_mode = BTN_SHORT;
+    p->ring.cc_behavior = CC_NORMAL;
+    for (int i = 0; i < MAX_ACTIONS; i++) {
+        set_default_action(&p->ring.short_actions[i]);
+        set_default_action(&p->ring.long_actions[i]);
+    }
+
+    p->long_ms[0] = LONG_MS_DEFAULT;
+    p->long_ms[1] = LONG_MS_DEFAULT;
+
+    p->exp_res = EXP_RES_7BIT;
+    p->nrpn = 0;
+
+    p->flt_min_cut = EXP_FLT_MIN_CUT_DEFAULT;
+    p->flt_beta = EXP_FLT_BETA_DEFAULT;
+
+    p->curve = EXP_CURVE_LINEAR;
+    p->curve_n = 2;
+    p->curve_pts[0][0] = 0;   p->curve_pts[0][1] = 0;
+    p->curve_pts[1][0] = 100; p->curve_pts[1][1] = 100;
+}
+
+static void expfs_defaults(void)
+{
+    for (int i = 0; i < EXPFS_PORT_COUNT; i++) expfs_set_defaults_one(&s_expfs[i]);
+    expfs_publish();
+}
+
+// custom curve: clamp to 0..100, sort by x, drop duplicate x. < 2 points -> linear
+static void expfs_sanitize_curve(expfs_port_cfg_t *p)
+{
+    p->curve = (uint8_t)clampi((int)p->curve, EXP_CURVE_LINEAR, EXP_CURVE_CUSTOM);
+    p->curve_n = (uint8_t)clampi((int)p->curve_n, 0, EXP_CURVE_MAX_PTS);
+
+    for (int i = 0; i < p->curve_n; i++) {
+        p->curve_pts[i][0] = (uint8_t)clampi((int)p->curve_pts[i][0], 0, 100);
+        p->curve_pts[i][1] = (uint8_t)clampi((int)p->curve_pts[i][1], 0, 100);
+    }
+    for (int i = p->curve_n; i < EXP_CURVE_MAX_PTS; i++) {
+        p->curve_pts[i][0] = 0;
+        p->curve_pts[i][1] = 0;
+    }
+
+    // insertion sort (max 8)
+    for (int i = 1; i < p->curve_n; i++) {
+        uint8_t x = p->curve_pts[i][0], y = p->curve_pts[i][1];
+        int j = i - 1;
+        while (j >= 0 && p->curve_pts[j][0] > x) {
+            p->curve_pts[j + 1][0] = p->curve_pts[j][0];
+            p->curve_pts[j + 1][1] = p->curve_pts[j][1];
+            j--;
+        }
+        p->curve_pts[j + 1][0] = x;
+        p->curve_pts[j + 1][1] = y;
+    }
+
+    int n = 0;
+    for (int i = 0; i < p->curve_n; i++) {
+        if (n > 0 && p->curve_pts[i][0] == p->curve_pts[n - 1][0]) continue;
+        p->curve_pts[n][0] = p->curve_pts[i][0];
+        p->curve_pts[n][1] = p->curve_pts[i][1];
+        n++;
+    }
+    for (int i = n; i < p->curve_n; i++) { p->curve_pts[i][0] = 0; p->curve_pts[i][1] = 0; }
+    p->curve_n = (uint8_t)n;
+
+    if (p->curve == EXP_CURVE_CUSTOM && p->curve_n < 2) p->curve = EXP_CURVE_LINEAR;
+}
+
+static void expfs_sanitize_btn(expfs_btncfg_t *m)
 {
     if (!m) return;
 
-    // no group led for exp/fs (force into 0..2)
-    int pm = (int)m->press_mode;
-    if (pm == BTN_SHORT_GROUP_LED) pm = BTN_SHORT;
-    m->press_mode = (btn_press_mode_t)clampi(pm, 0, 2);
+    // no group led for exp/fs (force into 0..2)
+    int pm = (int)m->press_mode;
+    if (pm == BTN_SHORT_GROUP_LED) pm = BTN_SHORT;
+    m->press_mode = (btn_press_mode_t)clampi(pm, 0, 2);
+
+    m->cc_behavior = (cc_behavior_t)clampi((int)m->cc_behavior, 0, 2);
+
+    for (int i = 0; i < MAX_ACTIONS; i++) {
+        action_t *sa = &m->short_actions[i];
+        action_t *la = &m->long_actions[i];
+
+        if (sa->type != ACT_CC && sa->type != ACT_PC) set_default_action(sa);
+        if (la->type != ACT_CC && la->type != ACT_PC) set_default_action(la);
+
+        sa->ch = (uint8_t)clampi((int)sa->ch, 1, 16);
+        la->ch = (uint8_t)clampi((int)la->ch, 1, 16);
+        sa->a  = (uint8_t)clampi((int)sa->a, 0, 127);
+        sa->b  = (uint8_t)clampi((int)sa->b, 0, 127);
+        sa->c  = 0;
+        la->a  = (uint8_t)clampi((int)la->a, 0, 127);
+        la->b  = (uint8_t)clampi((int)la->b, 0, 127);
+        la->c  = 0;
+    }
+}
+
+static void expfs_sanitize_all(void)
+{
+    for (int i = 0; i < EXPFS_PORT_COUNT; i++) {
+        expfs_port_cfg_t *p = &s_expfs[i];
+
+        p->kind = (expfs_kind_t)clampi((int)p->kind, 0, 2);
+
+        // calibration sanity
+        p->cal_min = (uint16_t)clampi((int)p->cal_min, 0, 4095);
+        p->cal_max = (uint16_t)clampi((int)p->cal_max, 0, 4095);
+
+        // exp action: allow CC or PC, single cmd
+        if (p->exp_action.type != ACT_CC && p->exp_action.type != ACT_PC) set_default_action(&p->exp_action);
+        p->exp_action.ch = (uint8_t)clampi((int)p->exp_action.ch, 1, 16);
+
+        if (p->exp_action.type == ACT_CC) {
+            p->exp_action.a = (uint8_t)clampi((int)p->exp_action.a, 0, 127); // cc#
+            p->exp_action.b = (uint8_t)clampi((int)p->exp_action.b, 0, 127); // val1
+            p->exp_action.c = (uint8_t)clampi((int)p->exp_action.c, 0, 127); // val2
+        } else if (p->exp_action.type == ACT_PC) {
+            // PC uses a=val1, b=val2
+            p->exp_action.a = (uint8_t)clampi((int)p->exp_action.a, 0, 127);
+            p->exp_action.b = (uint8_t)clampi((int)p->exp_action.b, 0, 127);
+            p->exp_action.c = 0;
+        } else {
+            set_default_action(&p->exp_action);
+        }
+
+        expfs_sanitize_btn(&p->tip);
+        expfs_sanitize_btn(&p->ring);
+
+        p->long_ms[0] = (uint16_t)clampi((int)p->long_ms[0], LONG_MS_MIN, LONG_MS_MAX);
+        p->long_ms[1] = (uint16_t)clampi((int)p->long_ms[1], LONG_MS_MIN, LONG_MS_MAX);
+
+        p->exp_res = (uint8_t)clampi((int)p->exp_res, EXP_RES_7BIT, EXP_RES_NRPN);
+        p->nrpn = (uint16_t)clampi((int)p->nrpn, 0, 16383);
+
+        p->flt_min_cut = (uint16_t)clampi((int)p->flt_min_cut, EXP_FLT_MIN_CUT_MIN, EXP_FLT_MIN_CUT_MAX);
+        p->flt_beta = (uint16_t)clampi((int)p->flt_beta, 0, EXP_FLT_BETA_MAX);
+
+        expfs_sanitize_curve(p);
+
+        p->kind_auto = p->kind_auto ? 1 : 0;
+        p->cal_auto = p->cal_auto ? 1 : 0;
+
+        p->exp_extra_n = (uint8_t)clampi((int)p->exp_extra_n, 0, EXP_EXTRA_TARGETS);
+        for (int k = 0; k < EXP_EXTRA_TARGETS; k++) {
+            exp_target_t *t = &p->exp_extra[k];
+            if (k >= p->exp_extra_n) { memset(t, 0, sizeof(*t)); continue; }
+            t->ch = (uint8_t)clampi((int)t->ch, 1, 16);
+            t->cc = (uint8_t)clampi((int)t->cc, 0, 127);
+            t->v1 = (uint8_t)clampi((int)t->v1, 0, 127);
+            t->v2 = (uint8_t)clampi((int)t->v2, 0, 127);
+            if (t->curve >= EXP_CURVE_CUSTOM) t->curve = EXP_CURVE_LINEAR;
+            t->rsv = 0;
+        }
+    }
+    expfs_publish();
+}
+
+static esp_err_t nvs_load_expfs(void)
+{
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+
+    nvs_handle_t h;
+    esp_err_t e = nvs_open("footsw", NVS_READONLY, &h);
+    if (e != ESP_OK) return e;
+
+    size_t len = 0;
+    e = nvs_get_blob(h, "expfs", NULL, &len);
+    if (e != ESP_OK) { nvs_close(h); return e; }
+
+    // fields are only ever appended to expfs_port_cfg_t:
+    // an older blob is a per-port prefix, the rest keeps defaults
+    size_t port_len = len / EXPFS_PORT_COUNT;
+    if ((len % EXPFS_PORT_COUNT) != 0 ||
+        port_len < EXPFS_CFG_V1_SIZE || port_len > sizeof(expfs_port_cfg_t)) {
+        nvs_close(h);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    uint8_t *tmp = (uint8_t *)malloc(len);
+    if (!tmp) { nvs_close(h); return ESP_ERR_NO_MEM; }
+
+    e = nvs_get_blob(h, "expfs", tmp, &len);
+    nvs_close(h);
+
+    if (e == ESP_OK) {
+        for (int i = 0; i < EXPFS_PORT_COUNT; i++) {
+            expfs_set_defaults_one(&s_expfs[i]);
+            memcpy(&s_expfs[i], tmp + (size_t)i * port_len, port_len);
+        }
+        if (port_len != sizeof(expfs_port_cfg_t)) {
+            ESP_LOGW(TAG, "exp/fs blob upgraded (%u -> %u bytes/port)",
+                     (unsigned)port_len, (unsigned)sizeof(expfs_port_cfg_t));
+        }
+        expfs_sanitize_all();
+    }
+    free(tmp);
+    return e;
+}
+
+// call without s_expfs_mtx held (copies under it, writes flash after)
+static esp_err_t nvs_save_expfs(void)
+{
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+
+    expfs_port_cfg_t *copy = (expfs_port_cfg_t *)malloc(sizeof(s_expfs));
+    if (!copy) return ESP_ERR_NO_MEM;
+    expfs_lock();
+    memcpy(copy, s_expfs, sizeof(s_expfs));
+    expfs_unlock();
+
+    nvs_handle_t h;
+    esp_err_t e = nvs_open("footsw", NVS_READWRITE, &h);
+    if (e == ESP_OK) {
+        e = nvs_set_blob(h, "expfs", copy, sizeof(s_expfs));
+        if (e == ESP_OK) e = nvs_commit(h);
+        nvs_close(h);
+    }
+    free(copy);
+
+    if (e != ESP_OK) ESP_LOGE(TAG, "nvs_save_expfs failed: %s", esp_err_to_name(e));
+    return e;
+}
+
+// -------------------- write-behind settings --------------------
+static cfg_setting_save_fn s_st_save[CFG_ST_COUNT] = {
+    [CFG_ST_BRIGHTNESS] = st_save_led_brightness,
+    [CFG_ST_CUR_BANK]   = st_save_cur_bank,
+    [CFG_ST_AB_LED]     = st_save_ab_led_sel,
+    [CFG_ST_LONG_MS]    = st_save_long_ms,
+    [CFG_ST_CHORD_MS]   = st_save_chord_ms,
+    [CFG_ST_EXPFS]      = nvs_save_expfs,
+};
+
+// write the dirty settings that are due (all: every dirty one). the bit is cleared before
+// the value is read -> a change during the write marks it again. failed items retry later
+static esp_err_t st_flush(bool all)
+{
+    if (s_st_mtx) xSemaphoreTake(s_st_mtx, portMAX_DELAY);
+
+    TickType_t now = xTaskGetTickCount();
+    uint32_t take = 0;
+
+    portENTER_CRITICAL(&s_st_mux);
+    for (int i = 0; i < CFG_ST_COUNT; i++) {
+        uint32_t bit = 1u << i;
+        if ((s_st_dirty & bit) && (all || (int32_t)(s_st_due[i] - now) <= 0)) take |= bit;
+    }
+    s_st_dirty &= ~take;
+    portEXIT_CRITICAL(&s_st_mux);
+
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < CFG_ST_COUNT; i++) {
+        if (!(take & (1u << i)) || !s_st_save[i]) continue;
+
+        esp_err_t e = s_st_save[i]();
+        if (e == ESP_OK) continue;
+        if (err == ESP_OK) err = e;
+        if (e != ESP_ERR_INVALID_STATE) st_mark_in((cfg_setting_t)i, CFG_ST_RETRY_MS);   // no backend: drop
+    }
+
+    if (s_st_mtx) xSemaphoreGive(s_st_mtx);
+    return err;
+}
+
+// esp_restart(): nothing pending is lost
+static void st_shutdown(void)
+{
+    (void)st_flush(true);
+}
+
+void config_store_setting_register(cfg_setting_t item, cfg_setting_save_fn save)
+{
+    if ((unsigned)item >= CFG_ST_COUNT) return;
+    s_st_save[item] = save;
+}
+
+void config_store_setting_dirty(cfg_setting_t item)
+{
+    if ((unsigned)item >= CFG_ST_COUNT) return;
+    st_mark(item);
+}
+
+esp_err_t config_store_flush_settings(void)
+{
+    return st_flush(true);
+}
+
+// -------------------- snapshot publish --------------------
+// both exp/fs ports from s_expfs (call under s_expfs_mtx), bumps the expfs gen
+static void expfs_publish(void)
+{
+    cfg_expfs_snap_t *n = (cfg_expfs_snap_t *)cfg_snap_alloc(sizeof(*n));
+    if (!n) {
+        ESP_LOGE(TAG, "exp/fs snapshot alloc failed, readers keep the old one");
+        return;
+    }
+    memcpy(n->port, s_expfs, sizeof(n->port));
+    n->ver = s_expfs_gen + 1;
+
+    cfg_expfs_snap_t *old = __atomic_exchange_n(&s_snap_expfs, n, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&s_expfs_gen, n->ver, __ATOMIC_SEQ_CST);
+    cfg_snap_retire(old);
+    cfg_snap_reclaim();
+}
+
+static void sanitize_map(btn_map_t *m)
+{
+    for (int i = 0; i < MAX_ACTIONS; i++) {
+        action_t *sa = &m->short_actions[i];
+        action_t *la = &m->long_actions[i];
+
+        if (sa->type != ACT_CC && sa->type != ACT_PC) set_default_action(sa);
+        if (la->type != ACT_CC && la->type != ACT_PC) set_default_action(la);
+
+        sa->ch = (uint8_t)clampi((int)sa->ch, 1, 16);
+        la->ch = (uint8_t)clampi((int)la->ch, 1, 16);
+        sa->a  = (uint8_t)clampi((int)sa->a, 0, 127);
+        sa->b  = (uint8_t)clampi((int)sa->b, 0, 127);
+        sa->c  = 0;
+        la->a  = (uint8_t)clampi((int)la->a, 0, 127);
+        la->b  = (uint8_t)clampi((int)la->b, 0, 127);
+        la->c  = 0;
+    }
+
+    int pm = (int)m->press_mode;
+    if (pm == 4) pm = 0; // migrate old tap tempo -> short
+    m->press_mode  = (btn_press_mode_t)clampi(pm, 0, 3);
+    m->cc_behavior = (cc_behavior_t)clampi((int)m->cc_behavior, 0, 2);
+}
+
+// one bank (names = switch_name[NUM_BTNS])
+static void sanitize_page(char (*names)[NAME_LEN], btn_map_t *map)
+{
+    for (int k = 0; k < NUM_BTNS; k++) {
+        sanitize_map(&map[k]);
+        names[k][NAME_LEN - 1] = 0;
+    }
+}
+
+static void sanitize_layout(cfg_layout_t *lay)
+{
+    for (int b = 0; b < MAX_BANKS; b++) lay->bank_name[b][NAME_LEN - 1] = 0;
+    lay->bank_count = (uint8_t)clampi((int)lay->bank_count, 1, MAX_BANKS);
+}
+
+static void page_defaults(char (*names)[NAME_LEN], btn_map_t *map)
+{
+    for (int k = 0; k < NUM_BTNS; k++) {
+        char sn[NAME_LEN];
+        snprintf(sn, sizeof(sn), "SW %d", k + 1);
+        memset(names[k], 0, NAME_LEN);
+        safe_set_name(names[k], sn, "SW");
+
+        btn_map_t *m = &map[k];
+        memset(m, 0, sizeof(*m));
+        m->press_mode  = BTN_SHORT;
+        m->cc_behavior = CC_NORMAL;
+
+        for (int i = 0; i < MAX_ACTIONS; i++) {
+            set_default_action(&m->short_actions[i]);
+            set_default_action(&m->long_actions[i]);
+        }
+    }
+}
+
+static void layout_defaults(cfg_layout_t *lay)
+{
+    memset(lay, 0, sizeof(*lay));
+    lay->bank_count = 1;
+
+    for (int b = 0; b < MAX_BANKS; b++) {
+        char bn[NAME_LEN];
+        snprintf(bn, sizeof(bn), "Bank %d", b + 1);
+        safe_set_name(lay->bank_name[b], bn, "Bank");
+    }
+}
+
+// mapping / names only (no side effects on the separately stored settings)
+static void set_cfg_defaults(foot_config_t *cfg)
+{
+    if (!cfg) return;
+
+    memset(cfg, 0, sizeof(*cfg));
+
+    cfg->bank_count = 1;
+
+    for (int b = 0; b < MAX_BANKS; b++) {
+        char bn[NAME_LEN];
+        snprintf(bn, sizeof(bn), "Bank %d", b + 1);
+        safe_set_name(cfg->bank_name[b], bn, "Bank");
+
+        page_defaults(cfg->switch_name[b], cfg->map[b]);
+    }
+}
+
+static void set_defaults(foot_config_t *cfg)
+{
+    if (!cfg) return;
+
+    set_cfg_defaults(cfg);
+
+    ab_led_defaults();
+    s_cur_bank = 0;
+
+    // exp/fs defaults too
+    expfs_defaults();
+}
+
+// -------------------- base image reads --------------------
+typedef struct {
+    const cfg_base_t *b;
+    FILE *f;
+} cfg_rd_t;
+
+static bool cfg_rd_open(cfg_rd_t *r, const cfg_base_t *b)
+{
+    r->b = b;
+    r->f = NULL;
+    if (b->ram || b->log || b->size == 0) return true;
+
+    r->f = fopen(CFG_FILE_PATH, "rb");
+    return r->f != NULL;
+}
+
+static void cfg_rd_close(cfg_rd_t *r)
+{
+    if (r->f) fclose(r->f);
+    r->f = NULL;
+}
+
+static bool cfg_rd_at(cfg_rd_t *r, size_t off, void *dst, size_t n)
+{
+    if (off + n > r->b->size) return false;
+    if (r->b->ram) {
+        memcpy(dst, r->b->ram + off, n);
+        return true;
+    }
+    if (!r->f || fseek(r->f, (long)off, SEEK_SET) != 0) return false;
+    return fread(dst, 1, n, r->f) == n;
+}
+
+// bank record of the base, decoded + sanitized (banks past the image: defaults).
+// rec = CFG_V6_BANK_MAX scratch
+static esp_err_t cfg_base_get(cfg_rd_t *r, int bank, char (*names)[NAME_LEN], btn_map_t *map, uint8_t *rec)
+{
+    const cfg_base_t *b = r->b;
+
+    page_defaults(names, map);
+    if (bank >= b->bank_count) return ESP_OK;
+
+    bool ok;
+    size_t len = 0;
+    if (b->log) {
+        esp_err_t e = cfg_log_get((uint8_t)(CFG_LK_BANK0 + bank), rec, CFG_V6_BANK_MAX, &len);
+        if (e == ESP_ERR_NOT_FOUND) return ESP_OK;   // never edited: defaults
+        ok = (e == ESP_OK);
+    } else {
+        uint32_t end = (bank + 1 < b->bank_count) ? b->rec_off[bank + 1] : b->body;
+        len = (size_t)(end - b->rec_off[bank]);
+        ok = cfg_rd_at(r, sizeof(cfg_hdr_v4_t) + b->rec_off[bank], rec, len);
+    }
+    if (!ok || cfg_v6_get_bank(&names[0][0], map, rec, len) != len) {
+        page_defaults(names, map);
+        return ESP_FAIL;
+    }
+
+    sanitize_page(names, map);
+    return ESP_OK;
+}
+
+// one sequential pass over an image (b->ram + b->size, or CFG_FILE_PATH): header, crc,
+// then the head -> record index + layout. b is left without an image on failure
+static esp_err_t cfg_base_scan(cfg_base_t *b, cfg_layout_t *lay)
+{
+    uint8_t *buf = (uint8_t *)heap_caps_malloc(CFG_V6_HEAD_MAX, MALLOC_CAP_8BIT);
+    if (!buf) return ESP_ERR_NO_MEM;
+
+    size_t have = b->ram ? b->size : 0;
+    cfg_hdr_v4_t hdr;
+    cfg_rd_t r;
+    esp_err_t e = ESP_FAIL;
+
+    b->size = sizeof(hdr);
+    if (!cfg_rd_open(&r, b)) {
+        heap_caps_free(buf);
+        b->size = 0;
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    do {
+        if (!cfg_rd_at(&r, 0, &hdr, sizeof(hdr))) break;
+        if (hdr.magic != CFG_MAGIC || hdr.ver != CFG_VER) break;
+        if (hdr.size < 1 + 4 || hdr.size > (uint32_t)cfg_v6_max_size(MAX_BANKS)) break;
+        if (b->ram && sizeof(hdr) + hdr.size != have) break;
+
+        b->size = (uint32_t)(sizeof(hdr) + hdr.size);
+        b->body = hdr.size - 4u;
+
+        // crc in CFG_V6_HEAD_MAX chunks
+        uint32_t crc = 0;
+        size_t off = 0;
+        while (off < b->body) {
+            size_t n = b->body - off;
+            if (n > CFG_V6_HEAD_MAX) n = CFG_V6_HEAD_MAX;
+            if (!cfg_rd_at(&r, sizeof(hdr) + off, buf, n)) break;
+            crc = esp_rom_crc32_le(crc, buf, (uint32_t)n);
+            off += n;
+        }
+        uint8_t t[4];
+        if (off != b->body || !cfg_rd_at(&r, sizeof(hdr) + b->body, t, sizeof(t))) break;
+        uint32_t want = (uint32_t)t[0] | ((uint32_t)t[1] << 8) | ((uint32_t)t[2] << 16) | ((uint32_t)t[3] << 24);
+        if (want != crc) {
+            e = ESP_ERR_INVALID_CRC;
+            break;
+        }
+
+        size_t hn = (b->body < CFG_V6_HEAD_MAX) ? b->body : CFG_V6_HEAD_MAX;
+        int bc = 0;
+        if (!cfg_rd_at(&r, sizeof(hdr), buf, hn) ||
+            !cfg_v6_get_head(&bc, &lay->bank_name[0][0], b->rec_off, buf, hn)) break;
+
+        bool ok = true;
+        for (int k = 0; k < bc && ok; k++) {
+            uint32_t end = (k + 1 < bc) ? b->rec_off[k + 1] : b->body;
+            ok = (b->rec_off[k] <= end && end <= b->body && end - b->rec_off[k] <= CFG_V6_BANK_MAX);
+        }
+        if (!ok) break;
+
+        b->bank_count = bc;
+        b->epoch = hdr.epoch;
+        lay->bank_count = (uint8_t)bc;
+        sanitize_layout(lay);
+        e = ESP_OK;
+    } while (0);
+
+    cfg_rd_close(&r);
+    heap_caps_free(buf);
+
+    if (e != ESP_OK) {
+        b->bank_count = 0;
+        b->size = 0;
+    }
+    return e;
+}
+
+// layout record of the config log -> log base (bank records are read by key on demand)
+static esp_err_t cfg_log_load(cfg_base_t *b, cfg_layout_t *lay)
+{
+    uint8_t *buf = (uint8_t *)heap_caps_malloc(CFG_V6_HEAD_MAX, MALLOC_CAP_8BIT);
+    if (!buf) return ESP_ERR_NO_MEM;
+
+    size_t len = 0;
+    int bc = 0;
+    esp_err_t e = cfg_log_get(CFG_LK_LAYOUT, buf, CFG_V6_HEAD_MAX, &len);
+    if (e == ESP_OK && cfg_v6_get_names(&bc, &lay->bank_name[0][0], buf, len) != len) e = ESP_FAIL;
+    heap_caps_free(buf);
+
+    if (e != ESP_OK) {
+        layout_defaults(lay);
+        return e;
+    }
+
+    memset(b, 0, sizeof(*b));
+    b->log = true;
+    b->stored = true;
+    b->bank_count = bc;
+    lay->bank_count = (uint8_t)bc;
+    sanitize_layout(lay);
+    return ESP_OK;
+}
+
+// -------------------- base image writes --------------------
+// banks of a new image, asked in order 0..bank_count-1 twice (size pass, write pass)
+typedef esp_err_t (*cfg_src_fn)(void *ctx, int bank, cfg_page_t *out);
+
+typedef struct {
+    cfg_page_t pg;
+    uint8_t    rec[CFG_V6_BANK_MAX];
+    uint8_t    head[CFG_V6_HEAD_MAX];
+} cfg_build_buf_t;
+
+typedef struct {
+    FILE    *f;       // CFG_FILE_PATH_TMP, or
+    uint8_t *ram;     // exact-size buffer
+    size_t   len;
+    uint32_t crc;
+    bool     err;
+} cfg_sink_t;
+
+static void cfg_sink_put(cfg_sink_t *o, const void *p, size_t n)
+{
+    if (o->err) return;
+    o->crc = esp_rom_crc32_le(o->crc, (const uint8_t *)p, (uint32_t)n);
+    if (o->f) o->err = (fwrite(p, 1, n, o->f) != n);
+    else memcpy(o->ram + o->len, p, n);
+    o->len += n;
+}
+
+// stream a v6 image from `src` into CFG_FILE_PATH_TMP (to_file) or an exact-size RAM buffer.
+// pass 1 only sizes the bank records, pass 2 writes header, head, records and crc:
+// RAM = one page + one record + the head, whatever the bank count
+static esp_err_t cfg_image_build(cfg_base_t *nb, const cfg_layout_t *lay, cfg_src_fn src, void *ctx, bool to_file)
+{
+    int bc = clampi((int)lay->bank_count, 1, MAX_BANKS);
 
-    m->cc_behavior = (cc_behavior_t)clampi((int)m->cc_behavior, 0, 2);
+    cfg_build_buf_t *w = (cfg_build_buf_t *)heap_caps_malloc(sizeof(*w), MALLOC_CAP_8BIT);
+    if (!w) return ESP_ERR_NO_MEM;
 
-    for (int i = 0; i < MAX_ACTIONS; i++) {
-        action_t *sa = &m->short_actions[i];
-        action_t *la = &m->long_actions[i];
+    memset(nb, 0, sizeof(*nb));
+    esp_err_t e = ESP_OK;
 
-        if (sa->type != ACT_CC && sa->type != ACT_PC) set_default_action(sa);
-        if (la->type != ACT_CC && la->type != ACT_PC) set_default_action(la);
+    // pass 1: record sizes -> offset table
+    uint32_t pos = (uint32_t)cfg_v6_put_head(w->head, bc, &lay->bank_name[0][0], NULL);
+    for (int b = 0; b < bc; b++) {
+        e = src(ctx, b, &w->pg);
+        if (e != ESP_OK) break;
+        sanitize_page(w->pg.switch_name, w->pg.map);
+        nb->rec_off[b] = pos;
+        pos += (uint32_t)cfg_v6_put_bank(w->rec, &w->pg.switch_name[0][0], w->pg.map);
+    }
+    if (e != ESP_OK) {
+        heap_caps_free(w);
+        memset(nb, 0, sizeof(*nb));
+        return e;
+    }
 
-        sa->ch = (uint8_t)clampi((int)sa->ch, 1, 16);
-        la->ch = (uint8_t)clampi((int)la->ch, 1, 16);
-        sa->a  = (uint8_t)clampi((int)sa->a, 0, 127);
-        sa->b  = (uint8_t)clampi((int)sa->b, 0, 127);
-        sa->c  = 0;
-        la->a  = (uint8_t)clampi((int)la->a, 0, 127);
-        la->b  = (uint8_t)clampi((int)la->b, 0, 127);
-        la->c  = 0;
+    size_t head_len = cfg_v6_put_head(w->head, bc, &lay->bank_name[0][0], nb->rec_off);
+    nb->bank_count = bc;
+    nb->body = pos;
+    nb->size = (uint32_t)(sizeof(cfg_hdr_v4_t) + pos + 4u);
+    nb->epoch = (uint16_t)(s_cfg_epoch + 1u);   // new epoch: the old journal no longer applies
+
+    cfg_sink_t o = {0};
+    if (to_file) {
+        o.f = fopen(CFG_FILE_PATH_TMP, "wb");
+    } else {
+        o.ram = (uint8_t *)heap_caps_malloc(nb->size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!o.ram) o.ram = (uint8_t *)heap_caps_malloc(nb->size, MALLOC_CAP_8BIT);
+    }
+    if (!o.f && !o.ram) {
+        heap_caps_free(w);
+        memset(nb, 0, sizeof(*nb));
+        return to_file ? ESP_FAIL : ESP_ERR_NO_MEM;
     }
-}
 
-static void expfs_sanitize_all(void)
-{
-    for (int i = 0; i < EXPFS_PORT_COUNT; i++) {
-        expfs_port_cfg_t *p = &s_expfs[i];
+    cfg_hdr_v4_t hdr = { .magic = CFG_MAGIC, .ver = CFG_VER, .epoch = nb->epoch, .size = pos + 4u };
+    cfg_sink_put(&o, &hdr, sizeof(hdr));
+    o.crc = 0;   // payload only
+    cfg_sink_put(&o, w->head, head_len);
 
-        p->kind = (expfs_kind_t)clampi((int)p->kind, 0, 2);
+    // pass 2: the same records again (sources do not change while the image is written)
+    for (int b = 0; b < bc; b++) {
+        e = src(ctx, b, &w->pg);
+        if (e != ESP_OK) break;
+        sanitize_page(w->pg.switch_name, w->pg.map);
+        size_t n = cfg_v6_put_bank(w->rec, &w->pg.switch_name[0][0], w->pg.map);
+        if (o.len - sizeof(hdr) != nb->rec_off[b]) { e = ESP_FAIL; break; }
+        cfg_sink_put(&o, w->rec, n);
+    }
+    if (e == ESP_OK && o.len - sizeof(hdr) != pos) e = ESP_FAIL;
+    if (e == ESP_OK) {
+        uint32_t crc = o.crc;
+        uint8_t t[4] = { (uint8_t)crc, (uint8_t)(crc >> 8), (uint8_t)(crc >> 16), (uint8_t)(crc >> 24) };
+        cfg_sink_put(&o, t, sizeof(t));
+        if (o.err) e = ESP_FAIL;
+    }
 
-        // calibration sanity
-        p->cal_min = (uint16_t)clampi((int)p->cal_min, 0, 4095);
-        p->cal_max = (uint16_t)clampi((int)p->cal_max, 0, 4095);
+    if (o.f) {
+        fflush(o.f);
+        fclose(o.f);
+    }
+    heap_caps_free(w);
 
-        // exp action: allow CC or PC, single cmd
-        if (p->exp_action.type != ACT_CC && p->exp_action.type != ACT_PC) set_default_action(&p->exp_action);
-        p->exp_action.ch = (uint8_t)clampi((int)p->exp_action.ch, 1, 16);
+    if (e != ESP_OK) {
+        if (to_file) unlink(CFG_FILE_PATH_TMP);
+        if (o.ram) heap_caps_free(o.ram);
+        memset(nb, 0, sizeof(*nb));
+        return e;
+    }
 
-        if (p->exp_action.type == ACT_CC) {
-            p->exp_action.a = (uint8_t)clampi((int)p->exp_action.a, 0, 127); // cc#
-            p->exp_action.b = (uint8_t)clampi((int)p->exp_action.b, 0, 127); // val1
-            p->exp_action.c = (uint8_t)clampi((int)p->exp_action.c, 0, 127); // val2
-        } else if (p->exp_action.type == ACT_PC) {
-            // PC uses a=val1, b=val2
-            p->exp_action.a = (uint8_t)clampi((int)p->exp_action.a, 0, 127);
-            p->exp_action.b = (uint8_t)clampi((int)p->exp_action.b, 0, 127);
-            p->exp_action.c = 0;
-        } else {
-            set_default_action(&p->exp_action);
-        }
+    nb->ram = o.ram;
+    return ESP_OK;
+}
 
-        expfs_sanitize_btn(&p->tip);
-        expfs_sanitize_btn(&p->ring);
+// config log batch: layout, bank records, deletes past bank_count (a later layout grow
+// starts those banks from defaults, like an image without them)
+typedef struct {
+    const cfg_layout_t *lay;
+    cfg_src_fn     src;
+    void          *ctx;
+    const uint8_t *only;    // banks to write, NULL = all
+    cfg_page_t     pg;
+} cfg_log_batch_t;
+
+static esp_err_t cfg_log_item(void *ctx, int i, uint8_t *key, uint8_t *buf, size_t *len)
+{
+    cfg_log_batch_t *c = (cfg_log_batch_t *)ctx;
+    int bc = clampi((int)c->lay->bank_count, 1, MAX_BANKS);
+
+    if (i == 0) {
+        *key = CFG_LK_LAYOUT;
+        *len = cfg_v6_put_names(buf, bc, &c->lay->bank_name[0][0]);
+        return ESP_OK;
+    }
+
+    int bank = i - 1;
+    *key = (uint8_t)(CFG_LK_BANK0 + bank);
+    if (bank >= bc) {
+        *len = CFG_LOG_DEL;
+        return ESP_OK;
     }
+    if (c->only && !c->only[bank]) return ESP_ERR_NOT_FOUND;
+
+    esp_err_t e = c->src(c->ctx, bank, &c->pg);
+    if (e != ESP_OK) return (e == ESP_ERR_NOT_FOUND) ? ESP_FAIL : e;
+    sanitize_page(c->pg.switch_name, c->pg.map);
+    *len = cfg_v6_put_bank(buf, &c->pg.switch_name[0][0], c->pg.map);
+    return ESP_OK;
 }
 
-static esp_err_t nvs_load_expfs(void)
+// banks of `src` (only[b] != 0, NULL = all) + the layout -> config log, one batch.
+// unchanged records cost a read, no write
+static esp_err_t cfg_log_commit(cfg_base_t *nb, const cfg_layout_t *lay, cfg_src_fn src, void *ctx,
+                                const uint8_t *only)
 {
-    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+    cfg_log_batch_t *c = (cfg_log_batch_t *)heap_caps_malloc(sizeof(*c), MALLOC_CAP_8BIT);
+    if (!c) return ESP_ERR_NO_MEM;
 
-    nvs_handle_t h;
-    esp_err_t e = nvs_open("footsw", NVS_READONLY, &h);
+    *c = (cfg_log_batch_t){ .lay = lay, .src = src, .ctx = ctx, .only = only };
+    esp_err_t e = cfg_log_write(1 + MAX_BANKS, cfg_log_item, c);
+    heap_caps_free(c);
+
+    memset(nb, 0, sizeof(*nb));
     if (e != ESP_OK) return e;
 
-    size_t len = 0;
-    e = nvs_get_blob(h, "expfs", NULL, &len);
-    if (e != ESP_OK) { nvs_close(h); return e; }
+    nb->log = true;
+    nb->stored = true;
+    nb->bank_count = clampi((int)lay->bank_count, 1, MAX_BANKS);
+    return ESP_OK;
+}
 
-    if (len != sizeof(s_expfs)) { nvs_close(h); return ESP_ERR_INVALID_SIZE; }
+static esp_err_t nvs_save_image(const cfg_base_t *b);
 
-    e = nvs_get_blob(h, "expfs", s_expfs, &len);
-    nvs_close(h);
+// new base: config log first (only[b] = banks that changed, NULL = all; images always take
+// every bank), else SPIFFS file, else RAM + NVS copy. ESP_OK = stored; otherwise nb may
+// still hold an unsaved RAM image the caller can make live
+static esp_err_t cfg_image_write(cfg_base_t *nb, const cfg_layout_t *lay, cfg_src_fn src, void *ctx,
+                                 const uint8_t *only)
+{
+    // the log stays the only copy once it holds the config: no file / NVS image behind it
+    if (s_log_ok) return cfg_log_commit(nb, lay, src, ctx, only);
+
+    esp_err_t e = ESP_FAIL;
+    if (s_spiffs_ok) {
+        e = cfg_image_build(nb, lay, src, ctx, true);
+        if (e == ESP_OK) return ESP_OK;
+        ESP_LOGW(TAG, "cfg image -> SPIFFS failed: %s", esp_err_to_name(e));
+    }
+
+    // fallback to NVS (may fail when config is very large)
+    e = cfg_image_build(nb, lay, src, ctx, false);
+    if (e != ESP_OK) return e;
 
-    if (e == ESP_OK) expfs_sanitize_all();
+    e = nvs_save_image(nb);
+    nb->stored = (e == ESP_OK);
     return e;
 }
 
-static esp_err_t nvs_save_expfs(void)
+// make nb the live base (s_io_mtx + cfg_lock held). a file image replaces CFG_FILE_PATH and
+// restarts the journal; a stored RAM image or the config log supersedes the file
+static esp_err_t cfg_base_install(cfg_base_t *nb)
 {
-    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+    bool file = (nb->ram == NULL && !nb->log);
 
-    nvs_handle_t h;
-    esp_err_t e = nvs_open("footsw", NVS_READWRITE, &h);
-    if (e != ESP_OK) return e;
+    if (file) {
+        // atomic replace
+        unlink(CFG_FILE_PATH);
+        if (rename(CFG_FILE_PATH_TMP, CFG_FILE_PATH) != 0) {
+            unlink(CFG_FILE_PATH_TMP);
+            memset(nb, 0, sizeof(*nb));
+            ESP_LOGE(TAG, "cfg base rename failed");
+            return ESP_FAIL;
+        }
+    } else if (nb->stored && s_spiffs_ok) {
+        unlink(CFG_FILE_PATH);
+    }
 
-    e = nvs_set_blob(h, "expfs", s_expfs, sizeof(s_expfs));
-    if (e == ESP_OK) e = nvs_commit(h);
-    nvs_close(h);
+    // the old journal belongs to the old file; keep it while that file is still the newest copy
+    if (s_spiffs_ok && (file || nb->stored)) unlink(CFG_JNL_PATH);
 
-    if (e != ESP_OK) ESP_LOGE(TAG, "nvs_save_expfs failed: %s", esp_err_to_name(e));
-    return e;
+    if (s_base.ram) heap_caps_free(s_base.ram);
+    s_base = *nb;
+    memset(nb, 0, sizeof(*nb));
+
+    s_cfg_epoch = s_base.epoch;
+    s_jnl_size = 0;
+    s_jnl_ok = file;
+    return ESP_OK;
 }
 
-static void sanitize_cfg(foot_config_t *cfg)
+// -------------------- bank pages --------------------
+static void cfg_snap_free(void *p)
 {
-    if (!cfg) return;
+    if (p) heap_caps_free((cfg_snap_node_t *)p - 1);
+}
 
-    for (int b = 0; b < MAX_BANKS; b++) {
-        for (int k = 0; k < NUM_BTNS; k++) {
-            btn_map_t *m = &cfg->map[b][k];
+static inline bool cfg_page_pinned(int bank)
+{
+    return s_page_dirty[bank] || s_page_saving[bank];
+}
 
-            for (int i = 0; i < MAX_ACTIONS; i++) {
-                action_t *sa = &m->short_actions[i];
-                action_t *la = &m->long_actions[i];
-
-                if (sa->type != ACT_CC && sa->type != ACT_PC) set_default_action(sa);
-                if (la->type != ACT_CC && la->type != ACT_PC) set_default_action(la);
-
-                sa->ch = (uint8_t)clampi((int)sa->ch, 1, 16);
-                la->ch = (uint8_t)clampi((int)la->ch, 1, 16);
-                sa->a  = (uint8_t)clampi((int)sa->a, 0, 127);
-                sa->b  = (uint8_t)clampi((int)sa->b, 0, 127);
-                sa->c  = 0;
-                la->a  = (uint8_t)clampi((int)la->a, 0, 127);
-                la->b  = (uint8_t)clampi((int)la->b, 0, 127);
-                la->c  = 0;
-            }
+static int cfg_page_pinned_count(void)
+{
+    int n = 0;
+    for (int b = 0; b < MAX_BANKS; b++) n += s_page_dirty[b] ? 1 : 0;
+    return n;
+}
+
+static bool cfg_page_in_ws(int bank)
+{
+    int bc = config_store_bank_count();
+    int cur = wrapi((int)s_cur_bank, bc);
+    return bank == cur || bank == wrapi(cur + 1, bc) || bank == wrapi(cur - 1, bc);
+}
+
+// swap the published page (n = NULL evicts); the old copy is freed after its readers
+static void cfg_page_publish(int bank, cfg_bank_snap_t *n)
+{
+    s_snap_seq++;
+    if (n) n->ver = s_snap_seq;
+
+    cfg_bank_snap_t *old = __atomic_exchange_n(&s_snap_bank[bank], n, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&s_snap_bank_ver[bank], s_snap_seq, __ATOMIC_SEQ_CST);
+    s_page_count += (n ? 1 : 0) - (old ? 1 : 0);
+    cfg_snap_retire(old);
+}
+
+// bank name + separately stored per-button settings
+static void cfg_page_fill(cfg_bank_snap_t *p, int bank)
+{
+    p->bank = (uint8_t)bank;
+    memcpy(p->bank_name, s_layout.bank_name[bank], sizeof(p->bank_name));
+    memcpy(p->long_ms, s_long_ms[bank], sizeof(p->long_ms));
+    for (int k = 0; k < NUM_BTNS; k++) p->ab_led_sel[k] = s_ab_led_sel[bank][k] ? 1u : 0u;
+}
+
+// evict LRU pages past CFG_PAGE_MAX (never pinned, working set or `keep`)
+static void cfg_page_trim(int keep)
+{
+    while (s_page_count > CFG_PAGE_MAX) {
+        int victim = -1;
+        for (int b = 0; b < MAX_BANKS; b++) {
+            if (!s_snap_bank[b] || b == keep || cfg_page_pinned(b) || cfg_page_in_ws(b)) continue;
+            if (victim < 0 || (int32_t)(s_page_used[b] - s_page_used[victim]) < 0) victim = b;
+        }
+        if (victim < 0) break;
+        cfg_page_publish(victim, NULL);
+    }
+}
+
+// resident page of `bank` (< bank_count), read from the base if needed (under cfg_lock).
+// NULL = no memory / base read error
+static const cfg_bank_snap_t *cfg_page_get(int bank)
+{
+    cfg_bank_snap_t *p = s_snap_bank[bank];
 
-            int pm = (int)m->press_mode;
-            if (pm == 4) pm = 0; // migrate old tap tempo -> short
-            m->press_mode  = (btn_press_mode_t)clampi(pm, 0, 3);
-            m->cc_behavior = (cc_behavior_t)clampi((int)m->cc_behavior, 0, 2);
+    if (!p) {
+        p = (cfg_bank_snap_t *)cfg_snap_alloc(sizeof(*p));
+        uint8_t *rec = (uint8_t *)heap_caps_malloc(CFG_V6_BANK_MAX, MALLOC_CAP_8BIT);
+        esp_err_t e = ESP_ERR_NO_MEM;
+        cfg_rd_t r;
+        if (p && rec) {
+            e = ESP_ERR_NOT_FOUND;
+            if (cfg_rd_open(&r, &s_base)) {
+                e = cfg_base_get(&r, bank, p->switch_name, p->map, rec);
+                cfg_rd_close(&r);
+            }
+        }
+        heap_caps_free(rec);
 
-            cfg->switch_name[b][k][NAME_LEN - 1] = 0;
+        if (e != ESP_OK) {
+            ESP_LOGE(TAG, "bank %d page-in failed: %s", bank, esp_err_to_name(e));
+            cfg_snap_free(p);
+            return NULL;
         }
-        cfg->bank_name[b][NAME_LEN - 1] = 0;
+
+        cfg_page_fill(p, bank);
+        cfg_page_publish(bank, p);
+        cfg_page_trim(bank);
     }
 
-    cfg->bank_count = (uint8_t)clampi((int)cfg->bank_count, 1, MAX_BANKS);
+    s_page_used[bank] = ++s_page_clock;
+    return p;
 }
 
-static void set_defaults(foot_config_t *cfg)
+// private copy of a page to edit: publish with cfg_page_commit or drop with cfg_snap_free
+static cfg_bank_snap_t *cfg_page_edit(int bank)
 {
-    if (!cfg) return;
+    const cfg_bank_snap_t *cur = cfg_page_get(bank);
+    if (!cur) return NULL;
 
-    memset(cfg, 0, sizeof(*cfg));
+    cfg_bank_snap_t *n = (cfg_bank_snap_t *)cfg_snap_alloc(sizeof(*n));
+    if (!n) {
+        ESP_LOGE(TAG, "page alloc failed (bank %d)", bank);
+        return NULL;
+    }
+    memcpy(n, cur, sizeof(*n));
+    return n;
+}
 
-    cfg->bank_count = 1;
+// publish an edited copy (name / settings refreshed); dirty pins it until the next base
+static void cfg_page_commit(cfg_bank_snap_t *n, bool dirty)
+{
+    int bank = n->bank;
+
+    cfg_page_fill(n, bank);
+    cfg_page_publish(bank, n);
+    if (dirty) s_page_dirty[bank] = 1;
+    s_page_used[bank] = ++s_page_clock;
+    cfg_page_trim(bank);
+}
+
+// re-publish a resident page after its bank name / led / long-press changed
+static void cfg_page_refresh(int bank)
+{
+    const cfg_bank_snap_t *cur = s_snap_bank[bank];
+    if (!cur) return;
+
+    cfg_bank_snap_t *n = (cfg_bank_snap_t *)cfg_snap_alloc(sizeof(*n));
+    if (!n) {
+        ESP_LOGE(TAG, "page alloc failed (bank %d), readers keep the old one", bank);
+        return;
+    }
+    memcpy(n, cur, sizeof(*n));
+    cfg_page_fill(n, bank);
+    cfg_page_publish(bank, n);
+}
+
+// drop pages from `from` up, pending edits included (new base / layout shrink)
+static void cfg_page_drop(int from)
+{
+    for (int b = from; b < MAX_BANKS; b++) {
+        if (s_snap_bank[b]) cfg_page_publish(b, NULL);
+        s_page_dirty[b] = 0;
+        s_page_saving[b] = 0;
+        s_jnl_btn_dirty[b] = 0;
+        s_jnl_name_dirty[b] = 0;
+    }
+}
+
+// load the working set (current bank +-1) and trim. true = something was paged in
+static bool cfg_page_ws(void)
+{
+    int bc = config_store_bank_count();
+    int cur = wrapi((int)s_cur_bank, bc);
+    int ws[3] = { cur, wrapi(cur + 1, bc), wrapi(cur - 1, bc) };
+
+    bool loaded = false;
+    for (int i = 0; i < 3; i++) {
+        if (!s_snap_bank[ws[i]]) loaded = true;
+        (void)cfg_page_get(ws[i]);
+    }
+    cfg_page_trim(-1);
+    return loaded;
+}
+
+static void cfg_request_pages(void)
+{
+    if (s_page_task) xTaskNotifyGive(s_page_task);
+}
+
+// keeps the working set resident after bank changes (flash reads happen here, not in foot_task)
+static void cfg_page_task(void *arg)
+{
+    (void)arg;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        cfg_lock();
+        bool loaded = cfg_page_ws();
+        cfg_unlock();
+
+        cfg_snap_reclaim();
+
+        // the current bank may only be readable now
+        if (loaded) display_uart_request_refresh();
+    }
+}
+
+// -------------------- image sources --------------------
+// live config: pages captured under cfg_lock (read section held), the rest from the base
+typedef struct {
+    cfg_rd_t rd;
+    const cfg_bank_snap_t *page[MAX_BANKS];
+    uint8_t rec[CFG_V6_BANK_MAX];
+} cfg_live_src_t;
+
+static esp_err_t cfg_src_live(void *ctx, int bank, cfg_page_t *out)
+{
+    cfg_live_src_t *c = (cfg_live_src_t *)ctx;
+    const cfg_bank_snap_t *p = c->page[bank];
+
+    if (p) {
+        memcpy(out->switch_name, p->switch_name, sizeof(out->switch_name));
+        memcpy(out->map, p->map, sizeof(out->map));
+        return ESP_OK;
+    }
+    return cfg_base_get(&c->rd, bank, out->switch_name, out->map, c->rec);
+}
+
+// whole legacy struct (v3/v4/v5 migration, v5 import)
+static esp_err_t cfg_src_full(void *ctx, int bank, cfg_page_t *out)
+{
+    const foot_config_t *c = (const foot_config_t *)ctx;
+    memcpy(out->switch_name, c->switch_name[bank], sizeof(out->switch_name));
+    memcpy(out->map, c->map[bank], sizeof(out->map));
+    return ESP_OK;
+}
+
+// full rewrite of the live config into a new base (save task, boot). streamed from the
+// resident pages + the old base; edits made meanwhile stay pinned for the next one
+static esp_err_t cfg_rewrite(void)
+{
+    cfg_live_src_t *c = (cfg_live_src_t *)heap_caps_malloc(sizeof(*c), MALLOC_CAP_8BIT);
+    cfg_layout_t *lay = (cfg_layout_t *)heap_caps_malloc(sizeof(*lay), MALLOC_CAP_8BIT);
+    if (!c || !lay) {
+        heap_caps_free(c);
+        heap_caps_free(lay);
+        return ESP_ERR_NO_MEM;
+    }
+
+    io_lock();
 
+    cfg_lock();
+    *lay = s_layout;
     for (int b = 0; b < MAX_BANKS; b++) {
-        char bn[NAME_LEN];
-        snprintf(bn, sizeof(bn), "Bank %d", b + 1);
-        safe_set_name(cfg->bank_name[b], bn, "Bank");
+        c->page[b] = s_snap_bank[b];
+        s_page_saving[b] = s_page_dirty[b];
+        s_page_dirty[b] = 0;
+    }
+    memset(s_jnl_btn_dirty, 0, sizeof(s_jnl_btn_dirty));    // covered by the full image
+    memset(s_jnl_name_dirty, 0, sizeof(s_jnl_name_dirty));
+    s_jnl_pending = false;
+    s_cfg_dirty = false;
+    // captured pages stay valid until release (writers only retire them)
+    __atomic_add_fetch(&s_snap_readers, 1, __ATOMIC_SEQ_CST);
+    cfg_unlock();
 
-        for (int k = 0; k < NUM_BTNS; k++) {
-            char sn[NAME_LEN];
-            snprintf(sn, sizeof(sn), "SW %d", k + 1);
-            safe_set_name(cfg->switch_name[b][k], sn, "SW");
+    // s_base only changes under s_io_mtx: safe to read without cfg_lock.
+    // on the config log only the edited banks are appended (first time: all of them)
+    esp_err_t e = ESP_ERR_NOT_FOUND;
+    if (cfg_rd_open(&c->rd, &s_base)) {
+        e = cfg_image_write(&s_base_next, lay, cfg_src_live, c, s_base.log ? s_page_saving : NULL);
+        cfg_rd_close(&c->rd);
+    }
+    config_store_snap_release();
+
+    cfg_lock();
+    bool live = (e == ESP_OK || s_base_next.ram != NULL);
+    if (live && cfg_base_install(&s_base_next) != ESP_OK) {
+        live = false;
+        e = ESP_FAIL;
+    }
+    for (int b = 0; b < MAX_BANKS; b++) {
+        // not in any base yet -> pinned again
+        if (!live && s_page_saving[b] && s_snap_bank[b]) s_page_dirty[b] = 1;
+        s_page_saving[b] = 0;
+    }
+    cfg_page_trim(-1);   // pages written into the base are evictable again
+    if (e != ESP_OK) s_cfg_dirty = true;   // live but unsaved (RAM) or failed: retry later
+    cfg_unlock();
 
-            btn_map_t *m = &cfg->map[b][k];
-            m->press_mode  = BTN_SHORT;
-            m->cc_behavior = CC_NORMAL;
+    io_unlock();
 
-            for (int i = 0; i < MAX_ACTIONS; i++) {
-                set_default_action(&m->short_actions[i]);
-                set_default_action(&m->long_actions[i]);
-            }
+    heap_caps_free(c);
+    heap_caps_free(lay);
+    cfg_snap_reclaim();
+    return e;
+}
+
+// config from `src` becomes the base and goes live (import / generator / migration):
+// pages and pending edits are dropped, the journal restarts
+static esp_err_t cfg_base_replace(const cfg_layout_t *lay, cfg_src_fn src, void *ctx)
+{
+    io_lock();
+
+    esp_err_t e = cfg_image_write(&s_base_next, lay, src, ctx, NULL);
+    if (e == ESP_OK || s_base_next.ram) {
+        cfg_lock();
+        esp_err_t ie = cfg_base_install(&s_base_next);
+        if (ie == ESP_OK) {
+            s_layout = *lay;
+            sanitize_layout(&s_layout);
+            cfg_page_drop(0);
+            s_jnl_pending = false;
+            s_cfg_dirty = (e != ESP_OK);
+            s_cur_bank = (uint8_t)wrapi((int)s_cur_bank, config_store_bank_count());
+            cfg_touch();
+            (void)cfg_page_ws();
+        } else {
+            e = ie;
         }
+        cfg_unlock();
     }
 
-    ab_led_defaults();
-    s_cur_bank = 0;
+    io_unlock();
+    cfg_snap_reclaim();
+    return e;
+}
 
-    // exp/fs defaults too
-    expfs_defaults();
+// legacy struct -> new base (one-time temp of sizeof(foot_config_t), PSRAM first)
+static foot_config_t *cfg_legacy_alloc(void)
+{
+    foot_config_t *c = (foot_config_t *)heap_caps_malloc(sizeof(*c), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!c) c = (foot_config_t *)heap_caps_malloc(sizeof(*c), MALLOC_CAP_8BIT);
+    if (!c) ESP_LOGE(TAG, "No heap for legacy config (%u bytes)", (unsigned)sizeof(*c));
+    else set_cfg_defaults(c);
+    return c;
+}
+
+static esp_err_t cfg_migrate_full(const foot_config_t *c)
+{
+    cfg_layout_t *lay = (cfg_layout_t *)heap_caps_malloc(sizeof(*lay), MALLOC_CAP_8BIT);
+    if (!lay) return ESP_ERR_NO_MEM;
+
+    lay->bank_count = c->bank_count;
+    memcpy(lay->bank_name, c->bank_name, sizeof(lay->bank_name));
+    sanitize_layout(lay);
+
+    esp_err_t e = cfg_base_replace(lay, cfg_src_full, (void *)c);
+    heap_caps_free(lay);
+    return e;
 }
 
 // ---------- NVS load/save (v4) ----------
@@ -833,118 +2430,100 @@ static esp_err_t nvs_save_v4(const foot_config_t *in)
     return e;
 }
 
-// -------------------- v5 packed config (ลดขนาด + ลดโอกาส NVS เต็ม) --------------------
-static size_t cfg_v5_packed_size(int bank_count)
+// -------------------- packed config (ลดขนาด + ลดโอกาส NVS เต็ม) --------------------
+// v5 = raw slices, v6 = compact + crc (both in cfg_pack.c). new saves are always v6
+static size_t cfg_packed_max(uint16_t ver)
 {
-    if (bank_count < 1) bank_count = 1;
-    if (bank_count > MAX_BANKS) bank_count = MAX_BANKS;
-
-    // [u8 bank_count] + bank_name + switch_name + map
-    return (size_t)1
-         + (size_t)bank_count * (size_t)NAME_LEN
-         + (size_t)bank_count * (size_t)NUM_BTNS * (size_t)NAME_LEN
-         + (size_t)bank_count * (size_t)NUM_BTNS * sizeof(btn_map_t);
+    return (ver == 5) ? cfg_v5_packed_size(MAX_BANKS) : cfg_v6_max_size(MAX_BANKS);
 }
 
-static esp_err_t cfg_v5_pack(const foot_config_t *in, uint8_t **out_buf, size_t *out_len)
+// start from sane defaults (fills unused banks too), back to defaults on a bad payload
+static esp_err_t cfg_unpack(foot_config_t *out, uint16_t ver, const uint8_t *buf, size_t len)
 {
-    if (!in || !out_buf || !out_len) return ESP_ERR_INVALID_ARG;
-
-    int bc = (int)in->bank_count;
-    if (bc < 1) bc = 1;
-    if (bc > MAX_BANKS) bc = MAX_BANKS;
-
-    size_t need = cfg_v5_packed_size(bc);
-
-    uint8_t *buf = (uint8_t *)heap_caps_malloc(need, MALLOC_CAP_8BIT);
-    if (!buf) return ESP_ERR_NO_MEM;
-
-    uint8_t *p = buf;
-    *p++ = (uint8_t)bc;
-
-    memcpy(p, in->bank_name, (size_t)bc * (size_t)NAME_LEN);
-    p += (size_t)bc * (size_t)NAME_LEN;
-
-    memcpy(p, in->switch_name, (size_t)bc * (size_t)NUM_BTNS * (size_t)NAME_LEN);
-    p += (size_t)bc * (size_t)NUM_BTNS * (size_t)NAME_LEN;
+    set_cfg_defaults(out);
 
-    memcpy(p, in->map, (size_t)bc * (size_t)NUM_BTNS * sizeof(btn_map_t));
-    p += (size_t)bc * (size_t)NUM_BTNS * sizeof(btn_map_t);
+    esp_err_t e = ESP_FAIL;
+    if (ver == CFG_VER) e = cfg_v6_unpack(out, buf, len);
+    else if (ver == 5) e = cfg_v5_unpack(out, buf, len);
 
-    *out_buf = buf;
-    *out_len = need;
-    return ESP_OK;
+    if (e != ESP_OK) set_cfg_defaults(out);
+    return e;
 }
 
-static esp_err_t cfg_v5_unpack(foot_config_t *out, const uint8_t *buf, size_t len)
+// v6 image (header + payload in RAM) as the cfg_hdr / cfg_data blob pair
+static esp_err_t nvs_save_image(const cfg_base_t *b)
 {
-    if (!out || !buf) return ESP_ERR_INVALID_ARG;
-    if (len < 1) return ESP_FAIL;
-
-    int bc = (int)buf[0];
-    if (bc < 1 || bc > MAX_BANKS) return ESP_FAIL;
-
-    size_t need = cfg_v5_packed_size(bc);
-    if (len != need) return ESP_FAIL;
-
-    // start from sane defaults (fills unused banks too)
-    set_defaults(out);
-
-    out->bank_count = (uint8_t)bc;
-
-    const uint8_t *p = buf + 1;
+    if (!b || !b->ram) return ESP_ERR_INVALID_ARG;
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
 
-    memcpy(out->bank_name, p, (size_t)bc * (size_t)NAME_LEN);
-    p += (size_t)bc * (size_t)NAME_LEN;
+    nvs_handle_t h;
+    esp_err_t e = nvs_open("footsw", NVS_READWRITE, &h);
+    if (e != ESP_OK) return e;
 
-    memcpy(out->switch_name, p, (size_t)bc * (size_t)NUM_BTNS * (size_t)NAME_LEN);
-    p += (size_t)bc * (size_t)NUM_BTNS * (size_t)NAME_LEN;
+    e = nvs_set_blob(h, "cfg_hdr", b->ram, sizeof(cfg_hdr_v4_t));
+    if (e == ESP_OK) e = nvs_set_blob(h, "cfg_data", b->ram + sizeof(cfg_hdr_v4_t), b->size - sizeof(cfg_hdr_v4_t));
+    if (e == ESP_OK) e = nvs_commit(h);
+    nvs_close(h);
 
-    memcpy(out->map, p, (size_t)bc * (size_t)NUM_BTNS * sizeof(btn_map_t));
-    return ESP_OK;
+    if (e != ESP_OK) ESP_LOGE(TAG, "nvs_save_image failed: %s", esp_err_to_name(e));
+    return e;
 }
 
-static esp_err_t nvs_save_v5_packed(const foot_config_t *in)
+// v6 blob pair -> RAM image in b (scanned: crc + record index + layout)
+static esp_err_t nvs_load_image(cfg_base_t *b, cfg_layout_t *lay, const cfg_hdr_v4_t *hdr)
 {
-    if (!in) return ESP_ERR_INVALID_ARG;
+    if (!b || !lay || !hdr) return ESP_ERR_INVALID_ARG;
     if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
 
-    uint8_t *buf = NULL;
-    size_t len = 0;
-    esp_err_t e = cfg_v5_pack(in, &buf, &len);
+    if (hdr->magic != CFG_MAGIC || hdr->ver != CFG_VER) return ESP_FAIL;
+    if (hdr->size < 1 + 4 || hdr->size > (uint32_t)cfg_v6_max_size(MAX_BANKS)) return ESP_FAIL;
+
+    nvs_handle_t h;
+    esp_err_t e = nvs_open("footsw", NVS_READONLY, &h);
     if (e != ESP_OK) return e;
 
-    cfg_hdr_v4_t hdr;
-    memset(&hdr, 0, sizeof(hdr));
-    hdr.magic = CFG_MAGIC;
-    hdr.ver   = CFG_VER;      // 5
-    hdr.size  = (uint32_t)len;
+    size_t dlen = 0;
+    e = nvs_get_blob(h, "cfg_data", NULL, &dlen);
+    if (e != ESP_OK || dlen != (size_t)hdr->size) {
+        nvs_close(h);
+        return ESP_FAIL;
+    }
 
-    nvs_handle_t h;
-    e = nvs_open("footsw", NVS_READWRITE, &h);
-    if (e != ESP_OK) {
-        heap_caps_free(buf);
-        return e;
+    size_t total = sizeof(cfg_hdr_v4_t) + dlen;
+    uint8_t *buf = (uint8_t *)heap_caps_malloc(total, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) buf = (uint8_t *)heap_caps_malloc(total, MALLOC_CAP_8BIT);
+    if (!buf) {
+        nvs_close(h);
+        return ESP_ERR_NO_MEM;
     }
 
-    e = nvs_set_blob(h, "cfg_hdr", &hdr, sizeof(hdr));
-    if (e == ESP_OK) e = nvs_set_blob(h, "cfg_data", buf, len);
-    if (e == ESP_OK) e = nvs_commit(h);
+    memcpy(buf, hdr, sizeof(cfg_hdr_v4_t));
+    e = nvs_get_blob(h, "cfg_data", buf + sizeof(cfg_hdr_v4_t), &dlen);
     nvs_close(h);
 
-    heap_caps_free(buf);
+    if (e == ESP_OK) {
+        memset(b, 0, sizeof(*b));
+        b->ram = buf;
+        b->size = (uint32_t)total;
+        e = cfg_base_scan(b, lay);
+    }
+    if (e != ESP_OK) {
+        heap_caps_free(buf);
+        memset(b, 0, sizeof(*b));
+        return e;
+    }
 
-    if (e != ESP_OK) ESP_LOGE(TAG, "nvs_save_v5_packed failed: %s", esp_err_to_name(e));
-    return e;
+    b->stored = true;
+    return ESP_OK;
 }
 
-static esp_err_t nvs_load_v5_packed(foot_config_t *out, const cfg_hdr_v4_t *hdr)
+static esp_err_t nvs_load_packed(foot_config_t *out, const cfg_hdr_v4_t *hdr)
 {
     if (!out || !hdr) return ESP_ERR_INVALID_ARG;
     if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
 
-    if (hdr->magic != CFG_MAGIC || hdr->ver != CFG_VER) return ESP_FAIL;
-    if (hdr->size < 1 || hdr->size > (uint32_t)cfg_v5_packed_size(MAX_BANKS)) return ESP_FAIL;
+    if (hdr->magic != CFG_MAGIC || (hdr->ver != CFG_VER && hdr->ver != 5)) return ESP_FAIL;
+    if (hdr->size < 1 || hdr->size > (uint32_t)cfg_packed_max(hdr->ver)) return ESP_FAIL;
 
     nvs_handle_t h;
     esp_err_t e = nvs_open("footsw", NVS_READONLY, &h);
@@ -967,7 +2546,7 @@ static esp_err_t nvs_load_v5_packed(foot_config_t *out, const cfg_hdr_v4_t *hdr)
     nvs_close(h);
 
     if (e == ESP_OK) {
-        e = cfg_v5_unpack(out, buf, dlen);
+        e = cfg_unpack(out, hdr->ver, buf, dlen);
     }
 
     heap_caps_free(buf);
@@ -991,8 +2570,8 @@ static esp_err_t nvs_load_cfg_any(foot_config_t *out)
 
     if (hdr.magic != CFG_MAGIC) return ESP_FAIL;
 
-    if (hdr.ver == CFG_VER) {
-        return nvs_load_v5_packed(out, &hdr);
+    if (hdr.ver == CFG_VER || hdr.ver == 5) {
+        return nvs_load_packed(out, &hdr);
     }
     if (hdr.ver == 4) {
         // v4 old full-size config
@@ -1002,31 +2581,60 @@ static esp_err_t nvs_load_cfg_any(foot_config_t *out)
 }
 
 
-const foot_config_t *config_store_get(void)
+uint32_t config_store_get_gen(void)
 {
-    return s_cfg;
+    return s_cfg_gen;
 }
 
-void config_store_init(void)
+uint32_t config_store_get_expfs_gen(void)
 {
-    // ✅ allocate config first (prefer PSRAM)
-    if (!s_cfg) {
-        s_cfg = (foot_config_t *)heap_caps_malloc(sizeof(foot_config_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
-        if (!s_cfg) {
-            s_cfg = (foot_config_t *)heap_caps_malloc(sizeof(foot_config_t), MALLOC_CAP_8BIT);
-        }
+    return __atomic_load_n(&s_expfs_gen, __ATOMIC_SEQ_CST);
+}
 
-        if (!s_cfg) {
-            ESP_LOGE(TAG, "No heap for config_store (%u bytes). System will run without config.",
-                     (unsigned)sizeof(foot_config_t));
-            s_led_brightness = 100;
-            ab_led_defaults();
-            s_cur_bank = 0;
-            expfs_defaults();
-            return;
-        }
+uint32_t config_store_get_bank_ver(int bank)
+{
+    if (bank < 0 || bank >= MAX_BANKS) return 0;
+    return __atomic_load_n(&s_snap_bank_ver[bank], __ATOMIC_SEQ_CST);
+}
+
+// count first, then load: a writer that sees 0 after its swap knows nobody holds the old copy
+const cfg_bank_snap_t *config_store_snap_bank(int bank)
+{
+    __atomic_add_fetch(&s_snap_readers, 1, __ATOMIC_SEQ_CST);
+    if (bank < 0 || bank >= MAX_BANKS) return NULL;
+    return __atomic_load_n(&s_snap_bank[bank], __ATOMIC_SEQ_CST);
+}
+
+const cfg_expfs_snap_t *config_store_snap_expfs(void)
+{
+    __atomic_add_fetch(&s_snap_readers, 1, __ATOMIC_SEQ_CST);
+    return __atomic_load_n(&s_snap_expfs, __ATOMIC_SEQ_CST);
+}
+
+void config_store_snap_release(void)
+{
+    __atomic_sub_fetch(&s_snap_readers, 1, __ATOMIC_SEQ_CST);
+}
+
+void config_store_init(void)
+{
+    // writer locks (readers use the published snapshots, no lock)
+    if (!s_cfg_mtx) s_cfg_mtx = xSemaphoreCreateMutex();
+    if (!s_expfs_mtx) s_expfs_mtx = xSemaphoreCreateMutex();
+    if (!s_io_mtx) s_io_mtx = xSemaphoreCreateMutex();
+    if (!s_st_mtx) {
+        s_st_mtx = xSemaphoreCreateMutex();
+        (void)esp_register_shutdown_handler(st_shutdown);
     }
 
+    // defaults (used when no stored config): no base image = every bank at defaults
+    layout_defaults(&s_layout);
+    memset(&s_base, 0, sizeof(s_base));
+    ab_led_defaults();
+    long_ms_defaults();
+    s_cur_bank = 0;
+    expfs_defaults();
+
     // ✅ NVS init แบบไม่ทำให้รีบูต
     esp_err_t e = nvs_flash_init();
     if (e == ESP_ERR_INVALID_STATE) {
@@ -1048,110 +2656,186 @@ void config_store_init(void)
         ESP_LOGE(TAG, "NVS not available: %s (run with defaults, no persistence)", esp_err_to_name(e));
     }
 
-    // defaults (used when no stored config)
-    set_defaults(s_cfg);
-
     // SPIFFS (no-format) — used for large config persistence
+    int64_t t_load = esp_timer_get_time();
     (void)cfg_mount_spiffs_noformat();
 
-    // ✅ create mutex + async save task once *any* persistence is available
-    if (s_nvs_ok || s_spiffs_ok) {
-        if (!s_cfg_mtx) s_cfg_mtx = xSemaphoreCreateMutex();
+    // config log: one scan of its partition (older partition tables: not there -> SPIFFS / NVS)
+    e = cfg_log_mount(CFG_LOG_LABEL);
+    s_log_ok = (e == ESP_OK);
+    if (!s_log_ok && e != ESP_ERR_NOT_FOUND) ESP_LOGE(TAG, "config log mount failed: %s", esp_err_to_name(e));
+
+    // ✅ create async save task once *any* persistence is available
+    if (s_nvs_ok || s_spiffs_ok || s_log_ok) {
         if (!s_cfg_save_task) {
             xTaskCreatePinnedToCore(cfg_save_task, "cfg_save", 4096, NULL, 5, &s_cfg_save_task, 0);
         }
     }
+    if (!s_page_task) {
+        xTaskCreatePinnedToCore(cfg_page_task, "cfg_page", 3072, NULL, 5, &s_page_task, 0);
+    }
 
     bool loaded_cfg = false;
 
-    // 1) prefer SPIFFS config (works even at MAX_BANKS)
-    if (s_spiffs_ok) {
-        esp_err_t fe = cfg_load_v5_packed_file(s_cfg);
+    // 0) config log: layout record only, banks are read on demand
+    if (s_log_ok) {
+        cfg_lock();
+        esp_err_t le = cfg_log_load(&s_base, &s_layout);
+        cfg_unlock();
+        if (le == ESP_OK) {
+            loaded_cfg = true;
+            ESP_LOGI(TAG, "Loaded config from log (%d banks)", s_base.bank_count);
+        } else if (le != ESP_ERR_NOT_FOUND) {
+            ESP_LOGE(TAG, "config log layout unreadable: %s", esp_err_to_name(le));
+        }
+    }
+
+    // 1) SPIFFS config (works even at MAX_BANKS): one scan, banks are read on demand
+    if (!loaded_cfg && s_spiffs_ok) {
+        bool rewrite = false;
+
+        cfg_lock();
+        esp_err_t fe = cfg_base_scan(&s_base, &s_layout);
         if (fe == ESP_OK) {
             loaded_cfg = true;
-            ESP_LOGI(TAG, "Loaded config ver=%u from SPIFFS", (unsigned)CFG_VER);
+            s_cfg_epoch = s_base.epoch;
+            s_jnl_ok = true;
+            ESP_LOGI(TAG, "Loaded config ver=%u from SPIFFS (%d banks, %u bytes)",
+                     (unsigned)CFG_VER, s_base.bank_count, (unsigned)s_base.size);
+
+            // per-button edits saved since the last full rewrite (pin their pages)
+            rewrite = !cfg_jnl_replay(NULL, CFG_JNL_PATH, CFG_JNL_VER) ||
+                      cfg_page_pinned_count() > CFG_PAGE_PIN_MAX;
+        } else {
+            layout_defaults(&s_layout);
+        }
+        cfg_unlock();
+
+        if (rewrite) (void)cfg_rewrite();
+
+        if (!loaded_cfg) {
+            // one-time v5 -> v6: base + its journal, rewrite, drop the v5 files
+            foot_config_t *tmp = cfg_legacy_alloc();
+            if (tmp && cfg_load_packed_file(tmp, CFG_V5_FILE_PATH) == ESP_OK) {
+                loaded_cfg = true;
+                (void)cfg_jnl_replay(tmp, CFG_V5_JNL_PATH, CFG_JNL_VER_V5);
+                s_jnl_size = 0;
+                if (cfg_migrate_full(tmp) == ESP_OK) {
+                    unlink(CFG_V5_FILE_PATH);
+                    unlink(CFG_V5_JNL_PATH);
+                    ESP_LOGW(TAG, "Migrated config v5 -> v6 (SPIFFS)");
+                }
+            }
+            heap_caps_free(tmp);
         }
     }
 
     // 2) fallback to NVS (legacy) and then cache to SPIFFS
     if (!loaded_cfg && s_nvs_ok) {
-        // peek saved ver (for one-time migrate v4->v5)
-        uint16_t saved_ver = 0;
+        // peek saved ver (v6 loads as is, v3/v4/v5 migrate once)
+        cfg_hdr_v4_t hdr;
+        memset(&hdr, 0, sizeof(hdr));
         {
             nvs_handle_t th;
             if (nvs_open("footsw", NVS_READONLY, &th) == ESP_OK) {
                 size_t hlen = sizeof(cfg_hdr_v4_t);
-                cfg_hdr_v4_t hdr;
-                if (nvs_get_blob(th, "cfg_hdr", &hdr, &hlen) == ESP_OK && hlen == sizeof(cfg_hdr_v4_t)) {
-                    if (hdr.magic == CFG_MAGIC) saved_ver = hdr.ver;
+                if (nvs_get_blob(th, "cfg_hdr", &hdr, &hlen) != ESP_OK || hlen != sizeof(cfg_hdr_v4_t)) {
+                    memset(&hdr, 0, sizeof(hdr));
                 }
                 nvs_close(th);
             }
         }
+        uint16_t saved_ver = (hdr.magic == CFG_MAGIC) ? hdr.ver : 0;
+
+        if (saved_ver == CFG_VER) {
+            cfg_lock();
+            e = nvs_load_image(&s_base, &s_layout, &hdr);
+            if (e == ESP_OK) s_cfg_epoch = s_base.epoch;
+            else layout_defaults(&s_layout);
+            cfg_unlock();
 
-        e = nvs_load_cfg_any(s_cfg);
-        if (e == ESP_OK) {
-            loaded_cfg = true;
-            ESP_LOGI(TAG, "Loaded config ver=%u from NVS", (unsigned)saved_ver);
-            if (saved_ver == 4) {
-                ESP_LOGW(TAG, "Migrating config v4 -> v5 packed");
-                (void)nvs_save_v5_packed(s_cfg);
-            }
-        } else {
-            // migrate v3 -> v5 (ผ่าน struct เดิม)
-            e = nvs_load_migrate_v3_to_v4(s_cfg);
             if (e == ESP_OK) {
                 loaded_cfg = true;
-                ESP_LOGW(TAG, "Migrated legacy v3 -> v5 packed (page removed, keep page0)");
-                (void)nvs_save_v5_packed(s_cfg);
-            }
-        }
+                ESP_LOGI(TAG, "Loaded config ver=%u from NVS", (unsigned)saved_ver);
 
-        if (!loaded_cfg) {
-            ESP_LOGW(TAG, "No saved config, using defaults");
-            (void)nvs_save_v5_packed(s_cfg);
+                // cache to SPIFFS for future (so MAX_BANKS saves work)
+                if (s_spiffs_ok) (void)cfg_rewrite();
+            }
+        } else {
+            foot_config_t *tmp = cfg_legacy_alloc();
+            if (tmp) {
+                e = nvs_load_cfg_any(tmp);
+                if (e == ESP_OK) {
+                    loaded_cfg = true;
+                    ESP_LOGW(TAG, "Migrating config v%u -> v6 packed", (unsigned)saved_ver);
+                } else if (nvs_load_migrate_v3_to_v4(tmp) == ESP_OK) {
+                    // migrate v3 -> v6 (ผ่าน struct เดิม)
+                    loaded_cfg = true;
+                    ESP_LOGW(TAG, "Migrated legacy v3 -> v6 packed (page removed, keep page0)");
+                }
+                if (loaded_cfg) (void)cfg_migrate_full(tmp);
+                heap_caps_free(tmp);
+            }
         }
+    }
 
-        // cache to SPIFFS for future (so MAX_BANKS saves work)
-        if (s_spiffs_ok) (void)cfg_save_v5_packed_file(s_cfg);
+    if (!loaded_cfg && (s_nvs_ok || s_spiffs_ok || s_log_ok)) {
+        ESP_LOGW(TAG, "No saved config, using defaults");
+        (void)cfg_rewrite();
     }
 
-    sanitize_cfg(s_cfg);
+    // first boot with the config log: the SPIFFS / NVS config moves over once
+    if (s_log_ok && !s_base.log && cfg_rewrite() == ESP_OK) ESP_LOGW(TAG, "Moved config into the config log");
 
-    if (s_nvs_ok) {
+    if (s_nvs_ok || s_log_ok) {
         // led brightness
         uint8_t bri = 100;
-        e = nvs_load_led_brightness(&bri);
+        e = st_load_led_brightness(&bri);
         if (e == ESP_OK) {
             s_led_brightness = bri;
             ESP_LOGI(TAG, "Loaded led brightness=%u", (unsigned)s_led_brightness);
         } else {
             s_led_brightness = 100;
-            (void)nvs_save_led_brightness(s_led_brightness);
+            st_mark(CFG_ST_BRIGHTNESS);
             ESP_LOGW(TAG, "No led brightness saved, default=100");
         }
 
         // ab led sel
         ab_led_defaults();
-        e = nvs_load_ab_led_sel();
+        e = st_load_ab_led_sel();
         if (e == ESP_OK) {
             ESP_LOGI(TAG, "Loaded ab led sel (blob)");
         } else {
             ab_led_defaults();
-            (void)nvs_save_ab_led_sel();
+            st_mark(CFG_ST_AB_LED);
             ESP_LOGW(TAG, "No ab led sel saved, default=B");
         }
 
+        // long-press threshold
+        long_ms_defaults();
+        e = st_load_long_ms();
+        if (e == ESP_OK) {
+            ESP_LOGI(TAG, "Loaded long-press ms (blob)");
+        } else {
+            long_ms_defaults();
+            ESP_LOGW(TAG, "No long-press ms saved, default=%d", LONG_MS_DEFAULT);
+        }
+
+        // chord window
+        uint8_t cms = CHORD_MS_DEFAULT;
+        e = st_load_chord_ms(&cms);
+        s_chord_ms = (e == ESP_OK) ? cms : (uint8_t)CHORD_MS_DEFAULT;
+
         // current bank
         uint8_t cb = 0;
-        e = nvs_load_cur_bank(&cb);
+        e = st_load_cur_bank(&cb);
         if (e == ESP_OK) {
             int bc = config_store_bank_count();
             s_cur_bank = (uint8_t)wrapi((int)cb, bc);
             ESP_LOGI(TAG, "Loaded cur_bank=%u", (unsigned)s_cur_bank);
         } else {
             s_cur_bank = 0;
-            (void)nvs_save_cur_bank(s_cur_bank);
+            st_mark(CFG_ST_CUR_BANK);
             ESP_LOGW(TAG, "No cur_bank saved, default=0");
         }
 
@@ -1162,46 +2846,54 @@ void config_store_init(void)
             ESP_LOGI(TAG, "Loaded exp/fs (blob)");
         } else {
             expfs_defaults();
-            (void)nvs_save_expfs();
+            st_mark(CFG_ST_EXPFS);
             ESP_LOGW(TAG, "No exp/fs saved, default=single sw");
         }
 
     } else {
         s_led_brightness = 100;
         ab_led_defaults();
+        long_ms_defaults();
         s_cur_bank = 0;
         expfs_defaults();
-        sanitize_cfg(s_cfg);
         expfs_sanitize_all();
     }
+
+    // first pages: working set of the loaded bank (ab led / long-press are part of them)
+    cfg_lock();
+    for (int b = 0; b < MAX_BANKS; b++) cfg_page_refresh(b);
+    (void)cfg_page_ws();
+    cfg_unlock();
+    cfg_snap_reclaim();
+
+    ESP_LOGI(TAG, "config + settings loaded in %u us (%s)", (unsigned)(esp_timer_get_time() - t_load),
+             s_base.log ? "config log" : s_base.ram ? "NVS" : "SPIFFS + NVS");
 }
 
 // ---- helpers ----
 int config_store_bank_count(void)
 {
-    if (!s_cfg) return 1;
-    return (int)clampi((int)s_cfg->bank_count, 1, MAX_BANKS);
+    return (int)clampi((int)s_layout.bank_count, 1, MAX_BANKS);
 }
 
 const char *config_store_bank_name(int bank)
 {
-    if (!s_cfg) return "Bank";
     int bc = config_store_bank_count();
     bank = wrapi(bank, bc);
-    return s_cfg->bank_name[bank];
+    return s_layout.bank_name[bank];
 }
 
 // ---- layout json (banks only) ----
 esp_err_t config_store_get_layout_json(char *out, int out_len)
 {
     if (!out || out_len <= 0) return ESP_ERR_INVALID_ARG;
-    if (!s_cfg) return ESP_FAIL;
 
     cJSON *root = cJSON_CreateObject();
     cJSON_AddNumberToObject(root, "maxBanks", MAX_BANKS);
 
     int bc = config_store_bank_count();
     cJSON_AddNumberToObject(root, "bankCount", bc);
+    cJSON_AddNumberToObject(root, "chordMs", s_chord_ms);
 
     cJSON *banks = cJSON_CreateArray();
     cJSON_AddItemToObject(root, "banks", banks);
@@ -1209,7 +2901,7 @@ esp_err_t config_store_get_layout_json(char *out, int out_len)
     for (int b = 0; b < bc; b++) {
         cJSON *bo = cJSON_CreateObject();
         cJSON_AddNumberToObject(bo, "index", b);
-        cJSON_AddStringToObject(bo, "name", s_cfg->bank_name[b]);
+        cJSON_AddStringToObject(bo, "name", s_layout.bank_name[b]);
         cJSON_AddItemToArray(banks, bo);
     }
 
@@ -1231,7 +2923,6 @@ esp_err_t config_store_get_layout_json(char *out, int out_len)
 esp_err_t config_store_set_layout_json(const char *json)
 {
     if (!json) return ESP_ERR_INVALID_ARG;
-    if (!s_cfg) return ESP_FAIL;
 
     cJSON *root = cJSON_Parse(json);
     if (!root) return ESP_FAIL;
@@ -1245,9 +2936,13 @@ esp_err_t config_store_set_layout_json(const char *json)
 
     int bc = clampi(jbc->valueint, 1, MAX_BANKS);
 
+    // optional (older UI does not send it)
+    cJSON *jcm = cJSON_GetObjectItem(root, "chordMs");
+    int new_chord_ms = cJSON_IsNumber(jcm) ? (int)chord_ms_sanitize(jcm->valueint) : -1;
+
     uint8_t new_bank_count = (uint8_t)bc;
     char new_bank_name[MAX_BANKS][NAME_LEN];
-    memcpy(new_bank_name, s_cfg->bank_name, sizeof(new_bank_name));
+    memcpy(new_bank_name, s_layout.bank_name, sizeof(new_bank_name));
 
     for (int b = 0; b < bc; b++) {
         cJSON *bo = cJSON_GetArrayItem(jbanks, b);
@@ -1264,19 +2959,26 @@ esp_err_t config_store_set_layout_json(const char *json)
 
     cfg_lock();
 
-    s_cfg->bank_count = new_bank_count;
-    memcpy(s_cfg->bank_name, new_bank_name, sizeof(new_bank_name));
+    s_layout.bank_count = new_bank_count;
+    memcpy(s_layout.bank_name, new_bank_name, sizeof(new_bank_name));
 
-    sanitize_cfg(s_cfg);
+    sanitize_layout(&s_layout);
 
     // clamp current bank if bankCount reduced
     int cur = (int)s_cur_bank;
     int bc2 = config_store_bank_count();
     s_cur_bank = (uint8_t)wrapi(cur, bc2);
 
+    // banks past the new count leave RAM (edits included), the rest get their new name
+    cfg_page_drop(bc2);
+    for (int b = 0; b < bc2; b++) cfg_page_refresh(b);
+
+    cfg_touch();
     cfg_unlock();
 
-    if (s_nvs_ok) (void)nvs_save_cur_bank(s_cur_bank);
+    cfg_request_pages();
+    st_mark(CFG_ST_CUR_BANK);
+    if (new_chord_ms >= 0 && (uint8_t)new_chord_ms != s_chord_ms) (void)config_store_set_chord_ms((uint8_t)new_chord_ms);
 
     // ✅ async save + refresh display slave
     cfg_request_save();
@@ -1289,17 +2991,23 @@ esp_err_t config_store_set_layout_json(const char *json)
 esp_err_t config_store_get_bank_json(int bank, char *out, int out_len)
 {
     if (!out || out_len <= 0) return ESP_ERR_INVALID_ARG;
-    if (!s_cfg) return ESP_FAIL;
 
     int bc = config_store_bank_count();
     bank = wrapi(bank, bc);
 
+    char names[NUM_BTNS][NAME_LEN];
+    cfg_lock();
+    const cfg_bank_snap_t *p = cfg_page_get(bank);
+    if (p) memcpy(names, p->switch_name, sizeof(names));
+    cfg_unlock();
+    if (!p) return ESP_FAIL;
+
     cJSON *root = cJSON_CreateObject();
     cJSON *arr = cJSON_CreateArray();
     cJSON_AddItemToObject(root, "switchNames", arr);
 
     for (int k = 0; k < NUM_BTNS; k++) {
-        cJSON_AddItemToArray(arr, cJSON_CreateString(s_cfg->switch_name[bank][k]));
+        cJSON_AddItemToArray(arr, cJSON_CreateString(names[k]));
     }
 
     char *s = cJSON_PrintUnformatted(root);
@@ -1320,7 +3028,6 @@ esp_err_t config_store_get_bank_json(int bank, char *out, int out_len)
 esp_err_t config_store_set_bank_json(int bank, const char *json)
 {
     if (!json) return ESP_ERR_INVALID_ARG;
-    if (!s_cfg) return ESP_FAIL;
 
     int bc = config_store_bank_count();
     bank = wrapi(bank, bc);
@@ -1339,20 +3046,30 @@ esp_err_t config_store_set_bank_json(int bank, const char *json)
 
     cfg_lock();
 
+    cfg_bank_snap_t *pg = cfg_page_edit(bank);
+    if (!pg) {
+        cfg_unlock();
+        cJSON_Delete(root);
+        return ESP_ERR_NO_MEM;
+    }
+
     for (int k = 0; k < n; k++) {
         cJSON *s = cJSON_GetArrayItem(arr, k);
         if (cJSON_IsString(s)) {
-            safe_set_name(s_cfg->switch_name[bank][k], s->valuestring, s_cfg->switch_name[bank][k]);
+            safe_set_name(pg->switch_name[k], s->valuestring, pg->switch_name[k]);
         }
-        s_cfg->switch_name[bank][k][NAME_LEN - 1] = 0;
+        pg->switch_name[k][NAME_LEN - 1] = 0;
     }
 
     cJSON_Delete(root);
 
-    sanitize_cfg(s_cfg);
+    sanitize_page(pg->switch_name, pg->map);
+    cfg_page_commit(pg, true);
+    cfg_mark_names(bank);
+    cfg_touch();
     cfg_unlock();
 
-    cfg_request_save();
+    cfg_request_save_delta();
     display_uart_request_refresh();
 
     return ESP_OK;
@@ -1420,18 +3137,25 @@ static void action_to_json(cJSON *arr, const action_t *a)
 esp_err_t config_store_get_btn_json(int bank, int btn, char *out, int out_len)
 {
     if (!out || out_len <= 0) return ESP_ERR_INVALID_ARG;
-    if (!s_cfg) return ESP_FAIL;
 
     int bc = config_store_bank_count();
     bank = wrapi(bank, bc);
     btn  = wrapi(btn,  NUM_BTNS);
 
-    const btn_map_t *m = &s_cfg->map[bank][btn];
+    btn_map_t mm;
+    cfg_lock();
+    const cfg_bank_snap_t *p = cfg_page_get(bank);
+    if (p) mm = p->map[btn];
+    cfg_unlock();
+    if (!p) return ESP_FAIL;
+
+    const btn_map_t *m = &mm;
 
     cJSON *root = cJSON_CreateObject();
     cJSON_AddNumberToObject(root, "pressMode",  (int)m->press_mode);
     cJSON_AddNumberToObject(root, "ccBehavior", (int)m->cc_behavior);
     cJSON_AddNumberToObject(root, "abLed", (int)(s_ab_led_sel[bank][btn] ? 1 : 0));
+    cJSON_AddNumberToObject(root, "longMs", (int)s_long_ms[bank][btn]);
 
     cJSON *sa = cJSON_CreateArray();
     cJSON *la = cJSON_CreateArray();
@@ -1459,7 +3183,6 @@ esp_err_t config_store_get_btn_json(int bank, int btn, char *out, int out_len)
 esp_err_t config_store_set_btn_json(int bank, int btn, const char *json)
 {
     if (!json) return ESP_ERR_INVALID_ARG;
-    if (!s_cfg) return ESP_FAIL;
 
     int bc = config_store_bank_count();
     bank = wrapi(bank, bc);
@@ -1473,39 +3196,35 @@ esp_err_t config_store_set_btn_json(int bank, int btn, const char *json)
     cJSON *sa = cJSON_GetObjectItem(root, "short");
     cJSON *la = cJSON_GetObjectItem(root, "long");
     cJSON *ab = cJSON_GetObjectItem(root, "abLed");
+    cJSON *lm = cJSON_GetObjectItem(root, "longMs"); // optional
 
     if (!cJSON_IsNumber(pm) || !cJSON_IsNumber(cb) || !cJSON_IsArray(sa) || !cJSON_IsArray(la)) {
         cJSON_Delete(root);
         return ESP_FAIL;
     }
 
-    cfg_lock();
-
-    btn_map_t *m = &s_cfg->map[bank][btn];
+    // parse everything first: a bad request leaves the bank untouched
+    btn_map_t m;
+    memset(&m, 0, sizeof(m));
 
     int pressMode = clampi(pm->valueint, 0, 3);
     int ccBeh     = clampi(cb->valueint, 0, 2);
-    m->press_mode  = (btn_press_mode_t)pressMode;
-    m->cc_behavior = (cc_behavior_t)ccBeh;
+    m.press_mode  = (btn_press_mode_t)pressMode;
+    m.cc_behavior = (cc_behavior_t)ccBeh;
 
-    if (cJSON_IsNumber(ab)) {
-        int sel = clampi(ab->valueint, 0, 1);
-        s_ab_led_sel[bank][btn] = (uint8_t)sel;
-    } else {
-        s_ab_led_sel[bank][btn] = (s_ab_led_sel[bank][btn] ? 1u : 0u);
-    }
+    int sel = cJSON_IsNumber(ab) ? clampi(ab->valueint, 0, 1) : -1;
+    int lms = cJSON_IsNumber(lm) ? clampi(lm->valueint, LONG_MS_MIN, LONG_MS_MAX) : -1;
 
     for (int i = 0; i < MAX_ACTIONS; i++) {
-        set_default_action(&m->short_actions[i]);
-        set_default_action(&m->long_actions[i]);
+        set_default_action(&m.short_actions[i]);
+        set_default_action(&m.long_actions[i]);
     }
 
     int ns = cJSON_GetArraySize(sa);
     if (ns > MAX_ACTIONS) ns = MAX_ACTIONS;
     for (int i = 0; i < ns; i++) {
-        if (!parse_action(cJSON_GetArrayItem(sa, i), &m->short_actions[i])) {
+        if (!parse_action(cJSON_GetArrayItem(sa, i), &m.short_actions[i])) {
             cJSON_Delete(root);
-            cfg_unlock();
             return ESP_FAIL;
         }
     }
@@ -1513,22 +3232,42 @@ esp_err_t config_store_set_btn_json(int bank, int btn, const char *json)
     int nl = cJSON_GetArraySize(la);
     if (nl > MAX_ACTIONS) nl = MAX_ACTIONS;
     for (int i = 0; i < nl; i++) {
-        if (!parse_action(cJSON_GetArrayItem(la, i), &m->long_actions[i])) {
+        if (!parse_action(cJSON_GetArrayItem(la, i), &m.long_actions[i])) {
             cJSON_Delete(root);
-            cfg_unlock();
             return ESP_FAIL;
         }
     }
 
     cJSON_Delete(root);
+    sanitize_map(&m);
+
+    cfg_lock();
+
+    cfg_bank_snap_t *pg = cfg_page_edit(bank);
+    if (!pg) {
+        cfg_unlock();
+        return ESP_ERR_NO_MEM;
+    }
+    pg->map[btn] = m;
+
+    uint8_t ab_old = s_ab_led_sel[bank][btn];
+    if (sel >= 0) s_ab_led_sel[bank][btn] = (uint8_t)sel;
+    else s_ab_led_sel[bank][btn] = (s_ab_led_sel[bank][btn] ? 1u : 0u);
+    bool ab_changed = (s_ab_led_sel[bank][btn] != ab_old);
 
-    sanitize_cfg(s_cfg);
+    bool long_changed = (lms >= 0 && (uint16_t)lms != s_long_ms[bank][btn]);
+    if (lms >= 0) s_long_ms[bank][btn] = (uint16_t)lms;
+
+    cfg_page_commit(pg, true);   // picks up ab led / long-press as well
+    cfg_mark_btn(bank, btn);
+    cfg_touch();
     cfg_unlock();
 
-    // ✅ async save (ลดอาการเว็บค้างตอนเซฟ)
-    cfg_request_save();
+    // ✅ async save (ลดอาการเว็บค้างตอนเซฟ) -> journal record, not a full rewrite
+    cfg_request_save_delta();
 
-    if (s_nvs_ok) (void)nvs_save_ab_led_sel();
+    if (ab_changed) st_mark(CFG_ST_AB_LED);
+    if (long_changed) st_mark(CFG_ST_LONG_MS);
     return ESP_OK;
 }
 
@@ -1542,12 +3281,24 @@ esp_err_t config_store_set_led_brightness(uint8_t percent)
 {
     if (percent > 100) percent = 100;
     s_led_brightness = percent;
-    esp_err_t err = nvs_save_led_brightness(s_led_brightness);
-    if (err == ESP_OK) {
-        // keep RGB PWM LED brightness in sync
-        rgb_store_apply();
-    }
-    return err;
+    st_mark(CFG_ST_BRIGHTNESS);
+
+    // keep RGB PWM LED brightness in sync
+    rgb_store_apply();
+    return ESP_OK;
+}
+
+// ---- chord window public API ----
+uint8_t config_store_get_chord_ms(void)
+{
+    return s_chord_ms;
+}
+
+esp_err_t config_store_set_chord_ms(uint8_t ms)
+{
+    s_chord_ms = chord_ms_sanitize(ms);
+    st_mark(CFG_ST_CHORD_MS);
+    return ESP_OK;
 }
 
 // ---- a+b led selection public API ----
@@ -1567,8 +3318,24 @@ esp_err_t config_store_set_ab_led_sel(int bank, int btn, uint8_t sel)
     btn  = wrapi(btn, NUM_BTNS);
 
     sel = (sel ? 1u : 0u);
+    cfg_lock();
     s_ab_led_sel[bank][btn] = sel;
-    return nvs_save_ab_led_sel();
+    cfg_page_refresh(bank);
+    cfg_unlock();
+
+    if (!s_nvs_ok && !s_log_ok) return ESP_ERR_INVALID_STATE;
+    st_mark(CFG_ST_AB_LED);
+    return ESP_OK;
+}
+
+// ---- long-press threshold public API ----
+uint16_t config_store_get_long_ms(int bank, int btn)
+{
+    int bc = config_store_bank_count();
+    bank = wrapi(bank, bc);
+    btn  = wrapi(btn, NUM_BTNS);
+
+    return s_long_ms[bank][btn];
 }
 
 // ---- current bank persistence public API ----
@@ -1581,13 +3348,21 @@ uint8_t config_store_get_current_bank(void)
 esp_err_t config_store_set_current_bank(uint8_t bank)
 {
     int bc = config_store_bank_count();
-    s_cur_bank = (uint8_t)wrapi((int)bank, bc);
+    uint8_t nb = (uint8_t)wrapi((int)bank, bc);
+    bool changed = (nb != s_cur_bank);
+    s_cur_bank = nb;
+
+    // working set of the new bank is paged in off this task
+    cfg_request_pages();
 
     // ✅ notify display slave every time bank changes
     display_uart_request_refresh();
 
-    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
-    return nvs_save_cur_bank(s_cur_bank);
+    // write-behind: a bank change never waits for flash.
+    // same bank (footswitch_init at boot) -> nothing to persist, boot stays read-only
+    if (!s_nvs_ok && !s_log_ok) return ESP_ERR_INVALID_STATE;
+    if (changed) st_mark(CFG_ST_CUR_BANK);
+    return ESP_OK;
 }
 
 // -------------------- exp/fs JSON API --------------------
@@ -1614,10 +3389,45 @@ static expfs_kind_t str_to_kind(const char *s)
     return EXPFS_KIND_SINGLE_SW;
 }
 
-static void btncfg_to_json(cJSON *root, const expfs_btncfg_t *m)
+static const char *res_to_str(uint8_t r)
+{
+    if (r == EXP_RES_14BIT) return "14bit";
+    if (r == EXP_RES_NRPN) return "nrpn";
+    return "7bit";
+}
+
+static uint8_t str_to_res(const char *s)
+{
+    if (!s) return EXP_RES_7BIT;
+    if (strcmp(s, "14bit") == 0) return EXP_RES_14BIT;
+    if (strcmp(s, "nrpn") == 0) return EXP_RES_NRPN;
+    return EXP_RES_7BIT;
+}
+
+static const char *curve_to_str(uint8_t c)
+{
+    if (c == EXP_CURVE_LOG) return "log";
+    if (c == EXP_CURVE_ANTILOG) return "antilog";
+    if (c == EXP_CURVE_S) return "s";
+    if (c == EXP_CURVE_CUSTOM) return "custom";
+    return "linear";
+}
+
+static uint8_t str_to_curve(const char *s)
+{
+    if (!s) return EXP_CURVE_LINEAR;
+    if (strcmp(s, "log") == 0) return EXP_CURVE_LOG;
+    if (strcmp(s, "antilog") == 0) return EXP_CURVE_ANTILOG;
+    if (strcmp(s, "s") == 0) return EXP_CURVE_S;
+    if (strcmp(s, "custom") == 0) return EXP_CURVE_CUSTOM;
+    return EXP_CURVE_LINEAR;
+}
+
+static void btncfg_to_json(cJSON *root, const expfs_btncfg_t *m, uint16_t long_ms)
 {
     cJSON_AddNumberToObject(root, "pressMode", (int)m->press_mode);
     cJSON_AddNumberToObject(root, "ccBehavior", (int)m->cc_behavior);
+    cJSON_AddNumberToObject(root, "longMs", (int)long_ms);
 
     cJSON *sa = cJSON_CreateArray();
     cJSON *la = cJSON_CreateArray();
@@ -1628,7 +3438,7 @@ static void btncfg_to_json(cJSON *root, const expfs_btncfg_t *m)
     for (int i = 0; i < MAX_ACTIONS; i++) action_to_json(la, &m->long_actions[i]);
 }
 
-static bool json_to_btncfg(cJSON *root, expfs_btncfg_t *m)
+static bool json_to_btncfg(cJSON *root, expfs_btncfg_t *m, uint16_t *long_ms)
 {
     if (!cJSON_IsObject(root) || !m) return false;
 
@@ -1636,9 +3446,14 @@ static bool json_to_btncfg(cJSON *root, expfs_btncfg_t *m)
     cJSON *cb = cJSON_GetObjectItem(root, "ccBehavior");
     cJSON *sa = cJSON_GetObjectItem(root, "short");
     cJSON *la = cJSON_GetObjectItem(root, "long");
+    cJSON *lm = cJSON_GetObjectItem(root, "longMs"); // optional
 
     if (!cJSON_IsNumber(pm) || !cJSON_IsNumber(cb) || !cJSON_IsArray(sa) || !cJSON_IsArray(la)) return false;
 
+    if (long_ms && cJSON_IsNumber(lm)) {
+        *long_ms = (uint16_t)clampi(lm->valueint, LONG_MS_MIN, LONG_MS_MAX);
+    }
+
     int pressMode = clampi(pm->valueint, 0, 2);
     int ccBeh     = clampi(cb->valueint, 0, 2);
 
@@ -1675,8 +3490,10 @@ esp_err_t config_store_get_expfs_json(int port, char *out, int out_len)
 
     cJSON *root = cJSON_CreateObject();
     cJSON_AddStringToObject(root, "kind", kind_to_str(p->kind));
+    cJSON_AddBoolToObject(root, "autoKind", p->kind_auto ? 1 : 0);
     cJSON_AddNumberToObject(root, "calMin", (int)p->cal_min);
     cJSON_AddNumberToObject(root, "calMax", (int)p->cal_max);
+    cJSON_AddBoolToObject(root, "calAuto", p->cal_auto ? 1 : 0);
 
     // exp
     cJSON *exp = cJSON_CreateObject();
@@ -1684,6 +3501,32 @@ esp_err_t config_store_get_expfs_json(int port, char *out, int out_len)
     cJSON *expArr = cJSON_CreateArray();
     cJSON_AddItemToObject(exp, "cmd", expArr);
     action_to_json(expArr, &p->exp_action);
+    cJSON_AddStringToObject(exp, "res", res_to_str(p->exp_res));
+    cJSON_AddNumberToObject(exp, "nrpn", (int)p->nrpn);
+    cJSON_AddNumberToObject(exp, "fltMinCut", (int)p->flt_min_cut);
+    cJSON_AddNumberToObject(exp, "fltBeta", (int)p->flt_beta);
+    cJSON_AddStringToObject(exp, "curve", curve_to_str(p->curve));
+    cJSON *pts = cJSON_CreateArray();
+    cJSON_AddItemToObject(exp, "curvePts", pts);
+    for (int i = 0; i < p->curve_n; i++) {
+        cJSON *pt = cJSON_CreateArray();
+        cJSON_AddItemToArray(pt, cJSON_CreateNumber(p->curve_pts[i][0]));
+        cJSON_AddItemToArray(pt, cJSON_CreateNumber(p->curve_pts[i][1]));
+        cJSON_AddItemToArray(pts, pt);
+    }
+
+    cJSON *tgts = cJSON_CreateArray();
+    cJSON_AddItemToObject(exp, "targets", tgts);
+    for (int k = 0; k < p->exp_extra_n; k++) {
+        const exp_target_t *t = &p->exp_extra[k];
+        cJSON *jt = cJSON_CreateObject();
+        cJSON_AddNumberToObject(jt, "ch", t->ch);
+        cJSON_AddNumberToObject(jt, "cc", t->cc);
+        cJSON_AddNumberToObject(jt, "v1", t->v1);
+        cJSON_AddNumberToObject(jt, "v2", t->v2);
+        cJSON_AddStringToObject(jt, "curve", curve_to_str(t->curve));
+        cJSON_AddItemToArray(tgts, jt);
+    }
 
     // tip/ring
     cJSON *tip = cJSON_CreateObject();
@@ -1691,8 +3534,8 @@ esp_err_t config_store_get_expfs_json(int port, char *out, int out_len)
     cJSON_AddItemToObject(root, "tip", tip);
     cJSON_AddItemToObject(root, "ring", ring);
 
-    btncfg_to_json(tip, &p->tip);
-    btncfg_to_json(ring, &p->ring);
+    btncfg_to_json(tip, &p->tip, p->long_ms[0]);
+    btncfg_to_json(ring, &p->ring, p->long_ms[1]);
 
     char *s = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
@@ -1721,6 +3564,26 @@ esp_err_t config_store_set_expfs_json(int port, const char *json)
     expfs_set_defaults_one(&tmp);
     tmp.kind = str_to_kind(jk->valuestring);
 
+    // keep current thresholds unless the request sets them
+    tmp.long_ms[0] = s_expfs[port].long_ms[0];
+    tmp.long_ms[1] = s_expfs[port].long_ms[1];
+    tmp.exp_res = s_expfs[port].exp_res;
+    tmp.nrpn = s_expfs[port].nrpn;
+    tmp.flt_min_cut = s_expfs[port].flt_min_cut;
+    tmp.flt_beta = s_expfs[port].flt_beta;
+    tmp.curve = s_expfs[port].curve;
+    tmp.curve_n = s_expfs[port].curve_n;
+    memcpy(tmp.curve_pts, s_expfs[port].curve_pts, sizeof(tmp.curve_pts));
+    tmp.exp_extra_n = s_expfs[port].exp_extra_n;
+    memcpy(tmp.exp_extra, s_expfs[port].exp_extra, sizeof(tmp.exp_extra));
+    tmp.kind_auto = s_expfs[port].kind_auto;
+    tmp.cal_auto = s_expfs[port].cal_auto;
+
+    cJSON *jauto = cJSON_GetObjectItem(root, "autoKind");
+    if (cJSON_IsBool(jauto)) tmp.kind_auto = cJSON_IsTrue(jauto) ? 1 : 0;
+    cJSON *jcauto = cJSON_GetObjectItem(root, "calAuto");
+    if (cJSON_IsBool(jcauto)) tmp.cal_auto = cJSON_IsTrue(jcauto) ? 1 : 0;
+
     // calibration
     cJSON *jmin = cJSON_GetObjectItem(root, "calMin");
     cJSON *jmax = cJSON_GetObjectItem(root, "calMax");
@@ -1746,6 +3609,64 @@ esp_err_t config_store_set_expfs_json(int port, const char *json)
                 }
             }
         }
+
+        // optional: output resolution (older UI does not send these)
+        cJSON *jres = cJSON_GetObjectItem(jexp, "res");
+        cJSON *jnrpn = cJSON_GetObjectItem(jexp, "nrpn");
+        if (cJSON_IsString(jres)) tmp.exp_res = str_to_res(jres->valuestring);
+        if (cJSON_IsNumber(jnrpn)) tmp.nrpn = (uint16_t)clampi(jnrpn->valueint, 0, 16383);
+
+        cJSON *jfc = cJSON_GetObjectItem(jexp, "fltMinCut");
+        cJSON *jfb = cJSON_GetObjectItem(jexp, "fltBeta");
+        if (cJSON_IsNumber(jfc)) tmp.flt_min_cut = (uint16_t)clampi(jfc->valueint, EXP_FLT_MIN_CUT_MIN, EXP_FLT_MIN_CUT_MAX);
+        if (cJSON_IsNumber(jfb)) tmp.flt_beta = (uint16_t)clampi(jfb->valueint, 0, EXP_FLT_BETA_MAX);
+
+        // curve: preset name + optional [[x%,y%],...] breakpoints (custom)
+        cJSON *jcv = cJSON_GetObjectItem(jexp, "curve");
+        cJSON *jpts = cJSON_GetObjectItem(jexp, "curvePts");
+        if (cJSON_IsString(jcv)) tmp.curve = str_to_curve(jcv->valuestring);
+        if (cJSON_IsArray(jpts)) {
+            int n = 0;
+            memset(tmp.curve_pts, 0, sizeof(tmp.curve_pts));
+            int cnt = cJSON_GetArraySize(jpts);
+            for (int i = 0; i < cnt && n < EXP_CURVE_MAX_PTS; i++) {
+                cJSON *pt = cJSON_GetArrayItem(jpts, i);
+                if (!cJSON_IsArray(pt) || cJSON_GetArraySize(pt) < 2) continue;
+                cJSON *jx = cJSON_GetArrayItem(pt, 0);
+                cJSON *jy = cJSON_GetArrayItem(pt, 1);
+                if (!cJSON_IsNumber(jx) || !cJSON_IsNumber(jy)) continue;
+                tmp.curve_pts[n][0] = (uint8_t)clampi(jx->valueint, 0, 100);
+                tmp.curve_pts[n][1] = (uint8_t)clampi(jy->valueint, 0, 100);
+                n++;
+            }
+            tmp.curve_n = (uint8_t)n;
+        }
+
+        // extra targets: [{ch,cc,v1,v2,curve}, ...] (max EXP_EXTRA_TARGETS, [] = none)
+        cJSON *jtg = cJSON_GetObjectItem(jexp, "targets");
+        if (cJSON_IsArray(jtg)) {
+            int n = 0;
+            memset(tmp.exp_extra, 0, sizeof(tmp.exp_extra));
+            int cnt = cJSON_GetArraySize(jtg);
+            for (int i = 0; i < cnt && n < EXP_EXTRA_TARGETS; i++) {
+                cJSON *jt = cJSON_GetArrayItem(jtg, i);
+                if (!cJSON_IsObject(jt)) continue;
+                cJSON *jch = cJSON_GetObjectItem(jt, "ch");
+                cJSON *jcc = cJSON_GetObjectItem(jt, "cc");
+                cJSON *jv1 = cJSON_GetObjectItem(jt, "v1");
+                cJSON *jv2 = cJSON_GetObjectItem(jt, "v2");
+                cJSON *jtc = cJSON_GetObjectItem(jt, "curve");
+                if (!cJSON_IsNumber(jcc)) continue;
+
+                exp_target_t *t = &tmp.exp_extra[n++];
+                t->ch = (uint8_t)clampi(cJSON_IsNumber(jch) ? jch->valueint : 1, 1, 16);
+                t->cc = (uint8_t)clampi(jcc->valueint, 0, 127);
+                t->v1 = (uint8_t)clampi(cJSON_IsNumber(jv1) ? jv1->valueint : 0, 0, 127);
+                t->v2 = (uint8_t)clampi(cJSON_IsNumber(jv2) ? jv2->valueint : 127, 0, 127);
+                t->curve = cJSON_IsString(jtc) ? str_to_curve(jtc->valuestring) : EXP_CURVE_LINEAR;
+            }
+            tmp.exp_extra_n = (uint8_t)n;
+        }
     }
 
     // tip/ring cfg
@@ -1753,20 +3674,23 @@ esp_err_t config_store_set_expfs_json(int port, const char *json)
     cJSON *jring = cJSON_GetObjectItem(root, "ring");
 
     if (cJSON_IsObject(jtip)) {
-        if (!json_to_btncfg(jtip, &tmp.tip)) { cJSON_Delete(root); return ESP_FAIL; }
+        if (!json_to_btncfg(jtip, &tmp.tip, &tmp.long_ms[0])) { cJSON_Delete(root); return ESP_FAIL; }
     }
     if (cJSON_IsObject(jring)) {
-        if (!json_to_btncfg(jring, &tmp.ring)) { cJSON_Delete(root); return ESP_FAIL; }
+        if (!json_to_btncfg(jring, &tmp.ring, &tmp.long_ms[1])) { cJSON_Delete(root); return ESP_FAIL; }
     }
 
     cJSON_Delete(root);
 
-    // store then sanitize all
+    // store then sanitize all (publishes)
+    expfs_lock();
     s_expfs[port] = tmp;
     expfs_sanitize_all();
+    expfs_unlock();
 
-    if (s_nvs_ok) return nvs_save_expfs();
-    return ESP_ERR_INVALID_STATE;
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+    st_mark(CFG_ST_EXPFS);
+    return ESP_OK;
 }
 
 esp_err_t config_store_set_expfs_cal(int port, int which_min0_max1, uint16_t raw)
@@ -1774,12 +3698,38 @@ esp_err_t config_store_set_expfs_cal(int port, int which_min0_max1, uint16_t raw
     port = clampi(port, 0, EXPFS_PORT_COUNT - 1);
     raw = (uint16_t)clampi((int)raw, 0, 4095);
 
+    expfs_lock();
     if (which_min0_max1) s_expfs[port].cal_max = raw;
     else s_expfs[port].cal_min = raw;
-
     expfs_sanitize_all();
-    if (s_nvs_ok) return nvs_save_expfs();
-    return ESP_ERR_INVALID_STATE;
+    expfs_unlock();
+
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+    st_mark(CFG_ST_EXPFS);
+    return ESP_OK;
+}
+
+esp_err_t config_store_set_expfs_cal_auto(int port, uint16_t cal_min, uint16_t cal_max)
+{
+    if (port < 0 || port >= EXPFS_PORT_COUNT) return ESP_ERR_INVALID_ARG;
+    cal_min = (uint16_t)clampi((int)cal_min, 0, 4095);
+    cal_max = (uint16_t)clampi((int)cal_max, 0, 4095);
+
+    expfs_lock();
+    expfs_port_cfg_t *p = &s_expfs[port];
+    if (p->cal_min == cal_min && p->cal_max == cal_max) {
+        expfs_unlock();
+        return ESP_OK;
+    }
+
+    p->cal_min = cal_min;
+    p->cal_max = cal_max;
+    expfs_publish();   // new gen -> expfs rebuilds the LUT
+    expfs_unlock();
+
+    if (!s_nvs_ok) return ESP_ERR_INVALID_STATE;
+    st_mark_in(CFG_ST_EXPFS, EXPFS_LAZY_SAVE_MS);
+    return ESP_OK;
 }
 
 // -------------------- import/export (generator + packed) --------------------
@@ -1818,40 +3768,62 @@ static void fill_action_list(uint32_t *seed, action_t *list)
     }
 }
 
-static void config_store_fill_fullmax(uint32_t seed)
+// fullmax generator as an image source (same sequence as the old in-place fill)
+typedef struct {
+    uint32_t seed;
+    uint32_t s;
+} cfg_gen_src_t;
+
+static esp_err_t cfg_src_fullmax(void *ctx, int bank, cfg_page_t *out)
 {
-    cfg_lock();
+    cfg_gen_src_t *g = (cfg_gen_src_t *)ctx;
+    if (bank == 0) g->s = g->seed;   // both build passes see the same banks
 
-    set_defaults(s_cfg);
-    s_cfg->bank_count = MAX_BANKS;
+    page_defaults(out->switch_name, out->map);
+    for (int k = 0; k < NUM_BTNS; k++) {
+        // max 5 chars recommended on UI, but config supports NAME_LEN
+        snprintf(out->switch_name[k], NAME_LEN, "SW%u", (unsigned)(k + 1));
 
-    // names
-    for (int b = 0; b < MAX_BANKS; b++) {
-        snprintf(s_cfg->bank_name[b], NAME_LEN, "BANK%03d", b + 1);
-        for (int k = 0; k < NUM_BTNS; k++) {
-            // max 5 chars recommended on UI, but config supports NAME_LEN
-            snprintf(s_cfg->switch_name[b][k], NAME_LEN, "SW%u", (unsigned)(k + 1));
-        }
+        btn_map_t *m = &out->map[k];
+        // cycle press modes (0..3) and cc behaviors (0..2)
+        m->press_mode = (btn_press_mode_t)((bank + k) % 4);
+        m->cc_behavior = (cc_behavior_t)((bank + (k * 3)) % 3);
+
+        fill_action_list(&g->s, m->short_actions);
+        fill_action_list(&g->s, m->long_actions);
     }
+    return ESP_OK;
+}
 
-    // mappings
-    uint32_t s = seed ? seed : 1u;
-    for (int b = 0; b < MAX_BANKS; b++) {
-        for (int k = 0; k < NUM_BTNS; k++) {
-            btn_map_t *m = &s_cfg->map[b][k];
-            // cycle press modes (0..3) and cc behaviors (0..2)
-            m->press_mode = (btn_press_mode_t)((b + k) % 4);
-            m->cc_behavior = (cc_behavior_t)((b + (k * 3)) % 3);
+static esp_err_t config_store_fill_fullmax(uint32_t seed)
+{
+    cfg_layout_t *lay = (cfg_layout_t *)heap_caps_malloc(sizeof(*lay), MALLOC_CAP_8BIT);
+    if (!lay) return ESP_ERR_NO_MEM;
 
-            fill_action_list(&s, m->short_actions);
-            fill_action_list(&s, m->long_actions);
-        }
+    // names
+    layout_defaults(lay);
+    lay->bank_count = MAX_BANKS;
+    for (int b = 0; b < MAX_BANKS; b++) {
+        snprintf(lay->bank_name[b], NAME_LEN, "BANK%03d", b + 1);
     }
 
-    sanitize_cfg(s_cfg);
+    cfg_lock();
+    ab_led_defaults();
+    s_cur_bank = 0;
     cfg_unlock();
 
-    cfg_request_save();
+    expfs_lock();
+    expfs_defaults();
+    expfs_unlock();
+    st_mark(CFG_ST_AB_LED);
+    st_mark(CFG_ST_CUR_BANK);
+    st_mark(CFG_ST_EXPFS);
+
+    // mappings: generated bank by bank straight into the new base (persisted now)
+    cfg_gen_src_t g = { .seed = seed ? seed : 1u, .s = 0 };
+    esp_err_t e = cfg_base_replace(lay, cfg_src_fullmax, &g);
+    heap_caps_free(lay);
+    return e;
 }
 
 esp_err_t config_store_import_json(const char *json)
@@ -1873,17 +3845,8 @@ esp_err_t config_store_import_json(const char *json)
         }
         cJSON_Delete(root);
 
-        // fill + sanitize + persist
-        cfg_lock();
-        config_store_fill_fullmax(seed);
-        sanitize_cfg(s_cfg);
-        cfg_unlock();
-
-        // persist now (prefer SPIFFS, fallback NVS)
-        esp_err_t e = ESP_FAIL;
-        if (s_spiffs_ok) e = cfg_save_v5_packed_file(s_cfg);
-        if (e != ESP_OK && s_nvs_ok) e = nvs_save_v5_packed(s_cfg);
-        return (e == ESP_OK) ? ESP_OK : e;
+        // fill + persist (prefer SPIFFS, fallback NVS) + go live
+        return config_store_fill_fullmax(seed);
     }
 
     // --- packed-base64 import ---
@@ -1916,10 +3879,10 @@ esp_err_t config_store_import_json(const char *json)
         return ESP_FAIL;
     }
 
-    // validate header
+    // validate header (v5 backups still import)
     cfg_hdr_v4_t hdr;
     memcpy(&hdr, dec, sizeof(hdr));
-    if (hdr.magic != CFG_MAGIC || hdr.ver != CFG_VER) {
+    if (hdr.magic != CFG_MAGIC || (hdr.ver != CFG_VER && hdr.ver != 5)) {
         heap_caps_free(dec);
         return ESP_FAIL;
     }
@@ -1930,37 +3893,43 @@ esp_err_t config_store_import_json(const char *json)
         return ESP_FAIL;
     }
 
-    // unpack into temp config
-    foot_config_t *tmp = (foot_config_t *)heap_caps_malloc(sizeof(foot_config_t), MALLOC_CAP_8BIT);
+    esp_err_t e;
+    if (hdr.ver == CFG_VER) {
+        // v6: the decoded image is read bank by bank like a base (crc + index first)
+        cfg_base_t *ib = (cfg_base_t *)heap_caps_calloc(1, sizeof(*ib), MALLOC_CAP_8BIT);
+        cfg_layout_t *lay = (cfg_layout_t *)heap_caps_malloc(sizeof(*lay), MALLOC_CAP_8BIT);
+        cfg_live_src_t *c = (cfg_live_src_t *)heap_caps_calloc(1, sizeof(*c), MALLOC_CAP_8BIT);
+        e = ESP_ERR_NO_MEM;
+        if (ib && lay && c) {
+            ib->ram = dec;
+            ib->size = (uint32_t)dec_len;
+            layout_defaults(lay);
+            e = cfg_base_scan(ib, lay);
+            if (e == ESP_OK && cfg_rd_open(&c->rd, ib)) {
+                e = cfg_base_replace(lay, cfg_src_live, c);
+                cfg_rd_close(&c->rd);
+            }
+        }
+        heap_caps_free(ib);
+        heap_caps_free(lay);
+        heap_caps_free(c);
+        heap_caps_free(dec);
+        return e;
+    }
+
+    // v5: unpack into a temp config, then stream it into a new base
+    foot_config_t *tmp = cfg_legacy_alloc();
     if (!tmp) {
         heap_caps_free(dec);
         return ESP_ERR_NO_MEM;
     }
 
-    esp_err_t e = cfg_v5_unpack(tmp, dec + sizeof(cfg_hdr_v4_t), (size_t)hdr.size);
+    e = cfg_unpack(tmp, hdr.ver, dec + sizeof(cfg_hdr_v4_t), (size_t)hdr.size);
     heap_caps_free(dec);
 
-    if (e != ESP_OK) {
-        heap_caps_free(tmp);
-        return e;
-    }
-
-    sanitize_cfg(tmp);
-
-    // swap into live config
-    cfg_lock();
-    memcpy(s_cfg, tmp, sizeof(*s_cfg));
-    cfg_unlock();
+    // persist now (write config file) + swap into live config
+    if (e == ESP_OK) e = cfg_migrate_full(tmp);
     heap_caps_free(tmp);
-
-    // persist now (write config file)
-    e = ESP_FAIL;
-    if (s_spiffs_ok) e = cfg_save_v5_packed_file(s_cfg);
-    if (e != ESP_OK && s_nvs_ok) e = nvs_save_v5_packed(s_cfg);
-
-    if (e == ESP_OK) {
-        s_cfg_dirty = false;
-    }
     return e;
 }
 
@@ -1970,8 +3939,9 @@ esp_err_t config_store_export_packed(uint8_t **out, size_t *out_len)
     *out = NULL;
     *out_len = 0;
 
-    // prefer exporting the exact stored file if available
-    if (cfg_mount_spiffs_noformat()) {
+    // prefer exporting the exact stored file if available (and nothing is pending on top)
+    if (cfg_mount_spiffs_noformat() && !s_base.ram && !s_base.log && s_jnl_size == 0 && !s_jnl_pending &&
+        !s_cfg_dirty && cfg_page_pinned_count() == 0) {
         struct stat st;
         if (stat(CFG_FILE_PATH, &st) == 0 && st.st_size > (off_t)sizeof(cfg_hdr_v4_t)) {
             size_t n = (size_t)st.st_size;
@@ -1988,27 +3958,40 @@ esp_err_t config_store_export_packed(uint8_t **out, size_t *out_len)
         }
     }
 
-    // fallback: pack current config into same file format (hdr + data)
-    uint8_t *p = NULL;
-    size_t plen = 0;
-    esp_err_t e = cfg_v5_pack(s_cfg, &p, &plen);
-    if (e != ESP_OK) return e;
+    // fallback: build the live config into the same file format (hdr + data) in RAM
+    cfg_live_src_t *c = (cfg_live_src_t *)heap_caps_malloc(sizeof(*c), MALLOC_CAP_8BIT);
+    cfg_layout_t *lay = (cfg_layout_t *)heap_caps_malloc(sizeof(*lay), MALLOC_CAP_8BIT);
+    if (!c || !lay) {
+        heap_caps_free(c);
+        heap_caps_free(lay);
+        return ESP_ERR_NO_MEM;
+    }
 
-    size_t total = sizeof(cfg_hdr_v4_t) + plen;
-    uint8_t *buf = (uint8_t *)heap_caps_malloc(total, MALLOC_CAP_8BIT);
-    if (!buf) { heap_caps_free(p); return ESP_ERR_NO_MEM; }
+    io_lock();
 
-    cfg_hdr_v4_t hdr;
-    memset(&hdr, 0, sizeof(hdr));
-    hdr.magic = CFG_MAGIC;
-    hdr.ver = CFG_VER;
-    hdr.size = (uint32_t)plen;
+    cfg_lock();
+    *lay = s_layout;
+    for (int b = 0; b < MAX_BANKS; b++) c->page[b] = s_snap_bank[b];
+    __atomic_add_fetch(&s_snap_readers, 1, __ATOMIC_SEQ_CST);
+    cfg_unlock();
 
-    memcpy(buf, &hdr, sizeof(hdr));
-    memcpy(buf + sizeof(hdr), p, plen);
-    heap_caps_free(p);
+    esp_err_t e = ESP_ERR_NOT_FOUND;
+    if (cfg_rd_open(&c->rd, &s_base)) {
+        e = cfg_image_build(&s_base_next, lay, cfg_src_live, c, false);
+        cfg_rd_close(&c->rd);
+    }
+    config_store_snap_release();
 
-    *out = buf;
-    *out_len = total;
-    return ESP_OK;
+    if (e == ESP_OK) {
+        *out = s_base_next.ram;
+        *out_len = s_base_next.size;
+    }
+    memset(&s_base_next, 0, sizeof(s_base_next));
+
+    io_unlock();
+
+    heap_caps_free(c);
+    heap_caps_free(lay);
+    cfg_snap_reclaim();
+    return e;
 }
@@ -71,6 +71,46 @@ typedef enum {
     EXPFS_KIND_DUAL_SW   = 2,
 } expfs_kind_t;
 
+// exp output resolution
+// - 7BIT : one CC 0..127 (default, same as before)
+// - 14BIT: CC pair MSB (cc 0..31) + LSB (cc+32); cc >= 32 falls back to 7-bit
+// - NRPN : NRPN number `nrpn`, 14-bit data entry (CC6/38)
+typedef enum {
+    EXP_RES_7BIT   = 0,
+    EXP_RES_14BIT  = 1,
+    EXP_RES_NRPN   = 2,
+} exp_res_t;
+
+// exp smoothing defaults / limits (0.1 Hz units)
+#define EXP_FLT_MIN_CUT_DEFAULT 10    // 1.0 Hz at rest
+#define EXP_FLT_MIN_CUT_MIN     1
+#define EXP_FLT_MIN_CUT_MAX     200
+#define EXP_FLT_BETA_DEFAULT    80    // +8 Hz per full sweep/s
+#define EXP_FLT_BETA_MAX        1000
+
+// exp response curve
+typedef enum {
+    EXP_CURVE_LINEAR  = 0,
+    EXP_CURVE_LOG     = 1,   // fast start (linearises an antilog / reverse audio pot)
+    EXP_CURVE_ANTILOG = 2,   // slow start (linearises a log / audio taper pot)
+    EXP_CURVE_S       = 3,
+    EXP_CURVE_CUSTOM  = 4,
+} exp_curve_t;
+
+#define EXP_CURVE_MAX_PTS 8
+
+// extra EXP targets: same pedal also drives these CCs (7-bit), each with its own range/curve
+#define EXP_EXTRA_TARGETS 3
+
+typedef struct {
+    uint8_t ch;      // 1..16
+    uint8_t cc;      // 0..127
+    uint8_t v1;      // val1 (same meaning as exp_action b)
+    uint8_t v2;      // val2 (same meaning as exp_action c)
+    uint8_t curve;   // EXP_CURVE_LINEAR..EXP_CURVE_S (applied on top of the port curve)
+    uint8_t rsv;
+} exp_target_t;
+
 typedef struct {
     btn_press_mode_t press_mode;   // 0..2 only (no group led)
     cc_behavior_t    cc_behavior;
@@ -94,11 +134,50 @@ typedef struct {
     // switch configs
     expfs_btncfg_t tip;   // used for single/dual
     expfs_btncfg_t ring;  // used only for dual
+
+    // ---- fields below are appended (older NVS blobs load as a prefix) ----
+
+    // long-press threshold (ms) [tip, ring]
+    uint16_t long_ms[2];
+
+    // exp output resolution (CC only, see EXP_RES_*) + NRPN number for EXP_RES_NRPN
+    uint8_t  exp_res;
+    uint16_t nrpn;
+
+    // exp adaptive smoothing (exp_filter): cutoff at rest + speed gain, 0.1 Hz units
+    uint16_t flt_min_cut;
+    uint16_t flt_beta;
+
+    // exp response curve (EXP_CURVE_*). custom: curve_n breakpoints (x%, y%) sorted by x,
+    // x = pedal travel toward val2, y = share of val1..val2. compiled to a LUT by expfs
+    uint8_t  curve;
+    uint8_t  curve_n;
+    uint8_t  curve_pts[EXP_CURVE_MAX_PTS][2];
+
+    // extra CC targets (exp_action stays the first target)
+    uint8_t      exp_extra_n;
+    exp_target_t exp_extra[EXP_EXTRA_TARGETS];
+
+    // 1 = kind follows what the jack detector sees (exp / single / dual / empty)
+    uint8_t      kind_auto;
+
+    // 1 = cal_min/cal_max follow the pedal (exp_autocal), saved lazily
+    uint8_t      cal_auto;
 } expfs_port_cfg_t;
 
+// long-press threshold range (ms)
+#define LONG_MS_DEFAULT 400
+#define LONG_MS_MIN     50
+#define LONG_MS_MAX     5000
+
 // ---- init/load/save ----
 void config_store_init(void);
-const foot_config_t *config_store_get(void);
+
+// changes whenever the live mapping is edited/imported (for derived caches)
+uint32_t config_store_get_gen(void);
+
+// same for exp/fs port settings (expfs rebuilds its curve LUTs)
+uint32_t config_store_get_expfs_gen(void);
 
 // ---- layout helpers ----
 int  config_store_bank_count(void);
@@ -124,11 +203,22 @@ esp_err_t config_store_set_led_brightness(uint8_t percent);
 uint8_t  config_store_get_ab_led_sel(int bank, int btn);
 esp_err_t config_store_set_ab_led_sel(int bank, int btn, uint8_t sel);
 
+// ---- long-press threshold (per bank/button, ms) ----
+uint16_t config_store_get_long_ms(int bank, int btn);
+
+// ---- chord (combo) coincidence window (global, ms) ----
+#define CHORD_MS_DEFAULT 30
+#define CHORD_MS_MIN     5
+#define CHORD_MS_MAX     150
+uint8_t  config_store_get_chord_ms(void);
+esp_err_t config_store_set_chord_ms(uint8_t ms);
+
 // ---- current bank persistence ----
 uint8_t  config_store_get_current_bank(void);
 esp_err_t config_store_set_current_bank(uint8_t bank);
 
 // ---- exp/fs API ----
+// master copy (web / status); expfs_task reads config_store_snap_expfs()
 const expfs_port_cfg_t *config_store_get_expfs_cfg(int port);
 esp_err_t config_store_get_expfs_json(int port, char *out, int out_len);
 esp_err_t config_store_set_expfs_json(int port, const char *json);
@@ -136,13 +226,73 @@ esp_err_t config_store_set_expfs_json(int port, const char *json);
 // calibration save helper (persist)
 esp_err_t config_store_set_expfs_cal(int port, int which_min0_max1, uint16_t raw);
 
+// auto-range update from expfs: live at once, NVS write deferred + rate limited
+esp_err_t config_store_set_expfs_cal_auto(int port, uint16_t cal_min, uint16_t cal_max);
+
+// ---- write-behind settings ----
+// the setters above (brightness, a+b led, long-press, chord, current bank, exp/fs) and
+// rgb_store only change RAM and mark their item dirty: no lock, no flash, safe from
+// foot_task. the config save task writes a dirty item CFG_ST_FLUSH_MS after its
+// first change at the latest (exp/fs auto-range: rate limited), later changes of the same
+// item ride along. esp_restart() flushes whatever is still pending (shutdown handler).
+#define CFG_ST_FLUSH_MS 1500
+
+typedef enum {
+    CFG_ST_BRIGHTNESS = 0,
+    CFG_ST_CUR_BANK,
+    CFG_ST_AB_LED,
+    CFG_ST_LONG_MS,
+    CFG_ST_CHORD_MS,
+    CFG_ST_EXPFS,
+    CFG_ST_RGB,          // rgb_store: saved by the function it registers
+    CFG_ST_COUNT,
+} cfg_setting_t;
+
+typedef esp_err_t (*cfg_setting_save_fn)(void);
+
+// save function of a setting kept outside config_store (runs on the config save task)
+void config_store_setting_register(cfg_setting_t item, cfg_setting_save_fn save);
+// mark changed: never blocks, any task
+void config_store_setting_dirty(cfg_setting_t item);
+// write every dirty setting now (returns the first error)
+esp_err_t config_store_flush_settings(void);
+
+// ---- lock-free read snapshots (real-time tasks) ----
+// writers publish an immutable copy per bank (and one for both exp/fs ports) with an
+// atomic pointer swap; the old copy is freed once no reader section is open.
+// - readers never block: snap_* -> copy what you need -> config_store_snap_release()
+// - keep the section short (a memcpy), never block or call config_store setters inside
+// - ver changes on every publish: poll config_store_get_bank_ver() and re-read on change
+typedef struct {
+    uint32_t  ver;
+    uint8_t   bank;
+    char      bank_name[NAME_LEN];
+    char      switch_name[NUM_BTNS][NAME_LEN];
+    btn_map_t map[NUM_BTNS];
+    uint16_t  long_ms[NUM_BTNS];
+    uint8_t   ab_led_sel[NUM_BTNS];   // 0=A, 1=B
+} cfg_bank_snap_t;
+
+typedef struct {
+    uint32_t         ver;             // == config_store_get_expfs_gen() when published
+    expfs_port_cfg_t port[EXPFS_PORT_COUNT];
+} cfg_expfs_snap_t;
+
+uint32_t config_store_get_bank_ver(int bank);   // 0 = nothing published
+
+// open a read section (NULL = no config, section is open anyway -> always release)
+const cfg_bank_snap_t  *config_store_snap_bank(int bank);
+const cfg_expfs_snap_t *config_store_snap_expfs(void);
+void config_store_snap_release(void);
+
 // ---- import/export helpers ----
 // ✅ generator import:
 //   {"gen":"fullmax","seed":123}
 // - creates MAX_BANKS and fills every slot to MAX_ACTIONS
 esp_err_t config_store_import_json(const char *json);
 
-// export packed config (v5) currently stored; useful for backup/restore
+// export packed config (v6, see cfg_pack.h) currently stored; useful for backup/restore
+// - "packed-base64" import accepts v6 and older v5 exports
 // - returns ESP_ERR_NOT_FOUND if no stored config file
 // - out will be set to malloc'ed buffer (heap_caps_malloc) that caller must free
 esp_err_t config_store_export_packed(uint8_t **out, size_t *out_len);
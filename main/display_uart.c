@@ -38,32 +38,38 @@ static void sanitize_commas(char *s)
     }
 }
 
-static void build_msg(char *out, size_t out_len)
+void display_uart_build_msg(char *out, size_t out_len)
 {
     if (!out || out_len < 32) return;
     out[0] = 0;
 
-    const foot_config_t *cfg = config_store_get();
-    if (!cfg) {
+    int bank = (int)config_store_get_current_bank();
+    if (bank < 0) bank = 0;
+    if (bank >= config_store_bank_count()) bank = 0;
+
+    // names from the published snapshot (lock-free, never half-edited)
+    char bn[NAME_LEN];
+    char sw[NUM_BTNS][NAME_LEN];
+    const cfg_bank_snap_t *snap = config_store_snap_bank(bank);
+    if (snap) {
+        memcpy(bn, snap->bank_name, sizeof(bn));
+        memcpy(sw, snap->switch_name, sizeof(sw));
+    }
+    config_store_snap_release();
+
+    if (!snap) {
         // 1 bank + 8 switches placeholder
         snprintf(out, out_len, "@U,0,NA,NA,NA,NA,NA,NA,NA,NA\r\n");
         return;
     }
 
-    int bank = (int)config_store_get_current_bank();
-    if (bank < 0) bank = 0;
-    if (bank >= (int)cfg->bank_count) bank = 0;
-
-    char bn[NAME_LEN];
-    strncpy(bn, cfg->bank_name[bank], sizeof(bn));
     bn[NAME_LEN - 1] = 0;
     sanitize_commas(bn);
 
     int pos = snprintf(out, out_len, "@U,%d,%s", bank, bn);
 
     for (int k = 0; k < NUM_BTNS; k++) {
-        char sn[NAME_LEN];
-        strncpy(sn, cfg->switch_name[bank][k], sizeof(sn));
+        char *sn = sw[k];
         sn[NAME_LEN - 1] = 0;
         sanitize_commas(sn);
 
@@ -95,7 +101,7 @@ static void disp_task(void *arg)
         s_pending = false;
         if (s_lock) xSemaphoreGive(s_lock);
 
-        build_msg(msg, sizeof(msg));
+        display_uart_build_msg(msg, sizeof(msg));
 
         int w = uart_write_bytes(DISP_UART_NUM, msg, (int)strlen(msg));
         uart_wait_tx_done(DISP_UART_NUM, pdMS_TO_TICKS(50));
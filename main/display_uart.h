@@ -1,5 +1,6 @@
 // ===== FILE: main/display_uart.h =====
 #pragma once
+#include <stddef.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -11,6 +12,9 @@ void display_uart_init(void);
 // Request a refresh push (bank + switch names). Safe to call from other modules.
 void display_uart_request_refresh(void);
 
+// Frame pushed to the display: "@U,<bank>,<bank name>,<8 switch names>\r\n" (out_len >= 32)
+void display_uart_build_msg(char *out, size_t out_len);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
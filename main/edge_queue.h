@@ -0,0 +1,64 @@
+// ===== FILE: main/edge_queue.h =====
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Lock-free single-producer / single-consumer ring of timestamped input edges.
+//
+// - producer: GPIO ISR (all pins of one ISR service are dispatched from the same interrupt)
+// - consumer: the task that owns the button state machine
+// - full queue -> edge is dropped and counted; the consumer re-reads every pin when the
+//   counter moves, so a dropped edge is only late, never lost.
+
+#ifndef EDGE_QUEUE_LEN
+#define EDGE_QUEUE_LEN 64   // power of two
+#endif
+
+typedef struct {
+    int64_t t_us;    // esp_timer_get_time() at the edge
+    uint8_t idx;     // input index (owner defined)
+    uint8_t level;   // pin level after the edge (0 = pressed for pull-up inputs)
+} edge_evt_t;
+
+typedef struct {
+    volatile uint32_t head;     // written by producer only
+    volatile uint32_t tail;     // written by consumer only
+    volatile uint32_t dropped;  // producer side overflow counter
+    edge_evt_t buf[EDGE_QUEUE_LEN];
+} edge_queue_t;
+
+static inline void edge_queue_reset(edge_queue_t *q)
+{
+    q->head = 0;
+    q->tail = 0;
+    q->dropped = 0;
+}
+
+// producer side (ISR safe: no locks, no allocation)
+static inline bool edge_queue_push(edge_queue_t *q, const edge_evt_t *e)
+{
+    uint32_t head = q->head;
+    uint32_t tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+
+    if ((uint32_t)(head - tail) >= EDGE_QUEUE_LEN) {
+        q->dropped++;
+        return false;
+    }
+
+    q->buf[head & (EDGE_QUEUE_LEN - 1)] = *e;
+    __atomic_store_n(&q->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+// consumer side
+static inline bool edge_queue_pop(edge_queue_t *q, edge_evt_t *out)
+{
+    uint32_t tail = q->tail;
+    uint32_t head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+
+    if (head == tail) return false;
+
+    *out = q->buf[tail & (EDGE_QUEUE_LEN - 1)];
+    __atomic_store_n(&q->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
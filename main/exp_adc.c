@@ -0,0 +1,180 @@
+// ===== FILE: main/exp_adc.c =====
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_adc/adc_continuous.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+
+#include "exp_adc.h"
+
+static const char *TAG = "EXP_ADC";
+
+#define EXP_ADC_MAX_PORTS   4
+#define EXP_ADC_FRAME_BYTES (EXP_ADC_FRAME_CONV * SOC_ADC_DIGI_RESULT_BYTES)
+
+static adc_continuous_handle_t s_adc = NULL;
+static TaskHandle_t s_notify = NULL;
+
+static int     s_nports = 0;
+static int8_t  s_chan[EXP_ADC_MAX_PORTS];      // ADC1 channel per port, -1 = not on DMA
+
+// published by the ISR: frame average (0..4095)
+static volatile uint16_t s_avg[EXP_ADC_MAX_PORTS];
+static volatile uint8_t  s_have[EXP_ADC_MAX_PORTS];
+static volatile uint8_t  s_skip[EXP_ADC_MAX_PORTS];   // frames to drop (pins were reconfigured)
+
+static uint8_t s_enabled[EXP_ADC_MAX_PORTS];          // task side: port wants samples
+static uint8_t s_running;                             // DMA unit started
+
+// conv-done ISR: one pass over the frame (64 words), no copy, no task per sample
+static bool IRAM_ATTR on_conv_done(adc_continuous_handle_t h, const adc_continuous_evt_data_t *ed, void *arg)
+{
+    (void)h;
+    (void)arg;
+
+    uint32_t sum[EXP_ADC_MAX_PORTS] = { 0 };
+    uint32_t cnt[EXP_ADC_MAX_PORTS] = { 0 };
+
+    const uint32_t n = ed->size / SOC_ADC_DIGI_RESULT_BYTES;
+    const adc_digi_output_data_t *d = (const adc_digi_output_data_t *)ed->conv_frame_buffer;
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (d[i].type2.unit != 0) continue;   // ADC1 only
+        const int ch = (int)d[i].type2.channel;
+        for (int p = 0; p < s_nports; p++) {
+            if (s_chan[p] == ch) { sum[p] += d[i].type2.data; cnt[p]++; break; }
+        }
+    }
+
+    for (int p = 0; p < s_nports; p++) {
+        if (!cnt[p]) continue;
+        if (s_skip[p]) { s_skip[p]--; continue; }
+        s_avg[p] = (uint16_t)((sum[p] + cnt[p] / 2u) / cnt[p]);
+        s_have[p] = 1;
+    }
+
+    BaseType_t woke = pdFALSE;
+    if (s_notify) vTaskNotifyGiveFromISR(s_notify, &woke);
+    return woke == pdTRUE;
+}
+
+esp_err_t exp_adc_start(const int *ring_gpio, int n_ports, TaskHandle_t notify)
+{
+    if (s_adc) return ESP_OK;
+    if (!ring_gpio || n_ports <= 0) return ESP_ERR_INVALID_ARG;
+    if (n_ports > EXP_ADC_MAX_PORTS) n_ports = EXP_ADC_MAX_PORTS;
+
+    adc_digi_pattern_config_t pat[EXP_ADC_MAX_PORTS];
+    int npat = 0;
+
+    s_nports = n_ports;
+    for (int p = 0; p < n_ports; p++) {
+        s_chan[p] = -1;
+        s_avg[p] = 0;
+        s_have[p] = 0;
+        s_skip[p] = 0;
+        s_enabled[p] = 1;
+
+        adc_unit_t unit;
+        adc_channel_t ch;
+        if (adc_continuous_io_to_channel(ring_gpio[p], &unit, &ch) != ESP_OK) continue;
+        if (unit != ADC_UNIT_1) {
+            ESP_LOGI(TAG, "port=%d GPIO%d is on ADC2 -> oneshot", p, ring_gpio[p]);
+            continue;
+        }
+
+        s_chan[p] = (int8_t)ch;
+        pat[npat].atten = ADC_ATTEN_DB_12;
+        pat[npat].channel = (uint8_t)ch;
+        pat[npat].unit = ADC_UNIT_1;
+        pat[npat].bit_width = SOC_ADC_DIGI_MAX_BITWIDTH;
+        npat++;
+    }
+
+    if (npat == 0) {
+        s_nports = 0;
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    // the ISR reads the frame in place; flush_pool drops what nobody reads from the pool
+    adc_continuous_handle_cfg_t hcfg = {
+        .max_store_buf_size = EXP_ADC_FRAME_BYTES * 2,
+        .conv_frame_size = EXP_ADC_FRAME_BYTES,
+        .flags = { .flush_pool = 1 },
+    };
+    esp_err_t e = adc_continuous_new_handle(&hcfg, &s_adc);
+    if (e != ESP_OK) { s_adc = NULL; s_nports = 0; return e; }
+
+    adc_continuous_config_t ccfg = {
+        .pattern_num = (uint32_t)npat,
+        .adc_pattern = pat,
+        .sample_freq_hz = EXP_ADC_SAMPLE_HZ,
+        .conv_mode = ADC_CONV_SINGLE_UNIT_1,
+        .format = ADC_DIGI_OUTPUT_FORMAT_TYPE2,
+    };
+    e = adc_continuous_config(s_adc, &ccfg);
+
+    adc_continuous_evt_cbs_t cbs = { .on_conv_done = on_conv_done };
+    if (e == ESP_OK) e = adc_continuous_register_event_callbacks(s_adc, &cbs, NULL);
+
+    s_notify = notify;
+    if (e == ESP_OK) e = adc_continuous_start(s_adc);
+    if (e == ESP_OK) s_running = 1;
+
+    if (e != ESP_OK) {
+        ESP_LOGW(TAG, "continuous ADC failed: %s", esp_err_to_name(e));
+        adc_continuous_deinit(s_adc);
+        s_adc = NULL;
+        s_nports = 0;
+        return e;
+    }
+
+    ESP_LOGI(TAG, "DMA sampling: %d port(s), %d Hz, frame=%d (%d us)",
+             npat, EXP_ADC_SAMPLE_HZ, EXP_ADC_FRAME_CONV, EXP_ADC_PERIOD_US);
+    return ESP_OK;
+}
+
+bool exp_adc_active(int port)
+{
+    return s_adc && port >= 0 && port < s_nports && s_chan[port] >= 0;
+}
+
+bool exp_adc_get(int port, uint16_t *raw12)
+{
+    if (!raw12 || !exp_adc_active(port) || !s_enabled[port] || !s_have[port]) return false;
+
+    uint16_t v = s_avg[port];
+    *raw12 = (v > 4095) ? 4095 : v;
+    return true;
+}
+
+void exp_adc_skip(int port, uint8_t frames)
+{
+    if (!exp_adc_active(port)) return;
+    s_have[port] = 0;
+    s_skip[port] = frames;
+}
+
+void exp_adc_enable(int port, bool on)
+{
+    if (!exp_adc_active(port)) return;
+    if (s_enabled[port] == (on ? 1 : 0)) return;
+
+    s_enabled[port] = on ? 1 : 0;
+    if (on) exp_adc_skip(port, 1);   // first frame may straddle the enable
+
+    bool any = false;
+    for (int p = 0; p < s_nports; p++) if (s_chan[p] >= 0 && s_enabled[p]) any = true;
+
+    // no port needs samples -> stop the unit (no DMA, no ISR, no wakeups)
+    if (any && !s_running) {
+        if (adc_continuous_start(s_adc) == ESP_OK) s_running = 1;
+    } else if (!any && s_running) {
+        if (adc_continuous_stop(s_adc) == ESP_OK) s_running = 0;
+    }
+}
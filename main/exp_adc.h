@@ -0,0 +1,37 @@
+// ===== FILE: main/exp_adc.h =====
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+// Continuous (DMA) sampling of the EXP ring pins.
+//
+// - ADC1 pins are sampled by the digital controller at EXP_ADC_SAMPLE_HZ (no CPU per sample)
+// - every DMA frame (EXP_ADC_FRAME_CONV conversions = a fixed period) the conv-done ISR
+//   averages the frame per port and publishes one value -> oversampled, low noise,
+//   ~EXP_ADC_PERIOD_US old at most
+// - ADC2 pins are NOT sampled here (ESP32-S3 ADC2 DMA results are unreliable);
+//   the caller keeps reading those with adc_oneshot
+
+#define EXP_ADC_SAMPLE_HZ   16000                       // total conversions/s (all DMA ports)
+#define EXP_ADC_FRAME_CONV  64                          // conversions per DMA frame
+#define EXP_ADC_PERIOD_US   (EXP_ADC_FRAME_CONV * 1000000 / EXP_ADC_SAMPLE_HZ)   // 4 ms
+
+// start DMA sampling for the given ring GPIOs (index = port). ports on ADC2 are skipped.
+// notify: task woken once per published frame (may be NULL)
+esp_err_t exp_adc_start(const int *ring_gpio, int n_ports, TaskHandle_t notify);
+
+// port sampled by DMA?
+bool exp_adc_active(int port);
+
+// latest frame average (0..4095, rounded). false = no frame yet / port not on DMA
+bool exp_adc_get(int port, uint16_t *raw12);
+
+// drop the next n frames of this port (pins reconfigured for a jack probe)
+void exp_adc_skip(int port, uint8_t frames);
+
+// port wants samples? the DMA unit is stopped while no port does
+void exp_adc_enable(int port, bool on);
@@ -0,0 +1,99 @@
+// ===== FILE: main/exp_autocal.c =====
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "exp_autocal.h"
+
+#define AC_FULL_SCALE 4095
+
+static int clampi_ac(int v, int lo, int hi)
+{
+    if (v < lo) return lo;
+    if (v > hi) return hi;
+    return v;
+}
+
+void ac_seed(ac_state_t *st, uint16_t cal_min, uint16_t cal_max)
+{
+    st->inv = (cal_min > cal_max) ? 1 : 0;
+    st->lo = (int16_t)(st->inv ? cal_max : cal_min);
+    st->hi = (int16_t)(st->inv ? cal_min : cal_max);
+    st->ex_lo = -1;
+    st->ex_hi = -1;
+
+    // default range (or nothing usable): learn both ends from the first samples
+    st->fresh = ((st->lo <= 0 && st->hi >= AC_FULL_SCALE) || (st->hi - st->lo) < AC_MIN_SPAN) ? 1 : 0;
+    if (st->fresh) {
+        st->lo = -1;
+        st->hi = -1;
+    }
+}
+
+bool ac_ready(const ac_state_t *st)
+{
+    return !st->fresh && st->lo >= 0 && (st->hi - st->lo) >= AC_MIN_SPAN;
+}
+
+void ac_get(const ac_state_t *st, uint16_t *cal_min, uint16_t *cal_max)
+{
+    const uint16_t lo = (uint16_t)clampi_ac(st->lo, 0, AC_FULL_SCALE);
+    const uint16_t hi = (uint16_t)clampi_ac(st->hi, 0, AC_FULL_SCALE);
+    if (cal_min) *cal_min = st->inv ? hi : lo;
+    if (cal_max) *cal_max = st->inv ? lo : hi;
+}
+
+bool ac_update(ac_state_t *st, uint16_t raw)
+{
+    const int x = clampi_ac((int)raw, 0, AC_FULL_SCALE);
+    const int16_t lo0 = st->lo, hi0 = st->hi;
+
+    if (st->lo < 0) {
+        st->lo = st->hi = (int16_t)x;
+        return false;
+    }
+
+    // fresh tracker: plain min/max until the pedal has moved far enough
+    if (st->fresh) {
+        if (x < st->lo) st->lo = (int16_t)x;
+        if (x > st->hi) st->hi = (int16_t)x;
+        if ((st->hi - st->lo) < AC_MIN_SPAN + 2 * AC_EDGE) return false;
+        st->lo = (int16_t)(st->lo + AC_EDGE);
+        st->hi = (int16_t)(st->hi - AC_EDGE);
+        st->fresh = 0;
+        return true;
+    }
+
+    // ---- widen (hysteresis: filtered noise around an end does not creep it outward) ----
+    if (x < st->lo - AC_HYST) st->lo = (int16_t)(x + AC_EDGE);
+    if (x > st->hi + AC_HYST) st->hi = (int16_t)(x - AC_EDGE);
+
+    // ---- decay toward where the pedal actually turns around ----
+    const int span = st->hi - st->lo;
+    const int zone = span >> 3;
+
+    if (x <= st->lo + zone) {
+        if (st->ex_lo < 0 || x < st->ex_lo) st->ex_lo = (int16_t)x;
+    } else if (st->ex_lo >= 0) {
+        int target = st->ex_lo + AC_EDGE;
+        if (target > st->lo + AC_HYST) {
+            int nlo = st->lo + ((target - st->lo) >> AC_DECAY_SHIFT);
+            if (st->hi - nlo < AC_MIN_SPAN) nlo = st->hi - AC_MIN_SPAN;
+            if (nlo > st->lo) st->lo = (int16_t)nlo;
+        }
+        st->ex_lo = -1;
+    }
+
+    if (x >= st->hi - zone) {
+        if (st->ex_hi < 0 || x > st->ex_hi) st->ex_hi = (int16_t)x;
+    } else if (st->ex_hi >= 0) {
+        int target = st->ex_hi - AC_EDGE;
+        if (target < st->hi - AC_HYST) {
+            int nhi = st->hi - ((st->hi - target) >> AC_DECAY_SHIFT);
+            if (nhi - st->lo < AC_MIN_SPAN) nhi = st->lo + AC_MIN_SPAN;
+            if (nhi < st->hi) st->hi = (int16_t)nhi;
+        }
+        st->ex_hi = -1;
+    }
+
+    return st->lo != lo0 || st->hi != hi0;
+}
@@ -0,0 +1,41 @@
+// ===== FILE: main/exp_autocal.h =====
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Self-tracking EXP calibration (auto-range).
+//
+// - widen: filtered raw beyond an end by more than AC_HYST -> that end follows at once
+// - decay: every excursion into an end zone (outer 1/8 of the range) that stops short of
+//   the end pulls the end 1/4 of the way toward the deepest point reached
+//   -> driven by pedal use only, a pedal parked for an hour does not shrink the range
+// - ends sit AC_EDGE inside the extremes so 0 / 127 are reached even with +/-1 noise
+// - range never shrinks below AC_MIN_SPAN
+// - pure C (no ESP-IDF headers) -> builds on the host like exp_filter
+//
+// raw values are ADC units 0..4095. cal_min/cal_max keep the stored meaning
+// (min = toe, max = heel), either order.
+
+#define AC_HYST      8
+#define AC_EDGE      4
+#define AC_MIN_SPAN  256
+#define AC_DECAY_SHIFT 2
+
+typedef struct {
+    int16_t lo, hi;         // tracked range, lo < hi (raw)
+    int16_t ex_lo, ex_hi;   // deepest point of the current end-zone excursion, -1 = outside
+    uint8_t inv;            // 1 = cal_min is the high end
+    uint8_t fresh;          // started from the default 0..4095 range: learn from scratch
+} ac_state_t;
+
+// (re)start from a stored calibration
+void ac_seed(ac_state_t *st, uint16_t cal_min, uint16_t cal_max);
+
+// feed one filtered sample. true = range changed
+bool ac_update(ac_state_t *st, uint16_t raw);
+
+// usable for the LUT (fresh trackers need AC_MIN_SPAN of travel first)
+bool ac_ready(const ac_state_t *st);
+
+// tracked range back in cal_min / cal_max order
+void ac_get(const ac_state_t *st, uint16_t *cal_min, uint16_t *cal_max);
@@ -0,0 +1,59 @@
+// ===== FILE: main/exp_filter.c =====
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "exp_filter.h"
+
+#define EF_DT_MIN_US   100
+#define EF_DT_MAX_US   100000   // long gap (task starved / port switched) -> treat as 100 ms
+
+// smoothing factor for a first order low-pass, Q16:
+// alpha = 1 / (1 + tau/dt), tau = 1/(2*pi*fc)  ==  w / (w + 1), w = 2*pi*fc*dt
+static uint32_t alpha_q16(uint32_t fc_mhz, uint32_t dt_us)
+{
+    // w * 1e12 = 2*pi * fc_mhz * dt_us * 1e3  (6283 ~ 2*pi*1000)
+    const int64_t w = (int64_t)fc_mhz * (int64_t)dt_us * 6283LL;
+    const int64_t one = 1000000000000LL;
+    int64_t a = (w << 16) / (w + one);
+    if (a < 1) a = 1;
+    if (a > 65536) a = 65536;
+    return (uint32_t)a;
+}
+
+uint16_t ef_update(ef_state_t *st, const ef_cfg_t *cfg, uint16_t x, int64_t t_us)
+{
+    if (x > EF_FULL_SCALE) x = EF_FULL_SCALE;
+    const int32_t xq = (int32_t)x << 8;
+
+    if (!st->primed) {
+        st->x_q8 = xq;
+        st->dx = 0;
+        st->t_us = t_us;
+        st->primed = 1;
+        return x;
+    }
+
+    int64_t dt = t_us - st->t_us;
+    if (dt < EF_DT_MIN_US) dt = EF_DT_MIN_US;
+    if (dt > EF_DT_MAX_US) dt = EF_DT_MAX_US;
+    st->t_us = t_us;
+
+    // speed (raw/s) against the previous output, low-passed at EF_DCUTOFF_MHZ
+    const int32_t dx_now = (int32_t)((((int64_t)(xq - st->x_q8)) * 1000000LL / dt) >> 8);
+    const uint32_t ad = alpha_q16(EF_DCUTOFF_MHZ, (uint32_t)dt);
+    st->dx += (int32_t)(((int64_t)(dx_now - st->dx) * ad) >> 16);
+
+    // cutoff from speed
+    const uint32_t spd = (uint32_t)((st->dx < 0) ? -st->dx : st->dx);
+    uint64_t fc = (uint64_t)cfg->min_cut_dhz * 100u +
+                  (uint64_t)cfg->beta_dhz * 100u * spd / EF_FULL_SCALE;
+    if (fc > EF_MAX_CUT_MHZ) fc = EF_MAX_CUT_MHZ;
+
+    const uint32_t a = alpha_q16((uint32_t)fc, (uint32_t)dt);
+    st->x_q8 += (int32_t)(((int64_t)(xq - st->x_q8) * a) >> 16);
+
+    int32_t out = (st->x_q8 + 128) >> 8;
+    if (out < 0) out = 0;
+    if (out > EF_FULL_SCALE) out = EF_FULL_SCALE;
+    return (uint16_t)out;
+}
@@ -0,0 +1,41 @@
+// ===== FILE: main/exp_filter.h =====
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Adaptive low-pass for EXP pedals (1-euro filter style, integer math).
+//
+// - cutoff follows pedal speed: cutoff = min_cut + beta * |speed|
+//   -> pedal at rest: low cutoff, heavy smoothing (no +/-1 jitter)
+//   -> fast sweep: high cutoff, almost no lag
+// - speed = derivative of the input, itself low-passed at EF_DCUTOFF_MHZ
+// - pure C (no ESP-IDF headers) -> builds on the host like button_fsm
+//
+// input/output are raw ADC units 0..4095, state keeps 8 fractional bits.
+
+#define EF_DCUTOFF_MHZ   1000     // speed estimate cutoff (1 Hz)
+#define EF_MAX_CUT_MHZ   100000   // cap (100 Hz)
+#define EF_FULL_SCALE    4095
+
+typedef struct {
+    uint16_t min_cut_dhz;   // cutoff at rest, 0.1 Hz units (10 = 1.0 Hz)
+    uint16_t beta_dhz;      // cutoff added per full-scale/s of speed, 0.1 Hz units (80 = 8 Hz)
+} ef_cfg_t;
+
+typedef struct {
+    int32_t x_q8;      // filtered value (raw << 8)
+    int32_t dx;        // filtered speed (raw units / s)
+    int64_t t_us;      // last sample time
+    uint8_t primed;
+} ef_state_t;
+
+static inline void ef_reset(ef_state_t *st)
+{
+    st->x_q8 = 0;
+    st->dx = 0;
+    st->t_us = 0;
+    st->primed = 0;
+}
+
+// feed one sample taken at t_us, returns the filtered value (0..4095)
+uint16_t ef_update(ef_state_t *st, const ef_cfg_t *cfg, uint16_t x, int64_t t_us);
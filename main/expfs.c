@@ -1,19 +1,28 @@
 // ===== FILE: main/expfs.c =====
 #include <string.h>
 #include <stdint.h>
-#include <math.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
 #include "driver/gpio.h"
 #include "esp_adc/adc_oneshot.h"
+#include "esp_heap_caps.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_rom_sys.h"
 
 #include "config_store.h"
 #include "midi_actions.h"
 #include "usb_midi_host.h"
 #include "uart_midi_out.h"
+#include "midi_out.h"
+#include "button_fsm.h"
+#include "exp_adc.h"
+#include "exp_filter.h"
+#include "jack_detect.h"
+#include "exp_autocal.h"
+#include "lat_stats.h"
 
 #include "expfs.h"
 
@@ -25,9 +34,14 @@ static const char *TAG = "EXPFS";
 // 2) ทำสเกลให้สัมพันธ์กับระยะเท้ามากขึ้น (ชดเชย pot แบบ log/ไม่เชิงเส้น)
 #define EXP_SEND_THROTTLE_MS   (20)
 #define EXP_SEND_STABLE_MS     (10)
-#define EXP_IIR_SHIFT          (1)     // 2^3 = 8  (ยิ่งมากยิ่งเนียน)
 #define EXP_FORCE_DELTA        (1)     // diff >= 4 ส่งทันที (รู้สึกตอบสนอง)
-#define EXP_CURVE_GAMMA        (1.0f)  // 1.0 = linear LUT (ยังคง LUT ไว้เผื่อปรับภายหลัง)
+
+// 14-bit output (EXP_RES_14BIT / EXP_RES_NRPN): threshold อยู่ในโดเมน 14-bit
+// 1 ADC step (12-bit) ~ 4 หน่วย 14-bit -> deadband 8 ตัด jitter +/-1..2 step ของ ADC
+// ความถี่ส่งยังจำกัดด้วย EXP_SEND_THROTTLE_MS เหมือน 7-bit
+#define EXP_MIN_DELTA14        (8)
+#define EXP_FORCE_DELTA14      (128)   // = 1 step ของ 7-bit -> ส่งทันทีไม่รอนิ่ง
+#define EXP_NONE14             (0xFFFFu)
 
 
 // -------------------- pin map (ตามที่กำหนดให้) --------------------
@@ -60,19 +74,67 @@ static uint32_t  s_last_send_ms[EXPFS_PORT_COUNT];
 static uint16_t s_raw_hist[EXPFS_PORT_COUNT][3];
 static uint8_t  s_raw_hist_idx[EXPFS_PORT_COUNT];
 static int32_t  s_raw_filt[EXPFS_PORT_COUNT]; // filtered raw (0..4095)
+static ef_state_t s_ef[EXPFS_PORT_COUNT];       // adaptive smoothing (exp_filter)
 static uint8_t  s_pending_mapped[EXPFS_PORT_COUNT];
 static uint32_t s_pending_since_ms[EXPFS_PORT_COUNT];
-
-static uint8_t  s_curve_lut[128];
-static uint8_t  s_curve_inited;
+static uint16_t s_last_mapped14[EXPFS_PORT_COUNT];    // last sent 14-bit (EXP_NONE14 = none)
+static uint16_t s_pending_mapped14[EXPFS_PORT_COUNT];
+
+// per-port response LUT: raw ADC 0..4095 -> position 0..16383 (calibration + invert + curve)
+// rebuilt when exp/fs settings change (config_store_get_expfs_gen), runtime = one lookup
+#define EXP_LUT_LEN 4096
+static uint16_t *s_lut[EXPFS_PORT_COUNT];
+static uint8_t   s_lut_ok[EXPFS_PORT_COUNT];    // 0 = calibration range too small -> output 0
+static uint32_t  s_lut_gen;
+static uint8_t   s_lut_built;
+
+// private copy of both ports' settings (published snapshot, config_store_snap_expfs),
+// copied again together with the LUTs when the exp/fs gen changes -> no config lock here
+static expfs_port_cfg_t s_pcfg[EXPFS_PORT_COUNT];
+
+// auto-range calibration (cal_auto): tracker + last values pushed to config_store
+#define AC_COMMIT_MS 1000   // live LUT update at most once per second (NVS save is lazier)
+static ac_state_t s_ac[EXPFS_PORT_COUNT];
+static uint16_t   s_ac_cmin[EXPFS_PORT_COUNT];
+static uint16_t   s_ac_cmax[EXPFS_PORT_COUNT];
+static uint32_t   s_ac_commit_ms[EXPFS_PORT_COUNT];
+static uint8_t    s_ac_on[EXPFS_PORT_COUNT];
+
+// extra targets: position (0..16383, step 128) -> output value in q7 (val * 128), curve + range folded in
+#define EXP_TGT_LUT_LEN 129
+static uint16_t  s_tgt_lut[EXPFS_PORT_COUNT][EXP_EXTRA_TARGETS][EXP_TGT_LUT_LEN];
+static uint8_t   s_tgt_last[EXPFS_PORT_COUNT][EXP_EXTRA_TARGETS];   // last sent (0xFF = none)
+
+// controllers produced by one mapping pass, posted to midi_out as one batch
+typedef struct {
+    midi_ctl_t v[1 + EXP_EXTRA_TARGETS];
+    int n;
+} exp_batch_t;
 
 
 // fs runtime state
 static uint8_t s_fs_last_level[EXPFS_PORT_COUNT][2]; // [port][tip=0 ring=1] 0=pressed 1=released
-static int     s_fs_hold_ms[EXPFS_PORT_COUNT][2];
-static uint8_t s_fs_long_fired[EXPFS_PORT_COUNT][2];
+static bf_state_t s_fs_bf[EXPFS_PORT_COUNT][2];      // shared button state machine (button_fsm)
 static uint8_t s_fs_ab_state[EXPFS_PORT_COUNT][2];  // toggle a/b state (0=a 1=b)
 
+// long-press one-shot timers: ปลุก expfs_task ตรงเวลา threshold
+static esp_timer_handle_t s_fs_long_timer[EXPFS_PORT_COUNT][2];
+static TaskHandle_t s_expfs_task = NULL;
+
+// jack detect + pin config (pins are written only when the mode changes)
+typedef enum {
+    PINS_NONE = 0,
+    PINS_EXP,       // tip = Vref out, ring = ADC in (pull-down)
+    PINS_PULLUP,    // tip/ring inputs w/ pull-up (switches, probe config)
+} pins_mode_t;
+
+#define JD_SETTLE_US 100   // pull-up (~45k) + cable capacitance settle before a probe read
+
+static uint8_t  s_pins[EXPFS_PORT_COUNT];
+static jd_t     s_jd[EXPFS_PORT_COUNT];
+static uint8_t  s_jd_mode[EXPFS_PORT_COUNT];      // kind | auto<<7 the detector was reset for
+static uint32_t s_jd_probe_ms[EXPFS_PORT_COUNT];
+
 static inline uint32_t now_ms(void)
 {
     return (uint32_t)(xTaskGetTickCount() * portTICK_PERIOD_MS);
@@ -103,20 +165,133 @@ static inline uint16_t median3_u16(uint16_t a, uint16_t b, uint16_t c)
 
 static inline int iabs_local(int v) { return (v < 0) ? -v : v; }
 
-static void exp_curve_init_once(void)
+// preset breakpoints (x%, y%) - x = travel toward val2, y = share of val1..val2
+typedef struct {
+    uint8_t n;
+    uint8_t pts[EXP_CURVE_MAX_PTS][2];
+} exp_curve_pts_t;
+
+static const exp_curve_pts_t CURVE_PRESETS[] = {
+    [EXP_CURVE_LINEAR]  = { 2, { {0, 0}, {100, 100} } },
+    [EXP_CURVE_LOG]     = { 5, { {0, 0}, {4, 25}, {12, 50}, {38, 75}, {100, 100} } },
+    [EXP_CURVE_ANTILOG] = { 5, { {0, 0}, {25, 4}, {50, 12}, {75, 38}, {100, 100} } },
+    [EXP_CURVE_S]       = { 5, { {0, 0}, {25, 10}, {50, 50}, {75, 90}, {100, 100} } },
+};
+
+// piecewise linear through the breakpoints, 14-bit in/out. outside the first/last x -> clamp
+static int32_t curve_eval14(const exp_curve_pts_t *c, int32_t x14)
+{
+    int32_t px = (int32_t)c->pts[0][0] * 16383 / 100;
+    int32_t py = (int32_t)c->pts[0][1] * 16383 / 100;
+    if (x14 <= px) return py;
+
+    for (int i = 1; i < c->n; i++) {
+        int32_t nx = (int32_t)c->pts[i][0] * 16383 / 100;
+        int32_t ny = (int32_t)c->pts[i][1] * 16383 / 100;
+        if (x14 <= nx) {
+            if (nx == px) return ny;
+            return py + (ny - py) * (x14 - px) / (nx - px);
+        }
+        px = nx;
+        py = ny;
+    }
+    return py;
+}
+
+static void exp_tgt_compile(int port, const expfs_port_cfg_t *cfg)
+{
+    for (int k = 0; k < cfg->exp_extra_n && k < EXP_EXTRA_TARGETS; k++) {
+        const exp_target_t *tg = &cfg->exp_extra[k];
+        const exp_curve_pts_t *c = &CURVE_PRESETS[(tg->curve < EXP_CURVE_CUSTOM) ? tg->curve : EXP_CURVE_LINEAR];
+        const int32_t v1 = (int32_t)tg->v1 * 128;
+        const int32_t v2 = (int32_t)tg->v2 * 128;
+
+        for (int i = 0; i < EXP_TGT_LUT_LEN; i++) {
+            int32_t pos = clampi_local(i * 128, 0, 16383);
+            int32_t y = curve_eval14(c, pos);
+            s_tgt_lut[port][k][i] = (uint16_t)(v1 + (int32_t)((int64_t)y * (v2 - v1) / 16383LL));
+        }
+        s_tgt_last[port][k] = 0xFF;
+    }
+}
+
+static void exp_lut_compile(int port, const expfs_port_cfg_t *cfg)
 {
-    if (s_curve_inited) return;
-    for (int i = 0; i < 128; i++) {
-        float x = (float)i / 127.0f;
-        float y = powf(x, EXP_CURVE_GAMMA);
-        int v = (int)lroundf(y * 127.0f);
-        if (v < 0) v = 0;
-        if (v > 127) v = 127;
-        s_curve_lut[i] = (uint8_t)v;
+    exp_tgt_compile(port, cfg);
+
+    if (!s_lut[port]) {
+        uint16_t *t = (uint16_t *)heap_caps_malloc(EXP_LUT_LEN * sizeof(uint16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!t) t = (uint16_t *)heap_caps_malloc(EXP_LUT_LEN * sizeof(uint16_t), MALLOC_CAP_8BIT);
+        if (!t) { ESP_LOGE(TAG, "curve LUT alloc failed port=%d", port); s_lut_ok[port] = 0; return; }
+        s_lut[port] = t;
+    }
+
+    exp_curve_pts_t c;
+    if (cfg->curve == EXP_CURVE_CUSTOM && cfg->curve_n >= 2) {
+        c.n = cfg->curve_n;
+        memcpy(c.pts, cfg->curve_pts, sizeof(c.pts));
+    } else {
+        c = CURVE_PRESETS[(cfg->curve < EXP_CURVE_CUSTOM) ? cfg->curve : EXP_CURVE_LINEAR];
     }
-    s_curve_lut[0] = 0;
-    s_curve_lut[127] = 127;
-    s_curve_inited = 1;
+
+    // calibration meaning (ตาม UI):
+    // - cal_min = เหยียบลงสุด (toe), cal_max = ยกขึ้นสุด (heel)
+    // raw==lo (down) -> position 16383, raw==hi (up) -> 0 ("เหยียบลงค่าลด" ✅ เหมือนเดิม)
+    int lo = (int)cfg->cal_min;
+    int hi = (int)cfg->cal_max;
+    int32_t denom = (int32_t)hi - (int32_t)lo;
+
+    // avoid div0 / too small range
+    s_lut_ok[port] = !(denom > -8 && denom < 8);
+    if (!s_lut_ok[port]) return;
+
+    int mn = (lo < hi) ? lo : hi;
+    int mx = (lo < hi) ? hi : lo;
+
+    uint16_t *t = s_lut[port];
+    for (int raw = 0; raw < EXP_LUT_LEN; raw++) {
+        int r = clampi_local(raw, mn, mx);
+        int32_t n14 = (int32_t)((int64_t)(r - lo) * 16383LL / (int64_t)denom);
+        n14 = 16383 - clampi_local((int)n14, 0, 16383);
+        t[raw] = (uint16_t)clampi_local((int)curve_eval14(&c, n14), 0, 16383);
+    }
+}
+
+// rebuild LUTs after a settings change (web save / calibration / import)
+static void exp_lut_sync(void)
+{
+    uint32_t g = config_store_get_expfs_gen();
+    if (s_lut_built && g == s_lut_gen) return;
+
+    const cfg_expfs_snap_t *snap = config_store_snap_expfs();
+    if (snap) {
+        memcpy(s_pcfg, snap->port, sizeof(s_pcfg));
+        g = snap->ver;
+    }
+    config_store_snap_release();
+    if (!snap) return;   // nothing published yet
+
+    for (int p = 0; p < EXPFS_PORT_COUNT; p++) {
+        const expfs_port_cfg_t *cfg = &s_pcfg[p];
+        exp_lut_compile(p, cfg);
+
+        // re-seed the tracker only when the range came from elsewhere (web cal / import),
+        // our own commits come back here unchanged
+        if (cfg->cal_auto && (!s_ac_on[p] || cfg->cal_min != s_ac_cmin[p] || cfg->cal_max != s_ac_cmax[p])) {
+            ac_seed(&s_ac[p], cfg->cal_min, cfg->cal_max);
+            s_ac_cmin[p] = cfg->cal_min;
+            s_ac_cmax[p] = cfg->cal_max;
+        }
+        s_ac_on[p] = cfg->cal_auto;
+    }
+    s_lut_gen = g;
+    s_lut_built = 1;
+}
+
+static void fs_long_timer_cb(void *arg)
+{
+    (void)arg;
+    if (s_expfs_task) xTaskNotifyGive(s_expfs_task);
 }
 
 static inline int pressed_pin(gpio_num_t g)
@@ -130,9 +305,15 @@ static void adc_init_once(void)
     static int inited = 0;
     if (inited) return;
 
-    // prepare mapping for each port (ring pin used as ADC input)
+    // ADC1 ring pins: continuous DMA + frame averaging (exp_adc), wakes this task per frame
+    int ring_gpio[EXPFS_PORT_COUNT];
+    for (int p = 0; p < EXPFS_PORT_COUNT; p++) ring_gpio[p] = (int)HW[p].ring;
+    (void)exp_adc_start(ring_gpio, EXPFS_PORT_COUNT, s_expfs_task);
+
+    // prepare mapping for each remaining port (oneshot)
     for (int p = 0; p < EXPFS_PORT_COUNT; p++) {
         s_adc_map[p].valid = 0;
+        if (exp_adc_active(p)) continue;
 
         adc_unit_t unit;
         adc_channel_t ch;
@@ -192,24 +373,35 @@ static void adc_init_once(void)
     }
 
     // exp filter init
-    exp_curve_init_once();
     for (int p = 0; p < EXPFS_PORT_COUNT; p++) {
         s_raw_hist[p][0] = 0;
         s_raw_hist[p][1] = 0;
         s_raw_hist[p][2] = 0;
         s_raw_hist_idx[p] = 0;
         s_raw_filt[p] = 0;
+        ef_reset(&s_ef[p]);
         s_pending_mapped[p] = 0xFF;
         s_pending_since_ms[p] = 0;
+        s_last_mapped14[p] = EXP_NONE14;
+        s_pending_mapped14[p] = EXP_NONE14;
     }
 
     // fs init
     for (int p = 0; p < EXPFS_PORT_COUNT; p++) {
         for (int k = 0; k < 2; k++) {
             s_fs_last_level[p][k] = 1;
-            s_fs_hold_ms[p][k] = 0;
-            s_fs_long_fired[p][k] = 0;
+            bf_reset(&s_fs_bf[p][k]);
             s_fs_ab_state[p][k] = 0;
+
+            if (!s_fs_long_timer[p][k]) {
+                const esp_timer_create_args_t targs = {
+                    .callback = fs_long_timer_cb,
+                    .arg = NULL,
+                    .dispatch_method = ESP_TIMER_TASK,
+                    .name = "expfs_long",
+                };
+                if (esp_timer_create(&targs, &s_fs_long_timer[p][k]) != ESP_OK) s_fs_long_timer[p][k] = NULL;
+            }
         }
     }
 
@@ -235,53 +427,16 @@ static int adc_read_raw_port(int port, int *out_raw)
     return 1;
 }
 
-static inline void send_cc_all(uint8_t ch, uint8_t cc, uint8_t val)
-{
-    if (usb_midi_ready_fast()) (void)usb_midi_send_cc(ch, cc, val);
-    if (uart_midi_out_ready_fast()) (void)uart_midi_send_cc(ch, cc, val);
-}
-
 static inline void send_pc_all(uint8_t ch, uint8_t pc)
 {
-    if (usb_midi_ready_fast()) (void)usb_midi_send_pc(ch, pc);
-    if (uart_midi_out_ready_fast()) (void)uart_midi_send_pc(ch, pc);
+    midi_out_pc(ch, pc);
 }
 
-static uint8_t map_exp_value(const expfs_port_cfg_t *cfg, uint16_t raw)
+static uint8_t map_exp_value(int port, const expfs_port_cfg_t *cfg, uint16_t raw)
 {
-    if (!cfg) return 0;
-
-    // calibration meaning (ตาม UI):
-    // - cal_min = เหยียบลงสุด (toe)
-    // - cal_max = ยกขึ้นสุด (heel)
-    // ต้องการทิศทาง: "เหยียบลงค่าลด"  ✅
-    // ดังนั้น: toe(down) -> val ต่ำ, heel(up) -> val สูง
-    int lo = (int)cfg->cal_min; // down (toe)
-    int hi = (int)cfg->cal_max; // up   (heel)
-    int32_t denom = (int32_t)hi - (int32_t)lo;
-
-    // avoid div0 / too small range
-    if (denom > -8 && denom < 8) return 0;
-
-    // clamp raw into [min(lo,hi), max(lo,hi)]
-    int mn = (lo < hi) ? lo : hi;
-    int mx = (lo < hi) ? hi : lo;
-    int r = clampi_local((int)raw, mn, mx);
-
-    // base normalize: lo -> 0, hi -> 127 (denom may be negative)
-    int32_t num = (int32_t)r - (int32_t)lo;
-    int norm127 = (int)((int64_t)num * 127LL / (int64_t)denom);
-    norm127 = clampi_local(norm127, 0, 127);
+    if (!cfg || !s_lut[port] || !s_lut_ok[port]) return 0;
 
-    // apply curve LUT (ตอนนี้ gamma=1 -> linear)
-    norm127 = (int)s_curve_lut[norm127];
-
-    // IMPORTANT: invert direction so "down decreases"
-    // after this:
-    // - raw==lo (down)  => norm127 becomes 127
-    // - raw==hi (up)    => norm127 becomes 0
-    // and later mapping v1..v2 will make down -> lower output (as requested)
-    norm127 = 127 - norm127;
+    int32_t pos = s_lut[port][(raw < EXP_LUT_LEN) ? raw : (EXP_LUT_LEN - 1)];
 
     // output range val1..val2
     int v1 = 0, v2 = 127;
@@ -294,25 +449,95 @@ static uint8_t map_exp_value(const expfs_port_cfg_t *cfg, uint16_t raw)
     }
 
     int out;
-    if (v2 >= v1) out = v1 + (int)((int64_t)norm127 * (v2 - v1) / 127LL);
-    else          out = v1 - (int)((int64_t)norm127 * (v1 - v2) / 127LL);
+    if (v2 >= v1) out = v1 + (int)((int64_t)pos * (v2 - v1) / 16383LL);
+    else          out = v1 - (int)((int64_t)pos * (v1 - v2) / 16383LL);
 
     return clamp7(out);
 }
 
-static void handle_exp_port(int port, const expfs_port_cfg_t *cfg)
+// same LUT, kept at 14 bits (CC only: b=val1, c=val2)
+static uint16_t map_exp_value14(int port, const expfs_port_cfg_t *cfg, uint16_t raw)
 {
-    // EXP mode:
-    // - TIP = 3.3V output high (Vref)
-    // - RING = ADC input
-    gpio_set_direction(HW[port].tip, GPIO_MODE_OUTPUT);
-    gpio_set_level(HW[port].tip, 1);
+    if (!cfg || !s_lut[port] || !s_lut_ok[port]) return 0;
+
+    int32_t pos = s_lut[port][(raw < EXP_LUT_LEN) ? raw : (EXP_LUT_LEN - 1)];
 
-    gpio_set_direction(HW[port].ring, GPIO_MODE_INPUT);
-    // ✅ avoid floating ADC when jack is unplugged (reduces random noise / phantom movement)
-    // internal pulldown is weak (~tens of kΩ) so it won't heavily load typical EXP pedals
-    gpio_set_pull_mode(HW[port].ring, GPIO_PULLDOWN_ONLY);
+    // v1..v2 are 7-bit settings -> stretch to 14-bit so 127 reaches 16383
+    int32_t v1 = (int32_t)cfg->exp_action.b * 16383 / 127;
+    int32_t v2 = (int32_t)cfg->exp_action.c * 16383 / 127;
+
+    int32_t out;
+    if (v2 >= v1) out = v1 + (int32_t)((int64_t)pos * (v2 - v1) / 16383LL);
+    else          out = v1 - (int32_t)((int64_t)pos * (v1 - v2) / 16383LL);
+
+    return (uint16_t)clampi_local((int)out, 0, 16383);
+}
+
+static void exp_batch_add(exp_batch_t *b, uint8_t kind, uint8_t ch, uint16_t id, uint16_t val)
+{
+    if (b->n >= (int)(sizeof(b->v) / sizeof(b->v[0]))) return;
+    b->v[b->n++] = (midi_ctl_t){ .kind = kind, .ch = ch, .id = id, .val = val };
+}
 
+// extra targets: one pass over the shared position, changed values join the batch
+static void exp_targets_collect(int port, const expfs_port_cfg_t *cfg, uint16_t raw_f, exp_batch_t *b)
+{
+    if (!cfg->exp_extra_n || !s_lut[port] || !s_lut_ok[port]) return;
+
+    const uint32_t pos = s_lut[port][(raw_f < EXP_LUT_LEN) ? raw_f : (EXP_LUT_LEN - 1)];
+    const uint32_t i = pos >> 7;
+    const int32_t f = (int32_t)(pos & 127u);
+
+    for (int k = 0; k < cfg->exp_extra_n && k < EXP_EXTRA_TARGETS; k++) {
+        const uint16_t *l = s_tgt_lut[port][k];
+        int32_t q7 = (int32_t)l[i] + ((((int32_t)l[i + 1] - (int32_t)l[i]) * f) >> 7);
+        uint8_t v = clamp7((q7 + 64) >> 7);
+
+        if (v == s_tgt_last[port][k]) continue;
+        s_tgt_last[port][k] = v;
+        exp_batch_add(b, MIDI_CTL_CC7, cfg->exp_extra[k].ch, cfg->exp_extra[k].cc, v);
+    }
+}
+
+static void handle_exp_send14(int port, const expfs_port_cfg_t *cfg, uint16_t raw_f,
+                              uint32_t t, bool throttle_ok, exp_batch_t *b)
+{
+    uint16_t mapped = map_exp_value14(port, cfg, raw_f);
+
+    // stable window: เปลี่ยนน้อยกว่า deadband ไม่นับว่าเคลื่อน
+    uint16_t pend = s_pending_mapped14[port];
+    if (pend == EXP_NONE14 || iabs_local((int)mapped - (int)pend) >= EXP_MIN_DELTA14) {
+        s_pending_mapped14[port] = mapped;
+        s_pending_since_ms[port] = t;
+    }
+
+    uint16_t last = s_last_mapped14[port];
+    int diff = (last == EXP_NONE14) ? 16383 : iabs_local((int)mapped - (int)last);
+    bool stable_ok = (t - s_pending_since_ms[port]) >= EXP_SEND_STABLE_MS;
+
+    // endpoints always land exactly (deadband must not leave the pedal at 16380)
+    int32_t v1 = (int32_t)cfg->exp_action.b * 16383 / 127;
+    int32_t v2 = (int32_t)cfg->exp_action.c * 16383 / 127;
+    bool at_end = (mapped == v1 || mapped == v2) && diff > 0;
+
+    if (!throttle_ok) return;
+    if (!(diff >= EXP_FORCE_DELTA14 || (stable_ok && diff >= EXP_MIN_DELTA14) || at_end)) return;
+
+    s_last_mapped14[port] = mapped;
+    s_last_mapped[port] = (uint8_t)(mapped >> 7);
+
+    uint8_t ch = (uint8_t)clampi_local((int)cfg->exp_action.ch, 1, 16);
+
+    if (cfg->exp_res == EXP_RES_NRPN) {
+        exp_batch_add(b, MIDI_CTL_NRPN, ch, cfg->nrpn, mapped);
+    } else {
+        exp_batch_add(b, MIDI_CTL_CC14, ch, clamp7(cfg->exp_action.a), mapped);
+    }
+}
+
+// oneshot port: one read per loop, median(3) removes single spikes. returns 0..4095
+static uint16_t exp_read_oneshot(int port)
+{
     int raw_i = 0;
     if (adc_read_raw_port(port, &raw_i)) {
         if (raw_i < 0) raw_i = 0;
@@ -320,7 +545,6 @@ static void handle_exp_port(int port, const expfs_port_cfg_t *cfg)
         s_last_raw[port] = (uint16_t)raw_i;
     }
 
-    // -------- median(3) + IIR filtering to reduce jitter --------
     uint16_t raw_u = s_last_raw[port];
 
     // prime history on first run
@@ -328,184 +552,342 @@ static void handle_exp_port(int port, const expfs_port_cfg_t *cfg)
         s_raw_hist[port][0] = raw_u;
         s_raw_hist[port][1] = raw_u;
         s_raw_hist[port][2] = raw_u;
-        s_raw_filt[port] = (int32_t)raw_u;
-    } else {
-        uint8_t idx = s_raw_hist_idx[port];
-        s_raw_hist[port][idx] = raw_u;
-        s_raw_hist_idx[port] = (uint8_t)((idx + 1) % 3);
-
-        uint16_t med = median3_u16(s_raw_hist[port][0], s_raw_hist[port][1], s_raw_hist[port][2]);
-        int32_t f = s_raw_filt[port];
-        f += ((int32_t)med - f) >> EXP_IIR_SHIFT;
-        if (f < 0) f = 0;
-        if (f > 4095) f = 4095;
-        s_raw_filt[port] = f;
+        return raw_u;
     }
 
-    uint16_t raw_f = (uint16_t)s_raw_filt[port];
+    uint8_t idx = s_raw_hist_idx[port];
+    s_raw_hist[port][idx] = raw_u;
+    s_raw_hist_idx[port] = (uint8_t)((idx + 1) % 3);
 
-    // map (with curve) to output value
-    uint8_t mapped = map_exp_value(cfg, raw_f);
+    return median3_u16(s_raw_hist[port][0], s_raw_hist[port][1], s_raw_hist[port][2]);
+}
 
-    uint32_t t = now_ms();
+// widen / decay the calibration range from the filtered signal
+static void exp_autocal_step(int port, const expfs_port_cfg_t *cfg, uint16_t raw_f, uint32_t t)
+{
+    if (!cfg->cal_auto || !s_ac_on[port]) return;
 
-    // stable window: ต้องนิ่งซักพักก่อนส่ง เพื่อตัดอาการแกว่ง +/-1
-    if (mapped != s_pending_mapped[port]) {
-        s_pending_mapped[port] = mapped;
-        s_pending_since_ms[port] = t;
+    ac_state_t *st = &s_ac[port];
+    (void)ac_update(st, raw_f);
+    if (!ac_ready(st)) return;
+    if ((t - s_ac_commit_ms[port]) < AC_COMMIT_MS) return;
+
+    uint16_t mn, mx;
+    ac_get(st, &mn, &mx);
+    if (mn == s_ac_cmin[port] && mx == s_ac_cmax[port]) return;
+
+    s_ac_cmin[port] = mn;
+    s_ac_cmax[port] = mx;
+    s_ac_commit_ms[port] = t;
+    (void)config_store_set_expfs_cal_auto(port, mn, mx);
+}
+
+static void handle_exp_port(int port, const expfs_port_cfg_t *cfg)
+{
+    // pins are already in PINS_EXP (expfs_port_step)
+    uint16_t in;
+    if (exp_adc_active(port)) {
+        // DMA port: already a frame average (EXP_ADC_FRAME_CONV samples)
+        if (!exp_adc_get(port, &in)) return;
+        s_last_raw[port] = in;
+    } else {
+        in = exp_read_oneshot(port);
     }
 
-    int last_sent = (int)s_last_mapped[port];
-    int diff = (last_sent == 0xFF) ? 127 : iabs_local((int)mapped - last_sent);
-    bool stable_ok = (t - s_pending_since_ms[port]) >= EXP_SEND_STABLE_MS;
+    // adaptive smoothing: heavy at rest, near zero lag while the pedal moves fast
+    const ef_cfg_t fc = { .min_cut_dhz = cfg->flt_min_cut, .beta_dhz = cfg->flt_beta };
+    s_raw_filt[port] = (int32_t)ef_update(&s_ef[port], &fc, in, esp_timer_get_time());
+
+    uint16_t raw_f = (uint16_t)s_raw_filt[port];
+
+    uint32_t t = now_ms();
+    exp_autocal_step(port, cfg, raw_f, t);
     bool throttle_ok = (t - s_last_send_ms[port]) >= EXP_SEND_THROTTLE_MS;
+    exp_batch_t batch = { .n = 0 };
 
-    if (mapped != s_last_mapped[port] && throttle_ok && (stable_ok || diff >= EXP_FORCE_DELTA || s_last_mapped[port] == 0xFF)) {
-        s_last_send_ms[port] = t;
-        s_last_mapped[port] = mapped;
+    if (cfg->exp_action.type == ACT_CC &&
+        (cfg->exp_res == EXP_RES_NRPN || (cfg->exp_res == EXP_RES_14BIT && cfg->exp_action.a < 32))) {
+        // high resolution output (CC only; 14-bit CC needs an LSB partner -> cc 0..31)
+        handle_exp_send14(port, cfg, raw_f, t, throttle_ok, &batch);
+    } else {
+        // map (with curve) to output value
+        uint8_t mapped = map_exp_value(port, cfg, raw_f);
+
+        // stable window: ต้องนิ่งซักพักก่อนส่ง เพื่อตัดอาการแกว่ง +/-1
+        if (mapped != s_pending_mapped[port]) {
+            s_pending_mapped[port] = mapped;
+            s_pending_since_ms[port] = t;
+        }
+
+        int last_sent = (int)s_last_mapped[port];
+        int diff = (last_sent == 0xFF) ? 127 : iabs_local((int)mapped - last_sent);
+        bool stable_ok = (t - s_pending_since_ms[port]) >= EXP_SEND_STABLE_MS;
 
-        uint8_t ch = (uint8_t)clampi_local((int)cfg->exp_action.ch, 1, 16);
+        if (mapped != s_last_mapped[port] && throttle_ok && (stable_ok || diff >= EXP_FORCE_DELTA || s_last_mapped[port] == 0xFF)) {
+            s_last_mapped[port] = mapped;
 
-        if (cfg->exp_action.type == ACT_CC) {
-            uint8_t cc = clamp7(cfg->exp_action.a);
-            send_cc_all(ch, cc, mapped);
-        } else if (cfg->exp_action.type == ACT_PC) {
-            send_pc_all(ch, mapped);
+            uint8_t ch = (uint8_t)clampi_local((int)cfg->exp_action.ch, 1, 16);
+
+            if (cfg->exp_action.type == ACT_CC) {
+                exp_batch_add(&batch, MIDI_CTL_CC7, ch, clamp7(cfg->exp_action.a), mapped);
+            } else if (cfg->exp_action.type == ACT_PC) {
+                s_last_send_ms[port] = t;
+                send_pc_all(ch, mapped);
+            }
         }
     }
-}
 
-static void run_actions_trigger_list(const action_t *list, cc_behavior_t cc_beh)
-{
-    midi_actions_run(list, MAX_ACTIONS, cc_beh, MIDI_EVT_TRIGGER);
+    // extra targets ride the same throttle and go out in the same batch as the main value
+    if (throttle_ok) exp_targets_collect(port, cfg, raw_f, &batch);
+
+    if (batch.n) {
+        s_last_send_ms[port] = t;
+        midi_out_ctl_batch(batch.v, batch.n);
+    }
 }
-static void run_actions_down_up_list(const action_t *list, cc_behavior_t cc_beh, int event)
+
+static void emit_fs(void *ctx, int list_b, int event)
 {
-    midi_actions_run(list, MAX_ACTIONS, cc_beh, event);
+    const expfs_btncfg_t *m = (const expfs_btncfg_t *)ctx;
+    midi_actions_run(list_b ? m->long_actions : m->short_actions, MAX_ACTIONS, m->cc_behavior, event);
 }
 
-static void handle_fs_one(int port, int which /*0 tip, 1 ring*/, gpio_num_t pin, const expfs_btncfg_t *m)
+static void handle_fs_one(int port, int which /*0 tip, 1 ring*/, gpio_num_t pin,
+                          const expfs_btncfg_t *m, uint16_t long_ms)
 {
-    const int LONG_MS = 400;
+    const int64_t t = esp_timer_get_time();
 
     int now = gpio_get_level(pin); // 0 pressed, 1 released
     uint8_t last = s_fs_last_level[port][which];
+    bf_state_t *st = &s_fs_bf[port][which];
+    esp_timer_handle_t tmr = s_fs_long_timer[port][which];
 
-    const action_t *listA = m->short_actions;
-    const action_t *listB = m->long_actions;
+    // jack switch: 0..2 only (no group led)
+    bf_cfg_t bc = {
+        .mode = (uint8_t)((m->press_mode <= BTN_TOGGLE) ? m->press_mode : BTN_SHORT),
+        .momentary = (m->cc_behavior == CC_MOMENTARY) ? 1u : 0u,
+        .long_us = (uint32_t)long_ms * 1000u,
+    };
 
-    // edge down
+    uint16_t ops = 0;
     if (last == 1 && now == 0) {
-        s_fs_hold_ms[port][which] = 0;
-        s_fs_long_fired[port][which] = 0;
-
-        // momentary down
-        if (m->cc_behavior == CC_MOMENTARY) {
-            if (m->press_mode == BTN_TOGGLE) {
-                uint8_t st = s_fs_ab_state[port][which] ? 1 : 0;
-                run_actions_down_up_list(st ? listB : listA, m->cc_behavior, MIDI_EVT_DOWN);
-            } else {
-                run_actions_down_up_list(listA, m->cc_behavior, MIDI_EVT_DOWN);
-            }
-        }
-
-        // toggle immediate
-        if (m->press_mode == BTN_TOGGLE) {
-            uint8_t st = s_fs_ab_state[port][which] ? 1 : 0;
-            run_actions_trigger_list(st ? listB : listA, m->cc_behavior);
-            s_fs_ab_state[port][which] = (uint8_t)!st;
-        }
+        ops = bf_step(st, &bc, &s_fs_ab_state[port][which], BF_EV_DOWN, t);
+    } else if (last == 0 && now == 1) {
+        ops = bf_step(st, &bc, &s_fs_ab_state[port][which], BF_EV_UP, t);
+    } else if (now == 0) {
+        ops = bf_poll(st, &bc, &s_fs_ab_state[port][which], t);
     }
 
-    // hold
-    if (now == 0) {
-        s_fs_hold_ms[port][which] += 10;
+    if ((ops & BF_OP_DISARM_LONG) && tmr) (void)esp_timer_stop(tmr);
 
-        if (m->press_mode == BTN_SHORT_LONG &&
-            !s_fs_long_fired[port][which] &&
-            s_fs_hold_ms[port][which] >= LONG_MS)
-        {
-            run_actions_trigger_list(listB, m->cc_behavior);
-            s_fs_long_fired[port][which] = 1;
-        }
+    // latency origin = poll time of the edge (long-press output is not timed)
+    const bool edge = (now != (int)last);
+    if (edge) lat_origin_begin(t);
+    bf_exec(ops, emit_fs, (void *)m);
+    if (edge) lat_origin_end();
+
+    if ((ops & BF_OP_ARM_LONG) && tmr) {
+        int64_t remain = bf_long_deadline(st, &bc) - esp_timer_get_time();
+        if (remain < 1) remain = 1;
+        (void)esp_timer_stop(tmr);
+        (void)esp_timer_start_once(tmr, (uint64_t)remain);
     }
 
-    // edge up
-    if (last == 0 && now == 1) {
-        if (m->cc_behavior == CC_MOMENTARY) {
-            if (m->press_mode == BTN_TOGGLE) {
-                // use state BEFORE flip is ok; momentary expects "same selection"
-                uint8_t st = s_fs_ab_state[port][which] ? 1 : 0;
-                run_actions_down_up_list(st ? listB : listA, m->cc_behavior, MIDI_EVT_UP);
-            } else {
-                run_actions_down_up_list(listA, m->cc_behavior, MIDI_EVT_UP);
-            }
-        }
+    s_fs_last_level[port][which] = (uint8_t)now;
+}
 
-        if (m->press_mode == BTN_SHORT) {
-            run_actions_trigger_list(listA, m->cc_behavior);
-        }
+static void handle_fs_port(int port, const expfs_port_cfg_t *cfg, expfs_kind_t kind)
+{
+    // pins are already in PINS_PULLUP (expfs_port_step)
+    if (kind == EXPFS_KIND_SINGLE_SW) {
+        handle_fs_one(port, 0, HW[port].tip, &cfg->tip, cfg->long_ms[0]);
+    } else if (kind == EXPFS_KIND_DUAL_SW) {
+        handle_fs_one(port, 0, HW[port].tip,  &cfg->tip,  cfg->long_ms[0]);
+        handle_fs_one(port, 1, HW[port].ring, &cfg->ring, cfg->long_ms[1]);
+    }
+}
 
-        if (m->press_mode == BTN_SHORT_LONG) {
-            if (!s_fs_long_fired[port][which] && s_fs_hold_ms[port][which] < 400) {
-                run_actions_trigger_list(listA, m->cc_behavior);
-            }
-        }
+// -------------------- jack detect / pin config --------------------
+static void pins_set(int port, pins_mode_t m)
+{
+    if (s_pins[port] == m) return;
+    s_pins[port] = (uint8_t)m;
+
+    if (m == PINS_EXP) {
+        // EXP mode:
+        // - TIP = 3.3V output high (Vref)
+        // - RING = ADC input
+        gpio_set_direction(HW[port].tip, GPIO_MODE_OUTPUT);
+        gpio_set_level(HW[port].tip, 1);
+
+        gpio_set_direction(HW[port].ring, GPIO_MODE_INPUT);
+        // ✅ avoid floating ADC when jack is unplugged (reduces random noise / phantom movement)
+        // internal pulldown is weak (~tens of kΩ) so it won't heavily load typical EXP pedals
+        gpio_set_pull_mode(HW[port].ring, GPIO_PULLDOWN_ONLY);
+    } else {
+        // FS mode / probe: tip/ring are inputs w/ pull-up
+        gpio_set_direction(HW[port].tip, GPIO_MODE_INPUT);
+        gpio_set_pull_mode(HW[port].tip, GPIO_PULLUP_ONLY);
 
-        s_fs_hold_ms[port][which] = 0;
-        s_fs_long_fired[port][which] = 0;
+        gpio_set_direction(HW[port].ring, GPIO_MODE_INPUT);
+        gpio_set_pull_mode(HW[port].ring, GPIO_PULLUP_ONLY);
     }
+}
 
-    s_fs_last_level[port][which] = (uint8_t)now;
+// forget EXP send/filter state so a (re)plugged pedal starts clean
+static void exp_reset_port(int port)
+{
+    s_last_mapped[port] = 0xFF;
+    s_pending_mapped[port] = 0xFF;
+    s_last_mapped14[port] = EXP_NONE14;
+    s_pending_mapped14[port] = EXP_NONE14;
+    s_raw_hist[port][0] = s_raw_hist[port][1] = s_raw_hist[port][2] = 0;
+    ef_reset(&s_ef[port]);
+    for (int k = 0; k < EXP_EXTRA_TARGETS; k++) s_tgt_last[port][k] = 0xFF;
 }
 
-static void handle_fs_port(int port, const expfs_port_cfg_t *cfg)
+static void fs_reset_port(int port)
+{
+    for (int k = 0; k < 2; k++) {
+        s_fs_last_level[port][k] = 1;
+        bf_reset(&s_fs_bf[port][k]);
+        if (s_fs_long_timer[port][k]) (void)esp_timer_stop(s_fs_long_timer[port][k]);
+    }
+}
+
+// EXP active: flip to pull-ups for a moment and look at tip/ring (pot pulls tip low)
+static void jack_probe_exp(int port)
 {
-    // FS mode: tip/ring are inputs w/ pull-up
     gpio_set_direction(HW[port].tip, GPIO_MODE_INPUT);
     gpio_set_pull_mode(HW[port].tip, GPIO_PULLUP_ONLY);
-
-    gpio_set_direction(HW[port].ring, GPIO_MODE_INPUT);
     gpio_set_pull_mode(HW[port].ring, GPIO_PULLUP_ONLY);
+    esp_rom_delay_us(JD_SETTLE_US);
+
+    int tip = gpio_get_level(HW[port].tip);
+    int ring = gpio_get_level(HW[port].ring);
 
-    if (cfg->kind == EXPFS_KIND_SINGLE_SW) {
-        handle_fs_one(port, 0, HW[port].tip, &cfg->tip);
-    } else if (cfg->kind == EXPFS_KIND_DUAL_SW) {
-        handle_fs_one(port, 0, HW[port].tip,  &cfg->tip);
-        handle_fs_one(port, 1, HW[port].ring, &cfg->ring);
+    s_pins[port] = PINS_NONE;
+    pins_set(port, PINS_EXP);
+    exp_adc_skip(port, 2);   // drop frames that saw the probe
+
+    (void)jd_probe(&s_jd[port], tip, ring);
+}
+
+// ring ADC in probe config (wiper evidence). -1 = no sample this loop
+static int jack_ring_adc(int port)
+{
+    if (exp_adc_active(port)) {
+        uint16_t v = 0;
+        return exp_adc_get(port, &v) ? (int)v : -1;
+    }
+    int raw = 0;
+    return adc_read_raw_port(port, &raw) ? raw : -1;
+}
+
+static const char *jack_name(jack_state_t js)
+{
+    switch (js) {
+    case JACK_EMPTY:  return "empty";
+    case JACK_EXP:    return "exp";
+    case JACK_SINGLE: return "single";
+    case JACK_DUAL:   return "dual";
+    default:          return "unknown";
     }
 }
 
+static void expfs_port_step(int port, const expfs_port_cfg_t *cfg)
+{
+    const uint32_t t = now_ms();
+    const uint8_t mode = (uint8_t)((uint8_t)cfg->kind | (cfg->kind_auto ? 0x80u : 0u));
+    jd_t *d = &s_jd[port];
+
+    if (mode != s_jd_mode[port]) {
+        s_jd_mode[port] = mode;
+        // manual exp: assume the pedal is there (same as before) until a probe says otherwise
+        jd_reset(d, (!cfg->kind_auto && cfg->kind == EXPFS_KIND_EXP) ? JACK_EXP : JACK_UNKNOWN);
+        s_jd_probe_ms[port] = t;
+        exp_reset_port(port);
+        fs_reset_port(port);
+    }
+
+    // manual switch kinds: no detection, pins set once, no ADC
+    if (!cfg->kind_auto && cfg->kind != EXPFS_KIND_EXP) {
+        pins_set(port, PINS_PULLUP);
+        exp_adc_enable(port, false);
+        handle_fs_port(port, cfg, cfg->kind);
+        return;
+    }
+
+    const jack_state_t prev = (jack_state_t)d->state;
+
+    if (d->state == JACK_EXP) {
+        pins_set(port, PINS_EXP);
+        exp_adc_enable(port, true);
+
+        if ((t - s_jd_probe_ms[port]) >= JD_PROBE_MS) {
+            s_jd_probe_ms[port] = t;
+            jack_probe_exp(port);
+        }
+        if (d->state == JACK_EXP) {
+            handle_exp_port(port, cfg);
+            return;
+        }
+    } else {
+        // probe config: the switch pins themselves, every loop is an observation
+        pins_set(port, PINS_PULLUP);
+
+        int tip = gpio_get_level(HW[port].tip);
+        int ring = gpio_get_level(HW[port].ring);
+
+        // ADC only while a pedal is possible (tip + ring low): empty jack -> no sampling
+        bool want_adc = jd_want_adc(d) || (tip == 0 && ring == 0);
+        exp_adc_enable(port, want_adc);
+
+        (void)jd_sample(d, tip, ring, want_adc ? jack_ring_adc(port) : -1, t);
+    }
+
+    if (d->state != prev) {
+        ESP_LOGI(TAG, "port=%d jack: %s -> %s", port + 1, jack_name(prev), jack_name((jack_state_t)d->state));
+        s_jd_probe_ms[port] = t;
+        exp_reset_port(port);
+        fs_reset_port(port);
+        if (d->state != JACK_EXP) exp_adc_enable(port, false);
+        return;   // pins follow on the next loop
+    }
+
+    // manual exp with no pedal: stay quiet
+    if (!cfg->kind_auto) return;
+
+    if (d->state == JACK_SINGLE) handle_fs_port(port, cfg, EXPFS_KIND_SINGLE_SW);
+    else if (d->state == JACK_DUAL) handle_fs_port(port, cfg, EXPFS_KIND_DUAL_SW);
+}
+
 static void expfs_task(void *arg)
 {
     (void)arg;
 
+    s_expfs_task = xTaskGetCurrentTaskHandle();
+    lat_origin_register();
     adc_init_once();
 
-    // init GPIO levels cache
+    // init GPIO levels cache + jack detect
     for (int p = 0; p < EXPFS_PORT_COUNT; p++) {
         s_fs_last_level[p][0] = 1;
         s_fs_last_level[p][1] = 1;
+        s_pins[p] = PINS_NONE;
+        s_jd_mode[p] = 0xFF;
+        jd_reset(&s_jd[p], JACK_UNKNOWN);
     }
 
     while (1) {
-        const expfs_port_cfg_t *c0 = config_store_get_expfs_cfg(0);
-        const expfs_port_cfg_t *c1 = config_store_get_expfs_cfg(1);
-
-        const expfs_port_cfg_t *cfgs[2] = { c0, c1 };
+        exp_lut_sync();
 
-        for (int p = 0; p < EXPFS_PORT_COUNT; p++) {
-            const expfs_port_cfg_t *cfg = cfgs[p];
-            if (!cfg) continue;
-
-            if (cfg->kind == EXPFS_KIND_EXP) {
-                handle_exp_port(p, cfg);
-            } else {
-                handle_fs_port(p, cfg);
-            }
+        for (int p = 0; s_lut_built && p < EXPFS_PORT_COUNT; p++) {
+            expfs_port_step(p, &s_pcfg[p]);
         }
 
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // 10ms scan; long-press timer / DMA frame (exp_adc, ทุก EXP_ADC_PERIOD_US) ปลุกก่อนได้
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(10));
     }
 }
 
@@ -515,6 +897,13 @@ void expfs_start(void)
     ESP_LOGI(TAG, "EXP/FS started (ports=%d)", EXPFS_PORT_COUNT);
 }
 
+void expfs_port_gpio(int port, int *tip, int *ring)
+{
+    const bool ok = (port >= 0 && port < EXPFS_PORT_COUNT);
+    if (tip) *tip = ok ? (int)HW[port].tip : -1;
+    if (ring) *ring = ok ? (int)HW[port].ring : -1;
+}
+
 uint16_t expfs_get_last_raw(int port)
 {
     if (port < 0 || port >= EXPFS_PORT_COUNT) return 0;
@@ -10,3 +10,6 @@ uint16_t expfs_get_last_raw(int port);
 
 // save calibration using current raw
 esp_err_t expfs_cal_save(int port, int which_min0_max1);
+
+// jack contacts of port (0..EXPFS_PORT_COUNT-1): tip / ring GPIO, -1 = out of range
+void expfs_port_gpio(int port, int *tip, int *ring);
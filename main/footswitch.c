@@ -1,6 +1,7 @@
 ﻿// ===== FILE: main/footswitch.c =====
 #include <string.h>
 #include <stdint.h>
+#include <stdbool.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -8,11 +9,15 @@
 #include "driver/gpio.h"
 #include "esp_log.h"
 #include "esp_heap_caps.h"
+#include "esp_timer.h"
 
 #include "footswitch.h"
 #include "config_store.h"
 #include "midi_actions.h"
 #include "rgb_led.h"
+#include "edge_queue.h"
+#include "button_fsm.h"
+#include "lat_stats.h"
 
 static const char *TAG = "FOOTSW";
 
@@ -33,8 +38,39 @@ static inline int wrapi(int v, int max)
     return r;
 }
 
+// -------------------- edge capture (GPIO ISR) --------------------
+// ISR จับทุก edge พร้อม timestamp (esp_timer, us) -> edge queue -> ปลุก foot_task ทันที
+// - ไม่ต้อง poll ทุก 10ms อีกต่อไป (ไม่มี jitter จาก tick 100Hz)
+// - debounce: รับ edge แรกทันที แล้วล็อก SW_DEBOUNCE_US ต่อปุ่ม
+//   หลังหมดล็อกจะอ่าน level จริงอีกครั้ง (กัน edge หาย/เด้ง)
+#define SW_DEBOUNCE_US    (5000)
+#define SW_IDLE_WAKE_MS   (50)   // idle: refresh LED / brightness
+#define SW_BUSY_WAKE_MS   (10)   // รอ debounce reconcile
+
+static TaskHandle_t s_foot_task = NULL;
+static edge_queue_t s_edges;
+
+static uint8_t s_level[8];        // debounced level (pull-up: pressed = 0)
+static int64_t s_db_until_us[8];  // debounce lockout end
+
+static void sw_isr(void *arg)
+{
+    int idx = (int)(intptr_t)arg;
+
+    edge_evt_t e = {
+        .t_us  = esp_timer_get_time(),
+        .idx   = (uint8_t)idx,
+        .level = (uint8_t)(gpio_get_level(sw_pins[idx]) ? 1 : 0),
+    };
+    (void)edge_queue_push(&s_edges, &e);
+
+    BaseType_t hp = pdFALSE;
+    if (s_foot_task) vTaskNotifyGiveFromISR(s_foot_task, &hp);
+    if (hp == pdTRUE) portYIELD_FROM_ISR();
+}
+
 // pull-up: pressed = 0
-static inline int pressed(int idx) { return gpio_get_level(sw_pins[idx]) == 0; }
+static inline int pressed(int idx) { return s_level[idx] == 0; }
 
 // -------------------- leds (WS2812) --------------------
 // ใช้ WS2812 (NeoPixel) 8 ดวงเป็น ring
@@ -74,20 +110,14 @@ static inline void led_apply_all(void)
 }
 
 
-// -------------------- run helpers --------------------
-
-static void run_actions_trigger_list(const action_t *list, cc_behavior_t cc_beh)
-{
-    midi_actions_run(list, MAX_ACTIONS, cc_beh, MIDI_EVT_TRIGGER);
-}
+footswitch_state_t footswitch_get_state(void) { return s_state; }
 
-static void run_actions_down_up_list(const action_t *list, cc_behavior_t cc_beh, int event)
+int footswitch_gpio(int idx)
 {
-    midi_actions_run(list, MAX_ACTIONS, cc_beh, event);
+    if (idx < 0 || idx >= 8) return -1;
+    return (int)sw_pins[idx];
 }
 
-footswitch_state_t footswitch_get_state(void) { return s_state; }
-
 void footswitch_set_bank(int bank)
 {
     int bc = config_store_bank_count();
@@ -99,81 +129,13 @@ void footswitch_set_bank(int bank)
     (void)config_store_set_current_bank((uint8_t)bank);
 }
 
-// -------------------- combo / nav lock --------------------
-// combo:
-// 5&6 -> bank--
-// 7&8 -> bank++
-static uint8_t s_combo_mask = 0;
-
-// ✅ NEW: lock ทุกปุ่มระหว่างยังค้างคอมโบอยู่
-static uint8_t s_nav_lock = 0;
-static uint8_t s_nav_hold_mask = 0;     // ปุ่มที่ต้องปล่อยครบถึงปลดล็อก
-static uint8_t s_nav_consumed_mask = 0; // ปุ่มที่ถูกใช้เป็นคอมโบแล้ว ห้ามยิง action ใด ๆ
-static uint8_t s_nav_pending_mask = 0;  // ปุ่ม 5-8 ที่ถูกกดเดี่ยว ๆ (defer ยิงตอนปล่อย)
-
-// helper: เช็คว่ามีปุ่มใน mask ยังค้างอยู่ไหม
-static inline int mask_any_pressed(uint8_t mask)
-{
-    for (int i = 0; i < 8; i++) {
-        if (mask & (1u << i)) {
-            if (pressed(i)) return 1;
-        }
-    }
-    return 0;
-}
-
-static void apply_combo_logic(void)
-{
-    int b5 = pressed(4);
-    int b6 = pressed(5);
-    int b7 = pressed(6);
-    int b8 = pressed(7);
-
-    // ถ้าล็อกอยู่: รอจนปล่อยคอมโบครบ 2 ปุ่ม
-    if (s_nav_lock) {
-        if (!mask_any_pressed(s_nav_hold_mask)) {
-            s_nav_lock = 0;
-            s_nav_hold_mask = 0;
-            s_nav_consumed_mask = 0;
-            s_combo_mask = 0;
-        }
-        return;
-    }
-
-    // detect combo ทันที (ไม่หน่วง)
-    if (b5 && b6) {
-        footswitch_set_bank((int)s_state.bank - 1);
-
-        s_combo_mask = (1u << 4) | (1u << 5);
-        s_nav_lock = 1;
-        s_nav_hold_mask = s_combo_mask;
-        s_nav_consumed_mask = s_combo_mask;
-
-        // ✅ ปุ่มคู่นี้ถูกใช้เป็นคอมโบแล้ว => ยกเลิก pending (กันไม่ให้ไปยิงตอนปล่อย)
-        s_nav_pending_mask &= (uint8_t)~s_combo_mask;
-        return;
-    }
-
-    if (b7 && b8) {
-        footswitch_set_bank((int)s_state.bank + 1);
-
-        s_combo_mask = (1u << 6) | (1u << 7);
-        s_nav_lock = 1;
-        s_nav_hold_mask = s_combo_mask;
-        s_nav_consumed_mask = s_combo_mask;
-
-        s_nav_pending_mask &= (uint8_t)~s_combo_mask;
-        return;
-    }
-
-    // ไม่มีคอมโบ: ไม่ต้องแตะ mask (pending จะตัดสินใจตอนปล่อย)
-}
-
 // -------------------- dynamic state (heap/PSRAM) --------------------
 typedef struct {
     uint8_t *ab_state;      // [MAX_BANKS][NUM_BTNS] 0=A,1=B
     uint8_t *group_sel;     // [MAX_BANKS] selected index 0..7 or 0xFF
-    uint8_t  pressed_sel[NUM_BTNS]; // 0=A,1=B (per button for momentary toggle)
+    midi_prog_t *prog;      // [NUM_BTNS][2] compiled short/long lists of the active bank
+    int      prog_bank;     // bank compiled in prog (-1 = none)
+    uint32_t prog_ver;      // snapshot ver at compile time
     uint8_t  inited;
 } foot_dyn_t;
 
@@ -197,8 +159,6 @@ static void dyn_state_init_once(void)
     s_dyn.group_sel = (uint8_t *)heap_caps_malloc(gp_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
     if (!s_dyn.group_sel) s_dyn.group_sel = (uint8_t *)heap_caps_malloc(gp_bytes, MALLOC_CAP_8BIT);
 
-    memset(s_dyn.pressed_sel, 0, sizeof(s_dyn.pressed_sel));
-
     if (s_dyn.ab_state) {
         memset(s_dyn.ab_state, 0, ab_bytes);
     } else {
@@ -211,6 +171,14 @@ static void dyn_state_init_once(void)
         ESP_LOGE(TAG, "no heap for group_sel (%u bytes) -> group led won't persist", (unsigned)gp_bytes);
     }
 
+    const size_t pg_bytes = sizeof(midi_prog_t) * (size_t)NUM_BTNS * 2u;
+    s_dyn.prog = (midi_prog_t *)heap_caps_malloc(pg_bytes, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_dyn.prog) s_dyn.prog = (midi_prog_t *)heap_caps_malloc(pg_bytes, MALLOC_CAP_8BIT);
+    if (!s_dyn.prog) {
+        ESP_LOGE(TAG, "no heap for midi programs (%u bytes) -> run action lists directly", (unsigned)pg_bytes);
+    }
+    s_dyn.prog_bank = -1;
+
     s_dyn.inited = 1;
 }
 
@@ -238,29 +206,398 @@ static inline void dyn_set_group(int bank, uint8_t v)
     s_dyn.group_sel[bank] = v;
 }
 
-static inline int is_nav_candidate_btn(int i)
+// -------------------- active bank view --------------------
+// private copy of the active bank's published snapshot (config_store_snap_bank):
+// copied again only when the bank or its version changes, no config lock in this task
+static cfg_bank_snap_t s_view;
+static int      s_view_bank = -1;
+static uint32_t s_view_ver;     // config_store_get_bank_ver() seen at copy time
+static uint8_t  s_view_ok;      // 0 = bank not published (no config)
+
+static const cfg_bank_snap_t *view_sync(int bank)
 {
-    // ปุ่ม 5-8 (index 4..7) เป็นปุ่มที่สามารถเข้า combo bank ได้
-    return (i >= 4 && i <= 7);
+    uint32_t ver = config_store_get_bank_ver(bank);
+    if (bank != s_view_bank || ver != s_view_ver) {
+        const cfg_bank_snap_t *snap = config_store_snap_bank(bank);
+        if (snap) memcpy(&s_view, snap, sizeof(s_view));
+        config_store_snap_release();
+
+        s_view_bank = bank;
+        s_view_ok = snap ? 1u : 0u;
+        // a newer copy may have been published in between -> take the one we hold
+        s_view_ver = snap ? s_view.ver : ver;
+    }
+    return s_view_ok ? &s_view : NULL;
 }
 
-static void foot_task(void *arg)
+// ✅ compile action lists ของ bank ที่ active (ครั้งเดียวต่อการเปลี่ยน bank / แก้ config)
+static void prog_sync(const cfg_bank_snap_t *v)
+{
+    if (!s_dyn.prog || !v) return;
+    if (s_dyn.prog_bank == (int)v->bank && s_dyn.prog_ver == v->ver) return;
+
+    for (int i = 0; i < NUM_BTNS; i++) {
+        const btn_map_t *m = &v->map[i];
+        midi_prog_compile(&s_dyn.prog[i * 2 + 0], m->short_actions, MAX_ACTIONS, m->cc_behavior);
+        midi_prog_compile(&s_dyn.prog[i * 2 + 1], m->long_actions,  MAX_ACTIONS, m->cc_behavior);
+    }
+    s_dyn.prog_bank = (int)v->bank;
+    s_dyn.prog_ver = v->ver;
+}
+
+// -------------------- per-button state machine --------------------
+// กด/ค้าง/ปล่อย ตัดสินใน button_fsm (ตารางเดียวกับ EXP/FS)
+// - long-press: เวลาอ้างอิงจาก timestamp ตอนกด + one-shot esp_timer ต่อปุ่ม
+static bf_state_t s_bf[8];
+static esp_timer_handle_t s_long_timer[8];
+
+static void wake_timer_cb(void *arg)
 {
     (void)arg;
+    if (s_foot_task) xTaskNotifyGive(s_foot_task);
+}
 
-    dyn_state_init_once();
+static void btn_cfg(const cfg_bank_snap_t *v, int i, bf_cfg_t *out)
+{
+    const btn_map_t *m = &v->map[i];
+    out->mode = (uint8_t)m->press_mode;
+    out->momentary = (m->cc_behavior == CC_MOMENTARY) ? 1u : 0u;
+    out->long_us = (uint32_t)v->long_ms[i] * 1000u;
+}
+
+typedef struct {
+    const btn_map_t   *m;
+    const midi_prog_t *prog;   // [2] short/long, NULL -> walk the action lists
+} btn_emit_ctx_t;
+
+static void emit_btn(void *ctx, int list_b, int event)
+{
+    const btn_emit_ctx_t *c = (const btn_emit_ctx_t *)ctx;
+    if (c->prog) {
+        midi_prog_run(&c->prog[list_b ? 1 : 0], event);
+        return;
+    }
+    const btn_map_t *m = c->m;
+    midi_actions_run(list_b ? m->long_actions : m->short_actions, MAX_ACTIONS, m->cc_behavior, event);
+}
+
+static void run_ops(const btn_map_t *m, const bf_cfg_t *bc, int bank, int i, uint16_t ops)
+{
+    if ((ops & BF_OP_DISARM_LONG) && s_long_timer[i]) (void)esp_timer_stop(s_long_timer[i]);
+
+    btn_emit_ctx_t ec = {
+        .m = m,
+        .prog = (s_dyn.prog && s_dyn.prog_bank == bank) ? &s_dyn.prog[i * 2] : NULL,
+    };
+    bf_exec(ops, emit_btn, &ec);
+
+    if (ops & BF_OP_GROUP) dyn_set_group(bank, (uint8_t)i);
+
+    if ((ops & BF_OP_ARM_LONG) && s_long_timer[i]) {
+        int64_t remain = bf_long_deadline(&s_bf[i], bc) - esp_timer_get_time();
+        if (remain < 1) remain = 1;
+        (void)esp_timer_stop(s_long_timer[i]);
+        (void)esp_timer_start_once(s_long_timer[i], (uint64_t)remain);
+    }
+}
+
+static void btn_event(int bank, int i, bf_event_t ev, int64_t t_us)
+{
+    const cfg_bank_snap_t *v = view_sync(bank);
+    if (!v) return;
+
+    const btn_map_t *m = &v->map[i];
+    bf_cfg_t bc;
+    prog_sync(v);
+    btn_cfg(v, i, &bc);
+
+    uint8_t ab = dyn_get_ab(bank, i);
+    uint16_t ops = (ev == BF_EV_LONG) ? bf_poll(&s_bf[i], &bc, &ab, t_us)
+                                      : bf_step(&s_bf[i], &bc, &ab, ev, t_us);
+    if (ab != dyn_get_ab(bank, i)) dyn_set_ab(bank, i, ab);
+
+    run_ops(m, &bc, bank, i, ops);
+}
+
+// -------------------- chords (combo) --------------------
+// คอร์ด = ปุ่มหลายปุ่มกดพร้อมกันภายใน coincidence window (config_store_get_chord_ms)
+// - ปุ่มที่อยู่ในคอร์ดใด ๆ: กดแล้วรอไม่เกิน window (ไม่ต้องรอปล่อยอีกต่อไป)
+//   ครบคอร์ด -> ยิง action ทันที, หมด window / กดชุดที่เป็นคอร์ดไม่ได้ -> ส่งเป็นการกดปกติ
+//   (timestamp ตอนกดจริง, long-press นับจากตอนกด)
+// - ปุ่มที่ไม่อยู่ในคอร์ดใด: ไม่มีหน่วงเลย
+// - หลังยิงคอร์ด: lock ทุกปุ่มจนปล่อยปุ่มคอร์ดครบ (ต้องกดใหม่หลังปลดล็อกเท่านั้น)
+typedef enum {
+    CHORD_ACT_BANK_PREV = 0,
+    CHORD_ACT_BANK_NEXT,
+} chord_act_t;
+
+typedef struct {
+    uint8_t mask;   // buttons (bit i = index i), any count >= 2
+    uint8_t act;    // chord_act_t
+} chord_def_t;
+
+static const chord_def_t CHORDS[] = {
+    { (1u << 4) | (1u << 5), CHORD_ACT_BANK_PREV },   // 5&6 -> bank--
+    { (1u << 6) | (1u << 7), CHORD_ACT_BANK_NEXT },   // 7&8 -> bank++
+};
+#define CHORD_COUNT ((int)(sizeof(CHORDS) / sizeof(CHORDS[0])))
+
+static uint8_t s_chord_lock = 0;
+static uint8_t s_chord_hold_mask = 0;     // ปุ่มที่ต้องปล่อยครบถึงปลดล็อก
+static uint8_t s_chord_pending = 0;       // ปุ่มที่กดแล้ว รอ window
+static int64_t s_chord_down_us[8];        // press time of pending buttons
+static int64_t s_chord_deadline_us = 0;   // 0 = no window open
+static esp_timer_handle_t s_chord_timer;
+
+static inline uint8_t chord_buttons(void)
+{
+    uint8_t m = 0;
+    for (int c = 0; c < CHORD_COUNT; c++) m |= CHORDS[c].mask;
+    return m;
+}
+
+static int chord_find(uint8_t mask)
+{
+    for (int c = 0; c < CHORD_COUNT; c++) {
+        if (CHORDS[c].mask == mask) return c;
+    }
+    return -1;
+}
+
+// ยังมีคอร์ดที่ใหญ่กว่าและครอบ mask นี้อยู่ไหม (ถ้าไม่มี ไม่ต้องรอ window)
+static int chord_can_grow(uint8_t mask)
+{
+    for (int c = 0; c < CHORD_COUNT; c++) {
+        if (CHORDS[c].mask != mask && (CHORDS[c].mask & mask) == mask) return 1;
+    }
+    return 0;
+}
+
+static void chord_run(uint8_t act)
+{
+    switch (act) {
+        case CHORD_ACT_BANK_PREV: footswitch_set_bank((int)s_state.bank - 1); break;
+        case CHORD_ACT_BANK_NEXT: footswitch_set_bank((int)s_state.bank + 1); break;
+        default: break;
+    }
+}
+
+static void chord_window_close(void)
+{
+    s_chord_pending = 0;
+    s_chord_deadline_us = 0;
+    if (s_chord_timer) (void)esp_timer_stop(s_chord_timer);
+}
+
+// ส่งปุ่มที่รอ window เข้า state machine ตามลำดับเวลาที่กด
+static void chord_flush(void)
+{
+    uint8_t pend = s_chord_pending;
+    chord_window_close();
+    if (!pend) return;
+
+    int bank = (int)s_state.bank;
+
+    while (pend) {
+        int first = -1;
+        for (int i = 0; i < 8; i++) {
+            if (!(pend & (1u << i))) continue;
+            if (first < 0 || s_chord_down_us[i] < s_chord_down_us[first]) first = i;
+        }
+        pend &= (uint8_t)~(1u << first);
+        btn_event(bank, first, BF_EV_DOWN, s_chord_down_us[first]);
+    }
+}
+
+// window หมดเวลา ณ เวลา t_us -> ตัดสินเป็นการกดปกติ
+static void chord_expire(int64_t t_us)
+{
+    if (s_chord_deadline_us != 0 && t_us >= s_chord_deadline_us) chord_flush();
+}
 
-    // inputs
+static void chord_lock(uint8_t hold_mask)
+{
+    s_chord_lock = 1;
+    s_chord_hold_mask = hold_mask;
+
+    // ปุ่มอื่นที่ค้างอยู่: ทิ้งการกด (ไม่ยิงอะไร)
+    for (int i = 0; i < 8; i++) {
+        if (!bf_is_down(&s_bf[i])) continue;
+        if (s_long_timer[i]) (void)esp_timer_stop(s_long_timer[i]);
+        bf_reset(&s_bf[i]);
+    }
+}
+
+static void chord_unlock_check(void)
+{
+    if (!s_chord_lock) return;
+    for (int i = 0; i < 8; i++) {
+        if ((s_chord_hold_mask & (1u << i)) && pressed(i)) return;
+    }
+    s_chord_lock = 0;
+    s_chord_hold_mask = 0;
+}
+
+// press of a chord button. return 1 if the press is held back for the window.
+static int chord_press(int i, int64_t t_us)
+{
+    uint8_t bit = (uint8_t)(1u << i);
+    if (!(chord_buttons() & bit)) return 0;
+
+    uint8_t pend = (uint8_t)(s_chord_pending | bit);
+
+    if (!s_chord_pending) {
+        uint32_t win_us = (uint32_t)config_store_get_chord_ms() * 1000u;
+        s_chord_deadline_us = t_us + (int64_t)win_us;
+        if (s_chord_timer) {
+            (void)esp_timer_stop(s_chord_timer);
+            (void)esp_timer_start_once(s_chord_timer, (uint64_t)win_us);
+        }
+    }
+    s_chord_pending = pend;
+    s_chord_down_us[i] = t_us;
+
+    int c = chord_find(pend);
+    if (c >= 0) {
+        chord_window_close();
+        chord_lock(CHORDS[c].mask);
+        chord_run(CHORDS[c].act);
+        return 1;
+    }
+
+    // ไม่มีคอร์ดไหนครอบชุดนี้ -> ไม่ต้องรอ (รวมปุ่มนี้ด้วย)
+    if (!chord_can_grow(pend)) chord_flush();
+    return 1;
+}
+
+static void led_render_pass(const cfg_bank_snap_t *v)
+{
+    for (int i = 0; i < 8; i++) {
+        int is_down = pressed(i);
+
+        if (!v) {
+            if (is_down) led_off(i);
+            else led_on(i);
+            continue;
+        }
+
+        int bank = (int)v->bank;
+        const btn_map_t *m = &v->map[i];
+
+        // group mode
+        if (m->press_mode == BTN_SHORT_GROUP_LED) {
+            uint8_t sel = dyn_get_group(bank);
+            int on = (sel == (uint8_t)i) ? 1 : 0;
+            if (is_down) on = 0;
+            if (on) led_on(i); else led_off(i);
+            continue;
+        }
+
+        // toggle: a+b led select (0=A,1=B)
+        if (m->press_mode == BTN_TOGGLE) {
+            uint8_t ledsel = v->ab_led_sel[i];                     // 0=A,1=B
+            int st = dyn_get_ab(bank, i) ? 1 : 0;                  // 0=A,1=B
+            int on = ledsel ? st : (!st);
+
+            if (is_down) on = 0;
+            if (on) led_on(i); else led_off(i);
+            continue;
+        }
+
+        // default: guide
+        if (is_down) led_off(i);
+        else led_on(i);
+    }
+}
+
+// accept one debounced edge and feed it to the state machine at the edge time
+static void accept_edge(int i, uint8_t level, int64_t t_us)
+{
+    s_level[i] = level;
+    s_db_until_us[i] = t_us + SW_DEBOUNCE_US;
+
+    chord_expire(t_us);
+
+    // ✅ ระหว่าง chord lock ห้ามทุกปุ่มยิงค่าใด ๆ
+    if (s_chord_lock) {
+        chord_unlock_check();
+        return;
+    }
+
+    if (level == 0) {
+        if (chord_press(i, t_us)) return;
+    } else if (s_chord_pending & (1u << i)) {
+        // ปล่อยก่อนหมด window -> กดเดี่ยว (DOWN ที่เวลากดจริง แล้ว UP)
+        chord_flush();
+    }
+
+    btn_event((int)s_state.bank, i, level == 0 ? BF_EV_DOWN : BF_EV_UP, t_us);
+}
+
+static void sw_inputs_init(void)
+{
+    edge_queue_reset(&s_edges);
+
+    // inputs (interrupt on both edges)
     gpio_config_t io = {
         .pin_bit_mask = 0,
         .mode = GPIO_MODE_INPUT,
         .pull_up_en = 1,
         .pull_down_en = 0,
-        .intr_type = GPIO_INTR_DISABLE,
+        .intr_type = GPIO_INTR_ANYEDGE,
     };
     for (int i = 0; i < 8; i++) io.pin_bit_mask |= (1ULL << sw_pins[i]);
     gpio_config(&io);
 
+    for (int i = 0; i < 8; i++) {
+        if (!s_long_timer[i]) {
+            const esp_timer_create_args_t targs = {
+                .callback = wake_timer_cb,
+                .arg = (void *)(intptr_t)i,
+                .dispatch_method = ESP_TIMER_TASK,
+                .name = "fs_long",
+            };
+            if (esp_timer_create(&targs, &s_long_timer[i]) != ESP_OK) s_long_timer[i] = NULL;
+        }
+
+        s_level[i] = (uint8_t)(gpio_get_level(sw_pins[i]) ? 1 : 0);
+        s_chord_down_us[i] = 0;
+        s_db_until_us[i] = 0;
+        bf_reset(&s_bf[i]);
+    }
+
+    if (!s_chord_timer) {
+        const esp_timer_create_args_t targs = {
+            .callback = wake_timer_cb,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "fs_chord",
+        };
+        if (esp_timer_create(&targs, &s_chord_timer) != ESP_OK) s_chord_timer = NULL;
+    }
+
+    // ISR service อาจถูกติดตั้งแล้วโดยโมดูลอื่น
+    esp_err_t e = gpio_install_isr_service(0);
+    if (e != ESP_OK && e != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "gpio_install_isr_service failed: %s", esp_err_to_name(e));
+        return;
+    }
+    for (int i = 0; i < 8; i++) {
+        e = gpio_isr_handler_add(sw_pins[i], sw_isr, (void *)(intptr_t)i);
+        if (e != ESP_OK) {
+            ESP_LOGE(TAG, "gpio_isr_handler_add GPIO%d failed: %s", (int)sw_pins[i], esp_err_to_name(e));
+        }
+    }
+}
+
+static void foot_task(void *arg)
+{
+    (void)arg;
+
+    s_foot_task = xTaskGetCurrentTaskHandle();
+    lat_origin_register();
+    dyn_state_init_once();
+
     // ws2812 init (strip already created in app_main, but safe to call again)
     rgb_led_init();
 
@@ -275,229 +612,80 @@ static void foot_task(void *arg)
     for (int i = 0; i < 8; i++) s_led_on[i] = 1;
     led_apply_all();
 
-    uint8_t last[8];
-    for (int i = 0; i < 8; i++) last[i] = 1;
-
-    const int LONG_MS = 400;
-
-    int hold_ms[8] = {0};
-    uint8_t long_fired[8] = {0};
+    sw_inputs_init();
 
     uint8_t last_bri = s_brightness;
+    uint32_t last_dropped = 0;
 
     while (1) {
-        apply_combo_logic();
-
-        // live brightness update
-        uint8_t bri = config_store_get_led_brightness();
-        if (bri > 100) bri = 100;
-        if (bri != last_bri) {
-            last_bri = bri;
-            led_set_brightness(bri);
+        // ปลุกเมื่อมี edge (ISR notify), long timer หรือ timeout สำหรับงานเบื้องหลัง
+        bool busy = false;
+        for (int i = 0; i < 8; i++) {
+            if (s_db_until_us[i] != 0) { busy = true; break; }
+        }
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(busy ? SW_BUSY_WAKE_MS : SW_IDLE_WAKE_MS));
+
+        // 1) edges from ISR (in order, each at its own timestamp)
+        edge_evt_t ev;
+        while (edge_queue_pop(&s_edges, &ev)) {
+            int i = ev.idx;
+            if (i < 0 || i >= 8) continue;
+            if (ev.level == s_level[i]) continue;          // bounce back to same level
+            if (ev.t_us < s_db_until_us[i]) continue;      // inside lockout -> reconcile later
+
+            // latency origin = ISR timestamp; everything posted while handling it is timed
+            lat_since(LAT_EDGE, (uint32_t)ev.t_us | 1u);
+            lat_origin_begin(ev.t_us);
+            accept_edge(i, ev.level, ev.t_us);
+            lat_origin_end();
         }
 
-        const foot_config_t *cfg = config_store_get();
-        int bank = (int)s_state.bank;
-
-        if (!cfg) {
-            for (int i = 0; i < 8; i++) {
-                int now = gpio_get_level(sw_pins[i]);
-                if (now == 0) led_off(i);
-                else led_on(i);
-                last[i] = (uint8_t)now;
-                hold_ms[i] = 0;
-                long_fired[i] = 0;
-            }
-            vTaskDelay(pdMS_TO_TICKS(10));
-            continue;
+        // edge หาย (คิวเต็ม) อาจเป็น edge สุดท้ายของขาที่ไม่มี lockout ค้าง -> อ่านทุกขาใหม่
+        uint32_t dropped = s_edges.dropped;
+        bool resync = false;
+        if (dropped != last_dropped) {
+            ESP_LOGW(TAG, "edge queue overflow (dropped=%u)", (unsigned)dropped);
+            last_dropped = dropped;
+            resync = true;
         }
 
+        // 2) debounce reconcile: หมดล็อกแล้ว level จริงต่างจากที่รับไว้ -> รับเป็น edge ใหม่
+        int64_t t_now = esp_timer_get_time();
         for (int i = 0; i < 8; i++) {
-            int now = gpio_get_level(sw_pins[i]); // 0 pressed, 1 released
-            const btn_map_t *m = &cfg->map[bank][i];
-
-            // ✅ NEW: ระหว่าง nav lock ห้ามปุ่มอื่นยิงค่าใด ๆ
-            // ต้องกดใหม่หลังปลดล็อกเท่านั้น
-            if (s_nav_lock && !(s_nav_hold_mask & (1u << i))) {
-                last[i] = (uint8_t)now;
-                hold_ms[i] = 0;
-                long_fired[i] = 0;
-                continue;
-            }
-
-            // ✅ ปุ่มที่ถูกใช้เป็นคอมโบแล้ว: ห้ามยิง action ใด ๆ
-            if (s_nav_consumed_mask & (1u << i)) {
-                last[i] = (uint8_t)now;
-                hold_ms[i] = 0;
-                long_fired[i] = 0;
-                continue;
-            }
+            if (s_db_until_us[i] == 0 ? !resync : t_now < s_db_until_us[i]) continue;
+            s_db_until_us[i] = 0;
 
-            // (กันปุ่มคอมโบไว้เหมือนเดิม)
-            if (s_combo_mask & (1u << i)) {
-                last[i] = (uint8_t)now;
-                hold_ms[i] = 0;
-                long_fired[i] = 0;
-                continue;
-            }
-
-            const action_t *listA = m->short_actions;
-            const action_t *listB = m->long_actions;
-
-            // ✅ NEW: ปุ่ม 5-8 ทำเป็น "defer" เพื่อกันยิง CC ก่อนจะเข้าคอมโบ
-            if (is_nav_candidate_btn(i)) {
-                // edge: down -> mark pending (ยังไม่ยิงอะไร)
-                if (last[i] == 1 && now == 0) {
-                    s_nav_pending_mask |= (1u << i);
-                    hold_ms[i] = 0;
-                    long_fired[i] = 0;
-                    last[i] = (uint8_t)now;
-                    continue;
-                }
-
-                // hold (เก็บเวลาไว้ตัดสิน short/long ตอนปล่อย)
-                if (now == 0) {
-                    if (s_nav_pending_mask & (1u << i)) {
-                        hold_ms[i] += 10;
-                        last[i] = (uint8_t)now;
-                        continue;
-                    }
-                }
-
-                // edge: up -> ถ้า pending และไม่ได้ถูก consume เป็นคอมโบ -> ยิงตอนปล่อย
-                if (last[i] == 0 && now == 1) {
-                    if (s_nav_pending_mask & (1u << i)) {
-                        // clear pending ก่อน
-                        s_nav_pending_mask &= (uint8_t)~(1u << i);
-
-                        // ทำงาน "ตอนปล่อย" เท่านั้น (กันกรณีคอมโบ)
-                        if (m->press_mode == BTN_SHORT_GROUP_LED) {
-                            run_actions_trigger_list(listA, m->cc_behavior);
-                            dyn_set_group(bank, (uint8_t)i);
-                        } else if (m->press_mode == BTN_TOGGLE) {
-                            uint8_t st = dyn_get_ab(bank, i) ? 1 : 0;
-                            run_actions_trigger_list(st ? listB : listA, m->cc_behavior);
-                            dyn_set_ab(bank, i, (uint8_t)!st);
-                        } else if (m->press_mode == BTN_SHORT_LONG) {
-                            if (hold_ms[i] >= LONG_MS) run_actions_trigger_list(listB, m->cc_behavior);
-                            else run_actions_trigger_list(listA, m->cc_behavior);
-                        } else {
-                            // BTN_SHORT หรืออื่น ๆ -> short
-                            run_actions_trigger_list(listA, m->cc_behavior);
-                        }
-
-                        hold_ms[i] = 0;
-                        long_fired[i] = 0;
-                        last[i] = (uint8_t)now;
-                        continue;
-                    }
-                }
-
-                last[i] = (uint8_t)now;
-                continue;
-            }
+            uint8_t lv = (uint8_t)(gpio_get_level(sw_pins[i]) ? 1 : 0);
+            if (lv != s_level[i]) accept_edge(i, lv, t_now);
+        }
 
-            // -------------------- NORMAL buttons (1-4) --------------------
-            // edge: down
-            if (last[i] == 1 && now == 0) {
-                hold_ms[i] = 0;
-                long_fired[i] = 0;
-
-                // momentary: DOWN
-                if (m->cc_behavior == CC_MOMENTARY) {
-                    if (m->press_mode == BTN_TOGGLE) {
-                        uint8_t st = dyn_get_ab(bank, i) ? 1 : 0;
-                        s_dyn.pressed_sel[i] = st;
-                        run_actions_down_up_list(st ? listB : listA, m->cc_behavior, MIDI_EVT_DOWN);
-                    } else {
-                        run_actions_down_up_list(listA, m->cc_behavior, MIDI_EVT_DOWN);
-                    }
-                }
-
-                // group: trigger + select
-                if (m->press_mode == BTN_SHORT_GROUP_LED) {
-                    run_actions_trigger_list(listA, m->cc_behavior);
-                    dyn_set_group(bank, (uint8_t)i);
-                }
-
-                // toggle: trigger + flip A/B
-                if (m->press_mode == BTN_TOGGLE) {
-                    uint8_t st = dyn_get_ab(bank, i) ? 1 : 0;
-                    run_actions_trigger_list(st ? listB : listA, m->cc_behavior);
-                    dyn_set_ab(bank, i, (uint8_t)!st);
-                }
-            }
+        // 3) chord window / chord release / long-press (timer driven)
+        chord_expire(t_now);
+        chord_unlock_check();
 
-            // hold
-            if (now == 0) {
-                hold_ms[i] += 10;
+        int bank = (int)s_state.bank;
 
-                if (m->press_mode == BTN_SHORT_LONG && !long_fired[i] && hold_ms[i] >= LONG_MS) {
-                    run_actions_trigger_list(listB, m->cc_behavior);
-                    long_fired[i] = 1;
-                }
-            }
+        // bank เปลี่ยน / config ถูกแก้ -> copy + compile ไว้ก่อนกดครั้งถัดไป
+        const cfg_bank_snap_t *v = view_sync(bank);
+        prog_sync(v);
 
-            // edge: up
-            if (last[i] == 0 && now == 1) {
-                if (m->cc_behavior == CC_MOMENTARY) {
-                    if (m->press_mode == BTN_TOGGLE) {
-                        uint8_t sel = s_dyn.pressed_sel[i] ? 1 : 0;
-                        run_actions_down_up_list(sel ? listB : listA, m->cc_behavior, MIDI_EVT_UP);
-                    } else {
-                        run_actions_down_up_list(listA, m->cc_behavior, MIDI_EVT_UP);
-                    }
-                }
-
-                // short: fire on release
-                if (m->press_mode == BTN_SHORT) {
-                    run_actions_trigger_list(listA, m->cc_behavior);
-                }
-
-                if (m->press_mode == BTN_SHORT_LONG) {
-                    if (!long_fired[i] && hold_ms[i] < LONG_MS) {
-                        run_actions_trigger_list(listA, m->cc_behavior);
-                    }
-                }
-
-                hold_ms[i] = 0;
-                long_fired[i] = 0;
+        if (v && !s_chord_lock) {
+            for (int i = 0; i < 8; i++) {
+                if (!bf_is_down(&s_bf[i])) continue;
+                btn_event(bank, i, BF_EV_LONG, t_now);
             }
-
-            last[i] = (uint8_t)now;
         }
 
-        // -------------------- LED render pass --------------------
-        for (int i = 0; i < 8; i++) {
-            const btn_map_t *m = &cfg->map[bank][i];
-            int is_down = (gpio_get_level(sw_pins[i]) == 0);
-
-            // group mode
-            if (m->press_mode == BTN_SHORT_GROUP_LED) {
-                uint8_t sel = dyn_get_group(bank);
-                int on = (sel == (uint8_t)i) ? 1 : 0;
-                if (is_down) on = 0;
-                if (on) led_on(i); else led_off(i);
-                continue;
-            }
-
-            // toggle: a+b led select (0=A,1=B)
-            if (m->press_mode == BTN_TOGGLE) {
-                uint8_t ledsel = config_store_get_ab_led_sel(bank, i); // 0=A,1=B
-                int st = dyn_get_ab(bank, i) ? 1 : 0;                  // 0=A,1=B
-                int on = ledsel ? st : (!st);
-
-                if (is_down) on = 0;
-                if (on) led_on(i); else led_off(i);
-                continue;
-            }
-
-            // default: guide
-            if (is_down) led_off(i);
-            else led_on(i);
+        // live brightness update
+        uint8_t bri = config_store_get_led_brightness();
+        if (bri > 100) bri = 100;
+        if (bri != last_bri) {
+            last_bri = bri;
+            led_set_brightness(bri);
         }
 
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // -------------------- LED render pass --------------------
+        led_render_pass(view_sync((int)s_state.bank));
     }
 }
 
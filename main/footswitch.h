@@ -10,3 +10,6 @@ void footswitch_start(void);
 
 footswitch_state_t footswitch_get_state(void);
 void footswitch_set_bank(int bank);
+
+// GPIO of footswitch idx (0..7), -1 = out of range
+int footswitch_gpio(int idx);
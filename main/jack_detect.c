@@ -0,0 +1,66 @@
+// ===== FILE: main/jack_detect.c =====
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "jack_detect.h"
+
+#define PAT(tip, ring) (uint8_t)(((tip) ? 2u : 0u) | ((ring) ? 1u : 0u))
+
+jack_state_t jd_sample(jd_t *d, int tip, int ring, int ring_adc, uint32_t t_ms)
+{
+    const uint8_t p = PAT(tip, ring);
+
+    if (p != d->pat) {
+        // a ring tap that ends with both contacts open: TS would keep ring low -> dual switch
+        if (d->pat == PAT(1, 0) && p == PAT(1, 1) &&
+            (d->state == JACK_UNKNOWN || d->state == JACK_EMPTY)) {
+            d->state = JACK_DUAL;
+        }
+        d->pat = p;
+        d->since_ms = t_ms;
+        d->evidence = 0;
+    }
+
+    if (p == PAT(0, 0) && ring_adc >= JD_EXP_RING_MIN) d->evidence = 1;
+
+    const uint32_t held = t_ms - d->since_ms;
+
+    switch (p) {
+    case PAT(1, 1):
+        // open: a dual switch released looks the same -> keep DUAL, anything else is empty
+        if (d->state != JACK_DUAL) d->state = JACK_EMPTY;
+        break;
+    case PAT(1, 0):
+        if (held >= JD_SINGLE_MS) d->state = JACK_SINGLE;
+        break;
+    case PAT(0, 1):
+        if (held >= JD_DUAL_MS) d->state = JACK_DUAL;
+        break;
+    default:   // 00: pedal, or switch(es) held
+        if (d->evidence && held >= JD_EXP_MS) d->state = JACK_EXP;
+        break;
+    }
+    return (jack_state_t)d->state;
+}
+
+jack_state_t jd_probe(jd_t *d, int tip, int ring)
+{
+    const uint8_t p = PAT(tip, ring);
+
+    // an EXP pot always pulls tip low
+    if (p == PAT(0, 0)) {
+        d->hits = 0;
+        d->pat = 0xFF;
+        return (jack_state_t)d->state;
+    }
+
+    if (p != d->pat) { d->pat = p; d->hits = 0; }
+    if (++d->hits < JD_PROBE_HITS) return (jack_state_t)d->state;
+
+    d->hits = 0;
+    d->pat = 0xFF;
+    if (p == PAT(1, 1)) d->state = JACK_EMPTY;
+    else if (p == PAT(1, 0)) d->state = JACK_SINGLE;
+    else d->state = JACK_DUAL;
+    return (jack_state_t)d->state;
+}
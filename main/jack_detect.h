@@ -0,0 +1,62 @@
+// ===== FILE: main/jack_detect.h =====
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// What is plugged into an EXP/FS jack (TRS: tip, ring, sleeve = GND).
+//
+// Observations are taken with tip + ring as inputs with pull-up ("probe config"):
+//   tip ring
+//    1   1   nothing / dual switch released  (cannot be told apart -> EMPTY until a press)
+//    1   0   TS single switch (ring touches the plug sleeve), released
+//    0   1   dual switch, tip pressed
+//    0   0   EXP pedal (pot tip->sleeve pulls tip low, wiper sits between)
+//            or switch(es) pressed -> EXP only when the ring ADC shows a wiper voltage
+//
+// - pure C (no ESP-IDF headers) like button_fsm; the caller does GPIO / ADC
+// - while EXP is active the pins are in EXP config: the caller probes at low rate
+//   (jd_probe) and restores the pins afterwards
+
+typedef enum {
+    JACK_UNKNOWN = 0,
+    JACK_EMPTY,
+    JACK_EXP,
+    JACK_SINGLE,
+    JACK_DUAL,
+} jack_state_t;
+
+#define JD_PROBE_MS        250   // EXP state: probe period
+#define JD_PROBE_HITS      2     // consecutive probes that must agree
+#define JD_DUAL_MS         30    // tip pressed + ring open
+#define JD_SINGLE_MS       1000  // ring held low (TS plug) - longer than a normal ring tap
+#define JD_EXP_MS          200   // tip + ring low with wiper evidence
+#define JD_EXP_RING_MIN    48    // ring ADC above this (pull-up config) = pot wiper, not a closed switch
+
+typedef struct {
+    uint8_t  state;       // jack_state_t
+    uint8_t  pat;         // candidate pattern (tip << 1 | ring), 0xFF = none
+    uint8_t  evidence;    // wiper seen during a 00 candidate
+    uint8_t  hits;        // probe agreement count
+    uint32_t since_ms;    // candidate start
+} jd_t;
+
+static inline void jd_reset(jd_t *d, jack_state_t initial)
+{
+    d->state = (uint8_t)initial;
+    d->pat = 0xFF;
+    d->evidence = 0;
+    d->hits = 0;
+    d->since_ms = 0;
+}
+
+// pins in probe config (every loop). ring_adc < 0 = not sampled. returns the state
+jack_state_t jd_sample(jd_t *d, int tip, int ring, int ring_adc, uint32_t t_ms);
+
+// EXP state: one probe result. returns the state
+jack_state_t jd_probe(jd_t *d, int tip, int ring);
+
+// caller should sample the ring ADC (EXP active or possible EXP candidate)
+static inline bool jd_want_adc(const jd_t *d)
+{
+    return d->state == JACK_EXP || d->pat == 0;
+}
@@ -0,0 +1,250 @@
+// ===== FILE: main/lat_stats.c =====
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "cJSON.h"
+
+#include "lat_stats.h"
+
+static const char *TAG = "LAT";
+
+#define LAT_LOG_PERIOD_MS 60000
+#define LAT_ORIGIN_SLOTS  2      // foot_task + expfs_task
+
+typedef struct {
+    volatile uint32_t n;
+    volatile uint32_t max_us;
+    volatile uint32_t b[LAT_BUCKETS];
+} lat_hist_t;
+
+typedef struct {
+    TaskHandle_t task;    // owner, set once (lat_origin_register)
+    uint32_t     t0_us;   // written by the owner only, 0 = no origin
+} lat_origin_t;
+
+static lat_hist_t s_h[LAT_STAGE_COUNT];
+static lat_origin_t s_org[LAT_ORIGIN_SLOTS];
+static esp_timer_handle_t s_log_timer = NULL;
+static uint32_t s_log_n = 0;
+
+static const char *STAGE_NAMES[LAT_STAGE_COUNT] = {
+    "edge", "actions", "submit_usb", "submit_uart", "wire_usb",
+};
+
+// -------------------- buckets (8 per octave) --------------------
+static inline int bucket_of(uint32_t v)
+{
+    if (v < (1u << LAT_SUB_BITS)) return (int)v;
+    int msb = 31 - __builtin_clz(v);
+    int idx = ((msb - (LAT_SUB_BITS - 1)) << LAT_SUB_BITS) + (int)((v >> (msb - LAT_SUB_BITS)) & ((1u << LAT_SUB_BITS) - 1u));
+    return (idx < LAT_BUCKETS) ? idx : (LAT_BUCKETS - 1);
+}
+
+// highest value that lands in bucket idx
+static uint32_t bucket_top(int idx)
+{
+    if (idx < (1 << LAT_SUB_BITS)) return (uint32_t)idx;
+    int msb = (idx >> LAT_SUB_BITS) + (LAT_SUB_BITS - 1);
+    uint32_t sub = (uint32_t)(idx & ((1 << LAT_SUB_BITS) - 1));
+    uint32_t lo = ((1u << LAT_SUB_BITS) + sub) << (msb - LAT_SUB_BITS);
+    return lo + (1u << (msb - LAT_SUB_BITS)) - 1u;
+}
+
+// -------------------- origin --------------------
+// one fixed slot per task, claimed once at task start; begin/end/get only touch the
+// caller's own slot afterwards
+void lat_origin_register(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+
+    for (int i = 0; i < LAT_ORIGIN_SLOTS; i++) {
+        if (__atomic_load_n(&s_org[i].task, __ATOMIC_ACQUIRE) == self) return;
+    }
+    for (int i = 0; i < LAT_ORIGIN_SLOTS; i++) {
+        TaskHandle_t none = NULL;
+        if (__atomic_compare_exchange_n(&s_org[i].task, &none, self, false,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return;
+    }
+    ESP_LOGW(TAG, "no origin slot left (%d)", LAT_ORIGIN_SLOTS);
+}
+
+static lat_origin_t *origin_slot(void)
+{
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    for (int i = 0; i < LAT_ORIGIN_SLOTS; i++) {
+        if (__atomic_load_n(&s_org[i].task, __ATOMIC_ACQUIRE) == self) return &s_org[i];
+    }
+    return NULL;
+}
+
+void lat_origin_begin(int64_t t_edge_us)
+{
+    lat_origin_t *o = origin_slot();
+    if (o) o->t0_us = (uint32_t)t_edge_us | 1u;   // 0 is "no origin"
+}
+
+void lat_origin_end(void)
+{
+    lat_origin_t *o = origin_slot();
+    if (o) o->t0_us = 0;
+}
+
+uint32_t lat_origin_get(void)
+{
+    const lat_origin_t *o = origin_slot();
+    return o ? o->t0_us : 0;
+}
+
+// -------------------- record --------------------
+void lat_record(lat_stage_t st, uint32_t us)
+{
+    if ((unsigned)st >= LAT_STAGE_COUNT) return;
+    lat_hist_t *h = &s_h[st];
+
+    __atomic_fetch_add(&h->b[bucket_of(us)], 1u, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->n, 1u, __ATOMIC_RELAXED);
+
+    uint32_t m = __atomic_load_n(&h->max_us, __ATOMIC_RELAXED);
+    while (us > m && !__atomic_compare_exchange_n(&h->max_us, &m, us, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+void lat_since(lat_stage_t st, uint32_t t0_us)
+{
+    if (!t0_us) return;
+    // t0 has bit 0 forced on (origin marker) -> same-microsecond samples would wrap
+    const int32_t d = (int32_t)((uint32_t)esp_timer_get_time() - t0_us);
+    lat_record(st, d > 0 ? (uint32_t)d : 0u);
+}
+
+// -------------------- read --------------------
+void lat_stats_get(lat_stage_t st, lat_summary_t *out)
+{
+    if (!out) return;
+    memset(out, 0, sizeof(*out));
+    if ((unsigned)st >= LAT_STAGE_COUNT) return;
+
+    const lat_hist_t *h = &s_h[st];
+
+    // snapshot counts (writers may run meanwhile, totals come from the snapshot)
+    uint32_t b[LAT_BUCKETS];
+    uint32_t n = 0;
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+        b[i] = __atomic_load_n(&h->b[i], __ATOMIC_RELAXED);
+        n += b[i];
+    }
+    out->n = n;
+    out->max_us = __atomic_load_n(&h->max_us, __ATOMIC_RELAXED);
+    if (!n) return;
+
+    const uint32_t r50 = (n + 1u) / 2u;
+    const uint32_t r99 = n - n / 100u;   // rank of the 99th percentile (1-based)
+    uint32_t acc = 0;
+    bool got50 = false;
+
+    for (int i = 0; i < LAT_BUCKETS; i++) {
+        acc += b[i];
+        if (!got50 && acc >= r50) { out->p50_us = bucket_top(i); got50 = true; }
+        if (acc >= r99) { out->p99_us = bucket_top(i); break; }
+    }
+
+    // bucket tops can overshoot the real maximum
+    if (out->p50_us > out->max_us) out->p50_us = out->max_us;
+    if (out->p99_us > out->max_us) out->p99_us = out->max_us;
+}
+
+void lat_stats_reset(void)
+{
+    for (int s = 0; s < LAT_STAGE_COUNT; s++) {
+        for (int i = 0; i < LAT_BUCKETS; i++) __atomic_store_n(&s_h[s].b[i], 0u, __ATOMIC_RELAXED);
+        __atomic_store_n(&s_h[s].n, 0u, __ATOMIC_RELAXED);
+        __atomic_store_n(&s_h[s].max_us, 0u, __ATOMIC_RELAXED);
+    }
+    s_log_n = 0;
+}
+
+void lat_stats_log(void)
+{
+    for (int s = 0; s < LAT_STAGE_COUNT; s++) {
+        lat_summary_t r;
+        lat_stats_get((lat_stage_t)s, &r);
+        if (!r.n) continue;
+        ESP_LOGI(TAG, "%-11s n=%u p50=%uus p99=%uus max=%uus", STAGE_NAMES[s],
+                 (unsigned)r.n, (unsigned)r.p50_us, (unsigned)r.p99_us, (unsigned)r.max_us);
+    }
+}
+
+static void log_timer_cb(void *arg)
+{
+    (void)arg;
+
+    // only when something new was measured
+    uint32_t n = 0;
+    for (int s = 0; s < LAT_STAGE_COUNT; s++) n += __atomic_load_n(&s_h[s].n, __ATOMIC_RELAXED);
+    if (n == s_log_n) return;
+    s_log_n = n;
+
+    lat_stats_log();
+}
+
+void lat_stats_init(void)
+{
+    if (s_log_timer) return;
+
+    const esp_timer_create_args_t a = {
+        .callback = log_timer_cb,
+        .arg = NULL,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "lat_log",
+    };
+    if (esp_timer_create(&a, &s_log_timer) != ESP_OK) {
+        s_log_timer = NULL;
+        ESP_LOGW(TAG, "log timer create failed (console report off)");
+        return;
+    }
+    (void)esp_timer_start_periodic(s_log_timer, (uint64_t)LAT_LOG_PERIOD_MS * 1000ULL);
+}
+
+esp_err_t lat_stats_get_json(char *out, int out_len)
+{
+    if (!out || out_len <= 0) return ESP_ERR_INVALID_ARG;
+
+    cJSON *root = cJSON_CreateObject();
+    if (!root) return ESP_ERR_NO_MEM;
+
+    cJSON *arr = cJSON_CreateArray();
+    cJSON_AddItemToObject(root, "stages", arr);
+
+    for (int s = 0; s < LAT_STAGE_COUNT; s++) {
+        lat_summary_t r;
+        lat_stats_get((lat_stage_t)s, &r);
+
+        cJSON *o = cJSON_CreateObject();
+        cJSON_AddStringToObject(o, "name", STAGE_NAMES[s]);
+        cJSON_AddNumberToObject(o, "n", (double)r.n);
+        cJSON_AddNumberToObject(o, "p50", (double)r.p50_us);
+        cJSON_AddNumberToObject(o, "p99", (double)r.p99_us);
+        cJSON_AddNumberToObject(o, "max", (double)r.max_us);
+        cJSON_AddItemToArray(arr, o);
+    }
+    cJSON_AddStringToObject(root, "unit", "us");
+
+    char *s = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+    if (!s) return ESP_FAIL;
+
+    int need = (int)strlen(s);
+    if (need >= out_len) { free(s); return ESP_FAIL; }
+
+    strcpy(out, s);
+    free(s);
+    return ESP_OK;
+}
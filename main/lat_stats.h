@@ -0,0 +1,57 @@
+// ===== FILE: main/lat_stats.h =====
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// Press-to-wire latency histograms.
+//
+// - every stage is measured from the same origin: the input edge timestamp
+//   (GPIO ISR for footswitches, poll time for EXP/FS jack switches)
+// - the origin travels with each MIDI message (midi_msg_t.t0_us) through the midi_out ring
+//   and is attached to the USB transfer, so completion can be timed too
+// - log-scale buckets (8 per octave, ~12% resolution), lock-free counters
+//   -> safe from any task, cost = one esp_timer read + a few atomic adds per sample
+// - messages without an origin (EXP values, clock, long-press, chord window) are not counted
+
+typedef enum {
+    LAT_EDGE = 0,      // edge -> seen by foot_task
+    LAT_ACTIONS,       // edge -> midi_actions_run / midi_prog_run entry
+    LAT_SUBMIT_USB,    // edge -> handed to the USB aggregator (sender task)
+    LAT_SUBMIT_UART,   // edge -> accepted by uart_midi_send_bytes
+    LAT_WIRE_USB,      // edge -> USB transfer_cb (transfer completed on the bus)
+    LAT_STAGE_COUNT
+} lat_stage_t;
+
+#define LAT_SUB_BITS 3
+#define LAT_BUCKETS  192   // covers > 16 s
+
+typedef struct {
+    uint32_t n;
+    uint32_t p50_us;
+    uint32_t p99_us;
+    uint32_t max_us;
+} lat_summary_t;
+
+// starts the console report (one line per stage every 60 s, only when new samples arrived)
+void lat_stats_init(void);
+
+// origin slot for the calling task: once, at task start (foot_task, expfs_task).
+// tasks without one never have an origin
+void     lat_origin_register(void);
+
+// origin for everything the calling task posts until lat_origin_end()
+void     lat_origin_begin(int64_t t_edge_us);
+void     lat_origin_end(void);
+uint32_t lat_origin_get(void);   // 0 = calling task has no origin
+
+void lat_record(lat_stage_t st, uint32_t us);
+
+// record now - t0_us (no-op for t0_us == 0)
+void lat_since(lat_stage_t st, uint32_t t0_us);
+
+void lat_stats_get(lat_stage_t st, lat_summary_t *out);
+void lat_stats_reset(void);
+void lat_stats_log(void);
+
+esp_err_t lat_stats_get_json(char *out, int out_len);
@@ -11,6 +11,8 @@
 #include "midi_actions.h"
 #include "usb_midi_host.h"
 #include "uart_midi_out.h"
+#include "midi_out.h"
+#include "lat_stats.h"
 
 static const char *TAG = "MIDI_ACT";
 
@@ -42,20 +44,26 @@ static void toggle_init_once(void)
     }
 }
 
+// ✅ queue only (midi_out sender tasks do the blocking USB/UART writes)
+static inline void send_op_all(const uint8_t pkt[4], int len)
+{
+    (void)midi_out_post(pkt, (uint8_t)len);
+}
+
 static inline void send_cc_all(uint8_t ch, uint8_t cc, uint8_t val)
 {
-    if (usb_midi_ready_fast()) (void)usb_midi_send_cc(ch, cc, val);
-    if (uart_midi_out_ready_fast()) (void)uart_midi_send_cc(ch, cc, val);
+    midi_out_cc(ch, cc, val);
 }
 
 static inline void send_pc_all(uint8_t ch, uint8_t pc)
 {
-    if (usb_midi_ready_fast()) (void)usb_midi_send_pc(ch, pc);
-    if (uart_midi_out_ready_fast()) (void)uart_midi_send_pc(ch, pc);
+    midi_out_pc(ch, pc);
 }
 
 void midi_actions_run(const action_t *actions, int n, cc_behavior_t cc_behavior, int event)
 {
+    lat_since(LAT_ACTIONS, lat_origin_get());
+
     const int usb_ok  = usb_midi_ready_fast();
     const int uart_ok = uart_midi_out_ready_fast();
 
@@ -116,3 +124,78 @@ void midi_actions_run(const action_t *actions, int n, cc_behavior_t cc_behavior,
         }
     }
 }
+
+// -------------------- compiled programs --------------------
+void midi_prog_compile(midi_prog_t *out, const action_t *actions, int n, cc_behavior_t cc_behavior)
+{
+    if (!out) return;
+    out->n = 0;
+    out->cc_behavior = (uint8_t)cc_behavior;
+    if (!actions) return;
+    if (n > MAX_ACTIONS) n = MAX_ACTIONS;
+
+    for (int i = 0; i < n; i++) {
+        const action_t *a = &actions[i];
+        uint8_t ch = clampCh(a->ch);
+        midi_op_t *op = &out->op[out->n];
+
+        if (a->type == ACT_CC) {
+            uint8_t cc = clamp7(a->a);
+            op->pkt[0] = 0x0B;   // cable 0, CIN = control change
+            op->pkt[1] = (uint8_t)(0xB0 | (ch - 1));
+            op->pkt[2] = cc;
+            op->pkt[3] = clamp7(a->b);
+            op->len = 3;
+            op->is_cc = 1;
+            op->tog = (uint16_t)tog_idx(ch, cc);
+            out->n++;
+        } else if (a->type == ACT_PC) {
+            op->pkt[0] = 0x0C;   // cable 0, CIN = program change
+            op->pkt[1] = (uint8_t)(0xC0 | (ch - 1));
+            op->pkt[2] = clamp7(a->a);
+            op->pkt[3] = 0;
+            op->len = 2;
+            op->is_cc = 0;
+            op->tog = 0;
+            out->n++;
+        }
+    }
+}
+
+// same output as midi_actions_run() on the source list
+void midi_prog_run(const midi_prog_t *prog, int event)
+{
+    if (!prog || prog->n == 0) return;
+    lat_since(LAT_ACTIONS, lat_origin_get());
+
+    const int usb_ok  = usb_midi_ready_fast();
+    const int uart_ok = uart_midi_out_ready_fast();
+    if (!usb_ok && !uart_ok) return;
+
+    const cc_behavior_t beh = (cc_behavior_t)prog->cc_behavior;
+    if (beh == CC_TOGGLE) toggle_init_once();
+
+    for (int i = 0; i < prog->n; i++) {
+        const midi_op_t *op = &prog->op[i];
+
+        if (!op->is_cc || beh == CC_NORMAL) {
+            if (event == MIDI_EVT_TRIGGER) send_op_all(op->pkt, op->len);
+            continue;
+        }
+
+        uint8_t pkt[4] = { op->pkt[0], op->pkt[1], op->pkt[2], op->pkt[3] };
+
+        if (beh == CC_TOGGLE) {
+            if (event != MIDI_EVT_TRIGGER) continue;
+            if (s_toggle) {
+                uint8_t *st = &s_toggle[op->tog];
+                *st = (uint8_t)!(*st);
+                if (!*st) pkt[3] = 0;
+            }
+        } else if (beh == CC_MOMENTARY) {
+            if (event == MIDI_EVT_TRIGGER) continue;
+            if (event == MIDI_EVT_UP) pkt[3] = 0;
+        }
+        send_op_all(pkt, 3);
+    }
+}
@@ -8,3 +8,24 @@
 #define MIDI_EVT_UP      2  // release
 
 void midi_actions_run(const action_t *actions, int n, cc_behavior_t cc_behavior, int event);
+
+// -------------------- compiled programs --------------------
+// action list -> dense list of ready-to-send messages
+// - ACT_NONE removed, channel/7-bit already clamped
+// - pkt = USB-MIDI event packet (cable 0), pkt[1..len] = serial MIDI bytes
+// compile once when the bank becomes active / config changes, then run on every press.
+typedef struct {
+    uint8_t  pkt[4];
+    uint8_t  len;       // 2 = PC, 3 = CC
+    uint8_t  is_cc;
+    uint16_t tog;       // CC toggle table index ((ch-1)*128 + cc)
+} midi_op_t;
+
+typedef struct {
+    uint8_t   n;             // ops used
+    uint8_t   cc_behavior;   // cc_behavior_t
+    midi_op_t op[MAX_ACTIONS];
+} midi_prog_t;
+
+void midi_prog_compile(midi_prog_t *out, const action_t *actions, int n, cc_behavior_t cc_behavior);
+void midi_prog_run(const midi_prog_t *prog, int event);
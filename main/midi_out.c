@@ -0,0 +1,522 @@
+// ===== FILE: main/midi_out.c =====
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "midi_out.h"
+#include "midi_ring.h"
+#include "usb_midi_host.h"
+#include "uart_midi_out.h"
+#include "lat_stats.h"
+
+static const char *TAG = "MIDI_OUT";
+
+#define MIDI_OUT_MAX_AGE_US ((uint32_t)MIDI_OUT_MAX_AGE_MS * 1000u)
+#define MIDI_TX_RETRY_MS    5    // transport ปฏิเสธ (wire busy) -> ลองใหม่เร็ว ๆ
+
+// ---- coalescing (last value wins) ----
+// CC ที่ post ผ่าน midi_out_cc_latest() (EXP pedal) ไม่เข้า ring แต่เก็บเป็น slot ต่อ (kind, ch, controller)
+// ค่าใหม่ทับค่าเก่าที่ยังไม่ได้ส่ง -> buffer คงที่, ค่าล่าสุดออกก่อนข้อความใน ring
+// 14-bit CC / NRPN: หนึ่ง slot = หนึ่งค่า 14-bit, sender แตกเป็นหลาย CC ต่อกันตามลำดับ MSB -> LSB
+#define MIDI_CO_SLOTS       MIDI_OUT_BATCH_MAX   // 2 EXP ports x (1 + EXP_EXTRA_TARGETS) -> 8 + spare
+
+#define CO_KIND_CC7   MIDI_CTL_CC7
+#define CO_KIND_CC14  MIDI_CTL_CC14   // MSB on cc, LSB on cc+32
+#define CO_KIND_NRPN  MIDI_CTL_NRPN   // CC99/98 select (only when changed), CC6/38 data entry
+
+#define CO_KEY(kind, ch0, id) (((uint32_t)(kind) << 20) | ((uint32_t)(ch0) << 14) | ((uint32_t)(id) & 0x3FFFu))
+#define CO_KEY_KIND(k)        ((uint8_t)((k) >> 20))
+#define CO_KEY_CH0(k)         ((uint8_t)(((k) >> 14) & 0x0Fu))
+#define CO_KEY_ID(k)          ((uint16_t)((k) & 0x3FFFu))
+
+#define CO_NONE 0xFFFFu
+
+typedef struct {
+    uint32_t key;      // CO_KEY(kind, ch-1, cc# or nrpn#)
+    uint16_t val;      // 0..127 (CC7) or 0..16383
+    uint16_t last;     // last value sent from this slot (CO_NONE = unknown) -> skip unchanged MSB
+    uint8_t  dirty;    // value waiting to be sent
+    uint8_t  used;
+    uint32_t t_us;     // post time of the pending value (wire latency stats)
+} midi_co_slot_t;
+
+typedef struct {
+    midi_ring_t       ring;
+    TaskHandle_t      task;
+    midi_out_stats_t  st;
+    const char       *name;
+
+    portMUX_TYPE      co_mux;
+    midi_co_slot_t    co[MIDI_CO_SLOTS];
+
+    // sender only: NRPN number selected on each channel (CO_NONE = unknown)
+    uint16_t          nrpn_sel[16];
+} midi_tx_ctx_t;
+
+static midi_tx_ctx_t s_tx[MIDI_TX_COUNT];
+static int s_started = 0;
+
+static inline uint8_t clamp7(int v)  { if (v < 0) return 0; if (v > 127) return 127; return (uint8_t)v; }
+static inline uint8_t clampCh(int v) { if (v < 1) return 1; if (v > 16) return 16; return (uint8_t)v; }
+static inline uint16_t clamp14(int v) { if (v < 0) return 0; if (v > 16383) return 16383; return (uint16_t)v; }
+
+static inline int tx_ready(midi_tx_t tx)
+{
+    return (tx == MIDI_TX_USB) ? usb_midi_ready_fast() : uart_midi_out_ready_fast();
+}
+
+static esp_err_t tx_send(midi_tx_t tx, const midi_msg_t *m)
+{
+    if (tx == MIDI_TX_USB) return usb_midi_send_pkt(m->pkt);
+    return uart_midi_send_raw(&m->pkt[1], m->len);
+}
+
+// sender side: USB packets are batched into one transfer per burst (flushed by tx_end)
+// (latency sample only once accepted: a refused message is retried)
+static esp_err_t tx_queue(midi_tx_t tx, const midi_msg_t *m)
+{
+    if (tx == MIDI_TX_USB) {
+        esp_err_t e = usb_midi_queue_pkt_ts(m->pkt, m->t0_us);
+        if (e == ESP_OK) lat_since(LAT_SUBMIT_USB, m->t0_us);
+        return e;
+    }
+    esp_err_t e = uart_midi_send_raw(&m->pkt[1], m->len);
+    if (e == ESP_OK) lat_since(LAT_SUBMIT_UART, m->t0_us);
+    return e;
+}
+
+// wire busy (ESP_ERR_TIMEOUT): how long to wait before the next try
+static TickType_t tx_retry_ticks(midi_tx_t tx)
+{
+    uint32_t us = (tx == MIDI_TX_UART) ? uart_midi_out_wait_us() : MIDI_TX_RETRY_MS * 1000u;
+    TickType_t t = pdMS_TO_TICKS((us + 999u) / 1000u);
+    return t ? t : 1;
+}
+
+static void tx_end(midi_tx_t tx)
+{
+    if (tx == MIDI_TX_USB && tx_ready(tx)) (void)usb_midi_flush();
+}
+
+static inline midi_msg_t cc_msg(uint8_t ch0, uint8_t cc, uint8_t val, uint32_t t_us)
+{
+    midi_msg_t m = {
+        .pkt = { 0x0B, (uint8_t)(0xB0 | ch0), (uint8_t)(cc & 0x7F), (uint8_t)(val & 0x7F) },
+        .len = 3,
+        .t_us = t_us,
+    };
+    return m;
+}
+
+// expand one controller value into its CC sequence. last/sel = what the receiver already has
+// (CO_NONE = unknown -> send everything). returns message count (1..4), *n_sel = leading select msgs
+static int co_build(uint32_t key, uint16_t val, uint16_t last, uint16_t sel, uint32_t t_us,
+                    midi_msg_t out[4], int *n_sel)
+{
+    const uint8_t ch0 = CO_KEY_CH0(key);
+    const uint16_t id = CO_KEY_ID(key);
+    int n = 0;
+
+    *n_sel = 0;
+
+    switch (CO_KEY_KIND(key)) {
+    case CO_KIND_CC14:
+        // receivers reset LSB on MSB -> MSB only when it changed, LSB always
+        if (last == CO_NONE || (last >> 7) != (val >> 7)) out[n++] = cc_msg(ch0, (uint8_t)id, (uint8_t)(val >> 7), t_us);
+        out[n++] = cc_msg(ch0, (uint8_t)(id + 32), (uint8_t)(val & 0x7F), t_us);
+        break;
+
+    case CO_KIND_NRPN:
+        if (sel != id) {
+            out[n++] = cc_msg(ch0, 99, (uint8_t)(id >> 7), t_us);
+            out[n++] = cc_msg(ch0, 98, (uint8_t)(id & 0x7F), t_us);
+            *n_sel = n;
+            last = CO_NONE;
+        }
+        if (last == CO_NONE || (last >> 7) != (val >> 7)) out[n++] = cc_msg(ch0, 6, (uint8_t)(val >> 7), t_us);
+        out[n++] = cc_msg(ch0, 38, (uint8_t)(val & 0x7F), t_us);
+        break;
+
+    default:
+        out[n++] = cc_msg(ch0, (uint8_t)id, (uint8_t)val, t_us);
+        break;
+    }
+    return n;
+}
+
+// sender: an ordered (ring) CC that touches the same controller / NRPN selection makes the
+// receiver state we assume unknown -> next slot value goes out in full
+static void co_ring_track(midi_tx_ctx_t *c, const midi_msg_t *m)
+{
+    if ((m->pkt[1] & 0xF0) != 0xB0) return;
+
+    const uint8_t ch0 = m->pkt[1] & 0x0F;
+    const uint8_t cc = m->pkt[2];
+
+    if (cc >= 98 && cc <= 101) c->nrpn_sel[ch0] = CO_NONE;
+
+    portENTER_CRITICAL(&c->co_mux);
+    for (int k = 0; k < MIDI_CO_SLOTS; k++) {
+        midi_co_slot_t *s = &c->co[k];
+        if (!s->used || CO_KEY_CH0(s->key) != ch0) continue;
+
+        uint8_t kind = CO_KEY_KIND(s->key);
+        uint16_t id = CO_KEY_ID(s->key);
+        if ((kind == CO_KIND_CC14 && (cc == id || cc == id + 32)) ||
+            (kind == CO_KIND_NRPN && (cc == 6 || cc == 38))) {
+            s->last = CO_NONE;
+        }
+    }
+    portEXIT_CRITICAL(&c->co_mux);
+}
+
+// producer: store/replace the pending value (call under co_mux). false = no slot free
+static bool co_put_locked(midi_tx_ctx_t *c, uint32_t key, uint16_t val, uint32_t t_us, bool *replaced)
+{
+    midi_co_slot_t *free_s = NULL;
+    for (int k = 0; k < MIDI_CO_SLOTS; k++) {
+        midi_co_slot_t *s = &c->co[k];
+        if (s->used && s->key == key) {
+            *replaced = s->dirty;
+            s->t_us = t_us;
+            s->val = val;
+            s->dirty = 1;
+            return true;
+        }
+        if (!free_s && (!s->used || !s->dirty)) free_s = s;
+    }
+    if (!free_s) return false;
+
+    free_s->used = 1;
+    free_s->key = key;
+    free_s->val = val;
+    free_s->last = CO_NONE;
+    free_s->dirty = 1;
+    free_s->t_us = t_us;
+    return true;
+}
+
+// sender: send every pending slot value. return 1 if something is still pending (retry later)
+static int co_flush(midi_tx_t tx, midi_tx_ctx_t *c)
+{
+    int pending = 0;
+
+    // take every dirty slot in one critical section: a batch posted together goes out together
+    uint16_t sv[MIDI_CO_SLOTS], sl[MIDI_CO_SLOTS];
+    uint32_t sk[MIDI_CO_SLOTS], st[MIDI_CO_SLOTS];
+    uint8_t  sd[MIDI_CO_SLOTS];
+
+    portENTER_CRITICAL(&c->co_mux);
+    for (int k = 0; k < MIDI_CO_SLOTS; k++) {
+        midi_co_slot_t *s = &c->co[k];
+        sd[k] = s->dirty;
+        sk[k] = s->key;
+        sv[k] = s->val;
+        sl[k] = s->last;
+        st[k] = s->t_us;
+        s->dirty = 0;
+    }
+    portEXIT_CRITICAL(&c->co_mux);
+
+    for (int k = 0; k < MIDI_CO_SLOTS; k++) {
+        midi_co_slot_t *s = &c->co[k];
+
+        if (!sd[k]) continue;
+
+        const uint32_t key = sk[k];
+        const uint16_t val = sv[k];
+        const uint16_t last = sl[k];
+        const uint32_t t0 = st[k];
+
+        // no age drop here: the slot always holds the newest value, which is the one the
+        // receiver has to end up with however late it goes out
+        if (!tx_ready(tx)) { c->st.fail++; continue; }
+
+        const uint8_t ch0 = CO_KEY_CH0(key);
+        midi_msg_t seq[4];
+        int n_sel = 0;
+        int n = co_build(key, val, last, c->nrpn_sel[ch0], t0, seq, &n_sel);
+
+        esp_err_t e = ESP_OK;
+        int i = 0;
+        for (; i < n; i++) {
+            e = tx_queue(tx, &seq[i]);
+            if (e != ESP_OK) break;
+        }
+
+        if (n_sel) {
+            // selection goes out first: once sent it stays valid even if data entry was refused
+            c->nrpn_sel[ch0] = (i >= n_sel) ? CO_KEY_ID(key) : CO_NONE;
+        }
+
+        if (e == ESP_OK) {
+            c->st.sent++;
+            portENTER_CRITICAL(&c->co_mux);
+            if (s->key == key) s->last = val;
+            portEXIT_CRITICAL(&c->co_mux);
+        } else if (e == ESP_ERR_TIMEOUT) {
+            // wire busy: put it back unless a newer value arrived meanwhile.
+            // partial sequence -> receiver state unknown, resend all of it
+            portENTER_CRITICAL(&c->co_mux);
+            if (s->key == key) {
+                if (i > 0) s->last = CO_NONE;
+                if (!s->dirty) { s->dirty = 1; s->t_us = t0; }
+            }
+            portEXIT_CRITICAL(&c->co_mux);
+            pending = 1;
+        } else {
+            c->st.fail++;
+            portENTER_CRITICAL(&c->co_mux);
+            if (s->key == key) s->last = CO_NONE;
+            portEXIT_CRITICAL(&c->co_mux);
+            if (CO_KEY_KIND(key) == CO_KIND_NRPN) c->nrpn_sel[ch0] = CO_NONE;
+        }
+    }
+    return pending;
+}
+
+static void sender_task(void *arg)
+{
+    midi_tx_t tx = (midi_tx_t)(intptr_t)arg;
+    midi_tx_ctx_t *c = &s_tx[tx];
+
+    c->task = xTaskGetCurrentTaskHandle();
+
+    uint32_t last_drop = 0;
+    int co_pending = 0;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(co_pending ? MIDI_TX_RETRY_MS : 1000));
+
+        uint32_t depth = midi_ring_depth(&c->ring);
+        if (depth > c->st.max_depth) c->st.max_depth = depth;
+
+        // latest controller values first, then the ordered ring
+        co_pending = co_flush(tx, c);
+
+        midi_msg_t m;
+        while (midi_ring_pop(&c->ring, &m)) {
+            uint32_t age = (uint32_t)esp_timer_get_time() - m.t_us;
+            if (age > MIDI_OUT_MAX_AGE_US) {
+                c->st.stale++;
+                continue;
+            }
+            if (!tx_ready(tx)) {   // unplugged while queued
+                c->st.fail++;
+                continue;
+            }
+
+            // wire busy (UART governor, USB transfers all in flight): wait and retry the
+            // same message, still bounded by MIDI_OUT_MAX_AGE_MS
+            esp_err_t e = tx_queue(tx, &m);
+            while (e == ESP_ERR_TIMEOUT &&
+                   (uint32_t)esp_timer_get_time() - m.t_us <= MIDI_OUT_MAX_AGE_US) {
+                vTaskDelay(tx_retry_ticks(tx));
+                e = tx_queue(tx, &m);
+            }
+            if (e == ESP_OK) c->st.sent++;
+            else if (e == ESP_ERR_TIMEOUT) c->st.stale++;
+            else c->st.fail++;
+            co_ring_track(c, &m);
+
+            // a newer pedal value posted while draining goes out before the rest
+            co_pending = co_flush(tx, c);
+        }
+        tx_end(tx);
+
+        uint32_t drop = c->st.overflow + c->st.stale + c->st.fail;
+        if (drop != last_drop) {
+            ESP_LOGW(TAG, "%s: overflow=%u stale=%u fail=%u", c->name,
+                     (unsigned)c->st.overflow, (unsigned)c->st.stale, (unsigned)c->st.fail);
+            last_drop = drop;
+        }
+    }
+}
+
+void midi_out_start(void)
+{
+    if (s_started) return;
+
+    static const char *names[MIDI_TX_COUNT] = { "usb", "uart" };
+
+    for (int t = 0; t < MIDI_TX_COUNT; t++) {
+        memset(&s_tx[t].st, 0, sizeof(s_tx[t].st));
+        midi_ring_reset(&s_tx[t].ring);
+        s_tx[t].name = names[t];
+        s_tx[t].co_mux = (portMUX_TYPE)portMUX_INITIALIZER_UNLOCKED;
+        memset(s_tx[t].co, 0, sizeof(s_tx[t].co));
+        for (int ch = 0; ch < 16; ch++) s_tx[t].nrpn_sel[ch] = CO_NONE;
+    }
+
+    // sender > input tasks (6): ข้อความออกทันทีหลัง post, รอ USB/UART แบบ block ได้โดยไม่กระทบปุ่ม
+    xTaskCreatePinnedToCore(sender_task, "midi_tx_usb",  3072, (void *)(intptr_t)MIDI_TX_USB,  7, NULL, 0);
+    xTaskCreatePinnedToCore(sender_task, "midi_tx_uart", 3072, (void *)(intptr_t)MIDI_TX_UART, 7, NULL, 0);
+
+    s_started = 1;
+    ESP_LOGI(TAG, "started (ring=%d, max age=%dms)", MIDI_RING_LEN, MIDI_OUT_MAX_AGE_MS);
+}
+
+bool midi_out_post(const uint8_t pkt4[4], uint8_t len)
+{
+    if (!pkt4 || len == 0 || len > 3) return false;
+
+    midi_msg_t m = {
+        .pkt = { pkt4[0], pkt4[1], pkt4[2], pkt4[3] },
+        .len = len,
+        .t_us = (uint32_t)esp_timer_get_time(),
+        .t0_us = lat_origin_get(),
+    };
+
+    bool any = false;
+    for (int t = 0; t < MIDI_TX_COUNT; t++) {
+        if (!tx_ready((midi_tx_t)t)) continue;   // ไม่มีปลายทาง -> drop (เหมือนเดิม)
+
+        midi_tx_ctx_t *c = &s_tx[t];
+
+        // sender ยังไม่เริ่ม (ช่วง boot) -> ส่งตรงแบบเดิม
+        if (!s_started || !c->task) {
+            any |= (tx_send((midi_tx_t)t, &m) == ESP_OK);
+            continue;
+        }
+
+        if (midi_ring_push(&c->ring, &m)) {
+            __atomic_fetch_add(&c->st.posted, 1, __ATOMIC_RELAXED);
+            xTaskNotifyGive(c->task);
+            any = true;
+        } else {
+            __atomic_fetch_add(&c->st.overflow, 1, __ATOMIC_RELAXED);
+        }
+    }
+    return any;
+}
+
+void midi_out_cc(uint8_t ch_1_16, uint8_t cc, uint8_t val)
+{
+    uint8_t ch = clampCh(ch_1_16);
+    const uint8_t pkt[4] = { 0x0B, (uint8_t)(0xB0 | (ch - 1)), clamp7(cc), clamp7(val) };
+    (void)midi_out_post(pkt, 3);
+}
+
+// controller -> slot key + value (clamped). CC14 without an LSB partner (cc >= 32) -> CC7
+static void ctl_key(const midi_ctl_t *v, uint32_t *key, uint16_t *val)
+{
+    const uint8_t ch0 = (uint8_t)(clampCh(v->ch) - 1);
+
+    switch (v->kind) {
+    case MIDI_CTL_CC14:
+        if (v->id < 32) {
+            *key = CO_KEY(CO_KIND_CC14, ch0, v->id);
+            *val = clamp14(v->val);
+        } else {
+            *key = CO_KEY(CO_KIND_CC7, ch0, clamp7(v->id));
+            *val = (uint16_t)(clamp14(v->val) >> 7);
+        }
+        break;
+    case MIDI_CTL_NRPN:
+        *key = CO_KEY(CO_KIND_NRPN, ch0, clamp14(v->id));
+        *val = clamp14(v->val);
+        break;
+    default:
+        *key = CO_KEY(CO_KIND_CC7, ch0, clamp7(v->id));
+        *val = clamp7(v->val);
+        break;
+    }
+}
+
+void midi_out_ctl_batch(const midi_ctl_t *v, int n)
+{
+    if (!v || n <= 0) return;
+    if (n > MIDI_CO_SLOTS) n = MIDI_CO_SLOTS;
+
+    const uint32_t t_us = (uint32_t)esp_timer_get_time();
+
+    uint32_t key[MIDI_CO_SLOTS];
+    uint16_t val[MIDI_CO_SLOTS];
+    for (int i = 0; i < n; i++) ctl_key(&v[i], &key[i], &val[i]);
+
+    if (!s_started) {
+        for (int i = 0; i < n; i++) {
+            midi_msg_t seq[4];
+            int n_sel = 0;
+            int m = co_build(key[i], val[i], CO_NONE, CO_NONE, t_us, seq, &n_sel);
+            for (int j = 0; j < m; j++) (void)midi_out_post(seq[j].pkt, seq[j].len);
+        }
+        return;
+    }
+
+    for (int t = 0; t < MIDI_TX_COUNT; t++) {
+        if (!tx_ready((midi_tx_t)t)) continue;
+        midi_tx_ctx_t *c = &s_tx[t];
+        if (!c->task) continue;
+
+        uint8_t put[MIDI_CO_SLOTS];
+        uint32_t replaced_n = 0;
+
+        // whole batch in one critical section -> the sender never sees half of it
+        portENTER_CRITICAL(&c->co_mux);
+        for (int i = 0; i < n; i++) {
+            bool replaced = false;
+            put[i] = co_put_locked(c, key[i], val[i], t_us, &replaced);
+            if (replaced) replaced_n++;
+        }
+        portEXIT_CRITICAL(&c->co_mux);
+
+        if (replaced_n) __atomic_fetch_add(&c->st.coalesced, replaced_n, __ATOMIC_RELAXED);
+
+        for (int i = 0; i < n; i++) {
+            if (put[i]) {
+                __atomic_fetch_add(&c->st.posted, 1, __ATOMIC_RELAXED);
+                continue;
+            }
+
+            // ไม่มี slot ว่าง -> เข้า ring ตามลำดับปกติ (ทั้งชุด, ไม่ข้าม MSB/select)
+            // ring ไม่พอทั้งชุด -> ไม่ใส่เลย, นับ overflow ครั้งเดียว
+            midi_msg_t seq[4];
+            int n_sel = 0;
+            int m = co_build(key[i], val[i], CO_NONE, CO_NONE, t_us, seq, &n_sel);
+            bool ok = midi_ring_push_n(&c->ring, seq, (uint32_t)m);
+            if (ok) __atomic_fetch_add(&c->st.posted, 1, __ATOMIC_RELAXED);
+            else    __atomic_fetch_add(&c->st.overflow, 1, __ATOMIC_RELAXED);
+        }
+
+        xTaskNotifyGive(c->task);
+    }
+}
+
+void midi_out_cc_latest(uint8_t ch_1_16, uint8_t cc, uint8_t val)
+{
+    const midi_ctl_t v = { .kind = MIDI_CTL_CC7, .ch = ch_1_16, .id = cc, .val = val };
+    midi_out_ctl_batch(&v, 1);
+}
+
+void midi_out_cc14_latest(uint8_t ch_1_16, uint8_t cc, uint16_t val14)
+{
+    const midi_ctl_t v = { .kind = MIDI_CTL_CC14, .ch = ch_1_16, .id = cc, .val = val14 };
+    midi_out_ctl_batch(&v, 1);
+}
+
+void midi_out_nrpn_latest(uint8_t ch_1_16, uint16_t param, uint16_t val14)
+{
+    const midi_ctl_t v = { .kind = MIDI_CTL_NRPN, .ch = ch_1_16, .id = param, .val = val14 };
+    midi_out_ctl_batch(&v, 1);
+}
+
+void midi_out_pc(uint8_t ch_1_16, uint8_t pc)
+{
+    uint8_t ch = clampCh(ch_1_16);
+    const uint8_t pkt[4] = { 0x0C, (uint8_t)(0xC0 | (ch - 1)), clamp7(pc), 0 };
+    (void)midi_out_post(pkt, 2);
+}
+
+void midi_out_get_stats(midi_tx_t tx, midi_out_stats_t *out)
+{
+    if (!out) return;
+    if ((unsigned)tx >= MIDI_TX_COUNT) { memset(out, 0, sizeof(*out)); return; }
+    *out = s_tx[tx].st;
+}
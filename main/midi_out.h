@@ -0,0 +1,71 @@
+// ===== FILE: main/midi_out.h =====
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Non-blocking MIDI output.
+// - midi_out_*() only queue the message (lock-free ring per transport) and return
+// - one sender task per transport (USB, UART) drains its ring, so a slow/stuck USB device
+//   no longer stalls button scanning / LEDs / EXP
+// - bounded latency: ring full -> message dropped (overflow),
+//   message older than MIDI_OUT_MAX_AGE_MS when the sender gets to it -> dropped (stale)
+
+#define MIDI_OUT_MAX_AGE_MS 200
+
+typedef enum {
+    MIDI_TX_USB = 0,
+    MIDI_TX_UART,
+    MIDI_TX_COUNT
+} midi_tx_t;
+
+typedef struct {
+    uint32_t posted;      // accepted into the ring
+    uint32_t sent;        // handed to the driver OK
+    uint32_t overflow;    // ring full at post
+    uint32_t stale;       // older than MIDI_OUT_MAX_AGE_MS at send
+    uint32_t fail;        // driver returned error
+    uint32_t coalesced;   // pending controller value replaced by a newer one
+    uint32_t max_depth;   // highest ring fill seen by the sender
+} midi_out_stats_t;
+
+// start sender tasks (call after usb_midi_host_init / uart_midi_out_init)
+void midi_out_start(void);
+
+// prebuilt USB-MIDI packet (pkt[1..len] = serial bytes). false = dropped on every transport
+bool midi_out_post(const uint8_t pkt4[4], uint8_t len);
+
+void midi_out_cc(uint8_t ch_1_16, uint8_t cc, uint8_t val);
+void midi_out_pc(uint8_t ch_1_16, uint8_t pc);
+
+// continuous controller (EXP pedal): last value wins per (transport, ch, cc).
+// a value not yet sent is replaced; sent ahead of the ordered footswitch messages.
+// never dropped as stale: after a stalled wire the newest value still goes out
+void midi_out_cc_latest(uint8_t ch_1_16, uint8_t cc, uint8_t val);
+
+// 14-bit variants (same last-value-wins slots, one slot per controller):
+// - cc14: MSB on cc (0..31), LSB on cc+32. MSB is skipped when unchanged. cc >= 32 -> 7-bit CC
+// - nrpn: CC99/98 select (only when another parameter was selected), then CC6/38 data entry
+void midi_out_cc14_latest(uint8_t ch_1_16, uint8_t cc, uint16_t val14);
+void midi_out_nrpn_latest(uint8_t ch_1_16, uint16_t param, uint16_t val14);
+
+// several controllers posted as one batch (one EXP pedal -> many targets):
+// all values land in their slots atomically and the sender sends them in the same pass
+// (one USB transfer). max MIDI_OUT_BATCH_MAX entries
+typedef enum {
+    MIDI_CTL_CC7 = 0,
+    MIDI_CTL_CC14,     // id = cc 0..31
+    MIDI_CTL_NRPN,     // id = nrpn 0..16383
+} midi_ctl_kind_t;
+
+typedef struct {
+    uint8_t  kind;     // midi_ctl_kind_t
+    uint8_t  ch;       // 1..16
+    uint16_t id;       // cc# or nrpn#
+    uint16_t val;      // 0..127 (CC7) or 0..16383
+} midi_ctl_t;
+
+#define MIDI_OUT_BATCH_MAX 12
+
+void midi_out_ctl_batch(const midi_ctl_t *v, int n);
+
+void midi_out_get_stats(midi_tx_t tx, midi_out_stats_t *out);
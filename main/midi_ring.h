@@ -0,0 +1,121 @@
+// ===== FILE: main/midi_ring.h =====
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// Bounded lock-free multi-producer / single-consumer ring of outgoing MIDI messages.
+//
+// - producers: any task (footswitch, exp/fs, ...) -> slot reserved with one CAS on head
+// - consumer: the transport sender task only
+// - each slot carries a sequence number (Vyukov style), so a producer that is preempted
+//   between reserve and publish never lets the consumer read a half written slot
+// - full ring -> message is rejected, the caller counts it as overflow
+//
+// keep the ring in internal RAM (atomics on PSRAM are not supported).
+
+#ifndef MIDI_RING_LEN
+#define MIDI_RING_LEN 64   // power of two
+#endif
+
+typedef struct {
+    uint8_t  pkt[4];   // USB-MIDI event packet, pkt[1..len] = serial bytes
+    uint8_t  len;      // 1..3
+    uint8_t  rsv[3];
+    uint32_t t_us;     // post time (low 32 bits of esp_timer_get_time)
+    uint32_t t0_us;    // input edge time for lat_stats, 0 = none
+} midi_msg_t;
+
+typedef struct {
+    volatile uint32_t seq;
+    midi_msg_t msg;
+} midi_ring_slot_t;
+
+typedef struct {
+    volatile uint32_t head;   // producers (CAS)
+    volatile uint32_t tail;   // consumer only
+    midi_ring_slot_t slot[MIDI_RING_LEN];
+} midi_ring_t;
+
+static inline void midi_ring_reset(midi_ring_t *r)
+{
+    r->head = 0;
+    r->tail = 0;
+    for (uint32_t i = 0; i < MIDI_RING_LEN; i++) r->slot[i].seq = i;
+}
+
+static inline bool midi_ring_push(midi_ring_t *r, const midi_msg_t *m)
+{
+    uint32_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        midi_ring_slot_t *s = &r->slot[pos & (MIDI_RING_LEN - 1)];
+        uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+        int32_t dif = (int32_t)(seq - pos);
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&r->head, &pos, pos + 1, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                s->msg = *m;
+                __atomic_store_n(&s->seq, pos + 1, __ATOMIC_RELEASE);
+                return true;
+            }
+            // CAS failed: pos reloaded with the current head
+        } else if (dif < 0) {
+            return false;   // full
+        } else {
+            pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+// n messages in consecutive slots, all or none (CC14 MSB+LSB, NRPN select+data).
+// the consumer frees slots in order: last slot free -> the n before it are free too
+static inline bool midi_ring_push_n(midi_ring_t *r, const midi_msg_t *m, uint32_t n)
+{
+    if (n == 0) return true;
+    if (n > MIDI_RING_LEN) return false;
+
+    uint32_t pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+
+    for (;;) {
+        const midi_ring_slot_t *last = &r->slot[(pos + n - 1) & (MIDI_RING_LEN - 1)];
+        uint32_t seq = __atomic_load_n(&last->seq, __ATOMIC_ACQUIRE);
+        int32_t dif = (int32_t)(seq - (pos + n - 1));
+
+        if (dif == 0) {
+            if (__atomic_compare_exchange_n(&r->head, &pos, pos + n, true,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                for (uint32_t i = 0; i < n; i++) {
+                    midi_ring_slot_t *s = &r->slot[(pos + i) & (MIDI_RING_LEN - 1)];
+                    s->msg = m[i];
+                    __atomic_store_n(&s->seq, pos + i + 1, __ATOMIC_RELEASE);
+                }
+                return true;
+            }
+        } else if (dif < 0) {
+            return false;   // not enough room
+        } else {
+            pos = __atomic_load_n(&r->head, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static inline bool midi_ring_pop(midi_ring_t *r, midi_msg_t *out)
+{
+    uint32_t pos = r->tail;
+    midi_ring_slot_t *s = &r->slot[pos & (MIDI_RING_LEN - 1)];
+    uint32_t seq = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE);
+
+    if ((int32_t)(seq - (pos + 1)) < 0) return false;   // empty (or producer not published yet)
+
+    *out = s->msg;
+    __atomic_store_n(&s->seq, pos + MIDI_RING_LEN, __ATOMIC_RELEASE);
+    r->tail = pos + 1;
+    return true;
+}
+
+// approximate fill level (consumer side, for stats)
+static inline uint32_t midi_ring_depth(const midi_ring_t *r)
+{
+    return __atomic_load_n(&r->head, __ATOMIC_RELAXED) - r->tail;
+}
@@ -28,6 +28,7 @@
 #include "footswitch.h"
 #include "expfs.h"
 #include "rgb_store.h"
+#include "lat_stats.h"
 
 static const char *TAG = "PORTAL";
 static httpd_handle_t s_http = NULL;
@@ -663,6 +664,49 @@ static esp_err_t h_post_expfs_cal(httpd_req_t *req)
     return ESP_OK;
 }
 
+// -------- API: STATS (press-to-wire latency) --------
+static esp_err_t h_get_stats_latency(httpd_req_t *req)
+{
+    if (!s_buf) return resp_503(req, "buffer not ready");
+
+    if (s_buf_lock) xSemaphoreTake(s_buf_lock, portMAX_DELAY);
+
+    memset(s_buf, 0, BUF_MAX + 1);
+    esp_err_t e = lat_stats_get_json(s_buf, BUF_MAX);
+
+    if (s_buf_lock) xSemaphoreGive(s_buf_lock);
+
+    if (e != ESP_OK) {
+        httpd_resp_send_err(req, HTTPD_500_INTERNAL_SERVER_ERROR, "stats read failed");
+        return ESP_FAIL;
+    }
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, s_buf);
+    return ESP_OK;
+}
+
+// POST = reset (start a fresh measurement)
+static esp_err_t h_post_stats_latency(httpd_req_t *req)
+{
+    int remain = req->content_len;
+    if (remain > 0) {
+        char dump[64];
+        while (remain > 0) {
+            int n = (remain > (int)sizeof(dump)) ? (int)sizeof(dump) : remain;
+            int r = httpd_req_recv(req, dump, n);
+            if (r <= 0) break;
+            remain -= r;
+        }
+    }
+
+    lat_stats_reset();
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, "{\"ok\":true}");
+    return ESP_OK;
+}
+
 // -------- API: LAYOUT (banks) --------
 static esp_err_t h_get_layout(httpd_req_t *req)
 {
@@ -1025,6 +1069,9 @@ static void start_http_server(void)
     httpd_uri_t u_expfs_p = { .uri="/api/expfs", .method=HTTP_POST, .handler=h_post_expfs };
     httpd_uri_t u_expfs_cal = { .uri="/api/expfs_cal", .method=HTTP_POST, .handler=h_post_expfs_cal };
 
+    httpd_uri_t u_lat_g = { .uri="/api/stats/latency", .method=HTTP_GET,  .handler=h_get_stats_latency };
+    httpd_uri_t u_lat_p = { .uri="/api/stats/latency", .method=HTTP_POST, .handler=h_post_stats_latency };
+
     reg_uri(s_http, &u_root,  "root");
     reg_uri(s_http, &u_js,    "js");
     reg_uri(s_http, &u_css,   "css");
@@ -1063,6 +1110,9 @@ static void start_http_server(void)
     reg_uri(s_http, &u_expfs_p, "expfs_post");
     reg_uri(s_http, &u_expfs_cal, "expfs_cal");
 
+    reg_uri(s_http, &u_lat_g, "latency_get");
+    reg_uri(s_http, &u_lat_p, "latency_post");
+
     ESP_LOGI(TAG, "HTTP server started");
 }
 
@@ -41,15 +41,22 @@ static esp_err_t nvs_load_blob(void)
     return err;
 }
 
+// write-behind (config_store save task): setters only mark CFG_ST_RGB dirty.
+// the web task may change pixels meanwhile -> write a copy
 static esp_err_t nvs_save_blob(void)
 {
+    uint32_t copy[RGB_LED_STRIP_LED_COUNT];
+    memcpy(copy, s_rgb_px, sizeof(copy));
+
     nvs_handle_t h;
     esp_err_t err = nvs_open(RGB_NVS_NAMESPACE, NVS_READWRITE, &h);
     if (err != ESP_OK) return err;
 
-    err = nvs_set_blob(h, RGB_NVS_KEY_BLOB, s_rgb_px, sizeof(s_rgb_px));
+    err = nvs_set_blob(h, RGB_NVS_KEY_BLOB, copy, sizeof(copy));
     if (err == ESP_OK) err = nvs_commit(h);
     nvs_close(h);
+
+    if (err != ESP_OK) ESP_LOGE(TAG, "failed to save per-pixel colors: %s", esp_err_to_name(err));
     return err;
 }
 
@@ -63,6 +70,7 @@ esp_err_t rgb_store_init(void)
     }
 
     set_default_colors();
+    config_store_setting_register(CFG_ST_RGB, nvs_save_blob);
 
     esp_err_t l = nvs_load_blob();
     if (l == ESP_OK) {
@@ -98,15 +106,10 @@ esp_err_t rgb_store_set_pixel_hex(int idx, uint32_t hex_rgb)
     if (idx < 0 || idx >= RGB_LED_STRIP_LED_COUNT) return ESP_ERR_INVALID_ARG;
 
     s_rgb_px[idx] = hex_rgb & 0xFFFFFFu;
-
-    esp_err_t err = nvs_save_blob();
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "failed to save per-pixel colors: %s", esp_err_to_name(err));
-        // still apply in RAM
-    }
+    config_store_setting_dirty(CFG_ST_RGB);
 
     rgb_store_apply();
-    return err;
+    return ESP_OK;
 }
 
 esp_err_t rgb_store_set_all_hex(const uint32_t *hex_rgb, int n)
@@ -115,14 +118,10 @@ esp_err_t rgb_store_set_all_hex(const uint32_t *hex_rgb, int n)
     if (n > RGB_LED_STRIP_LED_COUNT) n = RGB_LED_STRIP_LED_COUNT;
 
     for (int i = 0; i < n; i++) s_rgb_px[i] = hex_rgb[i] & 0xFFFFFFu;
-
-    esp_err_t err = nvs_save_blob();
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "failed to save per-pixel colors: %s", esp_err_to_name(err));
-    }
+    config_store_setting_dirty(CFG_ST_RGB);
 
     rgb_store_apply();
-    return err;
+    return ESP_OK;
 }
 
 uint32_t rgb_store_get_hex(void)
@@ -134,12 +133,8 @@ esp_err_t rgb_store_set_hex(uint32_t hex_rgb)
 {
     uint32_t v = hex_rgb & 0xFFFFFFu;
     for (int i = 0; i < RGB_LED_STRIP_LED_COUNT; i++) s_rgb_px[i] = v;
-
-    esp_err_t err = nvs_save_blob();
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "failed to save per-pixel colors: %s", esp_err_to_name(err));
-    }
+    config_store_setting_dirty(CFG_ST_RGB);
 
     rgb_store_apply();
-    return err;
+    return ESP_OK;
 }
@@ -5,6 +5,7 @@
 #include "esp_err.h"
 
 // Stores per-pixel RGB colors (0xRRGGBB) in NVS and applies them via rgb_led.
+// Setters apply at once; the NVS write is deferred (config_store write-behind settings).
 // Note: ON/OFF state is controlled by your program (footswitch / logic). This module only stores COLORS.
 
 esp_err_t rgb_store_init(void);
@@ -19,7 +20,7 @@ int rgb_store_count(void);
 // Get color for one pixel (0xRRGGBB)
 uint32_t rgb_store_get_pixel_hex(int idx);
 
-// Set color for one pixel, save to NVS, and apply.
+// Set color for one pixel, apply, and schedule the NVS save.
 esp_err_t rgb_store_set_pixel_hex(int idx, uint32_t hex_rgb);
 
 // Set all pixel colors (array length n). Saves and applies.
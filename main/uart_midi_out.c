@@ -3,8 +3,10 @@
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "driver/uart.h"
 #include "driver/gpio.h"
 
@@ -23,7 +25,28 @@ static const char *TAG = "UART_MIDI";
 #define UART_MIDI_RTS_GPIO  (-1)
 #define UART_MIDI_CTS_GPIO  (-1)
 
+// ---- tx path ----
+// driver TX ring buffer: uart_write_bytes() แค่ copy แล้ว return (ISR ป้อน FIFO เอง)
+#define UART_MIDI_TX_BUF        512
+
+// running status: ข้าม status byte ถ้าซ้ำกับข้อความก่อนหน้า (CC sweep: 3 -> 2 bytes)
+// ส่ง status เต็มอีกครั้งถ้าเงียบนานกว่านี้ (เผื่อเพิ่งเสียบสาย / receiver หลุด)
+#define UART_MIDI_RS_REFRESH_MS 300
+
+// rate governor: ไม่ให้คิวบนสายยาวเกินนี้ (31250 baud = 320us/byte)
+// เกิน -> ESP_ERR_TIMEOUT (ไม่ block ผู้เรียก, คิวไม่โตไม่จำกัด)
+// midi_out: รอ uart_midi_out_wait_us() แล้วส่งข้อความเดิมใหม่
+#define UART_MIDI_GOVERNOR      1
+#define UART_MIDI_MAX_BACKLOG_MS 40
+#define UART_MIDI_US_PER_BYTE   (10u * 1000000u / UART_MIDI_BAUD)
+
 static int s_inited = 0;
+static SemaphoreHandle_t s_tx_lock = NULL;
+
+static uint8_t s_rs = 0;               // running status (0 = none)
+static int64_t s_rs_us = 0;            // last time status byte was sent
+static int64_t s_wire_free_us = 0;     // estimated time the TX backlog is empty
+static uart_midi_stats_t s_stats;
 
 static inline uint8_t clamp7(int v)  { if (v < 0) return 0; if (v > 127) return 127; return (uint8_t)v; }
 static inline uint8_t clampCh(int v) { if (v < 1) return 1; if (v > 16) return 16; return (uint8_t)v; }
@@ -60,9 +83,15 @@ void uart_midi_out_init(void)
         return;
     }
 
+    s_tx_lock = xSemaphoreCreateMutex();
+    if (!s_tx_lock) {
+        ESP_LOGE(TAG, "tx lock alloc failed");
+        return;
+    }
+
     // ✅ แม้จะ TX อย่างเดียว ก็ใส่ RX buffer > 0 กัน ESP_ERR_INVALID_ARG
-    // TX buffer = 0 => uart_write_bytes จะส่งแบบ blocking ได้
-    e = uart_driver_install(UART_MIDI_PORT, 256, 0, 0, NULL, 0);
+    // TX buffer > 0 => uart_write_bytes ไม่ block (รอเฉพาะตอน buffer เต็ม)
+    e = uart_driver_install(UART_MIDI_PORT, 256, UART_MIDI_TX_BUF, 0, NULL, 0);
     if (e != ESP_OK && e != ESP_ERR_INVALID_STATE) {
         ESP_LOGE(TAG, "uart_driver_install failed: %s", esp_err_to_name(e));
         return;
@@ -78,19 +107,76 @@ int uart_midi_out_ready_fast(void)
     return s_inited;
 }
 
+// one complete message (status first, or a single realtime byte)
 static esp_err_t uart_midi_send_bytes(const uint8_t *b, int n)
 {
     if (!s_inited) return ESP_ERR_INVALID_STATE;
     if (!b || n <= 0) return ESP_ERR_INVALID_ARG;
 
-    int w = uart_write_bytes(UART_MIDI_PORT, (const char *)b, n);
-    if (w != n) return ESP_FAIL;
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
 
-    // ไม่จำเป็นต้องรอ TX done ก็ได้ แต่ใส่ไว้ให้ชัวร์
-    (void)uart_wait_tx_done(UART_MIDI_PORT, pdMS_TO_TICKS(20));
+    const int64_t now = esp_timer_get_time();
+    const uint8_t st = b[0];
+    int skip = 0;
+
+    if (st >= 0x80 && st <= 0xEF) {
+        // channel voice: running status
+        if (st == s_rs && (now - s_rs_us) < (int64_t)UART_MIDI_RS_REFRESH_MS * 1000) skip = 1;
+    } else if (st >= 0xF0 && st <= 0xF7) {
+        s_rs = 0;   // system common cancels running status
+    }
+    // realtime (F8..FF) may interleave without touching running status
+
+    int out_n = n - skip;
+
+#if UART_MIDI_GOVERNOR
+    if (s_wire_free_us < now) s_wire_free_us = now;
+    if (s_wire_free_us - now > (int64_t)UART_MIDI_MAX_BACKLOG_MS * 1000) {
+        s_stats.governor_refusals++;
+        xSemaphoreGive(s_tx_lock);
+        return ESP_ERR_TIMEOUT;
+    }
+#endif
+
+    int w = uart_write_bytes(UART_MIDI_PORT, (const char *)(b + skip), (size_t)out_n);
+    if (w != out_n) {
+        s_rs = 0;   // unknown what reached the wire -> send full status next time
+        xSemaphoreGive(s_tx_lock);
+        return ESP_FAIL;
+    }
+
+    s_wire_free_us += (int64_t)out_n * UART_MIDI_US_PER_BYTE;
+    s_stats.bytes += (uint32_t)out_n;
+    s_stats.rs_saved += (uint32_t)skip;
+
+    if (st >= 0x80 && st <= 0xEF && !skip) {
+        s_rs = st;
+        s_rs_us = now;
+    }
+
+    xSemaphoreGive(s_tx_lock);
     return ESP_OK;
 }
 
+void uart_midi_out_get_stats(uart_midi_stats_t *out)
+{
+    if (out) *out = s_stats;
+}
+
+uint32_t uart_midi_out_wait_us(void)
+{
+#if UART_MIDI_GOVERNOR
+    if (!s_inited) return 0;
+
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    int64_t over = s_wire_free_us - esp_timer_get_time() - (int64_t)UART_MIDI_MAX_BACKLOG_MS * 1000;
+    xSemaphoreGive(s_tx_lock);
+    return (over > 0) ? (uint32_t)over : 0;
+#else
+    return 0;
+#endif
+}
+
 esp_err_t uart_midi_send_cc(uint8_t ch_1_16, uint8_t cc, uint8_t val)
 {
     ch_1_16 = clampCh(ch_1_16);
@@ -139,3 +225,8 @@ esp_err_t uart_midi_send_rt(uint8_t rt_byte)
     uint8_t b = rt_byte;
     return uart_midi_send_bytes(&b, 1);
 }
+
+esp_err_t uart_midi_send_raw(const uint8_t *b, int n)
+{
+    return uart_midi_send_bytes(b, n);
+}
@@ -9,9 +9,24 @@ void uart_midi_out_init(void);
 // quick ready check
 int uart_midi_out_ready_fast(void);
 
+// tx path: buffered (driver ring), running status, rate governor
+typedef struct {
+    uint32_t bytes;               // bytes written to the wire
+    uint32_t rs_saved;            // status bytes skipped by running status
+    uint32_t governor_refusals;   // messages refused (ESP_ERR_TIMEOUT, caller retries): wire backlog over limit
+} uart_midi_stats_t;
+
+void uart_midi_out_get_stats(uart_midi_stats_t *out);
+
+// time until the governor takes the next message (0 = now)
+uint32_t uart_midi_out_wait_us(void);
+
 // sending helpers
 esp_err_t uart_midi_send_cc(uint8_t ch_1_16, uint8_t cc, uint8_t val);
 esp_err_t uart_midi_send_pc(uint8_t ch_1_16, uint8_t pc);
 esp_err_t uart_midi_send_note_on(uint8_t ch_1_16, uint8_t note, uint8_t vel);
 esp_err_t uart_midi_send_note_off(uint8_t ch_1_16, uint8_t note, uint8_t vel);
 esp_err_t uart_midi_send_rt(uint8_t rt_byte);
+
+// prebuilt message bytes (compiled programs, already clamped)
+esp_err_t uart_midi_send_raw(const uint8_t *b, int n);
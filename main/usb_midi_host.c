@@ -1,10 +1,12 @@
 ﻿// ===== FILE: main/usb_midi_host.c =====
 #include <string.h>
+#include <stdint.h>
 #include <stdbool.h>
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/queue.h"
 
 #include "esp_log.h"
 #include "esp_err.h"
@@ -13,11 +15,19 @@
 #include "usb/usb_types_ch9.h"
 
 #include "usb_midi_host.h"
+#include "lat_stats.h"
 
 static const char *TAG = "USB_MIDI";
 
 #define SEND_ALL_CABLES 0
 
+// ---- tx batching ----
+// event packets ถูกรวมลง transfer เดียวจนเต็ม wMaxPacketSize (16 packets ที่ full-speed 64B)
+// แล้วค่อย submit; มี transfer หลายตัวหมุนกัน -> เตรียม batch ถัดไประหว่างตัวก่อนหน้าอยู่บนบัส
+#define USB_TX_POOL     3      // in-flight transfers (triple buffer)
+#define USB_TX_BUF      64     // bytes per transfer (full-speed bulk max)
+#define USB_TX_WAIT_MS  50     // max wait for a free transfer (bounded; was 1000ms per packet)
+
 typedef struct {
     usb_host_client_handle_t client_hdl;
     usb_device_handle_t dev_hdl;
@@ -28,9 +38,15 @@ typedef struct {
 
     uint8_t midi_intf_num;
     uint8_t midi_ep_out;
+    uint16_t midi_ep_mps;         // OUT wMaxPacketSize (multiple of 4, <= USB_TX_BUF)
+
+    usb_transfer_t *xfer[USB_TX_POOL];
+    int xfer_n;
+    QueueHandle_t tx_free_q;      // idle transfers (returned by transfer_cb)
+    SemaphoreHandle_t tx_lock;    // aggregator owner
 
-    usb_transfer_t *xfer;
-    SemaphoreHandle_t tx_done_sem;
+    usb_transfer_t *agg;          // transfer being filled (NULL = none)
+    uint16_t agg_len;
 } usb_midi_host_state_t;
 
 static usb_midi_host_state_t s_usb;
@@ -50,11 +66,13 @@ typedef struct __attribute__((packed)) {
 static void transfer_cb(usb_transfer_t *transfer)
 {
     if (transfer->status == USB_TRANSFER_STATUS_COMPLETED) {
-        // ok
+        // context = earliest input edge time carried by this transfer (lat_stats)
+        lat_since(LAT_WIRE_USB, (uint32_t)(uintptr_t)transfer->context);
     } else {
         ESP_LOGW(TAG, "TX status=%d", (int)transfer->status);
     }
-    if (s_usb.tx_done_sem) xSemaphoreGive(s_usb.tx_done_sem);
+    transfer->context = NULL;
+    if (s_usb.tx_free_q) (void)xQueueSend(s_usb.tx_free_q, &transfer, 0);
 }
 
 // -------------------- USB client event callback --------------------
@@ -70,7 +88,7 @@ static void client_event_cb(const usb_host_client_event_msg_t *event_msg, void *
 }
 
 // -------------------- Find MIDI streaming interface + OUT endpoint --------------------
-static bool find_midi_out_ep(const usb_config_desc_t *cfg, uint8_t *out_intf, uint8_t *out_ep)
+static bool find_midi_out_ep(const usb_config_desc_t *cfg, uint8_t *out_intf, uint8_t *out_ep, uint16_t *out_mps)
 {
     const uint8_t *p = (const uint8_t *)cfg;
     const uint8_t *end = p + cfg->wTotalLength;
@@ -79,6 +97,7 @@ static bool find_midi_out_ep(const usb_config_desc_t *cfg, uint8_t *out_intf, ui
 
     uint8_t found_intf = 0;
     uint8_t found_ep   = 0;
+    uint16_t found_mps = 0;
     bool found_bulk = false;
 
     while (p + sizeof(usb_desc_header_t) <= end) {
@@ -107,12 +126,14 @@ static bool find_midi_out_ep(const usb_config_desc_t *cfg, uint8_t *out_intf, ui
                 if (is_bulk) {
                     *out_intf = cur_intf->bInterfaceNumber;
                     *out_ep   = ep->bEndpointAddress;
+                    *out_mps  = (uint16_t)(ep->wMaxPacketSize & 0x7FF);
                     return true;
                 }
                 if (!found_bulk) {
                     found_bulk = false;
                     found_intf = cur_intf->bInterfaceNumber;
                     found_ep   = ep->bEndpointAddress;
+                    found_mps  = (uint16_t)(ep->wMaxPacketSize & 0x7FF);
                 }
             }
         }
@@ -122,6 +143,7 @@ static bool find_midi_out_ep(const usb_config_desc_t *cfg, uint8_t *out_intf, ui
     if (found_ep) {
         *out_intf = found_intf;
         *out_ep   = found_ep;
+        *out_mps  = found_mps;
         return true;
     }
     return false;
@@ -164,7 +186,6 @@ static void midi_close_device(void)
         s_usb.claimed = false;
         s_usb.midi_ep_out = 0;
         s_usb.midi_intf_num = 0;
-        if (s_usb.tx_done_sem) xSemaphoreGive(s_usb.tx_done_sem);
         return;
     }
 
@@ -185,12 +206,19 @@ static void midi_close_device(void)
     s_usb.midi_ep_out = 0;
     s_usb.midi_intf_num = 0;
 
-    if (s_usb.xfer) {
-        s_usb.xfer->device_handle = NULL;
-        s_usb.xfer->bEndpointAddress = 0;
+    for (int k = 0; k < s_usb.xfer_n; k++) {
+        s_usb.xfer[k]->device_handle = NULL;
+        s_usb.xfer[k]->bEndpointAddress = 0;
     }
 
-    if (s_usb.tx_done_sem) xSemaphoreGive(s_usb.tx_done_sem);
+    // batch ที่ยังไม่ส่ง -> ทิ้ง, คืน transfer เข้า pool
+    if (s_usb.tx_lock) xSemaphoreTake(s_usb.tx_lock, portMAX_DELAY);
+    if (s_usb.agg) {
+        (void)xQueueSend(s_usb.tx_free_q, &s_usb.agg, 0);
+        s_usb.agg = NULL;
+        s_usb.agg_len = 0;
+    }
+    if (s_usb.tx_lock) xSemaphoreGive(s_usb.tx_lock);
 }
 
 static esp_err_t ensure_midi_ready(void)
@@ -206,7 +234,8 @@ static esp_err_t ensure_midi_ready(void)
         if (e != ESP_OK) { midi_close_device(); return e; }
 
         uint8_t intf = 0, ep_out = 0;
-        if (!find_midi_out_ep(cfg_desc, &intf, &ep_out)) {
+        uint16_t mps = 0;
+        if (!find_midi_out_ep(cfg_desc, &intf, &ep_out, &mps)) {
             ESP_LOGE(TAG, "No MIDI OUT endpoint found");
             midi_close_device();
             return ESP_FAIL;
@@ -215,19 +244,33 @@ static esp_err_t ensure_midi_ready(void)
         s_usb.midi_intf_num = intf;
         s_usb.midi_ep_out = ep_out;
 
+        // batch size: whole event packets that fit one max-size packet
+        if (mps > USB_TX_BUF) mps = USB_TX_BUF;
+        mps &= (uint16_t)~3u;
+        s_usb.midi_ep_mps = (mps >= 4) ? mps : 4;
+
         e = usb_host_interface_claim(s_usb.client_hdl, s_usb.dev_hdl, s_usb.midi_intf_num, 0);
         if (e != ESP_OK) { midi_close_device(); return e; }
         s_usb.claimed = true;
 
-        if (s_usb.xfer == NULL) {
-            e = usb_host_transfer_alloc(64, 0, &s_usb.xfer);
-            if (e != ESP_OK) { midi_close_device(); return e; }
-            s_usb.xfer->callback = transfer_cb;
-            s_usb.xfer->context = NULL;
+        while (s_usb.xfer_n < USB_TX_POOL) {
+            usb_transfer_t *x = NULL;
+            e = usb_host_transfer_alloc(USB_TX_BUF, 0, &x);
+            if (e != ESP_OK) break;
+            x->callback = transfer_cb;
+            x->context = NULL;
+            s_usb.xfer[s_usb.xfer_n++] = x;
+            (void)xQueueSend(s_usb.tx_free_q, &x, 0);
         }
+        if (s_usb.xfer_n == 0) { midi_close_device(); return ESP_ERR_NO_MEM; }
 
-        s_usb.xfer->device_handle = s_usb.dev_hdl;
-        s_usb.xfer->bEndpointAddress = s_usb.midi_ep_out;
+        for (int k = 0; k < s_usb.xfer_n; k++) {
+            s_usb.xfer[k]->device_handle = s_usb.dev_hdl;
+            s_usb.xfer[k]->bEndpointAddress = s_usb.midi_ep_out;
+        }
+        ESP_LOGI(TAG, "MIDI OUT ep=0x%02X mps=%u (batch %u pkts, %d xfers)",
+                 s_usb.midi_ep_out, (unsigned)s_usb.midi_ep_mps,
+                 (unsigned)(s_usb.midi_ep_mps / 4), s_usb.xfer_n);
     }
 
     return ESP_OK;
@@ -238,26 +281,80 @@ int usb_midi_ready_fast(void)
     return (s_usb.have_device &&
             s_usb.dev_hdl != NULL &&
             s_usb.claimed &&
-            s_usb.xfer != NULL &&
+            s_usb.xfer_n > 0 &&
             s_usb.midi_ep_out != 0);
 }
 
-static esp_err_t submit_pkt(const uint8_t pkt4[4])
+// -------------------- tx aggregator (call with tx_lock held) --------------------
+static esp_err_t agg_submit_locked(void)
 {
-    if (ensure_midi_ready() != ESP_OK) return ESP_ERR_INVALID_STATE;
+    usb_transfer_t *x = s_usb.agg;
+    if (!x || s_usb.agg_len == 0) return ESP_OK;
 
-    if (s_usb.tx_done_sem) xSemaphoreTake(s_usb.tx_done_sem, pdMS_TO_TICKS(1000));
+    s_usb.agg = NULL;
+    x->num_bytes = s_usb.agg_len;
+    s_usb.agg_len = 0;
 
-    memcpy(s_usb.xfer->data_buffer, pkt4, 4);
-    s_usb.xfer->num_bytes = 4;
+    esp_err_t err = usb_host_transfer_submit(x);
+    if (err != ESP_OK) (void)xQueueSend(s_usb.tx_free_q, &x, 0);
+    return err;
+}
 
-    esp_err_t err = usb_host_transfer_submit(s_usb.xfer);
-    if (err != ESP_OK) {
-        if (s_usb.tx_done_sem) xSemaphoreGive(s_usb.tx_done_sem);
+static esp_err_t agg_append_locked(const uint8_t pkt4[4], uint32_t t0_us)
+{
+    if (!s_usb.agg) {
+        usb_transfer_t *x = NULL;
+        if (xQueueReceive(s_usb.tx_free_q, &x, pdMS_TO_TICKS(USB_TX_WAIT_MS)) != pdTRUE || !x) {
+            return ESP_ERR_TIMEOUT;   // all transfers still on the bus
+        }
+        x->context = NULL;
+        s_usb.agg = x;
+        s_usb.agg_len = 0;
     }
+
+    if (t0_us && !s_usb.agg->context) s_usb.agg->context = (void *)(uintptr_t)t0_us;
+    memcpy(s_usb.agg->data_buffer + s_usb.agg_len, pkt4, 4);
+    s_usb.agg_len += 4;
+
+    // เต็ม 1 packet -> ส่งเลย
+    if (s_usb.agg_len + 4 > s_usb.midi_ep_mps) return agg_submit_locked();
+    return ESP_OK;
+}
+
+esp_err_t usb_midi_queue_pkt_ts(const uint8_t pkt4[4], uint32_t t0_us)
+{
+    if (!pkt4) return ESP_ERR_INVALID_ARG;
+    if (ensure_midi_ready() != ESP_OK) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_usb.tx_lock, portMAX_DELAY);
+    esp_err_t err = agg_append_locked(pkt4, t0_us);
+    xSemaphoreGive(s_usb.tx_lock);
     return err;
 }
 
+esp_err_t usb_midi_queue_pkt(const uint8_t pkt4[4])
+{
+    return usb_midi_queue_pkt_ts(pkt4, 0);
+}
+
+esp_err_t usb_midi_flush(void)
+{
+    if (!s_usb.tx_lock) return ESP_ERR_INVALID_STATE;
+
+    xSemaphoreTake(s_usb.tx_lock, portMAX_DELAY);
+    esp_err_t err = agg_submit_locked();
+    xSemaphoreGive(s_usb.tx_lock);
+    return err;
+}
+
+// single message: append + submit now (รวมกับที่ค้างอยู่ใน batch ด้วย)
+static esp_err_t submit_pkt(const uint8_t pkt4[4])
+{
+    esp_err_t err = usb_midi_queue_pkt(pkt4);
+    if (err != ESP_OK) return err;
+    return usb_midi_flush();
+}
+
 esp_err_t usb_midi_send_cc(uint8_t ch_1_16, uint8_t cc, uint8_t val)
 {
     ch_1_16 = clamp_ch(ch_1_16);
@@ -309,6 +406,12 @@ esp_err_t usb_midi_send_note_off(uint8_t ch_1_16, uint8_t note, uint8_t vel)
     return submit_pkt(pkt);
 }
 
+esp_err_t usb_midi_send_pkt(const uint8_t pkt4[4])
+{
+    if (!pkt4) return ESP_ERR_INVALID_ARG;
+    return submit_pkt(pkt4);
+}
+
 // ✅ realtime: CIN 0x0F = single byte (system real-time เช่น F8 clock)
 esp_err_t usb_midi_send_rt(uint8_t rt_byte)
 {
@@ -374,13 +477,13 @@ static void usb_client_task(void *arg)
 
 void usb_midi_host_init(void)
 {
-    // binary semaphore for TX serialize
-    s_usb.tx_done_sem = xSemaphoreCreateBinary();
-    if (!s_usb.tx_done_sem) {
-        ESP_LOGE(TAG, "tx_done_sem alloc failed");
+    // tx pool (free transfers) + aggregator lock
+    s_usb.tx_free_q = xQueueCreate(USB_TX_POOL, sizeof(usb_transfer_t *));
+    s_usb.tx_lock = xSemaphoreCreateMutex();
+    if (!s_usb.tx_free_q || !s_usb.tx_lock) {
+        ESP_LOGE(TAG, "tx pool alloc failed");
         return;
     }
-    xSemaphoreGive(s_usb.tx_done_sem);
 
     usb_host_config_t host_cfg = {
         .intr_flags = ESP_INTR_FLAG_LEVEL1,
@@ -16,3 +16,13 @@ esp_err_t usb_midi_send_note_off(uint8_t ch_1_16, uint8_t note, uint8_t vel);
 
 // ✅ realtime (midi clock etc.)
 esp_err_t usb_midi_send_rt(uint8_t rt_byte);
+
+// prebuilt USB-MIDI event packet (compiled programs, see midi_actions.h), sent now
+esp_err_t usb_midi_send_pkt(const uint8_t pkt4[4]);
+
+// batching: queue packets into the current transfer (auto-submit when wMaxPacketSize is full),
+// then flush once at the end of a burst
+esp_err_t usb_midi_queue_pkt(const uint8_t pkt4[4]);
+// same, t0_us = input edge time (lat_stats): transfer completion is timed against it
+esp_err_t usb_midi_queue_pkt_ts(const uint8_t pkt4[4], uint32_t t0_us);
+esp_err_t usb_midi_flush(void);